@@ -4,6 +4,9 @@
 #  FFTW3_FOUND - system has FFTW3
 #  FFTW3_INCLUDE_DIR - the FFTW3 include directory
 #  FFTW3_LIBRARIES - Link these to use FFTW3
+#  FFTW3_THREADS_LIBRARIES - Link these to use the FFTW3 threaded planner, if found
+#  FFTW3F_LIBRARIES - Link these to use single precision FFTW3, if found
+#  FFTW3F_THREADS_LIBRARIES - Link these to use the single precision threaded planner, if found
 #  FFTW3_VERSION_STRING - Human readable version number of fftw3
 #  FFTW3_VERSION_MAJOR  - Major version number of fftw3
 #  FFTW3_VERSION_MINOR  - Minor version number of fftw3
@@ -30,6 +33,27 @@ else (FFTW3_LIBRARIES)
     /usr/local/lib
   )
 
+  find_library(FFTW3_THREADS_LIBRARIES NAMES fftw3_threads
+    PATHS
+    ${_obLinkDir}
+    ${GNUWIN32_DIR}/lib
+    /usr/local/lib
+  )
+
+  find_library(FFTW3F_LIBRARIES NAMES fftw3f
+    PATHS
+    ${_obLinkDir}
+    ${GNUWIN32_DIR}/lib
+    /usr/local/lib
+  )
+
+  find_library(FFTW3F_THREADS_LIBRARIES NAMES fftw3f_threads
+    PATHS
+    ${_obLinkDir}
+    ${GNUWIN32_DIR}/lib
+    /usr/local/lib
+  )
+
   if(FFTW3_LIBRARIES)
     set(FFTW3_FOUND TRUE)
   else (FFTW3_LIBRARIES)
@@ -47,6 +71,6 @@ else (FFTW3_LIBRARIES)
     endif (FFTW3_FIND_REQUIRED)
   endif (FFTW3_FOUND)
 
-  mark_as_advanced(FFTW3_LIBRARIES)
+  mark_as_advanced(FFTW3_LIBRARIES FFTW3_THREADS_LIBRARIES FFTW3F_LIBRARIES FFTW3F_THREADS_LIBRARIES)
   
 endif (FFTW3_LIBRARIES)
@@ -22,6 +22,7 @@
 
 #include <cstring>
 #include <algorithm>
+#include <fstream>
 #include <memory>
 
 #include "group.h"
@@ -42,12 +43,17 @@ std::shared_ptr<Imager> imager(new Imager());
 
 Imager::Imager()
 {
-    setVersion(1, 2);
+    setVersion(1, 3);
     groups.resize(MAX_GROUP_COUNT);
     int i = 0;
     std::generate(groups.begin(), groups.end(), [this, &i] { return std::make_shared<Group>(i++, this); });
 }
 
+Imager::~Imager()
+{
+    stopWriter();
+}
+
 bool Imager::isRunning()
 {
     return ProgressNP.getState() == IPS_BUSY;
@@ -63,6 +69,11 @@ bool Imager::isFilterConnected()
     return StatusLP[FILTER].getState() == IPS_OK;
 }
 
+bool Imager::isPipelined()
+{
+    return BatchModeSP[PIPELINED].getState() == ISS_ON;
+}
+
 std::shared_ptr<Group> Imager::getGroup(int index) const
 {
     if(index > -1 && index <= maxGroup)
@@ -105,9 +116,10 @@ void Imager::initiateNextFilter()
                 initiateNextCapture();
             }
         }
-        else if (filterSlot != 0 && FilterSlotNP[0].getValue() != filterSlot)
+        else if (filterSlot != 0 && (!filterSlotKnown || FilterSlotNP[0].getValue() != filterSlot))
         {
             FilterSlotNP[0].setValue(filterSlot);
+            filterMoving = true;
             sendNewNumber(FilterSlotNP);
             LOGF_DEBUG("Group %d of %d, image %d of %d, filer %d, filter set initiated on %s",
                        group, maxGroup, image, maxImage, (int)FilterSlotNP[0].getValue(), FilterSlotNP.getDeviceName());
@@ -132,15 +144,39 @@ void Imager::initiateNextCapture()
                 ProgressNP.apply();
                 return;
             }
-            CCDImageBinNP[HOR_BIN].setValue(currentGroup()->binning());
-            CCDImageBinNP[VER_BIN].setValue(currentGroup()->binning());
-            sendNewNumber(CCDImageBinNP);
-            CCDImageExposureNP[0].setValue(currentGroup()->exposure());
+            // The CCD is still downloading the previous image, a new exposure would abort it
+            if (isPipelined() && ccdExposureState == IPS_BUSY)
+            {
+                captureDeferred = true;
+                return;
+            }
+            captureDeferred = false;
+            // In pipelined mode, settings the CCD already has are not sent again
+            if (!isPipelined() || sentBinning != currentGroup()->binning())
+            {
+                CCDImageBinNP[HOR_BIN].setValue(currentGroup()->binning());
+                CCDImageBinNP[VER_BIN].setValue(currentGroup()->binning());
+                sendNewNumber(CCDImageBinNP);
+                sentBinning = currentGroup()->binning();
+            }
+            if (!isPipelined() || !sentUploadSettings)
+            {
+                CCDUploadSettingsTP[UPLOAD_DIR].setText(ImageNameTP[IMAGE_FOLDER].getText());
+                CCDUploadSettingsTP[UPLOAD_PREFIX].setText("_TMP_");
+                sendNewSwitch(CCDUploadSP);
+                sendNewText(CCDUploadSettingsTP);
+                sentUploadSettings = true;
+            }
+            updateOverhead();
+            captureStarted = std::chrono::steady_clock::now();
+            captureExposure = currentGroup()->exposure();
+            if (isPipelined())
+            {
+                exposures.emplace_back(group, image);
+                exposing = true;
+            }
+            CCDImageExposureNP[0].setValue(captureExposure);
             sendNewNumber(CCDImageExposureNP);
-            CCDUploadSettingsTP[UPLOAD_DIR].setText(ImageNameTP[IMAGE_FOLDER].getText());
-            CCDUploadSettingsTP[UPLOAD_PREFIX].setText("_TMP_");
-            sendNewSwitch(CCDUploadSP);
-            sendNewText(CCDUploadSettingsTP);
             LOGF_DEBUG("Group %d of %d, image %d of %d, duration %.1fs, binning %d, capture initiated on %s", group,
                        maxGroup, image, maxImage, CCDImageExposureNP[0].getValue(), (int)CCDImageBinNP[HOR_BIN].getValue(),
                        CCDImageExposureNP.getDeviceName());
@@ -154,13 +190,42 @@ void Imager::startBatch()
     ProgressNP[GROUP].setValue(group = 1);
     ProgressNP[IMAGE].setValue(image = 1);
     maxImage                   = currentGroup()->count();
+    ProgressNP[FRAME_OVERHEAD].setValue(0);
+    ProgressNP[MEAN_OVERHEAD].setValue(0);
     ProgressNP.setState(IPS_BUSY);
     ProgressNP.apply();
+    captureStarted = std::chrono::steady_clock::time_point();
+    overheadSum    = 0;
+    overheadCount  = 0;
+    sentBinning    = 0;
+    sentUploadSettings = false;
+    filterMoving   = false;
+    captureDeferred = false;
+    exposures.clear();
+    exposing       = false;
+    lastExposure   = false;
+    ++batch;
+    if (isPipelined())
+    {
+        if (batchTimerID >= 0)
+            RemoveTimer(batchTimerID);
+        batchTimerID = SetTimer(getCurrentPollingPeriod());
+    }
     initiateNextFilter();
 }
 
 void Imager::abortBatch()
 {
+    // Nothing of the aborted batch is completed later
+    captureDeferred = false;
+    exposures.clear();
+    exposing     = false;
+    lastExposure = false;
+    if (batchTimerID >= 0)
+    {
+        RemoveTimer(batchTimerID);
+        batchTimerID = -1;
+    }
     ProgressNP.setState(IPS_ALERT);
     LOG_ERROR("Batch aborted");
     ProgressNP.apply();
@@ -168,11 +233,189 @@ void Imager::abortBatch()
 
 void Imager::batchDone()
 {
+    updateOverhead();
+    captureStarted = std::chrono::steady_clock::time_point();
     ProgressNP.setState(IPS_OK);
-    LOG_INFO("Batch done");
+    LOGF_INFO("Batch done, mean overhead per image %.3fs", ProgressNP[MEAN_OVERHEAD].getValue());
     ProgressNP.apply();
 }
 
+void Imager::updateOverhead()
+{
+    if (captureStarted == std::chrono::steady_clock::time_point())
+        return;
+
+    // time spent on download, saving, filter change and the commands to the CCD
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - captureStarted;
+    double overhead = std::max(0.0, elapsed.count() - captureExposure);
+
+    overheadSum += overhead;
+    ++overheadCount;
+    ProgressNP[FRAME_OVERHEAD].setValue(overhead);
+    ProgressNP[MEAN_OVERHEAD].setValue(overheadSum / overheadCount);
+    ProgressNP.apply();
+}
+
+void Imager::exposureFinished()
+{
+    // The filter change and the next exposure are initiated while the CCD downloads the image
+    exposing = false;
+    if (nextImage())
+        initiateNextFilter();
+    else
+        lastExposure = true;
+}
+
+bool Imager::nextImage()
+{
+    if (image == maxImage)
+    {
+        if (group == maxGroup)
+            return false;
+
+        maxImage           = nextGroup()->count();
+        ProgressNP[GROUP].setValue(group = group + 1);
+        ProgressNP[IMAGE].setValue(image = 1);
+    }
+    else
+    {
+        ProgressNP[IMAGE].setValue(image = image + 1);
+    }
+    ProgressNP.apply();
+    return true;
+}
+
+void Imager::imageReceived(PendingImage &&pendingImage)
+{
+    char name[128] = {0};
+
+    pendingImage.group = group;
+    pendingImage.image = image;
+    pendingImage.batch = batch;
+    pendingImage.last  = false;
+
+    if (isPipelined())
+    {
+        // The image may arrive before the CCD reports the end of the exposure
+        if (exposing)
+            exposureFinished();
+        if (exposures.empty())
+        {
+            LOG_WARN("Image received without a pending exposure, ignored");
+            return;
+        }
+        pendingImage.group = exposures.front().first;
+        pendingImage.image = exposures.front().second;
+        exposures.pop_front();
+        pendingImage.last = lastExposure && exposures.empty();
+    }
+
+    sprintf(name, IMAGE_NAME, ImageNameTP[IMAGE_FOLDER].getText(), ImageNameTP[IMAGE_NAME_PREFIX].getText(),
+            pendingImage.group, pendingImage.image, format);
+    pendingImage.name = name;
+
+    if (!isPipelined())
+    {
+        saveImage(pendingImage);
+        if (nextImage())
+            initiateNextFilter();
+        else
+            batchDone();
+        return;
+    }
+
+    // The image is saved by the writer while the CCD integrates the next one.
+    // The batch is done when the writer saves the last image.
+    startWriter();
+    std::lock_guard<std::mutex> lock(writerMutex);
+    writerQueue.push_back(std::move(pendingImage));
+    writerChanged.notify_all();
+}
+
+void Imager::saveImage(const PendingImage &pendingImage)
+{
+    const char *name = pendingImage.name.c_str();
+    bool saved;
+
+    if (pendingImage.source.empty())
+    {
+        std::ofstream file;
+        file.open(name, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(pendingImage.data.data(), pendingImage.data.size());
+        file.close();
+        saved = !file.fail();
+    }
+    else
+    {
+        saved = rename(pendingImage.source.c_str(), name) == 0;
+    }
+
+    if (saved)
+        LOGF_DEBUG("Group %d, image %d, saved to %s", pendingImage.group, pendingImage.image, name);
+    else
+        LOGF_ERROR("Group %d, image %d, failed to save %s", pendingImage.group, pendingImage.image, name);
+}
+
+void Imager::startWriter()
+{
+    if (writer.joinable())
+        return;
+
+    writerAboutToQuit = false;
+    writer = std::thread(&Imager::writerThread, this);
+}
+
+void Imager::stopWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        writerAboutToQuit = true;
+        writerChanged.notify_all();
+    }
+
+    if (writer.joinable())
+        writer.join();
+}
+
+void Imager::waitForWriter()
+{
+    std::unique_lock<std::mutex> lock(writerMutex);
+    writerChanged.wait(lock, [this]()
+    {
+        return writerQueue.empty() && !writerBusy;
+    });
+}
+
+void Imager::writerThread()
+{
+    std::unique_lock<std::mutex> lock(writerMutex);
+    for (;;)
+    {
+        writerChanged.wait(lock, [this]()
+        {
+            return writerAboutToQuit || !writerQueue.empty();
+        });
+
+        // pending images are saved before the writer quits
+        if (writerQueue.empty())
+            break;
+
+        PendingImage pendingImage = std::move(writerQueue.front());
+        writerQueue.pop_front();
+        writerBusy = true;
+
+        // Only the file is written here, the batch is completed on the main thread
+        lock.unlock();
+        saveImage(pendingImage);
+        lock.lock();
+
+        if (pendingImage.last)
+            writerBatchDone = pendingImage.batch;
+        writerBusy = false;
+        writerChanged.notify_all();
+    }
+}
+
 void Imager::initiateDownload()
 {
     int group = (int)DownloadNP[GROUP].getValue();
@@ -183,6 +426,9 @@ void Imager::initiateDownload()
     if (group == 0 || image == 0)
         return;
 
+    // the image may still be queued for saving
+    waitForWriter();
+
     sprintf(name, IMAGE_NAME, ImageNameTP[IMAGE_FOLDER].getText(), ImageNameTP[IMAGE_NAME_PREFIX].getText(), group, image, format);
     file.open(name, std::ios::in | std::ios::binary | std::ios::ate);
     DownloadNP[GROUP].setValue(0);
@@ -250,6 +496,8 @@ bool Imager::initProperties()
     ProgressNP[GROUP].fill("GROUP", "Current group", "%3.0f", 1, MAX_GROUP_COUNT, 1, 0);
     ProgressNP[IMAGE].fill("IMAGE", "Current image", "%3.0f", 1, 100, 1, 0);
     ProgressNP[REMAINING_TIME].fill("REMAINING_TIME", "Remaining time", "%5.2f", 0, 36000, 0, 0.0);
+    ProgressNP[FRAME_OVERHEAD].fill("FRAME_OVERHEAD", "Last image overhead (s)", "%5.3f", 0, 3600, 0, 0.0);
+    ProgressNP[MEAN_OVERHEAD].fill("MEAN_OVERHEAD", "Mean image overhead (s)", "%5.3f", 0, 3600, 0, 0.0);
     ProgressNP.fill(getDefaultName(), "PROGRESS", "Batch execution progress", MAIN_CONTROL_TAB,
                     IP_RO, 60, IPS_IDLE);
 
@@ -258,6 +506,11 @@ bool Imager::initProperties()
     BatchSP.fill(getDefaultName(), "BATCH", "Batch control", MAIN_CONTROL_TAB, IP_RW, ISR_NOFMANY,
                  60, IPS_IDLE);
 
+    BatchModeSP[SEQUENTIAL].fill("SEQUENTIAL", "Sequential", ISS_ON);
+    BatchModeSP[PIPELINED].fill("PIPELINED", "Pipelined", ISS_OFF);
+    BatchModeSP.fill(getDefaultName(), "BATCH_MODE", "Batch mode", OPTIONS_TAB, IP_RW, ISR_1OFMANY,
+                     60, IPS_IDLE);
+
     ImageNameTP[IMAGE_FOLDER].fill("IMAGE_FOLDER", "Image folder", "/tmp");
     ImageNameTP[IMAGE_NAME_PREFIX].fill("IMAGE_NAME_PREFIX", "Image prefix", "IMG");
     ImageNameTP.fill(getDefaultName(), "IMAGE_NAME", "Image name", OPTIONS_TAB, IP_RW, 60,
@@ -274,6 +527,7 @@ bool Imager::initProperties()
     defineProperty(GroupCountNP);
     defineProperty(ControlledDeviceTP);
     defineProperty(ImageNameTP);
+    defineProperty(BatchModeSP);
 
     for (int i = 0; i < GroupCountNP[0].getValue(); i++)
     {
@@ -401,6 +655,20 @@ bool Imager::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
             BatchSP.apply();
             return true;
         }
+        if (BatchModeSP.isNameMatch(name))
+        {
+            if (isRunning())
+            {
+                BatchModeSP.setState(IPS_ALERT);
+                LOG_WARN("Batch mode cannot be changed while the batch is running");
+                BatchModeSP.apply();
+                return true;
+            }
+            BatchModeSP.update(states, names, n);
+            BatchModeSP.setState(IPS_OK);
+            BatchModeSP.apply();
+            return true;
+        }
     }
     return DefaultDevice::ISNewSwitch(dev, name, states, names, n);
 }
@@ -458,10 +726,29 @@ bool Imager::Disconnect()
 {
     if (isRunning())
         abortBatch();
+    stopWriter();
     disconnectServer();
     return true;
 }
 
+void Imager::TimerHit()
+{
+    batchTimerID = -1;
+    if (!isRunning())
+        return;
+
+    bool done;
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        done = writerBatchDone == batch;
+    }
+
+    if (done)
+        batchDone();
+    else
+        batchTimerID = SetTimer(getCurrentPollingPeriod());
+}
+
 // BaseClient ----------------------------------------------------------------------------
 
 void Imager::serverConnected()
@@ -518,6 +805,13 @@ void Imager::newProperty(INDI::Property property)
         }
         StatusLP.apply();
     }
+
+    if (deviceName == controlledFilterWheel && property.isNameMatch("FILTER_SLOT"))
+    {
+        INDI::PropertyNumber propertyNumber{property};
+        FilterSlotNP[0].setValue(propertyNumber[0].getValue());
+        filterSlotKnown = property.getState() == IPS_OK || property.getState() == IPS_IDLE;
+    }
 }
 
 void Imager::updateProperty(INDI::Property property)
@@ -530,37 +824,13 @@ void Imager::updateProperty(INDI::Property property)
         {
             if (ProgressNP.getState() == IPS_BUSY)
             {
-                char name[128] = {0};
-                std::ofstream file;
+                PendingImage pendingImage;
 
                 strncpy(format, bp.getFormat(), 16);
-                sprintf(name, IMAGE_NAME, ImageNameTP[IMAGE_FOLDER].getText(), ImageNameTP[IMAGE_NAME_PREFIX].getText(), group, image, format);
-                file.open(name, std::ios::out | std::ios::binary | std::ios::trunc);
-                file.write(static_cast<char *>(bp.getBlob()), bp.getBlobLen());
-                file.close();
-                LOGF_DEBUG("Group %d of %d, image %d of %d, saved to %s", group, maxGroup, image, maxImage,
-                           name);
-                if (image == maxImage)
-                {
-                    if (group == maxGroup)
-                    {
-                        batchDone();
-                    }
-                    else
-                    {
-                        maxImage           = nextGroup()->count();
-                        ProgressNP[GROUP].setValue(group = group + 1);
-                        ProgressNP[IMAGE].setValue(image = 1);
-                        ProgressNP.apply();
-                        initiateNextFilter();
-                    }
-                }
-                else
-                {
-                    ProgressNP[IMAGE].setValue(image = image + 1);
-                    ProgressNP.apply();
-                    initiateNextFilter();
-                }
+                // the BLOB buffer is reused by the client for the next image
+                const char *blob = static_cast<const char *>(bp.getBlob());
+                pendingImage.data.assign(blob, blob + bp.getBlobLen());
+                imageReceived(std::move(pendingImage));
             }
         }
         return;
@@ -589,6 +859,20 @@ void Imager::updateProperty(INDI::Property property)
         INDI::PropertyNumber propertyNumber{property};
         ProgressNP[REMAINING_TIME].setValue(propertyNumber[0].getValue());
         ProgressNP.apply();
+        ccdExposureState = property.getState();
+        if (ccdExposureState == IPS_ALERT && (exposing || captureDeferred))
+        {
+            exposing = false;
+            captureDeferred = false;
+            ProgressNP.setState(IPS_ALERT);
+            LOG_ERROR("Exposure failed");
+            ProgressNP.apply();
+            return;
+        }
+        if (exposing && (ccdExposureState != IPS_BUSY || propertyNumber[0].getValue() <= 0))
+            exposureFinished();
+        if (captureDeferred && ccdExposureState != IPS_BUSY)
+            initiateNextCapture();
         return;
     }
 
@@ -596,42 +880,31 @@ void Imager::updateProperty(INDI::Property property)
     {
         INDI::PropertyNumber propertyNumber{property};
         FilterSlotNP[0].setValue(propertyNumber[0].getValue());
-        if (property.getState() == IPS_OK)
+        filterSlotKnown = property.getState() == IPS_OK;
+        // only continue with filter changes initiated by the batch
+        if (property.getState() == IPS_OK && filterMoving)
+        {
+            filterMoving = false;
             initiateNextCapture();
+        }
+        else if (property.getState() == IPS_ALERT && filterMoving)
+        {
+            filterMoving = false;
+            ProgressNP.setState(IPS_ALERT);
+            LOG_ERROR("Filter change failed");
+            ProgressNP.apply();
+        }
         return;
     }
 
     if (deviceName == controlledCCD && property.isNameMatch("CCD_FILE_PATH"))
     {
         INDI::PropertyText propertyText(property);
-        char name[128] = {0};
+        PendingImage pendingImage;
 
         strncpy(format, strrchr(propertyText[0].getText(), '.'), sizeof(format));
-        sprintf(name, IMAGE_NAME, ImageNameTP[IMAGE_FOLDER].getText(), ImageNameTP[IMAGE_NAME_PREFIX].getText(), group, image, format);
-        rename(propertyText[0].getText(), name);
-        LOGF_DEBUG("Group %d of %d, image %d of %d, saved to %s", group, maxGroup, image,
-                   maxImage, name);
-        if (image == maxImage)
-        {
-            if (group == maxGroup)
-            {
-                batchDone();
-            }
-            else
-            {
-                maxImage           = nextGroup()->count();
-                ProgressNP[GROUP].setValue(group = group + 1);
-                ProgressNP[IMAGE].setValue(image = 1);
-                ProgressNP.apply();
-                initiateNextFilter();
-            }
-        }
-        else
-        {
-            ProgressNP[IMAGE].setValue(image = image + 1);
-            ProgressNP.apply();
-            initiateNextFilter();
-        }
+        pendingImage.source = propertyText[0].getText();
+        imageReceived(std::move(pendingImage));
         return;
     }
 }
@@ -21,6 +21,16 @@
 
 #include "baseclient.h"
 #include "defaultdevice.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #define MAX_GROUP_COUNT 16
 
 class Group;
@@ -29,7 +39,7 @@ class Imager : public virtual INDI::DefaultDevice, public virtual INDI::BaseClie
 public:
     static const std::string DEVICE_NAME;
     Imager();
-    virtual ~Imager() = default;
+    virtual ~Imager();
 
     // DefaultDevice
 
@@ -56,6 +66,7 @@ protected:
     virtual const char *getDefaultName() override;
     virtual bool Connect() override;
     virtual bool Disconnect() override;
+    virtual void TimerHit() override;
 
 private:
     bool isRunning();
@@ -68,8 +79,31 @@ private:
     void startBatch();
     void abortBatch();
     void batchDone();
+    void exposureFinished();
     void initiateDownload();
 
+    // Captured image waiting to be saved to the image folder
+    struct PendingImage
+    {
+        std::string name;       // final image file name
+        std::string source;     // file saved by the CCD driver in local upload mode, empty for BLOBs
+        std::vector<char> data; // BLOB content
+        int group;
+        int image;
+        int batch;
+        bool last;              // the last image of the batch
+    };
+
+    bool isPipelined();
+    void imageReceived(PendingImage &&pendingImage);
+    bool nextImage();
+    void saveImage(const PendingImage &pendingImage);
+    void startWriter();
+    void stopWriter();
+    void waitForWriter();
+    void writerThread();
+    void updateOverhead();
+
     char format[16];
     int group { 0 };
     int maxGroup { 0 };
@@ -87,12 +121,14 @@ private:
 
     INDI::PropertyNumber GroupCountNP {1};
 
-    INDI::PropertyNumber ProgressNP {3};
+    INDI::PropertyNumber ProgressNP {5};
     enum
     {
         GROUP,
         IMAGE,
-        REMAINING_TIME
+        REMAINING_TIME,
+        FRAME_OVERHEAD,
+        MEAN_OVERHEAD
     };
     INDI::PropertySwitch BatchSP {2};
     enum
@@ -100,6 +136,12 @@ private:
         START,
         ABORT
     };
+    INDI::PropertySwitch BatchModeSP {2};
+    enum
+    {
+        SEQUENTIAL,
+        PIPELINED
+    };
     INDI::PropertyLight StatusLP {2};
 
     INDI::PropertyText ImageNameTP {2};
@@ -137,6 +179,38 @@ private:
 //    ITextVectorProperty CCDUploadSettingsTP;
 
     INDI::PropertyNumber FilterSlotNP {1};
+    bool filterSlotKnown { false };
+    bool filterMoving { false };
+
+    // The CCD accepts the next exposure when the previous one is complete
+    IPState ccdExposureState { IPS_IDLE };
+    bool captureDeferred { false };
+
+    // CCD settings already sent in pipelined mode
+    int sentBinning { 0 };
+    bool sentUploadSettings { false };
+
+    // Dead time between the end of an exposure and the start of the next one
+    std::chrono::steady_clock::time_point captureStarted;
+    double captureExposure { 0 };
+    double overheadSum { 0 };
+    int overheadCount { 0 };
+
+    // Background writer used in pipelined mode
+    std::thread writer;
+    std::mutex writerMutex;
+    std::condition_variable writerChanged;
+    std::deque<PendingImage> writerQueue;
+    bool writerBusy { false };
+    bool writerAboutToQuit { false };
+    int writerBatchDone { 0 }; // batch whose last image is saved, completed by TimerHit
+
+    // Exposures of the pipelined mode waiting for their images, as group and image numbers
+    std::deque<std::pair<int, int>> exposures;
+    bool exposing { false };
+    bool lastExposure { false };
+    int batch { 0 };
+    int batchTimerID { -1 };
 
     std::vector<std::shared_ptr<Group>> groups;
     std::shared_ptr<Group> currentGroup() const;
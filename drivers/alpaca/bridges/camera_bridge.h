@@ -60,6 +60,12 @@ class CameraBridge : public IDeviceBridge
                            const httplib::Request &req,
                            httplib::Response &res) override;
 
+        void setTransactionIDs(uint32_t clientTransactionID, uint32_t serverTransactionID) override
+        {
+            m_ClientTransactionID = clientTransactionID;
+            m_ServerTransactionID = serverTransactionID;
+        }
+
         void updateProperty(INDI::Property property) override;
 
         // Common Alpaca API methods
@@ -169,11 +175,17 @@ class CameraBridge : public IDeviceBridge
         void convertCoordinateSystem(std::vector<uint8_t> &imageData, int width, int height, int bytesPerPixel);
         void formatImageAsJSON(const std::vector<uint8_t> &rawData, int width, int height,
                                int bitsPerPixel, int naxis, nlohmann::json& response);
+        // Send the last image as ImageBytes if the client accepts it, returns false to use JSON
+        bool sendImageBytes(const httplib::Request &req, httplib::Response &res);
 
         // Device state
         INDI::BaseDevice m_Device;
         int m_DeviceNumber;
 
+        // Transaction IDs of the current request, written into ImageBytes metadata
+        uint32_t m_ClientTransactionID {0};
+        uint32_t m_ServerTransactionID {0};
+
         // Current state tracking - Camera Information
         int m_CameraXSize {0};
         int m_CameraYSize {0};
@@ -594,7 +594,8 @@ bool CameraBridge::extractImageFromFITS(const uint8_t* fitsData, size_t fitsSize
             datatype = TUSHORT;
             break;
         case 32:
-            datatype = TULONG;
+            // TULONG is the size of long, 64 bits on most platforms
+            datatype = TUINT;
             break;
         default:
             DEBUGFDEVICE(m_Device.getDeviceName(), INDI::Logger::DBG_ERROR, "Unsupported bits per pixel: %d", bitsPerPixel);
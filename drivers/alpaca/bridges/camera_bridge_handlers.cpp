@@ -23,6 +23,7 @@
 *******************************************************************************/
 
 #include "camera_bridge.h"
+#include "camera_image_bytes.h"
 #include "indilogger.h"
 #include <httplib.h>
 #include <chrono>
@@ -939,9 +940,11 @@ void CameraBridge::handleExposureMax(const httplib::Request &req, httplib::Respo
 // Image Data
 void CameraBridge::handleImageArray(const httplib::Request &req, httplib::Response &res)
 {
-    INDI_UNUSED(req);
     std::lock_guard<std::mutex> lock(m_Mutex);
 
+    if (sendImageBytes(req, res))
+        return;
+
     if (!m_ImageReady || m_LastImageData.empty())
     {
         sendResponseStatus(res, false, "No image available");
@@ -957,22 +960,48 @@ void CameraBridge::handleImageArray(const httplib::Request &req, httplib::Respon
 
 void CameraBridge::handleImageArrayVariant(const httplib::Request &req, httplib::Response &res)
 {
-    INDI_UNUSED(req);
     std::lock_guard<std::mutex> lock(m_Mutex);
 
+    if (sendImageBytes(req, res))
+        return;
+
     if (!m_ImageReady || m_LastImageData.empty())
     {
         sendResponseStatus(res, false, "No image available");
         return;
     }
 
-    // For now, return same as ImageArray - ImageBytes format would be implemented later
     json imageArray;
     formatImageAsJSON(m_LastImageData, m_LastImageWidth, m_LastImageHeight,
                       m_LastImageBPP, m_LastImageNAxis, imageArray);
     sendResponseValue(res, imageArray);
 }
 
+bool CameraBridge::sendImageBytes(const httplib::Request &req, httplib::Response &res)
+{
+    if (!AlpacaImageBytes::isAccepted(req.get_header_value("Accept")))
+        return false;
+
+    // The body is built in place and moved into the response, the frame is not copied otherwise
+    std::string body;
+    if (!m_ImageReady || m_LastImageData.empty())
+    {
+        // 0x40B: InvalidOperationException
+        AlpacaImageBytes::encodeError(body, 0x40B, "No image available", m_ClientTransactionID, m_ServerTransactionID);
+    }
+    else if (!AlpacaImageBytes::encode(body, m_LastImageData.data(), m_LastImageWidth, m_LastImageHeight,
+                                       m_LastImageBPP, m_LastImageNAxis, m_ClientTransactionID, m_ServerTransactionID))
+    {
+        DEBUGFDEVICE(m_Device.getDeviceName(), INDI::Logger::DBG_DEBUG,
+                     "ImageBytes not supported for %d-bit, %d-axis images, sending JSON", m_LastImageBPP, m_LastImageNAxis);
+        return false;
+    }
+
+    res.body = std::move(body);
+    res.set_header("Content-Type", AlpacaImageBytes::MimeType);
+    return true;
+}
+
 // Guiding
 void CameraBridge::handleIsPulseGuiding(const httplib::Request &req, httplib::Response &res)
 {
@@ -0,0 +1,209 @@
+/*******************************************************************************
+  Copyright(c) 2026 Jasem Mutlaq. All rights reserved.
+
+  INDI Alpaca Camera Bridge - ImageBytes Encoder
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#include "camera_image_bytes.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace AlpacaImageBytes
+{
+
+// Pixels transposed per tile, so that both the rows read and the columns written stay in cache
+static constexpr int TileSize = 64;
+
+template <typename T>
+static inline void storeLE(uint8_t *dst, T value)
+{
+    typename std::make_unsigned<T>::type bits = static_cast<typename std::make_unsigned<T>::type>(value);
+    for (size_t i = 0; i < sizeof(T); i++)
+        dst[i] = static_cast<uint8_t>(bits >> (8 * i));
+}
+
+static void writeMetadata(uint8_t *dst, int32_t errorNumber, uint32_t clientID, uint32_t serverID,
+                          int32_t transmissionType, int32_t rank, int32_t dimension1, int32_t dimension2, int32_t dimension3)
+{
+    const int32_t fields[11] =
+    {
+        1,                              // MetadataVersion
+        errorNumber,
+        static_cast<int32_t>(clientID),
+        static_cast<int32_t>(serverID),
+        static_cast<int32_t>(MetadataSize), // DataStart
+        errorNumber ? Unknown : Int32,  // ImageElementType, ImageArray is an Int32 array
+        transmissionType,
+        rank,
+        dimension1,
+        dimension2,
+        dimension3
+    };
+    for (int i = 0; i < 11; i++)
+        storeLE<int32_t>(dst + 4 * i, fields[i]);
+}
+
+// Alpaca arrays are [x][y][plane] with the last index changing fastest, the frame is [plane][y][x]
+template <typename Src, typename Dst>
+static void transpose(const Src *src, uint8_t *dst, int width, int height, int planes)
+{
+    const size_t planeSize = static_cast<size_t>(width) * height;
+    for (int y0 = 0; y0 < height; y0 += TileSize)
+    {
+        int y1 = std::min(y0 + TileSize, height);
+        for (int x0 = 0; x0 < width; x0 += TileSize)
+        {
+            int x1 = std::min(x0 + TileSize, width);
+            for (int x = x0; x < x1; x++)
+            {
+                uint8_t *column = dst + (static_cast<size_t>(x) * height + y0) * planes * sizeof(Dst);
+                for (int y = y0; y < y1; y++)
+                {
+                    const Src *pixel = src + static_cast<size_t>(y) * width + x;
+                    for (int p = 0; p < planes; p++, column += sizeof(Dst))
+                        storeLE<Dst>(column, static_cast<Dst>(pixel[p * planeSize]));
+                }
+            }
+        }
+    }
+}
+
+template <typename Src>
+static void transposeTo(ElementType type, const Src *src, uint8_t *dst, int width, int height, int planes)
+{
+    switch (type)
+    {
+        case Byte:
+            transpose<Src, uint8_t>(src, dst, width, height, planes);
+            break;
+        case UInt16:
+            transpose<Src, uint16_t>(src, dst, width, height, planes);
+            break;
+        case Int32:
+            transpose<Src, int32_t>(src, dst, width, height, planes);
+            break;
+        default:
+            transpose<Src, uint32_t>(src, dst, width, height, planes);
+            break;
+    }
+}
+
+static size_t elementSize(ElementType type)
+{
+    switch (type)
+    {
+        case Byte:
+            return 1;
+        case Int16:
+        case UInt16:
+            return 2;
+        case Double:
+        case UInt64:
+        case Int64:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+bool isAccepted(const std::string &accept)
+{
+    std::string lower(accept);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c)
+    {
+        return std::tolower(c);
+    });
+    return lower.find(MimeType) != std::string::npos;
+}
+
+ElementType transmissionType(const uint8_t *pixels, size_t count, int bitsPerPixel)
+{
+    switch (bitsPerPixel)
+    {
+        case 8:
+            return Byte;
+        case 16:
+            return UInt16;
+        case 32:
+        {
+            // 32 bit frames seldom use the whole range, most fit in 16 bits
+            const uint32_t *samples = reinterpret_cast<const uint32_t*>(pixels);
+            uint32_t maximum = 0;
+            for (size_t i = 0; i < count; i++)
+                maximum = std::max(maximum, samples[i]);
+            if (maximum <= std::numeric_limits<uint8_t>::max())
+                return Byte;
+            if (maximum <= std::numeric_limits<uint16_t>::max())
+                return UInt16;
+            if (maximum <= static_cast<uint32_t>(std::numeric_limits<int32_t>::max()))
+                return Int32;
+            return UInt32;
+        }
+        default:
+            return Unknown;
+    }
+}
+
+bool encode(std::string &body, const uint8_t *pixels, int width, int height, int bitsPerPixel, int naxis,
+            uint32_t clientID, uint32_t serverID)
+{
+    if ((naxis != 2 && naxis != 3) || width <= 0 || height <= 0)
+        return false;
+
+    // color frames hold the RGB planes one after the other
+    int planes = (naxis == 3) ? 3 : 1;
+    size_t count = static_cast<size_t>(width) * height * planes;
+    ElementType type = transmissionType(pixels, count, bitsPerPixel);
+    if (type == Unknown)
+        return false;
+
+    body.resize(MetadataSize + count * elementSize(type));
+    uint8_t *dst = reinterpret_cast<uint8_t*>(&body[0]);
+    writeMetadata(dst, 0, clientID, serverID, type, naxis, width, height, naxis == 3 ? planes : 0);
+    dst += MetadataSize;
+
+    switch (bitsPerPixel)
+    {
+        case 8:
+            transposeTo(type, pixels, dst, width, height, planes);
+            break;
+        case 16:
+            transposeTo(type, reinterpret_cast<const uint16_t*>(pixels), dst, width, height, planes);
+            break;
+        default:
+            transposeTo(type, reinterpret_cast<const uint32_t*>(pixels), dst, width, height, planes);
+            break;
+    }
+    return true;
+}
+
+void encodeError(std::string &body, int errorNumber, const std::string &message, uint32_t clientID, uint32_t serverID)
+{
+    body.resize(MetadataSize + message.size());
+    uint8_t *dst = reinterpret_cast<uint8_t*>(&body[0]);
+    writeMetadata(dst, errorNumber, clientID, serverID, Unknown, 0, 0, 0, 0);
+    std::memcpy(dst + MetadataSize, message.data(), message.size());
+}
+}
@@ -0,0 +1,72 @@
+/*******************************************************************************
+  Copyright(c) 2026 Jasem Mutlaq. All rights reserved.
+
+  INDI Alpaca Camera Bridge - ImageBytes Encoder
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Binary ImageArray responses as per ASCOM Alpaca API section 8 (ImageBytes)
+namespace AlpacaImageBytes
+{
+// ASCOM ImageArrayElementTypes
+enum ElementType
+{
+    Unknown = 0,
+    Int16   = 1,
+    Int32   = 2,
+    Double  = 3,
+    Single  = 4,
+    UInt64  = 5,
+    Byte    = 6,
+    Int64   = 7,
+    UInt16  = 8,
+    UInt32  = 9
+};
+
+constexpr const char *MimeType = "application/imagebytes";
+// Eleven little-endian 32 bit fields, the data or the error message follows
+constexpr size_t MetadataSize = 44;
+
+// True if the Accept header of the request lists the ImageBytes media type
+bool isAccepted(const std::string &accept);
+
+// Smallest element type holding the samples of the frame without loss
+ElementType transmissionType(const uint8_t *pixels, size_t count, int bitsPerPixel);
+
+/**
+ * Encode a frame as an ImageBytes response body.
+ * The frame is in raster order (x fastest, planes last), as extracted from the FITS BLOB.
+ * The body holds the metadata followed by the samples in Alpaca order (x slowest, plane fastest),
+ * little-endian, in the element type returned by transmissionType().
+ * Returns false if the bit depth or the number of axes is not supported.
+ */
+bool encode(std::string &body, const uint8_t *pixels, int width, int height, int bitsPerPixel, int naxis,
+            uint32_t clientID = 0, uint32_t serverID = 0);
+
+// Encode an error response body: the metadata followed by the UTF-8 message
+void encodeError(std::string &body, int errorNumber, const std::string &message,
+                 uint32_t clientID = 0, uint32_t serverID = 0);
+}
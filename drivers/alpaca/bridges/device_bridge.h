@@ -26,6 +26,7 @@
 
 #include "basedevice.h"
 #include "indiproperty.h"
+#include <cstdint>
 #include <string>
 #include <httplib.h>
 
@@ -45,6 +46,13 @@ class IDeviceBridge
                                    const httplib::Request &req,
                                    httplib::Response &res) = 0;
 
+        // Transaction IDs of the request about to be handled, for responses not encoded as JSON
+        virtual void setTransactionIDs(uint32_t clientTransactionID, uint32_t serverTransactionID)
+        {
+            (void)clientTransactionID;
+            (void)serverTransactionID;
+        }
+
         // Update from INDI property
         virtual void updateProperty(INDI::Property property) = 0;
 
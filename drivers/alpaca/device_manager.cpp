@@ -26,6 +26,7 @@
 #include "bridges/device_bridge.h"
 #include "bridges/telescope_bridge.h"
 #include "bridges/camera_bridge.h"
+#include "bridges/camera_image_bytes.h"
 #include "alpaca_client.h"
 #include "indilogger.h"
 
@@ -424,8 +425,13 @@ void DeviceManager::routeRequest(int deviceNumber, const std::string &deviceType
     }
 
     // Forward request to bridge
+    it->second->setTransactionIDs(clientTransactionID, serverTransactionID);
     it->second->handleRequest(method, req, res);
 
+    // ImageBytes responses are binary, the bridge already wrote the transaction IDs into their metadata
+    if (res.get_header_value("Content-Type") == AlpacaImageBytes::MimeType)
+        return;
+
     // Add transaction IDs to the response
     try
     {
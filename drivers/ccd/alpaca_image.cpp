@@ -0,0 +1,686 @@
+/*******************************************************************************
+  Copyright(c) 2026 Jasem Mutlaq. All rights reserved.
+
+  ASCOM Alpaca Camera INDI Driver - Image Ingestion
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#include "alpaca_image.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace AlpacaImage
+{
+
+// A tile covers TileRows pixels of TileColumns columns. Its columns are converted contiguously from the source,
+// then transposed in cache into the rows copied to the frame. Long column runs keep the source reads streaming.
+static constexpr uint32_t TileRows    = 512;
+static constexpr uint32_t TileColumns = 64;
+// Padding of the converted columns, so that reading across them does not hit the same cache sets
+static constexpr uint32_t ColumnPadding = 32;
+
+// Elements are not aligned in the ImageBytes payload, which starts at byte 44
+template <typename T>
+static inline T load(const uint8_t *src)
+{
+    T value;
+    std::memcpy(&value, src, sizeof(T));
+    return value;
+}
+
+// Conversions stay in the width of the element, so that the loops over the full tiles vectorize
+template <typename T>
+struct Sample;
+
+template <> struct Sample<uint8_t>
+{
+    static inline uint16_t convert(uint8_t value)
+    {
+        return static_cast<uint16_t>(value << 8);
+    }
+    typedef uint32_t Sum;
+};
+template <> struct Sample<int16_t>
+{
+    static inline uint16_t convert(int16_t value)
+    {
+        return static_cast<uint16_t>(value) ^ 0x8000;
+    }
+    typedef int32_t Sum;
+};
+template <> struct Sample<uint16_t>
+{
+    static inline uint16_t convert(uint16_t value)
+    {
+        return value;
+    }
+    typedef uint32_t Sum;
+};
+template <> struct Sample<int32_t>
+{
+    static inline uint16_t convert(int32_t value)
+    {
+        return static_cast<uint16_t>(std::min(std::max(value, 0), 65535));
+    }
+    typedef int64_t Sum;
+};
+template <> struct Sample<uint32_t>
+{
+    static inline uint16_t convert(uint32_t value)
+    {
+        return static_cast<uint16_t>(std::min(value, 65535u));
+    }
+    typedef uint64_t Sum;
+};
+template <> struct Sample<int64_t>
+{
+    static inline uint16_t convert(int64_t value)
+    {
+        return static_cast<uint16_t>(std::min<int64_t>(std::max<int64_t>(value, 0), 65535));
+    }
+    typedef int64_t Sum;
+};
+template <> struct Sample<uint64_t>
+{
+    static inline uint16_t convert(uint64_t value)
+    {
+        return static_cast<uint16_t>(std::min<uint64_t>(value, 65535));
+    }
+    typedef uint64_t Sum;
+};
+// NaN fails the comparison with 0 and ends up black
+template <> struct Sample<float>
+{
+    static inline uint16_t convert(float value)
+    {
+        return static_cast<uint16_t>(std::min(65535.0f, std::max(0.0f, value * 65535.0f)));
+    }
+    typedef double Sum;
+};
+template <> struct Sample<double>
+{
+    static inline uint16_t convert(double value)
+    {
+        return static_cast<uint16_t>(std::min(65535.0, std::max(0.0, value * 65535.0)));
+    }
+    typedef double Sum;
+};
+
+// Convert count elements of a column, averaging the planes of each pixel
+template <typename T, uint32_t Count>
+static inline void convertColumn(const uint8_t *column, uint32_t count, uint32_t planes, uint16_t *converted)
+{
+    typedef typename Sample<T>::Sum Sum;
+    // The trip count is known for the full tiles
+    if (Count)
+        count = Count;
+
+    if (planes == 1)
+    {
+        for (uint32_t j = 0; j < count; j++)
+            converted[j] = Sample<T>::convert(load<T>(column + j * sizeof(T)));
+        return;
+    }
+
+    for (uint32_t j = 0; j < count; j++, column += planes * sizeof(T))
+    {
+        Sum sum = 0;
+        for (uint32_t p = 0; p < planes; p++)
+            sum += load<T>(column + p * sizeof(T));
+        converted[j] = Sample<T>::convert(static_cast<T>(sum / static_cast<Sum>(planes)));
+    }
+}
+
+template <typename T>
+static void convertTiled(const uint8_t *src, uint32_t width, uint32_t height, uint32_t planes, bool flip, uint16_t *dst)
+{
+    const size_t stride = static_cast<size_t>(planes) * sizeof(T);
+    const size_t columnSize = TileRows + ColumnPadding;
+    // Zeroed once, the partial tiles on the edges transpose values that are not copied to the frame
+    std::vector<uint16_t> columnBuffer(TileColumns * columnSize), rowBuffer(TileRows * TileColumns);
+    uint16_t *tile = columnBuffer.data();
+    uint16_t *block = rowBuffer.data();
+
+    for (uint32_t x0 = 0; x0 < width; x0 += TileColumns)
+    {
+        const uint32_t columns = std::min(TileColumns, width - x0);
+        for (uint32_t y0 = 0; y0 < height; y0 += TileRows)
+        {
+            const uint32_t rows = std::min(TileRows, height - y0);
+
+            // Convert the columns of the tile, contiguous in the source
+            for (uint32_t i = 0; i < columns; i++)
+            {
+                const uint8_t *column = src + (static_cast<size_t>(x0 + i) * height + y0) * stride;
+                if (rows == TileRows)
+                    convertColumn<T, TileRows>(column, rows, planes, tile + i * columnSize);
+                else
+                    convertColumn<T, 0>(column, rows, planes, tile + i * columnSize);
+            }
+
+            // Transpose the tile into rows
+            for (uint32_t j = 0; j < TileRows; j++)
+                for (uint32_t i = 0; i < TileColumns; i++)
+                    block[j * TileColumns + i] = tile[i * columnSize + j];
+
+            // Copy the rows, contiguous in the frame
+            for (uint32_t j = 0; j < rows; j++)
+            {
+                const uint32_t y = flip ? height - 1 - (y0 + j) : y0 + j;
+                std::memcpy(dst + static_cast<size_t>(y) * width + x0, block + j * TileColumns, columns * sizeof(uint16_t));
+            }
+        }
+    }
+}
+
+size_t elementSize(int type)
+{
+    switch (type)
+    {
+        case Byte:
+            return 1;
+        case Int16:
+        case UInt16:
+            return 2;
+        case Int32:
+        case UInt32:
+        case Single:
+            return 4;
+        case Double:
+        case Int64:
+        case UInt64:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+bool toFrame(const uint8_t *src, int type, uint32_t width, uint32_t height, uint32_t planes, bool flip, uint16_t *dst)
+{
+    if (planes == 0)
+        planes = 1;
+
+    switch (type)
+    {
+        case Byte:
+            convertTiled<uint8_t>(src, width, height, planes, flip, dst);
+            return true;
+        case Int16:
+            convertTiled<int16_t>(src, width, height, planes, flip, dst);
+            return true;
+        case UInt16:
+            convertTiled<uint16_t>(src, width, height, planes, flip, dst);
+            return true;
+        case Int32:
+            convertTiled<int32_t>(src, width, height, planes, flip, dst);
+            return true;
+        case UInt32:
+            convertTiled<uint32_t>(src, width, height, planes, flip, dst);
+            return true;
+        case Int64:
+            convertTiled<int64_t>(src, width, height, planes, flip, dst);
+            return true;
+        case UInt64:
+            convertTiled<uint64_t>(src, width, height, planes, flip, dst);
+            return true;
+        case Single:
+            convertTiled<float>(src, width, height, planes, flip, dst);
+            return true;
+        case Double:
+            convertTiled<double>(src, width, height, planes, flip, dst);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Integers above this are parsed from the text, like the floating point numbers
+static constexpr uint64_t LargestInteger = 100000000000000000ULL;
+
+static inline int32_t clampSample(int64_t value)
+{
+    return static_cast<int32_t>(std::min<int64_t>(std::max<int64_t>(value, std::numeric_limits<int32_t>::min()),
+                                std::numeric_limits<int32_t>::max()));
+}
+
+JSONDecoder::JSONDecoder(size_t expectedSamples)
+{
+    m_Samples.reserve(expectedSamples);
+}
+
+bool JSONDecoder::fail(const std::string &error)
+{
+    if (m_Error.empty())
+        m_Error = error;
+    return false;
+}
+
+bool JSONDecoder::startValue()
+{
+    if (m_Expect != ExpectValue && m_Expect != ExpectValueOrClose)
+        return fail("unexpected value");
+    return true;
+}
+
+bool JSONDecoder::endValue()
+{
+    m_Expect = m_Stack.empty() ? ExpectEnd : ExpectNext;
+    return true;
+}
+
+bool JSONDecoder::openContainer(char type)
+{
+    if (!startValue())
+        return false;
+
+    if (m_ImageDepth)
+    {
+        // Level 1 is the array of columns, level 2 a column and level 3 the planes of a pixel
+        const size_t level = m_Stack.size() + 2 - m_ImageDepth;
+        if (type == '{' || level > 3)
+            return fail("unexpected element in the image array");
+        if (level == 2)
+            m_ColumnCount = 0;
+        else
+        {
+            if (m_Rank == 2)
+                return fail("image array mixes ranks");
+            m_Rank = 3;
+            m_PixelCount = 0;
+        }
+        m_Stack.push_back(type);
+    }
+    else
+    {
+        m_Stack.push_back(type);
+        if (type == '[' && m_Stack.size() == 2 && m_Stack[0] == '{' && m_Key == "Value")
+        {
+            if (m_HasImage)
+                return fail("more than one image array");
+            m_ImageDepth = m_Stack.size();
+        }
+    }
+
+    m_Expect = (type == '{') ? ExpectKeyOrClose : ExpectValueOrClose;
+    return true;
+}
+
+bool JSONDecoder::closeContainer(char type)
+{
+    const char open = (type == '}') ? '{' : '[';
+    if (m_Stack.empty() || m_Stack.back() != open)
+        return fail("unbalanced brackets");
+    if (m_Expect != ExpectNext && m_Expect != (type == '}' ? ExpectKeyOrClose : ExpectValueOrClose))
+        return fail("unexpected end of container");
+
+    if (m_ImageDepth)
+    {
+        const size_t level = m_Stack.size() + 1 - m_ImageDepth;
+        if (level == 3)
+        {
+            // The first pixel sets the number of planes
+            if (m_Width == 0 && m_ColumnCount == 0)
+                m_Planes = m_PixelCount;
+            else if (m_PixelCount != m_Planes)
+                return fail("pixels have different numbers of planes");
+            m_ColumnCount++;
+        }
+        else if (level == 2)
+        {
+            // The first column sets the height
+            if (m_Width == 0)
+                m_Height = m_ColumnCount;
+            else if (m_ColumnCount != m_Height)
+                return fail("columns have different heights");
+            m_Width++;
+        }
+        else
+        {
+            m_ImageDepth = 0;
+            m_HasImage = true;
+        }
+    }
+
+    m_Stack.pop_back();
+    return endValue();
+}
+
+bool JSONDecoder::onString()
+{
+    if (m_InKey)
+    {
+        m_InKey = false;
+        if (m_Stack.size() == 1)
+            m_Key = m_Text;
+        m_Expect = ExpectColon;
+        return true;
+    }
+    if (m_ImageDepth)
+        return fail("unexpected string in the image array");
+    if (m_Stack.size() == 1 && m_Key == "ErrorMessage")
+        m_ErrorMessage = m_Text;
+    return endValue();
+}
+
+bool JSONDecoder::onNumber()
+{
+    int64_t value;
+    if (!m_Float)
+    {
+        if (m_Digits == 0)
+            return fail("invalid number");
+        value = m_Negative ? -static_cast<int64_t>(m_Integer) : static_cast<int64_t>(m_Integer);
+    }
+    else
+    {
+        char *end = nullptr;
+        double number = strtod(m_Text.c_str(), &end);
+        if (end != m_Text.c_str() + m_Text.size())
+            return fail("invalid number " + m_Text);
+        value = static_cast<int64_t>(std::min(std::max(number, -2147483648.0), 2147483647.0));
+    }
+
+    if (m_ImageDepth)
+    {
+        const size_t level = m_Stack.size() + 1 - m_ImageDepth;
+        if (level == 1)
+            return fail("image array does not hold columns");
+        if (level == 2)
+        {
+            if (m_Rank == 3)
+                return fail("image array mixes ranks");
+            m_Rank = 2;
+            m_ColumnCount++;
+        }
+        else
+            m_PixelCount++;
+        m_Samples.push_back(clampSample(value));
+    }
+    else if (m_Stack.size() == 1 && m_Key == "ErrorNumber")
+        m_ErrorNumber = clampSample(value);
+    return endValue();
+}
+
+bool JSONDecoder::onLiteral()
+{
+    if (m_Text != "true" && m_Text != "false" && m_Text != "null")
+        return fail("invalid literal " + m_Text);
+    if (m_ImageDepth)
+        return fail("unexpected literal in the image array");
+    return endValue();
+}
+
+bool JSONDecoder::endToken()
+{
+    const Token token = m_Token;
+    m_Token = NoToken;
+    switch (token)
+    {
+        case NumberToken:
+            return onNumber();
+        case LiteralToken:
+            return onLiteral();
+        case StringToken:
+        case EscapeToken:
+            return fail("unterminated string");
+        default:
+            return true;
+    }
+}
+
+size_t JSONDecoder::feedSamples(const char *data, size_t i, size_t size)
+{
+    // Runs of plain integers followed by their separator in the chunk, anything else is left to the parser
+    uint32_t count = 0;
+    while (i < size)
+    {
+        size_t j = i;
+        uint64_t value = 0;
+        while (j < size && data[j] >= '0' && data[j] <= '9' && j - i < 10)
+        {
+            value = value * 10 + (data[j] - '0');
+            j++;
+        }
+        if (j == i || j == size || (data[j] != ',' && data[j] != ']'))
+            break;
+
+        m_Samples.push_back(clampSample(static_cast<int64_t>(value)));
+        count++;
+        if (data[j] == ']')
+        {
+            m_Expect = ExpectNext;
+            i = j;
+            break;
+        }
+        m_Expect = ExpectValue;
+        i = j + 1;
+    }
+
+    if (m_Rank == 2)
+        m_ColumnCount += count;
+    else
+        m_PixelCount += count;
+    return i;
+}
+
+bool JSONDecoder::feed(const char *data, size_t size)
+{
+    if (!m_Error.empty())
+        return false;
+
+    size_t i = 0;
+    while (i < size)
+    {
+        // The samples of a column, or of a pixel, once the rank is known
+        if (m_Token == NoToken && m_ImageDepth && m_Stack.size() + 1 - m_ImageDepth == static_cast<size_t>(m_Rank) &&
+                (m_Expect == ExpectValue || m_Expect == ExpectValueOrClose))
+        {
+            i = feedSamples(data, i, size);
+            if (i == size)
+                break;
+        }
+
+        // Tokens may span chunks, the character ending one is parsed again once it is complete
+        if (m_Token == NumberToken)
+        {
+            if (!m_Float)
+            {
+                // The digits of the integers, the bulk of an image array, are parsed in locals
+                uint64_t integer = m_Integer;
+                uint32_t digits = m_Digits;
+                while (i < size && data[i] >= '0' && data[i] <= '9' && integer <= LargestInteger)
+                {
+                    integer = integer * 10 + (data[i] - '0');
+                    digits++;
+                    i++;
+                }
+                m_Integer = integer;
+                m_Digits = digits;
+                if (i == size)
+                    return true;
+            }
+            const char c = data[i];
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || (m_Float && (c == '+' || c == '-')))
+            {
+                if (!m_Float)
+                {
+                    m_Text = (m_Negative ? "-" : "") + std::to_string(m_Integer);
+                    m_Float = true;
+                }
+                m_Text.push_back(c);
+                i++;
+                continue;
+            }
+            if (!endToken())
+                return false;
+            continue;
+        }
+
+        const char c = data[i];
+        if (m_Token == StringToken)
+        {
+            size_t stop = i;
+            while (stop < size && data[stop] != '"' && data[stop] != '\\')
+                stop++;
+            m_Text.append(data + i, stop - i);
+            if (stop == size)
+                return true;
+            i = stop + 1;
+            if (data[stop] == '\\')
+                m_Token = EscapeToken;
+            else
+            {
+                m_Token = NoToken;
+                if (!onString())
+                    return false;
+            }
+            continue;
+        }
+        if (m_Token == EscapeToken)
+        {
+            switch (c)
+            {
+                case 'n':
+                    m_Text.push_back('\n');
+                    break;
+                case 't':
+                    m_Text.push_back('\t');
+                    break;
+                case 'r':
+                    m_Text.push_back('\r');
+                    break;
+                case 'b':
+                    m_Text.push_back('\b');
+                    break;
+                case 'f':
+                    m_Text.push_back('\f');
+                    break;
+                case 'u':
+                    // Unicode escapes are kept as they are
+                    m_Text.append("\\u");
+                    break;
+                default:
+                    m_Text.push_back(c);
+                    break;
+            }
+            m_Token = StringToken;
+            i++;
+            continue;
+        }
+        if (m_Token == LiteralToken)
+        {
+            if (c >= 'a' && c <= 'z')
+            {
+                m_Text.push_back(c);
+                i++;
+                continue;
+            }
+            if (!endToken())
+                return false;
+            continue;
+        }
+
+        bool valid = true;
+        switch (c)
+        {
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                break;
+            case '{':
+            case '[':
+                valid = openContainer(c);
+                break;
+            case '}':
+            case ']':
+                valid = closeContainer(c);
+                break;
+            case ',':
+                if (m_Expect != ExpectNext)
+                    return fail("unexpected comma");
+                m_Expect = (m_Stack.back() == '{') ? ExpectKey : ExpectValue;
+                break;
+            case ':':
+                if (m_Expect != ExpectColon)
+                    return fail("unexpected colon");
+                m_Expect = ExpectValue;
+                break;
+            case '"':
+                if (m_Expect == ExpectKey || m_Expect == ExpectKeyOrClose)
+                    m_InKey = true;
+                else
+                    valid = startValue();
+                m_Token = StringToken;
+                m_Text.clear();
+                break;
+            case '-':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+                valid = startValue();
+                m_Token = NumberToken;
+                m_Negative = (c == '-');
+                m_Integer = m_Negative ? 0 : c - '0';
+                m_Digits = m_Negative ? 0 : 1;
+                m_Float = false;
+                break;
+            default:
+                if (c < 'a' || c > 'z')
+                    return fail(std::string("unexpected character ") + c);
+                valid = startValue();
+                m_Token = LiteralToken;
+                m_Text.assign(1, c);
+                break;
+        }
+        if (!valid)
+            return false;
+        i++;
+    }
+    return true;
+}
+
+bool JSONDecoder::finish()
+{
+    if (!m_Error.empty() || !endToken())
+        return false;
+    if (m_Expect != ExpectEnd)
+        return fail("incomplete response");
+    // An error response holds no image
+    if (m_ErrorNumber != 0)
+        return true;
+    if (!m_HasImage)
+        return fail("response holds no image array");
+    if (m_Width == 0 || m_Height == 0 || (m_Rank == 3 && m_Planes == 0))
+        return fail("empty image array");
+    return true;
+}
+}
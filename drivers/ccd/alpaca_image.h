@@ -0,0 +1,174 @@
+/*******************************************************************************
+  Copyright(c) 2026 Jasem Mutlaq. All rights reserved.
+
+  ASCOM Alpaca Camera INDI Driver - Image Ingestion
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace AlpacaImage
+{
+// ASCOM ImageArrayElementTypes
+enum ElementType
+{
+    Unknown = 0,
+    Int16   = 1,
+    Int32   = 2,
+    Double  = 3,
+    Single  = 4,
+    UInt64  = 5,
+    Byte    = 6,
+    Int64   = 7,
+    UInt16  = 8,
+    UInt32  = 9
+};
+
+// Size in bytes of an element of the given type, 0 if the type is not known
+size_t elementSize(int type);
+
+/**
+ * Convert an Alpaca image array into a 16 bit INDI frame in a single pass.
+ * The source holds little-endian elements of the given type in Alpaca order, [x][y][plane] with the plane
+ * changing fastest. The frame is written in raster order, the rows flipped from the Alpaca top-left origin
+ * when flip is set, and the color planes averaged.
+ * Integer samples are clamped to 16 bits, Byte samples are scaled by 256, Int16 samples are offset by 32768
+ * and floating point samples are scaled from the 0 to 1 range.
+ * Returns false if the type is not known.
+ */
+bool toFrame(const uint8_t *src, int type, uint32_t width, uint32_t height, uint32_t planes, bool flip, uint16_t *dst);
+
+/**
+ * Streaming decoder of a JSON ImageArray response.
+ * The body is fed in chunks as it is received. The Value array is parsed straight into Int32 samples in Alpaca
+ * order, the order of the ImageBytes data, without building a document of the response. Floating point samples
+ * are truncated and all samples are clamped to the Int32 range.
+ */
+class JSONDecoder
+{
+    public:
+        // The samples are reserved for the expected number of samples, when known
+        explicit JSONDecoder(size_t expectedSamples = 0);
+
+        // Parse the next chunk of the body, returns false once the body is not a valid ImageArray response
+        bool feed(const char *data, size_t size);
+        // Check that the body was a complete response, holding an image unless it reports an error
+        bool finish();
+
+        std::vector<int32_t> &samples()
+        {
+            return m_Samples;
+        }
+        // Dimensions of the image, planes is 0 for a rank 2 image
+        uint32_t width() const
+        {
+            return m_Width;
+        }
+        uint32_t height() const
+        {
+            return m_Height;
+        }
+        uint32_t planes() const
+        {
+            return m_Planes;
+        }
+        int rank() const
+        {
+            return m_Rank;
+        }
+        int errorNumber() const
+        {
+            return m_ErrorNumber;
+        }
+        const std::string &errorMessage() const
+        {
+            return m_ErrorMessage;
+        }
+        // Description of the parse error, empty if none
+        const std::string &error() const
+        {
+            return m_Error;
+        }
+
+    private:
+        enum Expect
+        {
+            ExpectValue,
+            ExpectValueOrClose,
+            ExpectKey,
+            ExpectKeyOrClose,
+            ExpectColon,
+            ExpectNext,
+            ExpectEnd
+        };
+        enum Token
+        {
+            NoToken,
+            StringToken,
+            EscapeToken,
+            NumberToken,
+            LiteralToken
+        };
+
+        bool fail(const std::string &error);
+        bool startValue();
+        bool endValue();
+        bool openContainer(char type);
+        bool closeContainer(char type);
+        bool onString();
+        bool onNumber();
+        bool onLiteral();
+        bool endToken();
+        size_t feedSamples(const char *data, size_t i, size_t size);
+
+        std::vector<int32_t> m_Samples;
+        // Open objects and arrays
+        std::string m_Stack;
+        Expect m_Expect { ExpectValue };
+        Token m_Token { NoToken };
+        std::string m_Text;
+        // Last key of the response object
+        std::string m_Key;
+        bool m_InKey { false };
+
+        // Integer being parsed, the text is parsed instead for floating point numbers
+        uint64_t m_Integer { 0 };
+        uint32_t m_Digits { 0 };
+        bool m_Negative { false };
+        bool m_Float { false };
+
+        // Depth of the Value array in the stack, 0 outside of it
+        size_t m_ImageDepth { 0 };
+        bool m_HasImage { false };
+        int m_Rank { 0 };
+        uint32_t m_Width { 0 }, m_Height { 0 }, m_Planes { 0 };
+        // Elements of the column and of the pixel being parsed
+        uint32_t m_ColumnCount { 0 }, m_PixelCount { 0 };
+
+        int m_ErrorNumber { 0 };
+        std::string m_ErrorMessage;
+        std::string m_Error;
+};
+}
@@ -19,8 +19,7 @@
 #include "ccd_simulator.h"
 #include "indicom.h"
 #include "stream/streammanager.h"
-
-#include "locale_compat.h"
+#include "dsp.h"
 
 #include <libnova/julian_day.h>
 #include <libastro.h>
@@ -40,6 +39,10 @@ static pthread_mutex_t condMutex = PTHREAD_MUTEX_INITIALIZER;
 
 static std::unique_ptr<CCDSim> ccdsim(new CCDSim());
 
+// Frames of at least this many pixels are drawn by the libdsp worker pool, in strips of at least MIN_STRIP_ROWS rows
+static const int64_t PARALLEL_MIN_PIXELS = 1 << 20;
+static const int MIN_STRIP_ROWS = 64;
+
 CCDSim::CCDSim() : INDI::FilterInterface(this)
 {
     currentRA  = RA;
@@ -730,82 +733,50 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
 
         if (ftype == INDI::CCDChip::LIGHT_FRAME)
         {
-            AutoCNumeric locale;
-            char gsccmd[250];
-            FILE * pp;
             int drawn = 0;
+            std::vector<StarCatalog::Star> stars;
 
-            sprintf(gsccmd, "gsc -c %8.6f %+8.6f -r %4.1f -m 0 %4.2f -n 3000",
-                    range360(rad),
-                    rangeDec(cameradec),
-                    radius,
-                    lookuplimit);
-
-            pp = popen(gsccmd, "r");
-            if (pp != nullptr)
+            if (m_Catalog.query(range360(rad), rangeDec(cameradec), radius, lookuplimit, stars))
             {
-                char line[256];
-
-                while (fgets(line, 256, pp) != nullptr)
+                for (const auto &star : stars)
                 {
-                    //  ok, lets parse this line for specifics we want
-                    char id[20];
-                    char plate[6];
-                    char ob[6];
-                    float mag;
-                    float mage;
-                    float ra;
-                    float dec;
-                    float pose;
-                    int band;
-                    float dist;
-                    int dir;
-                    int c;
-
-                    int rc = sscanf(line, "%10s %f %f %f %f %f %d %d %4s %2s %f %d", id, &ra, &dec, &pose, &mag, &mage,
-                                    &band, &c, plate, ob, &dist, &dir);
-                    if (rc == 12)
-                    {
-                        //  Convert the ra/dec to standard co-ordinates
-                        double sx;    //  standard co-ords
-                        double sy;    //
-                        double srar;  //  star ra in radians
-                        double sdecr; //  star dec in radians;
-                        double ccdx;
-                        double ccdy;
-
-                        srar  = ra * 0.0174532925;
-                        sdecr = dec * 0.0174532925;
-
-                        //  Handbook of astronomical image processing
-                        //  page 253
-                        //  equations 9.1 and 9.2
-                        //  convert ra/dec to standard co-ordinates
-
-                        sx = cos(sdecr) * sin(srar - rar) /
-                             (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
-                        sy = (sin(decr) * cos(sdecr) * cos(srar - rar) - cos(decr) * sin(sdecr)) /
-                             (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
-
-                        //  now convert to pixels
-                        ccdx = pa * sx + pb * sy + pc;
-                        ccdy = pd * sx + pe * sy + pf;
-
-                        // Invert horizontally and transform CW to CCW (see above)
-                        ccdx = ccdW - ccdx;
-
-                        rc = DrawImageStar(targetChip, mag, ccdx, ccdy, exposure_time);
-                        drawn += rc;
+                    //  Convert the ra/dec to standard co-ordinates
+                    double sx;    //  standard co-ords
+                    double sy;    //
+                    double srar;  //  star ra in radians
+                    double sdecr; //  star dec in radians;
+                    double ccdx;
+                    double ccdy;
+
+                    srar  = star.ra * 0.0174532925;
+                    sdecr = star.dec * 0.0174532925;
+
+                    //  Handbook of astronomical image processing
+                    //  page 253
+                    //  equations 9.1 and 9.2
+                    //  convert ra/dec to standard co-ordinates
+
+                    sx = cos(sdecr) * sin(srar - rar) /
+                         (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
+                    sy = (sin(decr) * cos(sdecr) * cos(srar - rar) - cos(decr) * sin(sdecr)) /
+                         (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
+
+                    //  now convert to pixels
+                    ccdx = pa * sx + pb * sy + pc;
+                    ccdy = pd * sx + pe * sy + pf;
+
+                    // Invert horizontally and transform CW to CCW (see above)
+                    ccdx = ccdW - ccdx;
+
+                    int rc = DrawImageStar(targetChip, star.mag, ccdx, ccdy, exposure_time);
+                    drawn += rc;
 #ifdef __DEV__
-                        if (rc == 1)
-                        {
-                            LOGF_DEBUG("star %s scope %6.4f %6.4f star %6.4f %6.4f ccd %6.2f %6.2f", id, rad, decPE, ra, dec, ccdx, ccdy);
-                            LOGF_DEBUG("star %s ccd %6.2f %6.2f", id, ccdx, ccdy);
-                        }
-#endif
+                    if (rc == 1)
+                    {
+                        LOGF_DEBUG("star scope %6.4f %6.4f star %6.4f %6.4f ccd %6.2f %6.2f", rad, cameradec, star.ra, star.dec, ccdx, ccdy);
                     }
+#endif
                 }
-                pclose(pp);
             }
             else
             {
@@ -821,106 +792,268 @@ int CCDSim::DrawCcdFrame(INDI::CCDChip * targetChip)
         //  this is essentially the same math as drawing a dim star with
         //  fwhm equivalent to the full field of view
 
-        if (ftype == INDI::CCDChip::LIGHT_FRAME || ftype == INDI::CCDChip::FLAT_FRAME)
+        bool const glow = ftype == INDI::CCDChip::LIGHT_FRAME || ftype == INDI::CCDChip::FLAT_FRAME;
+        float skyflux = 0;
+        if (glow)
         {
             //  calculate flux from our zero point and gain values
-            float glow = m_SkyGlow * 1.3;
+            float skyglow = m_SkyGlow * 1.3;
 
             if (ftype == INDI::CCDChip::FLAT_FRAME)
             {
                 //  Assume flats are done with a diffuser
                 //  in broad daylight, so, the sky magnitude
                 //  is much brighter than at night
-                glow = m_SkyGlow / 10;
+                skyglow = m_SkyGlow / 10;
             }
 
             // Flux represents one second, scale up linearly for exposure time
-            float const skyflux = flux(glow) * exposure_time;
-
-            uint16_t * pt = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
+            skyflux = flux(skyglow) * exposure_time;
+            updateVignetting(targetChip->getSubW(), targetChip->getSubH());
+        }
 
+        //  Now we add the shot noise of the signal, with bias and read noise
+        //  Large frames are split in strips of rows, drawn by the libdsp worker pool
+        bool const noise = m_MaxNoise > 0;
+        if (glow || noise)
+        {
             nheight = targetChip->getSubH();
             nwidth  = targetChip->getSubW();
+            m_NoiseSeed++;
 
-            for (int y = 0; y < nheight; y++)
+            // One strip per processor, the pool runs several strips on one thread if it is limited to fewer
+            int strips = 1;
+            if (static_cast<int64_t>(nwidth) * nheight >= PARALLEL_MIN_PIXELS)
+                strips = std::max(1, std::min<int>(std::thread::hardware_concurrency(), nheight / MIN_STRIP_ROWS));
+
+            std::vector<int> low(strips, minpix), high(strips, maxpix);
+            int const rows = (nheight + strips - 1) / strips;
+            auto draw = [&](int start, int end)
+            {
+                for (int i = start; i < end; i++)
+                    DrawBackgroundRows(targetChip, i * rows, std::min(nheight, (i + 1) * rows), skyflux, noise,
+                                       low[i], high[i]);
+            };
+            dsp_parallel_for(strips, [](void *arg, int start, int end)
             {
-                float const sy = nheight / 2 - y;
+                (*static_cast<decltype(draw) *>(arg))(start, end);
+            }, &draw);
 
-                for (int x = 0; x < nwidth; x++)
-                {
-                    float const sx = nwidth / 2 - x;
+            minpix = *std::min_element(low.begin(), low.end());
+            maxpix = *std::max_element(high.begin(), high.end());
+        }
+    }
+    else
+    {
+        testvalue++;
+        if (testvalue > 255)
+            testvalue = 0;
+        uint16_t val = testvalue;
+
+        int nbuf = targetChip->getSubW() * targetChip->getSubH();
 
-                    // Vignetting parameter in arcsec
-                    float const vig = std::min(nwidth, nheight) * ImageScalex;
+        for (int x = 0; x < nbuf; x++)
+        {
+            *ptr = val++;
+            ptr++;
+        }
+    }
+    return 0;
+}
 
-                    // Squared distance to center in arcsec (need to make this account for actual pixel size)
-                    float const dc2 = sx * sx * ImageScalex * ImageScalex + sy * sy * ImageScaley * ImageScaley;
+void CCDSim::updatePSF()
+{
+    if (m_PSF.seeing == seeing && m_PSF.scaleX == ImageScalex && m_PSF.scaleY == ImageScaley && !m_PSF.x.empty())
+        return;
 
-                    // Gaussian falloff to the edges of the frame
-                    float const fa = exp(-2.0 * 0.7 * dc2 / (vig * vig));
+    //  we need a box size that gives a radius at least 3 times fwhm
+    int const boxsize = static_cast<int>(seeing / ImageScaley * 3) + 1;
+
+    // Use a gaussian of unitary integral, scale it with the source flux
+    // f(x) = 1/(sqrt(2*pi)*sigma) * exp( -x² / (2*sigma²) )
+    // FWHM = 2*sqrt(2*log(2))*sigma => sigma = seeing/(2*sqrt(2*log(2)))
+    // With the squared distance to center in arcsec, exp(-(x²+y²)/(2*sigma²)) = exp(-x²/(2*sigma²)) * exp(-y²/(2*sigma²))
+    float const sigma = seeing / ( 2 * sqrt(2 * log(2)));
+    double const norm = 1 / (sigma * sqrt(2 * 3.1416));
+
+    m_PSF.x.resize(2 * boxsize + 1);
+    m_PSF.y.resize(2 * boxsize + 1);
+    for (int s = -boxsize; s <= boxsize; s++)
+    {
+        m_PSF.x[s + boxsize] = exp(-(s * s * ImageScalex * ImageScalex) / (2 * sigma * sigma));
+        m_PSF.y[s + boxsize] = norm * exp(-(s * s * ImageScaley * ImageScaley) / (2 * sigma * sigma));
+    }
+    m_PSF.seeing = seeing;
+    m_PSF.scaleX = ImageScalex;
+    m_PSF.scaleY = ImageScaley;
+}
 
-                    // Get the current value of the pixel, add the sky glow and scale for vignetting
-                    float fp = (pt[0] + skyflux) * fa;
+void CCDSim::updateVignetting(int width, int height)
+{
+    if (m_Vignetting.width == width && m_Vignetting.height == height && m_Vignetting.scaleX == ImageScalex
+            && m_Vignetting.scaleY == ImageScaley)
+        return;
 
-                    // Clamp to limits, store minmax
-                    if (fp > m_MaxVal) fp = m_MaxVal;
-                    if (fp < pt[0]) fp = pt[0];
-                    if (fp > maxpix) maxpix = fp;
-                    if (fp < minpix) minpix = fp;
+    // Vignetting parameter in arcsec
+    float const vig = std::min(width, height) * ImageScalex;
 
-                    // And put it back
-                    pt[0] = fp;
-                    pt++;
-                }
+    // Gaussian falloff to the edges of the frame, along x and along y
+    m_Vignetting.x.resize(width);
+    for (int x = 0; x < width; x++)
+    {
+        float const sx = width / 2 - x;
+        m_Vignetting.x[x] = exp(-2.0 * 0.7 * sx * sx * ImageScalex * ImageScalex / (vig * vig));
+    }
+    m_Vignetting.y.resize(height);
+    for (int y = 0; y < height; y++)
+    {
+        float const sy = height / 2 - y;
+        m_Vignetting.y[y] = exp(-2.0 * 0.7 * sy * sy * ImageScaley * ImageScaley / (vig * vig));
+    }
+    m_Vignetting.width = width;
+    m_Vignetting.height = height;
+    m_Vignetting.scaleX = ImageScalex;
+    m_Vignetting.scaleY = ImageScaley;
+}
+
+// Counter based random numbers (lowbias32 hash of the counter), the value of a counter only depends on the seed
+static inline uint32_t counterRandom(uint32_t seed, uint32_t counter)
+{
+    uint32_t z = counter * 0x9E3779B9u + seed;
+    z ^= z >> 16;
+    z *= 0x7FEB352Du;
+    z ^= z >> 15;
+    z *= 0x846CA68Bu;
+    z ^= z >> 16;
+    return z;
+}
+
+// Standard normal deviates, indexed by 16 random bits, from the inverse of the normal distribution (Acklam)
+static const std::vector<float> &gaussianTable()
+{
+    static const std::vector<float> table = []()
+    {
+        static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                                    1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00
+                                  };
+        static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                                    6.680131188771972e+01, -1.328068155288572e+01
+                                  };
+        static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                                    -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00
+                                  };
+        static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                                    3.754408661907416e+00
+                                  };
+        std::vector<float> values(65536);
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            double const p = (i + 0.5) / values.size();
+            double const q = std::min(p, 1 - p);
+            double x;
+            if (q < 0.02425)
+            {
+                double const r = std::sqrt(-2 * std::log(q));
+                x = (((((c[0] * r + c[1]) * r + c[2]) * r + c[3]) * r + c[4]) * r + c[5]) /
+                    ((((d[0] * r + d[1]) * r + d[2]) * r + d[3]) * r + 1);
+                if (p > 0.5)
+                    x = -x;
             }
+            else
+            {
+                double const u = p - 0.5, r = u * u;
+                x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * u /
+                    (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+            }
+            values[i] = x;
         }
+        return values;
+    }();
+    return table;
+}
 
-        //  Now we add some bias and read noise
-        int subX = targetChip->getSubX();
-        int subY = targetChip->getSubY();
-        int subW = targetChip->getSubW() + subX;
-        int subH = targetChip->getSubH() + subY;
+// Poisson deviate of the mean, by inversion of the uniform u for small means and from the normal deviate otherwise
+static inline float poisson(float mean, float normal, float u)
+{
+    if (mean <= 0)
+        return 0;
+    if (mean >= 32)
+        return std::max(0.0f, mean + std::sqrt(mean) * normal);
 
-        if (m_MaxNoise > 0)
+    float p = std::exp(-mean), cdf = p;
+    int k = 0;
+    while (u > cdf && k < 128)
+    {
+        k++;
+        p *= mean / k;
+        cdf += p;
+    }
+    return k;
+}
+
+void CCDSim::DrawBackgroundRows(INDI::CCDChip * targetChip, int first, int last, float skyflux, bool noise, int &low, int &high)
+{
+    int const nwidth = targetChip->getSubW();
+    uint16_t * const frame = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
+    float const maxval = m_MaxVal;
+    float const * const gaussian = gaussianTable().data();
+
+    // The uniform read noise of up to m_MaxNoise ADUs is drawn from the gaussian of the same mean and deviation
+    float const offset = m_Bias + m_MaxNoise / 2.0f;
+    float const readSigma = m_MaxNoise / std::sqrt(12.0f);
+    uint32_t const seed = static_cast<uint32_t>(m_NoiseSeed * 0x9E3779B97F4A7C15ULL >> 32);
+
+    std::vector<float> row(nwidth);
+    std::vector<uint32_t> bits(nwidth);
+    for (int y = first; y < last; y++)
+    {
+        uint16_t * const pt = frame + static_cast<size_t>(y) * nwidth;
+
+        // Add the sky glow and scale for vignetting, never below the stars already drawn
+        if (skyflux > 0)
         {
-            for (int x = subX; x < subW; x++)
+            float const fy = m_Vignetting.y[y];
+            float const * const fx = m_Vignetting.x.data();
+            for (int x = 0; x < nwidth; x++)
             {
-                for (int y = subY; y < subH; y++)
-                {
-                    int noise;
+                float const value = pt[x];
+                row[x] = std::max(value, std::min(maxval, (value + skyflux) * (fx[x] * fy)));
+            }
+        }
+        else
+        {
+            for (int x = 0; x < nwidth; x++)
+                row[x] = pt[x];
+        }
 
-                    noise = random();
-                    noise = noise % m_MaxNoise; //
+        if (noise)
+        {
+            // 32 random bits per pixel, half for the read noise and half for the shot noise
+            uint32_t const counter = static_cast<uint32_t>(y) * static_cast<uint32_t>(nwidth);
+            for (int x = 0; x < nwidth; x++)
+                bits[x] = counterRandom(seed, counter + x);
 
-                    AddToPixel(targetChip, x, y, m_Bias + noise);
-                }
+            for (int x = 0; x < nwidth; x++)
+            {
+                uint32_t const shotBits = bits[x] & 0xFFFF;
+                float const shot = poisson(row[x], gaussian[shotBits], (shotBits + 0.5f) * (1.0f / 65536.0f));
+                row[x] = shot + offset + readSigma * gaussian[bits[x] >> 16];
             }
         }
-    }
-    else
-    {
-        testvalue++;
-        if (testvalue > 255)
-            testvalue = 0;
-        uint16_t val = testvalue;
-
-        int nbuf = targetChip->getSubW() * targetChip->getSubH();
 
-        for (int x = 0; x < nbuf; x++)
+        for (int x = 0; x < nwidth; x++)
         {
-            *ptr = val++;
-            ptr++;
+            float const fp = std::min(maxval, std::max(0.0f, row[x]));
+            pt[x] = fp;
+            if (fp > high) high = fp;
+            if (fp < low) low = fp;
         }
     }
-    return 0;
 }
 
 int CCDSim::DrawImageStar(INDI::CCDChip * targetChip, float mag, float x, float y, float exposure_time)
 {
-    int sx, sy;
     int drew     = 0;
-    //int boxsizex = 5;
-    int boxsizey = 5;
     float flux;
 
     int subX = targetChip->getSubX();
@@ -941,42 +1074,35 @@ int CCDSim::DrawImageStar(INDI::CCDChip * targetChip, float mag, float x, float
     //  scale up linearly for exposure time
     flux = flux * exposure_time;
 
-    //  we need a box size that gives a radius at least 3 times fwhm
-    //qx       = seeing / ImageScalex;
-    //qx       = qx * 3;
-    //boxsizex = (int)qx;
-    //boxsizex++;
-    auto qx = seeing / ImageScaley;
-    qx = qx * 3;
-    boxsizey = static_cast<int>(qx);
-    boxsizey++;
-
-    //IDLog("BoxSize %d %d\n",boxsizex,boxsizey);
-
-    for (sy = -boxsizey; sy <= boxsizey; sy++)
-    {
-        for (sx = -boxsizey; sx <= boxsizey; sx++)
-        {
-            int rc;
-
-            // Squared distance to center in arcsec (need to make this account for actual pixel size)
-            float const dc2 = sx * sx * ImageScalex * ImageScalex + sy * sy * ImageScaley * ImageScaley;
-
-            // Use a gaussian of unitary integral, scale it with the source flux
-            // f(x) = 1/(sqrt(2*pi)*sigma) * exp( -x² / (2*sigma²) )
-            // FWHM = 2*sqrt(2*log(2))*sigma => sigma = seeing/(2*sqrt(2*log(2)))
-            float const sigma = seeing / ( 2 * sqrt(2 * log(2)));
-            float const fa = 1 / (sigma * sqrt(2 * 3.1416)) * exp( -dc2 / (2 * sigma * sigma));
+    //  The source contribution is the gaussian value, stretched by seeing/FWHM
+    updatePSF();
+    int const boxsize = static_cast<int>(m_PSF.x.size() / 2);
+    int const nwidth = targetChip->getSubW();
+    uint16_t * const frame = reinterpret_cast<uint16_t *>(targetChip->getFrameBuffer());
 
-            // The source contribution is the gaussian value, stretched by seeing/FWHM
-            float fp = fa * flux;
-
-            if (fp < 0)
-                fp = 0;
+    for (int sy = -boxsize; sy <= boxsize; sy++)
+    {
+        int const py = static_cast<int>(y + sy);
+        if (py < subY || py >= subH)
+            continue;
 
-            rc = AddToPixel(targetChip, x + sx, y + sy, fp);
-            if (rc != 0)
-                drew = 1;
+        float const fy = flux * m_PSF.y[sy + boxsize];
+        uint16_t * const row = frame + static_cast<size_t>(py - subY) * nwidth;
+        for (int sx = -boxsize; sx <= boxsize; sx++)
+        {
+            int const px = static_cast<int>(x + sx);
+            if (px < subX || px >= subW)
+                continue;
+
+            int newval = row[px - subX] + static_cast<int>(fy * m_PSF.x[sx + boxsize]);
+            if (newval > m_MaxVal)
+                newval = m_MaxVal;
+            if (newval > maxpix)
+                maxpix = newval;
+            if (newval < minpix)
+                minpix = newval;
+            row[px - subX] = newval;
+            drew = 1;
         }
     }
     return drew;
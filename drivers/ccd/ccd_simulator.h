@@ -22,6 +22,7 @@
 
 #include "indiccd.h"
 #include "indifilterinterface.h"
+#include "star_catalog.h"
 
 /**
  * @brief The CCDSim class provides an advanced simulator for a CCD that includes a dedicated on-board guide chip.
@@ -99,6 +100,8 @@ protected:
 
     int DrawImageStar(INDI::CCDChip *targetChip, float, float, float, float ExposureTime);
     int AddToPixel(INDI::CCDChip *targetChip, int, int, int);
+    // Adds sky glow with vignetting and noise to rows [first, last) of the subframe
+    void DrawBackgroundRows(INDI::CCDChip *targetChip, int first, int last, float skyflux, bool noise, int &low, int &high);
 
     virtual IPState GuideNorth(uint32_t) override;
     virtual IPState GuideSouth(uint32_t) override;
@@ -195,6 +198,24 @@ protected:
     float m_PolarError { 0 };
     float m_PolarDrift { 0 };
 
+    // Stars of the fields drawn so far
+    StarCatalog m_Catalog;
+
+    // The star PSF and the vignetting are separable gaussians, their profiles along x and y are cached
+    // for the seeing, image scale and subframe size they were computed for
+    struct Profile
+    {
+        float seeing { 0 }, scaleX { 0 }, scaleY { 0 };
+        int width { 0 }, height { 0 };
+        std::vector<float> x, y;
+    };
+    Profile m_PSF, m_Vignetting;
+    void updatePSF();
+    void updateVignetting(int width, int height);
+
+    // Noise of a pixel only depends on the frame number and the pixel index, whichever thread draws it
+    uint64_t m_NoiseSeed { 0 };
+
     double m_LastTemperature {0};
 
     int streamPredicate {0};
@@ -48,8 +48,6 @@ which can simulate backlash to the guiding pulses. See its Dec Backlash paramete
 #include "indicom.h"
 #include "stream/streammanager.h"
 
-#include "locale_compat.h"
-
 #include <libnova/julian_day.h>
 #include <libastro.h>
 
@@ -723,82 +721,46 @@ int GuideSim::DrawCcdFrame(INDI::CCDChip * targetChip)
 
         if (ftype == INDI::CCDChip::LIGHT_FRAME)
         {
-            AutoCNumeric locale;
-            char gsccmd[250];
-            FILE * pp;
             int drawn = 0;
-
-            sprintf(gsccmd, "gsc -c %8.6f %+8.6f -r %4.1f -m 0 %4.2f -n 3000",
-                    range360(rad),
-                    rangeDec(cameradec),
-                    radius,
-                    lookuplimit);
+            std::vector<StarCatalog::Star> stars;
 
             if (!Streamer->isStreaming() || (m_KingGamma > 0.))
-                LOGF_DEBUG("GSC Command: %s", gsccmd);
+                LOGF_DEBUG("Star lookup: %8.6f %+8.6f radius %4.1f magnitude %4.2f", range360(rad), rangeDec(cameradec), radius,
+                           lookuplimit);
 
-            pp = popen(gsccmd, "r");
-            if (pp != nullptr)
+            if (m_Catalog.query(range360(rad), rangeDec(cameradec), radius, lookuplimit, stars))
             {
-                char line[256];
-
-                while (fgets(line, 256, pp) != nullptr)
+                for (const auto &star : stars)
                 {
-                    //  ok, lets parse this line for specifics we want
-                    char id[20];
-                    char plate[6];
-                    char ob[6];
-                    float mag;
-                    float mage;
-                    float ra;
-                    float dec;
-                    float pose;
-                    int band;
-                    float dist;
-                    int dir;
-                    int c;
-
-                    int rc = sscanf(line, "%10s %f %f %f %f %f %d %d %4s %2s %f %d", id, &ra, &dec, &pose, &mag, &mage,
-                                    &band, &c, plate, ob, &dist, &dir);
-                    if (rc == 12)
-                    {
-                        //  Convert the ra/dec to standard co-ordinates
-                        double sx;    //  standard co-ords
-                        double sy;    //
-                        double srar;  //  star ra in radians
-                        double sdecr; //  star dec in radians;
-                        double ccdx;
-                        double ccdy;
-
-                        srar  = ra * DEGREES_TO_RADIANS;
-                        sdecr = dec * DEGREES_TO_RADIANS;
-                        //  Handbook of astronomical image processing
-                        //  page 253
-                        //  equations 9.1 and 9.2
-                        //  convert ra/dec to standard co-ordinates
-
-                        sx = cos(sdecr) * sin(srar - rar) /
-                             (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
-                        sy = (sin(decr) * cos(sdecr) * cos(srar - rar) - cos(decr) * sin(sdecr)) /
-                             (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
-
-                        //  now convert to pixels
-                        ccdx = pa * sx + pb * sy + pc;
-                        ccdy = pd * sx + pe * sy + pf;
-
-                        // Invert horizontally
-                        ccdx = ccdW - ccdx;
-
-                        rc = DrawImageStar(targetChip, mag, ccdx, ccdy, exposure_time, zeroPointK, zeroPointZ);
-                        drawn += rc;
-                        if (rc == 1)
-                        {
-                            //LOGF_DEBUG("star %s scope %6.4f %6.4f star %6.4f %6.4f ccd %6.2f %6.2f",id,rad,decPE,ra,dec,ccdx,ccdy);
-                            //LOGF_DEBUG("star %s ccd %6.2f %6.2f",id,ccdx,ccdy);
-                        }
-                    }
+                    //  Convert the ra/dec to standard co-ordinates
+                    double sx;    //  standard co-ords
+                    double sy;    //
+                    double srar;  //  star ra in radians
+                    double sdecr; //  star dec in radians;
+                    double ccdx;
+                    double ccdy;
+
+                    srar  = star.ra * DEGREES_TO_RADIANS;
+                    sdecr = star.dec * DEGREES_TO_RADIANS;
+                    //  Handbook of astronomical image processing
+                    //  page 253
+                    //  equations 9.1 and 9.2
+                    //  convert ra/dec to standard co-ordinates
+
+                    sx = cos(sdecr) * sin(srar - rar) /
+                         (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
+                    sy = (sin(decr) * cos(sdecr) * cos(srar - rar) - cos(decr) * sin(sdecr)) /
+                         (cos(decr) * cos(sdecr) * cos(srar - rar) + sin(decr) * sin(sdecr));
+
+                    //  now convert to pixels
+                    ccdx = pa * sx + pb * sy + pc;
+                    ccdy = pd * sx + pe * sy + pf;
+
+                    // Invert horizontally
+                    ccdx = ccdW - ccdx;
+
+                    drawn += DrawImageStar(targetChip, star.mag, ccdx, ccdy, exposure_time, zeroPointK, zeroPointZ);
                 }
-                pclose(pp);
             }
             else
             {
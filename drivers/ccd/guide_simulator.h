@@ -22,6 +22,7 @@
 #include "indifilterinterface.h"
 #include "indipropertyswitch.h"
 #include "fitskeyword.h"
+#include "star_catalog.h"
 
 /**
  * @brief The GuideSim class provides an advanced simulator for a CCD that includes a dedicated on-board guide chip.
@@ -131,6 +132,9 @@ class GuideSim : public INDI::CCD
 
         bool m_AbortPrimaryFrame { false };
 
+        // Stars of the fields drawn so far
+        StarCatalog m_Catalog;
+
         /// Guide rate is 7 arcseconds per second
         float m_GuideRate { 7 };
 
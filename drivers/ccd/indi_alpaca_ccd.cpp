@@ -23,6 +23,7 @@
 *******************************************************************************/
 
 #include "indi_alpaca_ccd.h"
+#include "alpaca_image.h"
 
 #include "indicom.h"
 #include <httplib.h>
@@ -1089,7 +1090,7 @@ bool AlpacaCCD::alpacaGetImageReady()
 ////////////////////////////////////////////////////////////////////////////////////////////
 ///
 ////////////////////////////////////////////////////////////////////////////////////////////
-bool AlpacaCCD::alpacaGetImageArrayImageBytes(uint8_t** buffer, size_t* buffer_size, ImageBytesMetadata* metadata)
+bool AlpacaCCD::alpacaGetImageArrayImageBytes(std::string &body, ImageBytesMetadata* metadata)
 {
     if (!httpClient)
     {
@@ -1179,33 +1180,21 @@ bool AlpacaCCD::alpacaGetImageArrayImageBytes(uint8_t** buffer, size_t* buffer_s
     }
 
     // Calculate expected data size based on transmission element type
-    size_t bytes_per_element;
-    switch (metadata->TransmissionElementType)
+    size_t bytes_per_element = AlpacaImage::elementSize(metadata->TransmissionElementType);
+    if (bytes_per_element == 0)
     {
-        case 6: // Byte
-            bytes_per_element = 1;
-            break;
-        case 1: // Int16
-        case 8: // UInt16
-            bytes_per_element = 2;
-            break;
-        case 2: // Int32
-        case 9: // UInt32
-        case 4: // Single (float)
-            bytes_per_element = 4;
-            break;
-        case 3: // Double
-        case 5: // UInt64
-        case 7: // Int64
-            bytes_per_element = 8;
-            break;
-        default:
-            LOGF_ERROR("Unsupported transmission element type: %d", metadata->TransmissionElementType);
-            return false;
+        LOGF_ERROR("Unsupported transmission element type: %d", metadata->TransmissionElementType);
+        return false;
     }
 
     uint32_t planes = (metadata->Rank == 3) ? metadata->Dimension3 : 1;
-    size_t expected_data_size = metadata->Dimension1 * metadata->Dimension2 * planes * bytes_per_element;
+    size_t expected_data_size = static_cast<size_t>(metadata->Dimension1) * metadata->Dimension2 * planes * bytes_per_element;
+    if (metadata->DataStart < static_cast<int32_t>(sizeof(ImageBytesMetadata)) ||
+            static_cast<size_t>(metadata->DataStart) > result->body.size())
+    {
+        LOGF_ERROR("Invalid image data offset: %d", metadata->DataStart);
+        return false;
+    }
     size_t actual_data_size = result->body.size() - metadata->DataStart;
 
     if (actual_data_size != expected_data_size)
@@ -1215,22 +1204,12 @@ bool AlpacaCCD::alpacaGetImageArrayImageBytes(uint8_t** buffer, size_t* buffer_s
         return false;
     }
 
-    // Allocate buffer for image data
-    *buffer_size = expected_data_size;
-    PrimaryCCD.setFrameBufferSize(*buffer_size);
-    *buffer = PrimaryCCD.getFrameBuffer();
-    if (!*buffer)
-    {
-        LOG_ERROR("Failed to allocate image buffer");
-        return false;
-    }
-
-    // Copy image data from response
-    std::memcpy(*buffer, result->body.data() + metadata->DataStart, *buffer_size);
+    // The image data is converted from the response, without copying it
+    body = std::move(result->body);
 
     LOGF_DEBUG("ImageBytes: %dx%dx%d, type %d->%d, %zu bytes",
                metadata->Dimension1, metadata->Dimension2, planes,
-               metadata->ImageElementType, metadata->TransmissionElementType, *buffer_size);
+               metadata->ImageElementType, metadata->TransmissionElementType, expected_data_size);
 
     return true;
 }
@@ -1238,93 +1217,63 @@ bool AlpacaCCD::alpacaGetImageArrayImageBytes(uint8_t** buffer, size_t* buffer_s
 ////////////////////////////////////////////////////////////////////////////////////////////
 ///
 ////////////////////////////////////////////////////////////////////////////////////////////
-bool AlpacaCCD::alpacaGetImageArrayJSON(ImageMetadata& meta, uint8_t** buffer, size_t* buffer_size)
+bool AlpacaCCD::alpacaGetImageArrayJSON(ImageMetadata& meta, std::vector<int32_t> &samples)
 {
     // Fallback to standard JSON ImageArray method
-    nlohmann::json response;
-    if (!sendAlpacaGET("/imagearray", response))
-    {
-        LOG_ERROR("Failed to get image array via JSON");
-        return false;
-    }
-
-    if (!response.contains("Value") || !response["Value"].is_array())
+    if (!httpClient)
     {
-        LOG_ERROR("Invalid JSON image array response");
+        LOG_ERROR("HTTP client not initialized.");
         return false;
     }
 
-    auto imageArray = response["Value"];
+    std::string url = getAlpacaURL("/imagearray");
+    url += "?ClientID=" + std::to_string(getpid()) + "&ClientTransactionID=" + std::to_string(getTransactionId());
 
-    // Determine array dimensions
-    if (imageArray.empty() || !imageArray[0].is_array())
+    // The body is decoded as it is received, straight into the samples of the frame being read out
+    AlpacaImage::JSONDecoder decoder(static_cast<size_t>(PrimaryCCD.getSubW() / PrimaryCCD.getBinX()) *
+                                     (PrimaryCCD.getSubH() / PrimaryCCD.getBinY()));
+    int status = 0;
+    auto result = httpClient->Get(url.c_str(), [&status](const httplib::Response & response)
     {
-        LOG_ERROR("Invalid image array structure");
-        return false;
-    }
-
-    meta.width = imageArray.size();
-    meta.height = imageArray[0].size();
-    meta.rank = 2;
-    meta.planes = 0;
+        status = response.status;
+        return status == 200;
+    },
+    [&decoder](const char *data, size_t length)
+    {
+        return decoder.feed(data, length);
+    });
 
-    // Check if it's a 3D array (color)
-    if (!imageArray[0][0].is_number())
+    if (!result)
     {
-        if (imageArray[0][0].is_array())
-        {
-            meta.rank = 3;
-            meta.planes = imageArray[0][0].size();
-        }
+        if (status != 0 && status != 200)
+            LOGF_ERROR("Image array request returned status %d", status);
+        else if (!decoder.error().empty())
+            LOGF_ERROR("Invalid JSON image array response: %s", decoder.error().c_str());
         else
-        {
-            LOG_ERROR("Unsupported image array element type");
-            return false;
-        }
+            LOGF_ERROR("Failed to get image array via JSON: %s", httplib::to_string(result.error()).c_str());
+        return false;
     }
 
-    // Allocate buffer (assume 32-bit integers as per ASCOM standard)
-    size_t pixel_count = meta.width * meta.height * (meta.planes > 0 ? meta.planes : 1);
-    *buffer_size = pixel_count * sizeof(int32_t);
-    PrimaryCCD.setFrameBufferSize(*buffer_size);
-    *buffer = PrimaryCCD.getFrameBuffer();
-    if (!*buffer)
+    if (!decoder.finish())
     {
-        LOG_ERROR("Failed to allocate image buffer");
+        LOGF_ERROR("Invalid JSON image array response: %s", decoder.error().c_str());
         return false;
     }
 
-    int32_t* int_buffer = reinterpret_cast<int32_t*>(*buffer);
-    size_t index = 0;
-
-    // Copy data with proper ordering as per ASCOM specification
-    if (meta.rank == 2)
-    {
-        // 2D monochrome array
-        for (uint32_t x = 0; x < meta.width; x++)
-        {
-            for (uint32_t y = 0; y < meta.height; y++)
-            {
-                int_buffer[index++] = imageArray[x][y].get<int32_t>();
-            }
-        }
-    }
-    else
+    if (decoder.errorNumber() != 0)
     {
-        // 3D color array
-        for (uint32_t x = 0; x < meta.width; x++)
-        {
-            for (uint32_t y = 0; y < meta.height; y++)
-            {
-                for (uint32_t p = 0; p < meta.planes; p++)
-                {
-                    int_buffer[index++] = imageArray[x][y][p].get<int32_t>();
-                }
-            }
-        }
+        LOGF_ERROR("Alpaca error in /imagearray: %d - %s", decoder.errorNumber(), decoder.errorMessage().c_str());
+        return false;
     }
 
-    meta.type = 2; // Int32
+    // Int32 elements as per ASCOM standard, in the order of the ImageBytes data
+    meta.width = decoder.width();
+    meta.height = decoder.height();
+    meta.rank = decoder.rank();
+    meta.planes = decoder.planes();
+    samples.swap(decoder.samples());
+
+    meta.type = 3; // Int32
 
     // Get additional metadata for FITS headers
     meta.max_adu = m_MaxADU;
@@ -1344,21 +1293,20 @@ bool AlpacaCCD::alpacaGetImageArrayJSON(ImageMetadata& meta, uint8_t** buffer, s
 ////////////////////////////////////////////////////////////////////////////////////////////
 bool AlpacaCCD::downloadImage()
 {
-    uint8_t* image_buffer = nullptr;
-    size_t buffer_size = 0;
     bool success = false;
 
     LOG_DEBUG("Starting image download...");
 
     // Try ImageBytes protocol first (ASCOM Alpaca API v10 section 8)
+    std::string imagebytes_body;
     ImageBytesMetadata imagebytes_meta;
-    if (alpacaGetImageArrayImageBytes(&image_buffer, &buffer_size, &imagebytes_meta))
+    if (alpacaGetImageArrayImageBytes(imagebytes_body, &imagebytes_meta))
     {
         LOGF_DEBUG("ImageBytes metadata: %dx%dx%d, rank=%d, image_type=%d, transmission_type=%d",
                    imagebytes_meta.Dimension1, imagebytes_meta.Dimension2,
                    (imagebytes_meta.Rank == 3) ? imagebytes_meta.Dimension3 : 1,
                    imagebytes_meta.Rank, imagebytes_meta.ImageElementType, imagebytes_meta.TransmissionElementType);
-        LOGF_DEBUG("Raw buffer size: %zu bytes", buffer_size);
+        LOGF_DEBUG("Raw buffer size: %zu bytes", imagebytes_body.size() - imagebytes_meta.DataStart);
 
         // Convert ImageBytes metadata to our internal format
         m_CurrentImage.width = imagebytes_meta.Dimension1;
@@ -1416,34 +1364,32 @@ bool AlpacaCCD::downloadImage()
                    m_CurrentImage.width, m_CurrentImage.height, m_CurrentImage.planes,
                    m_CurrentImage.rank, m_CurrentImage.type);
 
-        // Convert ImageBytes data format to match our processing expectations
-        // ImageBytes uses row-major ordering as per ASCOM spec section 8.8.1
-        // We need to handle the data according to transmission element type
-        success = processImageBytesData(image_buffer, buffer_size, imagebytes_meta);
+        success = processImageBytesData(reinterpret_cast<const uint8_t*>(imagebytes_body.data()) + imagebytes_meta.DataStart,
+                                        imagebytes_body.size() - imagebytes_meta.DataStart, imagebytes_meta);
     }
     else
     {
         // Fallback to JSON ImageArray method
         LOG_DEBUG("ImageBytes not supported, falling back to JSON ImageArray");
-        if (alpacaGetImageArrayJSON(m_CurrentImage, &image_buffer, &buffer_size))
+        std::vector<int32_t> samples;
+        if (alpacaGetImageArrayJSON(m_CurrentImage, samples))
         {
             LOGF_DEBUG("JSON image metadata: %dx%d, planes=%d, rank=%d, type=%d",
                        m_CurrentImage.width, m_CurrentImage.height, m_CurrentImage.planes,
                        m_CurrentImage.rank, m_CurrentImage.type);
-            LOGF_DEBUG("JSON buffer size: %zu bytes", buffer_size);
-
-            // Translate coordinate system (ASCOM top-left to INDI bottom-left)
-            translateCoordinates(image_buffer, m_CurrentImage);
-
-            // Process the image
-            if (m_CurrentImage.planes == 0 || m_CurrentImage.planes == 1)
-            {
-                success = processMonoImage(image_buffer);
-            }
-            else
-            {
-                success = processColorImage(image_buffer);
-            }
+            LOGF_DEBUG("JSON buffer size: %zu bytes", samples.size() * sizeof(int32_t));
+
+            // The Int32 elements are in the ImageBytes order, they are converted the same way
+            ImageBytesMetadata json_meta {};
+            json_meta.MetadataVersion = 1;
+            json_meta.ImageElementType = AlpacaImage::Int32;
+            json_meta.TransmissionElementType = AlpacaImage::Int32;
+            json_meta.Rank = m_CurrentImage.rank;
+            json_meta.Dimension1 = m_CurrentImage.width;
+            json_meta.Dimension2 = m_CurrentImage.height;
+            json_meta.Dimension3 = m_CurrentImage.planes;
+            success = processImageBytesData(reinterpret_cast<const uint8_t*>(samples.data()), samples.size() * sizeof(int32_t),
+                                            json_meta);
         }
         else
         {
@@ -1451,13 +1397,6 @@ bool AlpacaCCD::downloadImage()
         }
     }
 
-    // Clean up
-    if (image_buffer)
-    {
-        // Since we are using the PrimaryCCD buffer, we don't need to free it here.
-        // The INDI::CCD class will handle the memory management.
-    }
-
     m_ExposureInProgress = false;
     LOGF_DEBUG("Image download completed: %s", success ? "SUCCESS" : "FAILED");
     return success;
@@ -1718,7 +1657,7 @@ void AlpacaCCD::updateCameraState()
 ////////////////////////////////////////////////////////////////////////////////////////////
 ///
 ////////////////////////////////////////////////////////////////////////////////////////////
-bool AlpacaCCD::processImageBytesData(uint8_t* buffer, size_t buffer_size, const ImageBytesMetadata& metadata)
+bool AlpacaCCD::processImageBytesData(const uint8_t* buffer, size_t buffer_size, const ImageBytesMetadata& metadata)
 {
     // Handle ImageBytes data format as per ASCOM Alpaca API v10 section 8.8
     // ImageBytes uses row-major ordering with specific element ordering rules
@@ -1732,37 +1671,23 @@ bool AlpacaCCD::processImageBytesData(uint8_t* buffer, size_t buffer_size, const
     uint32_t width = metadata.Dimension1;
     uint32_t height = metadata.Dimension2;
     uint32_t planes = (metadata.Rank == 3) ? metadata.Dimension3 : 1;
-    size_t pixel_count = width * height * planes;
+    size_t pixel_count = static_cast<size_t>(width) * height * planes;
 
     LOGF_DEBUG("Image dimensions: %dx%d, planes=%d, pixel_count=%zu", width, height, planes, pixel_count);
 
-    // Determine bytes per element based on transmission type
-    size_t bytes_per_element;
-    switch (metadata.TransmissionElementType)
+    if (metadata.Rank != 2 && metadata.Rank != 3)
     {
-        case 6: // Byte
-            bytes_per_element = 1;
-            break;
-        case 1: // Int16
-        case 8: // UInt16
-            bytes_per_element = 2;
-            break;
-        case 2: // Int32
-        case 9: // UInt32
-        case 4: // Single (float)
-            bytes_per_element = 4;
-            break;
-        case 3: // Double
-        case 5: // UInt64
-        case 7: // Int64
-            bytes_per_element = 8;
-            break;
-        default:
-            LOGF_ERROR("Unsupported transmission element type: %d", metadata.TransmissionElementType);
-            return false;
+        LOGF_ERROR("Unsupported image rank: %d", metadata.Rank);
+        return false;
     }
 
-    LOGF_DEBUG("Bytes per element: %zu", bytes_per_element);
+    // Determine bytes per element based on transmission type
+    size_t bytes_per_element = AlpacaImage::elementSize(metadata.TransmissionElementType);
+    if (bytes_per_element == 0)
+    {
+        LOGF_ERROR("Unsupported transmission element type: %d", metadata.TransmissionElementType);
+        return false;
+    }
 
     // Validate buffer size
     size_t expected_size = pixel_count * bytes_per_element;
@@ -1772,8 +1697,8 @@ bool AlpacaCCD::processImageBytesData(uint8_t* buffer, size_t buffer_size, const
         return false;
     }
 
-    // Convert ImageBytes data to INDI format (typically 16-bit)
-    size_t indi_buffer_size = width * height * sizeof(uint16_t);
+    // Convert ImageBytes data to INDI format (16-bit), color planes are averaged
+    size_t indi_buffer_size = static_cast<size_t>(width) * height * sizeof(uint16_t);
     PrimaryCCD.setFrameBufferSize(indi_buffer_size);
     uint16_t* indi_buffer = reinterpret_cast<uint16_t*>(PrimaryCCD.getFrameBuffer());
     if (!indi_buffer)
@@ -1782,34 +1707,9 @@ bool AlpacaCCD::processImageBytesData(uint8_t* buffer, size_t buffer_size, const
         return false;
     }
 
-    LOGF_DEBUG("Allocated INDI buffer: %zu bytes (%dx%d * 2 bytes/pixel)",
-               indi_buffer_size, width, height);
-
-    // ImageBytes uses row-major ordering as per section 8.8.1
-    // For 2D arrays: rightmost dimension (height) changes most quickly
-    // For 3D arrays: rightmost dimension (color plane) changes most quickly
-
-    if (metadata.Rank == 2)
-    {
-        // 2D monochrome/Bayer image
-        LOG_DEBUG("Converting 2D image data");
-        convertImageBytesToINDI2D(buffer, indi_buffer, width, height, metadata.TransmissionElementType);
-    }
-    else if (metadata.Rank == 3)
-    {
-        // 3D color image - for now, just take the first plane or convert to grayscale
-        // This is a simplified implementation; full color support would require more work
-        LOGF_DEBUG("Converting 3D image data (averaging %d planes to grayscale)", planes);
-        convertImageBytesToINDI3D(buffer, indi_buffer, width, height, planes, metadata.TransmissionElementType);
-    }
-    else
-    {
-        LOGF_ERROR("Unsupported image rank: %d", metadata.Rank);
-        return false;
-    }
-
-    // ImageBytes data is already in the correct coordinate system (FITS standard)
-    // No need to flip coordinates like we do for JSON data
+    // Single pass over the frame: transposed from the Alpaca [x][y] order, converted to 16 bits
+    // and flipped from the ASCOM top-left origin to the INDI bottom-left origin
+    AlpacaImage::toFrame(buffer, metadata.TransmissionElementType, width, height, planes, true, indi_buffer);
 
     // Upload to INDI
     primary_chip->setFrame(0, 0, width, height);
@@ -1823,111 +1723,6 @@ bool AlpacaCCD::processImageBytesData(uint8_t* buffer, size_t buffer_size, const
     return true;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////
-///
-////////////////////////////////////////////////////////////////////////////////////////////
-bool AlpacaCCD::processMonoImage(uint8_t* buffer)
-{
-    // Set up INDI CCD buffer
-    INDI::CCDChip* primary_chip = &PrimaryCCD;
-
-    primary_chip->setImageExtension("fits");
-
-    // Convert data type if needed (INDI typically expects 16-bit)
-    uint16_t* indi_buffer = nullptr;
-    size_t pixel_count = m_CurrentImage.width * m_CurrentImage.height;
-    size_t indi_buffer_size = pixel_count * sizeof(uint16_t);
-    PrimaryCCD.setFrameBufferSize(indi_buffer_size);
-    indi_buffer = reinterpret_cast<uint16_t*>(PrimaryCCD.getFrameBuffer());
-
-    switch (m_CurrentImage.type)
-    {
-        case 1: // 8-bit to 16-bit
-            for (size_t i = 0; i < pixel_count; i++)
-            {
-                indi_buffer[i] = static_cast<uint16_t>(buffer[i]) << 8; // Scale to 16-bit
-            }
-            break;
-
-        case 2: // 16-bit (direct copy)
-            memcpy(indi_buffer, buffer, pixel_count * sizeof(uint16_t));
-            break;
-
-        case 3: // 32-bit to 16-bit (scale down)
-        {
-            uint32_t* src32 = reinterpret_cast<uint32_t*>(buffer);
-            for (size_t i = 0; i < pixel_count; i++)
-            {
-                indi_buffer[i] = static_cast<uint16_t>(src32[i] >> 16); // Scale down
-            }
-            break;
-        }
-        default:
-            LOGF_ERROR("Unsupported Alpaca image type: %d", m_CurrentImage.type);
-            return false;
-    }
-
-    if (!indi_buffer)
-    {
-        LOG_ERROR("Failed to convert image data");
-        return false;
-    }
-
-    // Upload to INDI
-    primary_chip->setFrame(0, 0, m_CurrentImage.width, m_CurrentImage.height);
-    primary_chip->setFrameBuffer(reinterpret_cast<uint8_t*>(indi_buffer)); // Cast to uint8_t*
-    primary_chip->setFrameBufferSize(pixel_count * sizeof(uint16_t), false);
-
-    ExposureComplete(primary_chip);
-
-    return true;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////
-///
-////////////////////////////////////////////////////////////////////////////////////////////
-bool AlpacaCCD::processColorImage(uint8_t* /*buffer*/)
-{
-    // Placeholder for color image processing
-    LOG_WARN("Color image processing not yet implemented.");
-    return false;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////
-///
-////////////////////////////////////////////////////////////////////////////////////////////
-void AlpacaCCD::translateCoordinates(uint8_t* buffer, const ImageMetadata& meta)
-{
-    // ASCOM: (0,0) = top-left, row-major memory
-    // INDI: (0,0) = bottom-left, expects FITS standard
-
-    size_t bytes_per_pixel = (meta.type == 1) ? 1 : (meta.type == 2) ? 2 : (meta.type == 3) ? 4 : 8;
-    size_t row_size = meta.width * bytes_per_pixel;
-
-    // For multi-plane images, flip each plane
-    uint32_t planes = (meta.planes > 0) ? meta.planes : 1;
-
-    for (uint32_t plane = 0; plane < planes; plane++)
-    {
-        uint8_t* plane_start = buffer + (plane * meta.width * meta.height * bytes_per_pixel);
-
-        // Flip image vertically (reverse row order)
-        for (uint32_t y = 0; y < meta.height / 2; y++)
-        {
-            uint8_t* top_row = plane_start + (y * row_size);
-            uint8_t* bottom_row = plane_start + ((meta.height - 1 - y) * row_size);
-
-            // Swap rows
-            for (size_t i = 0; i < row_size; i++)
-            {
-                uint8_t temp = top_row[i];
-                top_row[i] = bottom_row[i];
-                bottom_row[i] = temp;
-            }
-        }
-    }
-}
-
 ////////////////////////////////////////////////////////////////////////////////////////////
 ///
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -1973,243 +1768,6 @@ void AlpacaCCD::temperatureTimerTimeout()
 ////////////////////////////////////////////////////////////////////////////////////////////
 ///
 ////////////////////////////////////////////////////////////////////////////////////////////
-void AlpacaCCD::convertImageBytesToINDI2D(uint8_t* src_buffer, uint16_t* dst_buffer, uint32_t width, uint32_t height,
-        int32_t transmission_type)
-{
-    // Convert ImageBytes 2D data to INDI 16-bit format
-    // ImageBytes uses row-major ordering as per ASCOM Alpaca API v10 section 8.8.1
-    // For 2D arrays: rightmost dimension (height) changes most quickly
-
-    size_t dst_index = 0;
-
-    switch (transmission_type)
-    {
-        case 6: // Byte (8-bit)
-        {
-            uint8_t* src = src_buffer;
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    // Scale 8-bit to 16-bit
-                    dst_buffer[dst_index++] = static_cast<uint16_t>(src[x * height + y]) << 8;
-                }
-            }
-            break;
-        }
-        case 1: // Int16
-        {
-            int16_t* src = reinterpret_cast<int16_t*>(src_buffer);
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    // Convert signed to unsigned, handle negative values
-                    int16_t val = src[x * height + y];
-                    dst_buffer[dst_index++] = static_cast<uint16_t>(val + 32768);
-                }
-            }
-            break;
-        }
-        case 8: // UInt16
-        {
-            uint16_t* src = reinterpret_cast<uint16_t*>(src_buffer);
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    // Direct copy
-                    dst_buffer[dst_index++] = src[x * height + y];
-                }
-            }
-            break;
-        }
-        case 2: // Int32
-        {
-            int32_t* src = reinterpret_cast<int32_t*>(src_buffer);
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    // Scale down from 32-bit to 16-bit
-                    int32_t val = src[x * height + y];
-                    dst_buffer[dst_index++] = static_cast<uint16_t>(val);
-                }
-            }
-            break;
-        }
-        case 9: // UInt32
-        {
-            uint32_t* src = reinterpret_cast<uint32_t*>(src_buffer);
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    // Scale down from 32-bit to 16-bit
-                    uint32_t val = src[x * height + y];
-                    dst_buffer[dst_index++] = static_cast<uint16_t>(val);
-                }
-            }
-            break;
-        }
-        case 4: // Single (float)
-        {
-            float* src = reinterpret_cast<float*>(src_buffer);
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    // Convert float to 16-bit, assuming 0.0-1.0 range
-                    float val = src[x * height + y];
-                    dst_buffer[dst_index++] = static_cast<uint16_t>(val * 65535.0f);
-                }
-            }
-            break;
-        }
-        default:
-            LOGF_ERROR("Unsupported transmission type for 2D conversion: %d", transmission_type);
-            // Fill with zeros as fallback
-            memset(dst_buffer, 0, width * height * sizeof(uint16_t));
-            break;
-    }
-}
-
-void AlpacaCCD::convertImageBytesToINDI3D(uint8_t* src_buffer, uint16_t* dst_buffer, uint32_t width, uint32_t height,
-        uint32_t planes,
-        int32_t transmission_type)
-{
-    // Convert ImageBytes 3D data to INDI 16-bit format
-    // ImageBytes uses row-major ordering as per ASCOM Alpaca API v10 section 8.8.1
-    // For 3D arrays: rightmost dimension (color plane) changes most quickly
-
-    // For now, we'll convert 3D color data to grayscale by averaging the planes
-    // A full color implementation would require more complex handling
-
-    size_t dst_index = 0;
-
-    switch (transmission_type)
-    {
-        case 6: // Byte (8-bit)
-        {
-            uint8_t* src = src_buffer;
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    uint32_t sum = 0;
-                    for (uint32_t p = 0; p < planes; p++)
-                    {
-                        sum += src[(x * height + y) * planes + p];
-                    }
-                    // Average the planes and scale to 16-bit
-                    uint16_t avg = static_cast<uint16_t>((sum / planes)) << 8;
-                    dst_buffer[dst_index++] = avg;
-                }
-            }
-            break;
-        }
-        case 1: // Int16
-        {
-            int16_t* src = reinterpret_cast<int16_t*>(src_buffer);
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    int32_t sum = 0;
-                    for (uint32_t p = 0; p < planes; p++)
-                    {
-                        sum += src[(x * height + y) * planes + p];
-                    }
-                    // Average and convert to unsigned
-                    int16_t avg = static_cast<int16_t>(sum / planes);
-                    dst_buffer[dst_index++] = static_cast<uint16_t>(avg + 32768);
-                }
-            }
-            break;
-        }
-        case 8: // UInt16
-        {
-            uint16_t* src = reinterpret_cast<uint16_t*>(src_buffer);
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    uint32_t sum = 0;
-                    for (uint32_t p = 0; p < planes; p++)
-                    {
-                        sum += src[(x * height + y) * planes + p];
-                    }
-                    // Average the planes
-                    dst_buffer[dst_index++] = static_cast<uint16_t>(sum / planes);
-                }
-            }
-            break;
-        }
-        case 2: // Int32
-        {
-            int32_t* src = reinterpret_cast<int32_t*>(src_buffer);
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    int64_t sum = 0;
-                    for (uint32_t p = 0; p < planes; p++)
-                    {
-                        sum += src[(x * height + y) * planes + p];
-                    }
-                    // Average and scale down
-                    int32_t avg = static_cast<int32_t>(sum / planes);
-                    dst_buffer[dst_index++] = static_cast<uint16_t>(avg >> 16);
-                }
-            }
-            break;
-        }
-        case 9: // UInt32
-        {
-            uint32_t* src = reinterpret_cast<uint32_t*>(src_buffer);
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    uint64_t sum = 0;
-                    for (uint32_t p = 0; p < planes; p++)
-                    {
-                        sum += src[(x * height + y) * planes + p];
-                    }
-                    // Average and scale down
-                    uint32_t avg = static_cast<uint32_t>(sum / planes);
-                    dst_buffer[dst_index++] = static_cast<uint16_t>(avg >> 16);
-                }
-            }
-            break;
-        }
-        case 4: // Single (float)
-        {
-            float* src = reinterpret_cast<float*>(src_buffer);
-            for (uint32_t x = 0; x < width; x++)
-            {
-                for (uint32_t y = 0; y < height; y++)
-                {
-                    float sum = 0.0f;
-                    for (uint32_t p = 0; p < planes; p++)
-                    {
-                        sum += src[(x * height + y) * planes + p];
-                    }
-                    // Average and convert to 16-bit
-                    float avg = sum / planes;
-                    dst_buffer[dst_index++] = static_cast<uint16_t>(avg * 65535.0f);
-                }
-            }
-            break;
-        }
-        default:
-            LOGF_ERROR("Unsupported transmission type for 3D conversion: %d", transmission_type);
-            // Fill with zeros as fallback
-            memset(dst_buffer, 0, width * height * sizeof(uint16_t));
-            break;
-    }
-}
-
 void AlpacaCCD::addFITSKeywords(INDI::CCDChip * targetChip, std::vector<INDI::FITSRecord> &fitsKeywords)
 {
     // Call base class to add standard INDI FITS keywords and custom keywords
@@ -136,21 +136,11 @@ class AlpacaCCD : public INDI::CCD
 
         ImageMetadata m_CurrentImage;
         bool alpacaGetImageReady(); // Declared here
-        bool alpacaGetImageArrayImageBytes(uint8_t** buffer, size_t* buffer_size, ImageBytesMetadata* metadata);
-        bool alpacaGetImageArrayJSON(ImageMetadata &meta, uint8_t** buffer, size_t* buffer_size);
+        bool alpacaGetImageArrayImageBytes(std::string &body, ImageBytesMetadata* metadata);
+        bool alpacaGetImageArrayJSON(ImageMetadata &meta, std::vector<int32_t> &samples);
         bool downloadImage();
-        bool processImageBytesData(uint8_t* buffer, size_t buffer_size, const ImageBytesMetadata &metadata);
-        bool processMonoImage(uint8_t* buffer);
-        bool processColorImage(uint8_t* buffer); // Placeholder for color image processing
-
-        // ImageBytes data conversion helpers
-        void convertImageBytesToINDI2D(uint8_t* src_buffer, uint16_t* dst_buffer, uint32_t width, uint32_t height,
-                                       int32_t transmission_type);
-        void convertImageBytesToINDI3D(uint8_t* src_buffer, uint16_t* dst_buffer, uint32_t width, uint32_t height, uint32_t planes,
-                                       int32_t transmission_type);
-
-        // Data Translation
-        void translateCoordinates(uint8_t* buffer, const ImageMetadata &meta);
+        bool processImageBytesData(const uint8_t* buffer, size_t buffer_size, const ImageBytesMetadata &metadata);
+
         virtual void addFITSKeywords(INDI::CCDChip * targetChip, std::vector<INDI::FITSRecord> &fitsKeywords) override;
 
         // Worker thread for exposure handling
@@ -0,0 +1,243 @@
+/*******************************************************************************
+  Copyright(c) 2026 Jasem Mutlaq. All rights reserved.
+
+ Star catalog cache for the CCD simulators.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "star_catalog.h"
+
+#include "indicom.h"
+#include "locale_compat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <sys/wait.h>
+
+constexpr double StarCatalog::ZoneHeight;
+
+static const uint32_t Zones = static_cast<uint32_t>(180.0 / StarCatalog::ZoneHeight);
+// The query cone is widened by this ratio and margin, in arcminutes, so that it is reused while the pointing moves
+static const double QueryWidening = 1.1;
+static const double QueryMargin = 1.0;
+// The tiles are all dropped past this many, a night of slewing around the sky would keep them all otherwise
+static const size_t MaxTiles = 512;
+// At most this many stars, the brightest, are returned by a query, as the former gsc lookup of a frame returned
+static const size_t MaxStars = 3000;
+
+static inline double toRadians(double degrees)
+{
+    return degrees * M_PI / 180.0;
+}
+
+// Angular distance in degrees
+static double distance(double ra1, double dec1, double ra2, double dec2)
+{
+    double c = sin(toRadians(dec1)) * sin(toRadians(dec2)) + cos(toRadians(dec1)) * cos(toRadians(dec2)) * cos(toRadians(ra1 - ra2));
+    return acos(std::min(1.0, std::max(-1.0, c))) * 180.0 / M_PI;
+}
+
+static uint32_t zoneOf(double dec)
+{
+    int zone = static_cast<int>(std::floor((dec + 90.0) / StarCatalog::ZoneHeight));
+    return static_cast<uint32_t>(std::min(std::max(zone, 0), static_cast<int>(Zones) - 1));
+}
+
+// Tiles of a zone, about ZoneHeight degrees wide on the sky where the zone is the widest
+static uint32_t cellsOf(uint32_t zone)
+{
+    double low = -90.0 + zone * StarCatalog::ZoneHeight;
+    double high = low + StarCatalog::ZoneHeight;
+    double widest = (low <= 0 && high >= 0) ? 0 : std::min(std::fabs(low), std::fabs(high));
+    return std::max(1u, static_cast<uint32_t>(std::floor(360.0 * cos(toRadians(widest)) / StarCatalog::ZoneHeight)));
+}
+
+static uint32_t cellOf(double ra, uint32_t cells)
+{
+    return std::min(static_cast<uint32_t>(range360(ra) * cells / 360.0), cells - 1);
+}
+
+StarCatalog::StarCatalog(Loader loader) : m_Loader(std::move(loader))
+{
+}
+
+void StarCatalog::setLoader(Loader loader)
+{
+    std::lock_guard<std::mutex> guard(m_Lock);
+    m_Loader = std::move(loader);
+    m_Tiles.clear();
+    m_HasLast = false;
+}
+
+void StarCatalog::clear()
+{
+    std::lock_guard<std::mutex> guard(m_Lock);
+    m_Tiles.clear();
+    m_HasLast = false;
+}
+
+bool StarCatalog::loadTile(uint32_t zone, uint32_t cell, double magnitude, Tile &tile)
+{
+    const uint32_t cells = cellsOf(zone);
+    const double width = 360.0 / cells;
+    const double raLow = cell * width;
+    const double decLow = -90.0 + zone * ZoneHeight;
+    const double ra = raLow + width / 2;
+    const double dec = decLow + ZoneHeight / 2;
+
+    // Cone around the tile, the corners being its farthest points
+    double radius = 0;
+    for (double cornerRA : { raLow, raLow + width })
+        for (double cornerDE : { decLow, decLow + ZoneHeight })
+            radius = std::max(radius, distance(ra, dec, cornerRA, cornerDE));
+
+    std::vector<Star> stars;
+    if (!m_Loader || !m_Loader(ra, dec, radius * 60 + QueryMargin, magnitude, stars))
+        return false;
+    m_Loads++;
+
+    // Keep the stars of this tile only, the others belong to the tiles around it
+    tile.stars.clear();
+    for (const auto &star : stars)
+    {
+        if (zoneOf(star.dec) == zone && cellOf(star.ra, cells) == cell)
+            tile.stars.push_back(star);
+    }
+    tile.magnitude = magnitude;
+    return true;
+}
+
+bool StarCatalog::query(double ra, double dec, double radius, double magnitude, std::vector<Star> &stars)
+{
+    std::lock_guard<std::mutex> guard(m_Lock);
+
+    if (m_HasLast && magnitude == m_LastMagnitude && distance(ra, dec, m_LastRA, m_LastDE) * 60 + radius <= m_LastRadius)
+    {
+        stars = m_LastStars;
+        return true;
+    }
+
+    const double widened = radius * QueryWidening + QueryMargin;
+    const double r = widened / 60.0;
+    const double cosRadius = cos(toRadians(r));
+    const double sinDE = sin(toRadians(dec)), cosDE = cos(toRadians(dec));
+    // A cone around a pole covers every right ascension
+    const bool polar = std::fabs(dec) + r >= 90.0;
+    const double spanRA = polar ? 180.0 : asin(std::min(1.0, sin(toRadians(r)) / cosDE)) * 180.0 / M_PI;
+
+    std::vector<Star> result;
+    for (uint32_t zone = zoneOf(dec - r); zone <= zoneOf(dec + r); zone++)
+    {
+        const uint32_t cells = cellsOf(zone);
+        const double width = 360.0 / cells;
+        int first = static_cast<int>(std::floor((ra - spanRA) / width));
+        int last = static_cast<int>(std::floor((ra + spanRA) / width));
+        if (polar || last - first + 1 >= static_cast<int>(cells))
+        {
+            first = 0;
+            last = cells - 1;
+        }
+
+        for (int c = first; c <= last; c++)
+        {
+            const uint32_t cell = static_cast<uint32_t>((c % static_cast<int>(cells) + cells) % cells);
+            auto found = m_Tiles.find(zone * 1024 + cell);
+            if (found == m_Tiles.end() || found->second.magnitude < magnitude)
+            {
+                if (found == m_Tiles.end() && m_Tiles.size() >= MaxTiles)
+                    m_Tiles.clear();
+                Tile &tile = m_Tiles[zone * 1024 + cell];
+                if (!loadTile(zone, cell, magnitude, tile))
+                {
+                    m_Tiles.erase(zone * 1024 + cell);
+                    return false;
+                }
+                found = m_Tiles.find(zone * 1024 + cell);
+            }
+
+            for (const auto &star : found->second.stars)
+            {
+                if (star.mag > magnitude)
+                    continue;
+                double cosDistance = sinDE * sin(toRadians(star.dec)) + cosDE * cos(toRadians(star.dec)) * cos(toRadians(star.ra - ra));
+                if (cosDistance >= cosRadius)
+                    result.push_back(star);
+            }
+        }
+    }
+
+    if (result.size() > MaxStars)
+    {
+        std::nth_element(result.begin(), result.begin() + MaxStars, result.end(), [](const Star & a, const Star & b)
+        {
+            return a.mag < b.mag;
+        });
+        result.resize(MaxStars);
+    }
+
+    m_HasLast = true;
+    m_LastRA = ra;
+    m_LastDE = dec;
+    m_LastRadius = widened;
+    m_LastMagnitude = magnitude;
+    m_LastStars = result;
+    stars.swap(result);
+    return true;
+}
+
+bool StarCatalog::gscLoader(double ra, double dec, double radius, double magnitude, std::vector<Star> &stars)
+{
+    AutoCNumeric locale;
+    char gsccmd[250];
+
+    // A tile must not be truncated, the frames would miss the stars of its far side. Even along the galactic plane a
+    // tile holds a few thousand GSC stars, the limit only guards against runaway output.
+    snprintf(gsccmd, sizeof(gsccmd), "gsc -c %8.6f %+8.6f -r %4.1f -m 0 %4.2f -n 100000", range360(ra), rangeDec(dec), radius,
+             magnitude);
+
+    FILE *pp = popen(gsccmd, "r");
+    if (pp == nullptr)
+        return false;
+
+    char line[256];
+    while (fgets(line, 256, pp) != nullptr)
+    {
+        //  ok, lets parse this line for specifics we want
+        char id[20];
+        char plate[6];
+        char ob[6];
+        float mag;
+        float mage;
+        float sra;
+        float sdec;
+        float pose;
+        int band;
+        float dist;
+        int dir;
+        int c;
+
+        int rc = sscanf(line, "%10s %f %f %f %f %f %d %d %4s %2s %f %d", id, &sra, &sdec, &pose, &mag, &mage, &band, &c, plate, ob,
+                        &dist, &dir);
+        if (rc == 12)
+            stars.push_back({ sra, sdec, mag });
+    }
+
+    // The shell exits with 127 when gsc is not installed
+    int status = pclose(pp);
+    return status != -1 && !(WIFEXITED(status) && WEXITSTATUS(status) == 127);
+}
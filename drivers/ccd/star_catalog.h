@@ -0,0 +1,100 @@
+/*******************************************************************************
+  Copyright(c) 2026 Jasem Mutlaq. All rights reserved.
+
+ Star catalog cache for the CCD simulators.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief The StarCatalog class keeps the stars drawn by the simulators in memory.
+ *
+ * The sky is split into declination zones of ZoneHeight degrees, each split in right ascension into tiles about as
+ * wide as they are high. A tile is loaded once from the catalog, by default the General-Star-Catalog (gsc) tool,
+ * and cone queries are then answered from the tiles they cover. The result of the last query is reused as long as
+ * the cone stays within it, so that a mount tracking or guiding does not scan the tiles on every frame.
+ */
+class StarCatalog
+{
+    public:
+        struct Star
+        {
+            // J2000 coordinates in degrees
+            double ra;
+            double dec;
+            float mag;
+        };
+
+        /**
+         * Fetch the stars within radius arcminutes of ra and dec, in degrees, brighter than magnitude.
+         * Returns false if the catalog could not be read.
+         */
+        typedef std::function<bool(double ra, double dec, double radius, double magnitude, std::vector<Star> &stars)>
+        Loader;
+
+        // Height of the declination zones, in degrees
+        static constexpr double ZoneHeight = 2.0;
+
+        explicit StarCatalog(Loader loader = gscLoader);
+
+        /**
+         * Stars within radius arcminutes of ra and dec, in degrees, brighter than magnitude.
+         * The stars of a slightly larger cone may be returned, when they are reused from the previous query.
+         * Returns false if a tile could not be loaded.
+         */
+        bool query(double ra, double dec, double radius, double magnitude, std::vector<Star> &stars);
+
+        void setLoader(Loader loader);
+        // Forget the loaded tiles, for instance once the catalog changed
+        void clear();
+
+        // Number of tiles loaded from the catalog so far
+        uint32_t loads() const
+        {
+            return m_Loads;
+        }
+
+        // Read the stars of a cone from the gsc tool
+        static bool gscLoader(double ra, double dec, double radius, double magnitude, std::vector<Star> &stars);
+
+    private:
+        struct Tile
+        {
+            std::vector<Star> stars;
+            // Magnitude limit the tile was loaded to
+            double magnitude { 0 };
+        };
+
+        bool loadTile(uint32_t zone, uint32_t cell, double magnitude, Tile &tile);
+
+        Loader m_Loader;
+        std::unordered_map<uint32_t, Tile> m_Tiles;
+        uint32_t m_Loads { 0 };
+
+        // Previous query, widened to cover small moves of the pointing
+        bool m_HasLast { false };
+        double m_LastRA { 0 }, m_LastDE { 0 }, m_LastRadius { 0 }, m_LastMagnitude { 0 };
+        std::vector<Star> m_LastStars;
+
+        std::mutex m_Lock;
+};
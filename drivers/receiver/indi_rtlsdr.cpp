@@ -27,9 +27,11 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <termios.h>
+#include <poll.h>
 #include <indilogger.h>
 #include <memory>
 #include <deque>
+#include <vector>
 #include <indicom.h>
 
 #define min(a, b)               \
@@ -56,7 +58,14 @@ void RTLSDR::Callback()
     setBufferSize(getBufferSize() + MAX_FRAME_SIZE - (getBufferSize() % MAX_FRAME_SIZE));
     to_read = getBufferSize();
     buffer = (unsigned char *)realloc(buffer, min(MAX_FRAME_SIZE, getBufferSize()));
-    if((getSensorConnection() & CONNECTION_TCP) == 0)
+    // The reader owns the device in continuous mode, the samples read before the integration are dropped
+    const bool continuous = m_Reading;
+    if (continuous)
+    {
+        m_Consuming = true;
+        m_Ring.clear();
+    }
+    else if((getSensorConnection() & CONNECTION_TCP) == 0)
         rtlsdr_reset_buffer(rtl_dev);
     else
         tcflush(PortFD, TCIFLUSH);
@@ -68,7 +77,9 @@ void RTLSDR::Callback()
     {
         if (to_read > 0)
         {
-            if((getSensorConnection() & CONNECTION_TCP) == 0)
+            if (continuous)
+                n_read = static_cast<int>(m_Ring.read(continuum + b_read, to_read, std::chrono::milliseconds(100)));
+            else if((getSensorConnection() & CONNECTION_TCP) == 0)
                 rtlsdr_read_sync(rtl_dev, continuum + b_read, min(MAX_FRAME_SIZE, to_read), &n_read);
             else
                 n_read = read(PortFD, continuum + b_read, min(MAX_FRAME_SIZE, to_read));
@@ -93,6 +104,70 @@ void RTLSDR::Callback()
             LOG_INFO("Download complete.");
         }
     }
+    m_Consuming = false;
+}
+
+void RTLSDR::readerCallback(unsigned char *buf, uint32_t len, void *ctx)
+{
+    RTLSDR *receiver = static_cast<RTLSDR *>(ctx);
+    if (receiver->m_Consuming)
+        receiver->m_Ring.write(buf, len);
+}
+
+void RTLSDR::readerLoop()
+{
+    if((getSensorConnection() & CONNECTION_TCP) == 0)
+    {
+        rtlsdr_reset_buffer(rtl_dev);
+        // Returns once stopReader cancels it
+        if (rtlsdr_read_async(rtl_dev, &RTLSDR::readerCallback, this, 0, MAX_FRAME_SIZE) < 0 && m_Reading)
+            LOG_ERROR("Failed to read the samples of the receiver.");
+    }
+    else
+    {
+        std::vector<uint8_t> chunk(MAX_FRAME_SIZE);
+        tcflush(PortFD, TCIFLUSH);
+        while (m_Reading)
+        {
+            struct pollfd fd = { PortFD, POLLIN, 0 };
+            if (poll(&fd, 1, 100) <= 0)
+                continue;
+            ssize_t count = read(PortFD, chunk.data(), chunk.size());
+            if (count <= 0)
+            {
+                LOG_ERROR("Failed to read the samples of the rtl_tcp server.");
+                break;
+            }
+            if (m_Consuming)
+                m_Ring.write(chunk.data(), count);
+        }
+    }
+    m_ReaderDone = true;
+}
+
+void RTLSDR::startReader()
+{
+    if (m_Reading)
+        return;
+    m_Ring.clear();
+    m_Ring.resetCounters();
+    m_Reading = true;
+    m_ReaderDone = false;
+    m_Reader = std::thread(&RTLSDR::readerLoop, this);
+}
+
+void RTLSDR::stopReader()
+{
+    if (!m_Reading)
+        return;
+    m_Reading = false;
+    // Cancelling fails until the asynchronous read has started
+    if((getSensorConnection() & CONNECTION_TCP) == 0)
+    {
+        while (!m_ReaderDone && rtlsdr_cancel_async(rtl_dev) != 0)
+            usleep(1000);
+    }
+    m_Reader.join();
 }
 
 static class Loader
@@ -139,6 +214,15 @@ RTLSDR::RTLSDR(int32_t index)
     buffer = (unsigned char*)malloc(1);
 }
 
+RTLSDR::~RTLSDR()
+{
+    InIntegration = false;
+    if (m_Consumer.joinable())
+        m_Consumer.join();
+    stopReader();
+    waitIntegrationsComplete();
+}
+
 bool RTLSDR::Connect()
 {
     if((getSensorConnection() & CONNECTION_TCP) == 0)
@@ -159,6 +243,9 @@ bool RTLSDR::Connect()
 bool RTLSDR::Disconnect()
 {
     InIntegration = false;
+    if (m_Consumer.joinable())
+        m_Consumer.join();
+    stopReader();
     if((getSensorConnection() & CONNECTION_TCP) == 0)
     {
         rtlsdr_close(rtl_dev);
@@ -200,6 +287,15 @@ bool RTLSDR::initProperties()
     setMinMaxStep("RECEIVER_SETTINGS", "RECEIVER_ANTENNA", 1, 1, 0, true);
     setIntegrationFileExtension("fits");
 
+    AcquisitionSP[ACQUISITION_SYNC].fill("ACQUISITION_SYNC", "Synchronous", ISS_OFF);
+    AcquisitionSP[ACQUISITION_RING].fill("ACQUISITION_RING", "Continuous", ISS_ON);
+    AcquisitionSP.fill(getDeviceName(), "RECEIVER_ACQUISITION", "Acquisition", MAIN_CONTROL_TAB, IP_RW, ISR_1OFMANY, 60,
+                       IPS_IDLE);
+
+    OverrunsNP[OVERRUNS].fill("OVERRUNS", "Overruns", "%.f", 0, 1e12, 0, 0);
+    OverrunsNP[DROPPED_BYTES].fill("DROPPED_BYTES", "Dropped bytes", "%.f", 0, 1e15, 0, 0);
+    OverrunsNP.fill(getDeviceName(), "RECEIVER_OVERRUNS", "Overruns", MAIN_CONTROL_TAB, IP_RO, 60, IPS_IDLE);
+
     // Add Debug, Simulator, and Configuration controls
     addAuxControls();
 
@@ -221,9 +317,19 @@ bool RTLSDR::updateProperties()
         // Initial values
         setupParams(1000000, 1420000000, 10);
 
+        defineProperty(AcquisitionSP);
+        defineProperty(OverrunsNP);
+        if (AcquisitionSP.findOnSwitchIndex() == ACQUISITION_RING)
+            startReader();
+
         // Start the timer
         SetTimer(getCurrentPollingPeriod());
     }
+    else
+    {
+        deleteProperty(AcquisitionSP);
+        deleteProperty(OverrunsNP);
+    }
 
     return true;
 }
@@ -325,6 +431,33 @@ bool RTLSDR::ISNewNumber(const char *dev, const char *name, double values[], cha
     return processNumber(dev, name, values, names, n) & !r;
 }
 
+bool RTLSDR::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if (dev && !strcmp(dev, getDeviceName()) && AcquisitionSP.isNameMatch(name))
+    {
+        if (InIntegration)
+        {
+            LOG_WARN("Cannot change the acquisition mode while integrating.");
+            AcquisitionSP.setState(IPS_ALERT);
+            AcquisitionSP.apply();
+            return true;
+        }
+
+        AcquisitionSP.update(states, names, n);
+        if (isConnected())
+        {
+            if (AcquisitionSP.findOnSwitchIndex() == ACQUISITION_RING)
+                startReader();
+            else
+                stopReader();
+        }
+        AcquisitionSP.setState(IPS_OK);
+        AcquisitionSP.apply();
+        return true;
+    }
+    return INDI::Receiver::ISNewSwitch(dev, name, states, names, n);
+}
+
 /**************************************************************************************
 ** Client is asking us to start an exposure
 ***************************************************************************************/
@@ -333,8 +466,17 @@ bool RTLSDR::StartIntegration(double duration)
     IntegrationRequest = static_cast<float>(duration);
     AbortIntegration();
 
+    // Only one thread takes the samples from the ring, the previous integration is done first
+    if (m_Consumer.joinable())
+    {
+        if (m_Consumer.get_id() == std::this_thread::get_id())
+            m_Consumer.detach();
+        else
+            m_Consumer.join();
+    }
+
     // Run threads
-    std::thread(&RTLSDR::Callback, this).detach();
+    m_Consumer = std::thread(&RTLSDR::Callback, this);
     return true;
 }
 
@@ -392,6 +534,14 @@ void RTLSDR::TimerHit()
         setIntegrationLeft(timeleft);
     }
 
+    if (OverrunsNP[OVERRUNS].getValue() != m_Ring.overruns())
+    {
+        OverrunsNP[OVERRUNS].setValue(m_Ring.overruns());
+        OverrunsNP[DROPPED_BYTES].setValue(m_Ring.droppedBytes());
+        OverrunsNP.setState(m_Ring.overruns() > 0 ? IPS_ALERT : IPS_OK);
+        OverrunsNP.apply();
+    }
+
     SetTimer(getCurrentPollingPeriod());
     return;
 }
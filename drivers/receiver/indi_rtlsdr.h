@@ -26,6 +26,10 @@
 #include <rtl-sdr.h>
 #include "indireceiver.h"
 #include "stream/streammanager.h"
+#include "sample_ring.h"
+
+#include <atomic>
+#include <thread>
 
 enum Settings
 {
@@ -38,6 +42,7 @@ class RTLSDR : public INDI::Receiver
 {
     public:
         RTLSDR(int32_t index);
+        ~RTLSDR();
 
         void grabData();
         rtlsdr_dev *rtl_dev = { nullptr };
@@ -47,6 +52,7 @@ class RTLSDR : public INDI::Receiver
         uint8_t *buffer;
         int b_read, n_read;
         bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
+        bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
 
     protected:
         // General device functions
@@ -71,6 +77,12 @@ class RTLSDR : public INDI::Receiver
     private:
         void Callback();
 
+        // Continuous acquisition, a reader thread stores the samples in the ring and the integrations take them from it
+        void startReader();
+        void stopReader();
+        void readerLoop();
+        static void readerCallback(unsigned char *buf, uint32_t len, void *ctx);
+
         // Utility functions
         float CalcTimeLeft();
 
@@ -85,6 +97,27 @@ class RTLSDR : public INDI::Receiver
         pthread_t primary_thread;
         bool terminateThread;
 
+        SampleRing m_Ring;
+        std::thread m_Reader;
+        std::thread m_Consumer;
+        std::atomic<bool> m_Reading { false };
+        std::atomic<bool> m_ReaderDone { true };
+        // The samples are only stored while an integration or a stream takes them
+        std::atomic<bool> m_Consuming { false };
+
+        INDI::PropertySwitch AcquisitionSP {2};
+        enum
+        {
+            ACQUISITION_SYNC,
+            ACQUISITION_RING
+        };
+        INDI::PropertyNumber OverrunsNP {2};
+        enum
+        {
+            OVERRUNS,
+            DROPPED_BYTES
+        };
+
         bool sendTcpCommand(int cmd, int value);
         enum TcpCommands
         {
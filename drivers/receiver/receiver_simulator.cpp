@@ -22,7 +22,9 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <indilogger.h>
+#include <chrono>
 #include <memory>
+#include <vector>
 
 #define SPECTRUM_SIZE (256)
 #define min(a,b) \
@@ -30,19 +32,23 @@
       __typeof__ (b) _b = (b); \
     _a < _b ? _a : _b; })
 
-static pthread_cond_t cv         = PTHREAD_COND_INITIALIZER;
-static pthread_mutex_t condMutex = PTHREAD_MUTEX_INITIALIZER;
 std::unique_ptr<RadioSim> receiver(new RadioSim());
 
 RadioSim::RadioSim()
 {
-    streamPredicate = 0;
-    terminateThread = false;
 }
 
 RadioSim::~RadioSim()
 {
-
+    InIntegration = false;
+    if (m_Consumer.joinable())
+        m_Consumer.join();
+    if (m_Producing)
+    {
+        m_Producing = false;
+        m_Producer.join();
+    }
+    waitIntegrationsComplete();
 }
 
 /**************************************************************************************
@@ -55,10 +61,14 @@ bool RadioSim::Connect()
     // JM 2017-07-31 SetTimer already called in updateProperties(). Just call it once
     //SetTimer(getCurrentPollingPeriod());
 
-    streamPredicate = 0;
-    terminateThread = false;
-    // Run threads
-    std::thread(&RadioSim::streamCaptureHelper, this).detach();
+    streamPredicate = false;
+    if (!m_Producing)
+    {
+        m_Ring.clear();
+        m_Ring.resetCounters();
+        m_Producing = true;
+        m_Producer = std::thread(&RadioSim::produceSamples, this);
+    }
     SetTimer(getCurrentPollingPeriod());
 
     return true;
@@ -70,12 +80,15 @@ bool RadioSim::Connect()
 bool RadioSim::Disconnect()
 {
     InIntegration = false;
+    streamPredicate = false;
+    if (m_Consumer.joinable())
+        m_Consumer.join();
+    if (m_Producing)
+    {
+        m_Producing = false;
+        m_Producer.join();
+    }
     setBufferSize(1);
-    pthread_mutex_lock(&condMutex);
-    streamPredicate = 1;
-    terminateThread = true;
-    pthread_cond_signal(&cv);
-    pthread_mutex_unlock(&condMutex);
     LOG_INFO("Simulator Receiver disconnected successfully!");
     return true;
 }
@@ -108,6 +121,10 @@ bool RadioSim::initProperties()
     setMinMaxStep("RECEIVER_SETTINGS", "RECEIVER_BITSPERSAMPLE", 16, 16, 0, false);
     setIntegrationFileExtension("fits");
 
+    OverrunsNP[OVERRUNS].fill("OVERRUNS", "Overruns", "%.f", 0, 1e12, 0, 0);
+    OverrunsNP[DROPPED_BYTES].fill("DROPPED_BYTES", "Dropped bytes", "%.f", 0, 1e15, 0, 0);
+    OverrunsNP.fill(getDeviceName(), "RECEIVER_OVERRUNS", "Overruns", MAIN_CONTROL_TAB, IP_RO, 60, IPS_IDLE);
+
     // Add Debug, Simulator, and Configuration controls
     addAuxControls();
 
@@ -126,9 +143,13 @@ bool RadioSim::updateProperties()
         // Initial values
         setupParams(1000000, 1420000000, 10000, 10);
 
+        defineProperty(OverrunsNP);
+
         // Start the timer
         SetTimer(getCurrentPollingPeriod());
     }
+    else
+        deleteProperty(OverrunsNP);
 
     return INDI::Receiver::updateProperties();
 }
@@ -183,6 +204,15 @@ bool RadioSim::StartIntegration(double duration)
     IntegrationRequest = duration;
     AbortIntegration();
 
+    // Only one thread takes the samples from the ring, the previous integration is done first
+    if (m_Consumer.joinable())
+    {
+        if (m_Consumer.get_id() == std::this_thread::get_id())
+            m_Consumer.detach();
+        else
+            m_Consumer.join();
+    }
+
     // Since we have only have one Receiver with one chip, we set the exposure duration of the primary Receiver
     setIntegrationTime(duration);
     int to_read = getSampleRate() * getIntegrationTime() * abs(getBPS()) / 8;
@@ -197,7 +227,7 @@ bool RadioSim::StartIntegration(double duration)
         Streamer->setSize(getBufferSize() * 8 / abs(getBPS()), 1);
     }
 
-    // We're done
+    m_Consumer = std::thread(&RadioSim::integrate, this);
     return true;
 }
 
@@ -247,107 +277,108 @@ void RadioSim::TimerHit()
         if(timeleft <= 0.0)
         {
             /* We're done capturing */
-            LOG_INFO("Integration done, expecting data...");
             timeleft = 0.0;
-            grabData();
         }
 
         // This is an over simplified timing method, check ReceiverSimulator and RadioSimReceiver for better timing checks
         setIntegrationLeft(timeleft);
     }
 
+    if (OverrunsNP[OVERRUNS].getValue() != m_Ring.overruns())
+    {
+        OverrunsNP[OVERRUNS].setValue(m_Ring.overruns());
+        OverrunsNP[DROPPED_BYTES].setValue(m_Ring.droppedBytes());
+        OverrunsNP.setState(m_Ring.overruns() > 0 ? IPS_ALERT : IPS_OK);
+        OverrunsNP.apply();
+    }
+
     SetTimer(getCurrentPollingPeriod());
     return;
 }
 
 /**************************************************************************************
-** Create the spectrum
+** Produce the samples, as a receiver would read them
 ***************************************************************************************/
-void RadioSim::grabData()
+void RadioSim::produceSamples()
 {
-    if(InIntegration)
-    {
+    std::vector<uint8_t> chunk;
+    uint32_t seed = 1;
+    double pending = 0;
+    auto last = std::chrono::steady_clock::now();
 
-        LOG_INFO("Downloading...");
-        InIntegration = false;
+    while (m_Producing)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
 
-        uint8_t* continuum;
-        int size = getBufferSize();
+        // Bytes read by the receiver since the previous chunk
+        auto now = std::chrono::steady_clock::now();
+        pending += std::chrono::duration<double>(now - last).count() * getSampleRate() * abs(getBPS()) / 8;
+        last = now;
+        size_t size = static_cast<size_t>(pending);
+        pending -= size;
 
-        //Fill the continuum
-        continuum = getBuffer();
-        for(int i = 0; i < size; i++)
-            continuum[i] = rand() % 255;
+        if (!m_Consuming)
+            continue;
 
-        LOG_INFO("Download complete.");
-        IntegrationComplete();
+        chunk.resize(size);
+        for (auto &sample : chunk)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            sample = static_cast<uint8_t>(seed >> 24);
+        }
+        m_Ring.write(chunk.data(), size);
     }
 }
 
-//Streamer API functions
-
-bool RadioSim::StartStreaming()
-{
-    pthread_mutex_lock(&condMutex);
-    streamPredicate = 1;
-    pthread_mutex_unlock(&condMutex);
-    pthread_cond_signal(&cv);
-
-    return true;
-}
-
-bool RadioSim::StopStreaming()
+/**************************************************************************************
+** Take the integrations and the stream frames from the ring
+***************************************************************************************/
+void RadioSim::integrate()
 {
-    pthread_mutex_lock(&condMutex);
-    streamPredicate = 0;
-    pthread_mutex_unlock(&condMutex);
-    pthread_cond_signal(&cv);
-
-    return true;
-}
+    uint8_t *continuum = getBuffer();
+    int to_read = getBufferSize();
+    int b_read = 0;
 
-void RadioSim::streamCaptureHelper()
-{
-    struct itimerval tframe1, tframe2;
-    double deltas;
-    getitimer(ITIMER_REAL, &tframe1);
-    auto s1 = ((double)tframe2.it_value.tv_sec) + ((double)tframe2.it_value.tv_usec / 1e6);
-    auto s2 = ((double)tframe2.it_value.tv_sec) + ((double)tframe2.it_value.tv_usec / 1e6);
+    // The samples produced before the integration are dropped
+    m_Consuming = true;
+    m_Ring.clear();
 
-    while (true)
+    while (InIntegration)
     {
-        pthread_mutex_lock(&condMutex);
-
-        while (streamPredicate == 0)
+        if (to_read > 0)
         {
-            pthread_cond_wait(&cv, &condMutex);
+            int n_read = static_cast<int>(m_Ring.read(continuum + b_read, to_read, std::chrono::milliseconds(100)));
+            b_read += n_read;
+            to_read -= n_read;
         }
-        StartIntegration(1.0 / Streamer->getTargetFPS());
-
-        if (terminateThread)
-            break;
-
-        // release condMutex
-        pthread_mutex_unlock(&condMutex);
-
-        // Simulate exposure time
-        //usleep(ExposureRequest*1e5);
-        grabData();
-        getitimer(ITIMER_REAL, &tframe1);
-
-        s2 = ((double)tframe2.it_value.tv_sec) + ((double)tframe2.it_value.tv_usec / 1e6);
-        deltas = fabs(s2 - s1);
-
-        if (deltas < IntegrationTime)
-            usleep(fabs(IntegrationTime - deltas) * 1e6);
-
-        int32_t size = getBufferSize();
-        Streamer->newFrame(getBuffer(), size);
+        else if (!streamPredicate)
+        {
+            InIntegration = false;
+            LOG_INFO("Download complete.");
+            IntegrationComplete();
+        }
+        else
+        {
+            Streamer->newFrame(getBuffer(), getBufferSize());
+            to_read = getBufferSize();
+            b_read = 0;
+        }
+    }
+    m_Consuming = false;
+}
 
-        s1 = ((double)tframe1.it_value.tv_sec) + ((double)tframe1.it_value.tv_usec / 1e6);
+//Streamer API functions
 
-        getitimer(ITIMER_REAL, &tframe2);
-    }
+bool RadioSim::StartStreaming()
+{
+    streamPredicate = true;
+    return StartIntegration(1.0 / Streamer->getTargetFPS());
+}
 
-    pthread_mutex_unlock(&condMutex);
+bool RadioSim::StopStreaming()
+{
+    streamPredicate = false;
+    return AbortIntegration();
 }
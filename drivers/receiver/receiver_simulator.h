@@ -23,6 +23,10 @@
 #include "stream/streammanager.h"
 #include "dsp/convolution.h"
 #include "dsp/transforms.h"
+#include "sample_ring.h"
+
+#include <atomic>
+#include <thread>
 
 enum Settings
 {
@@ -54,9 +58,12 @@ class RadioSim : public INDI::Receiver
 
         bool StartStreaming() override;
         bool StopStreaming() override;
-        void streamCaptureHelper();
-        void * streamCapture();
-        void grabData();
+
+        // Synthetic samples are produced at the sample rate into the ring, the integrations and the stream take them from it
+        void produceSamples();
+        void integrate();
+
+        SampleRing m_Ring;
 
     private:
 
@@ -66,7 +73,18 @@ class RadioSim : public INDI::Receiver
         struct timeval CapStart;
         double IntegrationRequest;
 
-        int streamPredicate;
-        pthread_t primary_thread;
-        bool terminateThread;
+        std::atomic<bool> streamPredicate { false };
+
+        std::thread m_Producer;
+        std::thread m_Consumer;
+        std::atomic<bool> m_Producing { false };
+        // The samples are only stored while an integration or a stream takes them
+        std::atomic<bool> m_Consuming { false };
+
+        INDI::PropertyNumber OverrunsNP {2};
+        enum
+        {
+            OVERRUNS,
+            DROPPED_BYTES
+        };
 };
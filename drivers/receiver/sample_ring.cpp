@@ -0,0 +1,99 @@
+/*
+    Sample ring buffer for the INDI receivers
+    Copyright (C) 2026 Jasem Mutlaq
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "sample_ring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+SampleRing::SampleRing(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+    m_Buffer.resize(size);
+    m_Mask = size - 1;
+}
+
+bool SampleRing::write(const uint8_t *data, size_t size)
+{
+    const uint64_t head = m_Head.load(std::memory_order_relaxed);
+    const uint64_t tail = m_Tail.load(std::memory_order_acquire);
+    if (size > m_Buffer.size() - (head - tail))
+    {
+        m_Overruns.fetch_add(1, std::memory_order_relaxed);
+        m_DroppedBytes.fetch_add(size, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Copied in up to two parts, around the end of the buffer
+    const size_t offset = head & m_Mask;
+    const size_t first = std::min(size, m_Buffer.size() - offset);
+    memcpy(m_Buffer.data() + offset, data, first);
+    memcpy(m_Buffer.data(), data + first, size - first);
+
+    m_Head.store(head + size, std::memory_order_release);
+    return true;
+}
+
+size_t SampleRing::read(uint8_t *data, size_t size, std::chrono::milliseconds timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    size_t done = 0;
+    while (done < size)
+    {
+        const uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+        const uint64_t head = m_Head.load(std::memory_order_acquire);
+        const size_t count = std::min<size_t>(size - done, head - tail);
+        if (count == 0)
+        {
+            // The producer does not signal, poll at a fraction of a typical read
+            if (std::chrono::steady_clock::now() >= deadline)
+                break;
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            continue;
+        }
+
+        const size_t offset = tail & m_Mask;
+        const size_t first = std::min(count, m_Buffer.size() - offset);
+        memcpy(data + done, m_Buffer.data() + offset, first);
+        memcpy(data + done + first, m_Buffer.data(), count - first);
+
+        m_Tail.store(tail + count, std::memory_order_release);
+        done += count;
+    }
+    return done;
+}
+
+void SampleRing::clear()
+{
+    m_Tail.store(m_Head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+size_t SampleRing::available() const
+{
+    return m_Head.load(std::memory_order_acquire) - m_Tail.load(std::memory_order_acquire);
+}
+
+void SampleRing::resetCounters()
+{
+    m_Overruns.store(0, std::memory_order_relaxed);
+    m_DroppedBytes.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,85 @@
+/*
+    Sample ring buffer for the INDI receivers
+    Copyright (C) 2026 Jasem Mutlaq
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief The SampleRing class is a lock-free ring of samples between the thread reading a receiver and the
+ * thread consuming its integrations or stream frames.
+ *
+ * There must be a single producer and a single consumer. The producer never waits: when the ring cannot
+ * hold a whole read, the read is dropped and counted as an overrun.
+ */
+class SampleRing
+{
+    public:
+        // The capacity is rounded up to a power of two, the default holds two seconds of 16 bit samples at 2 MS/s
+        explicit SampleRing(size_t capacity = 1 << 23);
+
+        /**
+         * @brief write Store the samples read by the producer.
+         * @return false if the ring was too full and the samples were dropped.
+         */
+        bool write(const uint8_t *data, size_t size);
+
+        /**
+         * @brief read Copy the oldest samples, waiting up to timeout for size bytes to be available.
+         * @return number of bytes copied, less than size on timeout.
+         */
+        size_t read(uint8_t *data, size_t size, std::chrono::milliseconds timeout);
+
+        // Drop the samples stored so far, from the consumer
+        void clear();
+
+        // Bytes waiting to be read
+        size_t available() const;
+
+        size_t capacity() const
+        {
+            return m_Buffer.size();
+        }
+
+        // Producer reads dropped since the last resetCounters, and the bytes they held
+        uint64_t overruns() const
+        {
+            return m_Overruns.load(std::memory_order_relaxed);
+        }
+        uint64_t droppedBytes() const
+        {
+            return m_DroppedBytes.load(std::memory_order_relaxed);
+        }
+        void resetCounters();
+
+    private:
+        std::vector<uint8_t> m_Buffer;
+        size_t m_Mask { 0 };
+
+        // Total bytes written by the producer and read by the consumer, on their own cache lines
+        alignas(64) std::atomic<uint64_t> m_Head { 0 };
+        alignas(64) std::atomic<uint64_t> m_Tail { 0 };
+
+        std::atomic<uint64_t> m_Overruns { 0 };
+        std::atomic<uint64_t> m_DroppedBytes { 0 };
+};
@@ -14,6 +14,8 @@
 
 #include "indicom.h"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <iostream>
 #include <map>
@@ -22,10 +24,95 @@ namespace INDI
 {
 namespace AlignmentSubsystem
 {
+/// Facets wider than this, in radians, are listed in every cell of the cube map as their bounding cap is not convex
+static const double MaxBoundedFacet = 80.0 * M_PI / 180.0;
+
+/// Bounding cap of a cell of the cube map
+struct CubeMapCell
+{
+    TelescopeDirectionVector Centre;
+    double CosRadius;
+    double SinRadius;
+};
+
+/// Direction of the point (u, v) of a face of the cube map, u and v ranging from -1 to 1
+static TelescopeDirectionVector CubeMapDirection(int Face, double u, double v)
+{
+    double Side = (Face & 1) ? -1.0 : 1.0;
+    TelescopeDirectionVector Direction;
+    switch (Face / 2)
+    {
+        case 0:
+            Direction = TelescopeDirectionVector(Side, u, v);
+            break;
+        case 1:
+            Direction = TelescopeDirectionVector(u, Side, v);
+            break;
+        default:
+            Direction = TelescopeDirectionVector(u, v, Side);
+            break;
+    }
+    Direction.Normalise();
+    return Direction;
+}
+
+/// Index of the cube map cell a direction falls in
+static int CubeMapCellIndex(const TelescopeDirectionVector &Direction, int Cells)
+{
+    double X = std::fabs(Direction.x), Y = std::fabs(Direction.y), Z = std::fabs(Direction.z);
+    int Face;
+    double u, v;
+    if (X >= Y && X >= Z)
+    {
+        if (X == 0)
+            return 0;
+        Face = Direction.x < 0 ? 1 : 0;
+        u    = Direction.y / X;
+        v    = Direction.z / X;
+    }
+    else if (Y >= Z)
+    {
+        Face = Direction.y < 0 ? 3 : 2;
+        u    = Direction.x / Y;
+        v    = Direction.z / Y;
+    }
+    else
+    {
+        Face = Direction.z < 0 ? 5 : 4;
+        u    = Direction.x / Z;
+        v    = Direction.y / Z;
+    }
+    int i = std::min(Cells - 1, std::max(0, static_cast<int>((u + 1) / 2 * Cells)));
+    int j = std::min(Cells - 1, std::max(0, static_cast<int>((v + 1) / 2 * Cells)));
+    return (Face * Cells + j) * Cells + i;
+}
+
+/// Bounding caps of the cells of a cube map, through the corners of the cells
+static std::vector<CubeMapCell> MakeCubeMapCells(int Cells)
+{
+    std::vector<CubeMapCell> CubeMap(6 * Cells * Cells);
+    for (int Face = 0; Face < 6; Face++)
+        for (int j = 0; j < Cells; j++)
+            for (int i = 0; i < Cells; i++)
+            {
+                double u0 = -1.0 + 2.0 * i / Cells, u1 = -1.0 + 2.0 * (i + 1) / Cells;
+                double v0 = -1.0 + 2.0 * j / Cells, v1 = -1.0 + 2.0 * (j + 1) / Cells;
+                CubeMapCell &Cell = CubeMap[(Face * Cells + j) * Cells + i];
+                Cell.Centre       = CubeMapDirection(Face, (u0 + u1) / 2, (v0 + v1) / 2);
+                Cell.CosRadius    = 1.0;
+                for (double u : { u0, u1 })
+                    for (double v : { v0, v1 })
+                        Cell.CosRadius = std::min(Cell.CosRadius, Cell.Centre ^ CubeMapDirection(Face, u, v));
+                Cell.SinRadius = std::sqrt(std::max(0.0, 1.0 - Cell.CosRadius * Cell.CosRadius));
+            }
+    return CubeMap;
+}
+
 BasicMathPlugin::BasicMathPlugin()
 {
     pActualToApparentTransform = gsl_matrix_alloc(3, 3);
     pApparentToActualTransform = gsl_matrix_alloc(3, 3);
+    pScratchTransform          = gsl_matrix_alloc(3, 3);
 }
 
 // Destructor
@@ -34,6 +121,7 @@ BasicMathPlugin::~BasicMathPlugin()
 {
     gsl_matrix_free(pActualToApparentTransform);
     gsl_matrix_free(pApparentToActualTransform);
+    gsl_matrix_free(pScratchTransform);
 }
 
 // Public methods
@@ -224,28 +312,57 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
             if (!pInMemoryDatabase->GetDatabaseReferencePosition(Position))
                 return false;
 
-            // Compute Hulls etc.
-            ActualConvexHull.Reset();
-            ApparentConvexHull.Reset();
-            ActualDirectionCosines.clear();
+            // When sync points were only appended since the hulls were built, the new ones are added to them.
+            // Otherwise the hulls are built again.
+            size_t Built = HullSyncPoints.size();
+            bool Extend  = (Built > 0) && (Built <= SyncPoints.size()) &&
+                           (Position.latitude == HullPosition.latitude) && (Position.longitude == HullPosition.longitude) &&
+                           (ApproximateMountAlignment == HullAlignment);
+            for (size_t i = 0; Extend && i < Built; i++)
+            {
+                const AlignmentDatabaseEntry &Entry = SyncPoints[i];
+                const HullSyncPoint &Point          = HullSyncPoints[i];
+                Extend = (Entry.ObservationJulianDate == Point.ObservationJulianDate) &&
+                         (Entry.RightAscension == Point.RightAscension) && (Entry.Declination == Point.Declination) &&
+                         (Entry.TelescopeDirection.x == Point.TelescopeDirection.x) &&
+                         (Entry.TelescopeDirection.y == Point.TelescopeDirection.y) &&
+                         (Entry.TelescopeDirection.z == Point.TelescopeDirection.z);
+            }
+
+            if (Extend && Built == SyncPoints.size())
+                return true;
 
-            // Add a dummy point at the nadir
-            ActualConvexHull.MakeNewVertex(0.0, 0.0, -1.0, 0);
-            ApparentConvexHull.MakeNewVertex(0.0, 0.0, -1.0, 0);
+            if (!Extend)
+            {
+                // Compute Hulls etc.
+                ActualConvexHull.Reset();
+                ApparentConvexHull.Reset();
+                ActualDirectionCosines.clear();
+                ApparentDirectionCosines.clear();
+                ActualFaceLookup   = FaceLookup();
+                ApparentFaceLookup = FaceLookup();
+                HullSyncPoints.clear();
+                HullPosition  = Position;
+                HullAlignment = ApproximateMountAlignment;
+                Built         = 0;
+
+                // Add a dummy point at the nadir
+                ActualConvexHull.MakeNewVertex(0.0, 0.0, -1.0, 0);
+                ApparentConvexHull.MakeNewVertex(0.0, 0.0, -1.0, 0);
+            }
 
-            int VertexNumber = 1;
-            // Add the rest of the vertices
-            for (InMemoryDatabase::AlignmentDatabaseType::const_iterator Itr = SyncPoints.begin();
-                    Itr != SyncPoints.end(); Itr++)
+            // Add the new vertices
+            for (size_t i = Built; i < SyncPoints.size(); i++)
             {
+                const AlignmentDatabaseEntry &Entry = SyncPoints[i];
                 INDI::IEquatorialCoordinates RaDec;
                 TelescopeDirectionVector ActualDirectionCosine;
-                RaDec.declination = (*Itr).Declination;
-                RaDec.rightascension = (*Itr).RightAscension;
+                RaDec.declination = Entry.Declination;
+                RaDec.rightascension = Entry.RightAscension;
                 if (ApproximateMountAlignment == ZENITH)
                 {
                     INDI::IHorizontalCoordinates ActualSyncPoint;
-                    EquatorialToHorizontal(&RaDec, &Position, (*Itr).ObservationJulianDate, &ActualSyncPoint);
+                    EquatorialToHorizontal(&RaDec, &Position, Entry.ObservationJulianDate, &ActualSyncPoint);
                     // Now express this coordinate as normalised direction vectors (a.k.a direction cosines)
                     ActualDirectionCosine = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint);
                 }
@@ -254,104 +371,33 @@ bool BasicMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
                     ActualDirectionCosine = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec);
                 }
                 ActualDirectionCosines.push_back(ActualDirectionCosine);
+                ApparentDirectionCosines.push_back(Entry.TelescopeDirection);
+                HullSyncPoints.push_back({ Entry.ObservationJulianDate, Entry.RightAscension, Entry.Declination,
+                                           Entry.TelescopeDirection });
                 ActualConvexHull.MakeNewVertex(ActualDirectionCosine.x, ActualDirectionCosine.y,
-                                               ActualDirectionCosine.z, VertexNumber);
-                ApparentConvexHull.MakeNewVertex((*Itr).TelescopeDirection.x, (*Itr).TelescopeDirection.y,
-                                                 (*Itr).TelescopeDirection.z, VertexNumber);
-                VertexNumber++;
+                                               ActualDirectionCosine.z, static_cast<int>(i) + 1);
+                ApparentConvexHull.MakeNewVertex(Entry.TelescopeDirection.x, Entry.TelescopeDirection.y,
+                                                 Entry.TelescopeDirection.z, static_cast<int>(i) + 1);
             }
-            // I should only need to do this once but it is easier to do it twice
-            if (!ActualConvexHull.DoubleTriangle())
+
+            // The hulls keep the vertices already processed, only the new ones are added to them
+            if (!Extend && (!ActualConvexHull.DoubleTriangle() || !ApparentConvexHull.DoubleTriangle()))
+            {
+                HullSyncPoints.clear();
                 return false;
+            }
             ActualConvexHull.ConstructHull();
             ActualConvexHull.EdgeOrderOnFaces();
-
-            if (!ApparentConvexHull.DoubleTriangle())
-                return false;
-
             ApparentConvexHull.ConstructHull();
             ApparentConvexHull.EdgeOrderOnFaces();
 
-            // Make the matrices
-            ConvexHull::tFace CurrentFace = ActualConvexHull.faces;
-#ifdef CONVEX_HULL_DEBUGGING
-            int ActualFaces = 0;
-#endif
-            if (nullptr != CurrentFace)
-            {
-                do
-                {
-#ifdef CONVEX_HULL_DEBUGGING
-                    ActualFaces++;
-#endif
-                    if ((0 == CurrentFace->vertex[0]->vnum) || (0 == CurrentFace->vertex[1]->vnum) ||
-                            (0 == CurrentFace->vertex[2]->vnum))
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("Initialise - Ignoring actual face %d", ActualFaces);
-#endif
-                    }
-                    else
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("Initialise - Processing actual face %d v1 %d v2 %d v3 %d", ActualFaces,
-                                  CurrentFace->vertex[0]->vnum, CurrentFace->vertex[1]->vnum,
-                                  CurrentFace->vertex[2]->vnum);
-#endif
-                        CalculateTransformMatrices(ActualDirectionCosines[CurrentFace->vertex[0]->vnum - 1],
-                                                   ActualDirectionCosines[CurrentFace->vertex[1]->vnum - 1],
-                                                   ActualDirectionCosines[CurrentFace->vertex[2]->vnum - 1],
-                                                   SyncPoints[CurrentFace->vertex[0]->vnum - 1].TelescopeDirection,
-                                                   SyncPoints[CurrentFace->vertex[1]->vnum - 1].TelescopeDirection,
-                                                   SyncPoints[CurrentFace->vertex[2]->vnum - 1].TelescopeDirection,
-                                                   CurrentFace->pMatrix, nullptr);
-                    }
-                    CurrentFace = CurrentFace->next;
-                }
-                while (CurrentFace != ActualConvexHull.faces);
-            }
-
-            // One of these days I will optimise this
-            CurrentFace = ApparentConvexHull.faces;
-#ifdef CONVEX_HULL_DEBUGGING
-            int ApparentFaces = 0;
-#endif
-            if (nullptr != CurrentFace)
-            {
-                do
-                {
-#ifdef CONVEX_HULL_DEBUGGING
-                    ApparentFaces++;
-#endif
-                    if ((0 == CurrentFace->vertex[0]->vnum) || (0 == CurrentFace->vertex[1]->vnum) ||
-                            (0 == CurrentFace->vertex[2]->vnum))
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("Initialise - Ignoring apparent face %d", ApparentFaces);
-#endif
-                    }
-                    else
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("Initialise - Processing apparent face %d v1 %d v2 %d v3 %d", ApparentFaces,
-                                  CurrentFace->vertex[0]->vnum, CurrentFace->vertex[1]->vnum,
-                                  CurrentFace->vertex[2]->vnum);
-#endif
-                        CalculateTransformMatrices(SyncPoints[CurrentFace->vertex[0]->vnum - 1].TelescopeDirection,
-                                                   SyncPoints[CurrentFace->vertex[1]->vnum - 1].TelescopeDirection,
-                                                   SyncPoints[CurrentFace->vertex[2]->vnum - 1].TelescopeDirection,
-                                                   ActualDirectionCosines[CurrentFace->vertex[0]->vnum - 1],
-                                                   ActualDirectionCosines[CurrentFace->vertex[1]->vnum - 1],
-                                                   ActualDirectionCosines[CurrentFace->vertex[2]->vnum - 1],
-                                                   CurrentFace->pMatrix, nullptr);
-                    }
-                    CurrentFace = CurrentFace->next;
-                }
-                while (CurrentFace != ApparentConvexHull.faces);
-            }
+            // Make the matrices of the new facets
+            UpdateFaceLookup(ActualConvexHull, ActualFaceLookup, ActualDirectionCosines, ApparentDirectionCosines);
+            UpdateFaceLookup(ApparentConvexHull, ApparentFaceLookup, ApparentDirectionCosines, ActualDirectionCosines);
 
 #ifdef CONVEX_HULL_DEBUGGING
-            ASSDEBUGF("Initialise - ActualFaces %d ApparentFaces %d", ActualFaces, ApparentFaces);
+            ASSDEBUGF("Initialise - ActualFaces %d ApparentFaces %d", static_cast<int>(ActualFaceLookup.Faces.size()),
+                      static_cast<int>(ApparentFaceLookup.Faces.size()));
             ActualConvexHull.PrintObj("ActualHull.obj");
             ActualConvexHull.PrintOut("ActualHull.log", ActualConvexHull.vertices);
             ApparentConvexHull.PrintObj("ApparentHull.obj");
@@ -418,18 +464,15 @@ bool BasicMathPlugin::TransformCelestialToTelescope(const double RightAscension,
             {
                 ActualVector = TelescopeDirectionVectorFromEquatorialCoordinates(ActualRaDec);
             }
-            gsl_vector *pGSLActualVector = gsl_vector_alloc(3);
-            gsl_vector_set(pGSLActualVector, 0, ActualVector.x);
-            gsl_vector_set(pGSLActualVector, 1, ActualVector.y);
-            gsl_vector_set(pGSLActualVector, 2, ActualVector.z);
-            gsl_vector *pGSLApparentVector = gsl_vector_alloc(3);
-            MatrixVectorMultiply(pActualToApparentTransform, pGSLActualVector, pGSLApparentVector);
-            ApparentTelescopeDirectionVector.x = gsl_vector_get(pGSLApparentVector, 0);
-            ApparentTelescopeDirectionVector.y = gsl_vector_get(pGSLApparentVector, 1);
-            ApparentTelescopeDirectionVector.z = gsl_vector_get(pGSLApparentVector, 2);
+            double Actual[3] = { ActualVector.x, ActualVector.y, ActualVector.z };
+            double Apparent[3];
+            gsl_vector_view GSLActualVector   = gsl_vector_view_array(Actual, 3);
+            gsl_vector_view GSLApparentVector = gsl_vector_view_array(Apparent, 3);
+            MatrixVectorMultiply(pActualToApparentTransform, &GSLActualVector.vector, &GSLApparentVector.vector);
+            ApparentTelescopeDirectionVector.x = Apparent[0];
+            ApparentTelescopeDirectionVector.y = Apparent[1];
+            ApparentTelescopeDirectionVector.z = Apparent[2];
             ApparentTelescopeDirectionVector.Normalise();
-            gsl_vector_free(pGSLActualVector);
-            gsl_vector_free(pGSLApparentVector);
             break;
         }
 
@@ -447,138 +490,13 @@ bool BasicMathPlugin::TransformCelestialToTelescope(const double RightAscension,
                 ActualVector = TelescopeDirectionVectorFromEquatorialCoordinates(ActualRaDec);
             }
 
-            gsl_matrix *pTransform;
-            gsl_matrix *pComputedTransform = nullptr;
-            // Scale the actual telescope direction vector to make sure it traverses the unit sphere.
-            TelescopeDirectionVector ScaledActualVector = ActualVector * 2.0;
-            // Shoot the scaled vector in the into the list of actual facets
-            // and use the conversuion matrix from the one it intersects
-            ConvexHull::tFace CurrentFace = ActualConvexHull.faces;
-#ifdef CONVEX_HULL_DEBUGGING
-            int ActualFaces = 0;
-#endif
-            if (nullptr != CurrentFace)
-            {
-                do
-                {
-#ifdef CONVEX_HULL_DEBUGGING
-                    ActualFaces++;
-#endif
-                    // Ignore faces containing vertex 0 (nadir).
-                    if ((0 == CurrentFace->vertex[0]->vnum) || (0 == CurrentFace->vertex[1]->vnum) ||
-                            (0 == CurrentFace->vertex[2]->vnum))
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("Celestial to telescope - Ignoring actual face %d", ActualFaces);
-#endif
-                    }
-                    else
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("Celestial to telescope - Processing actual face %d v1 %d v2 %d v3 %d", ActualFaces,
-                                  CurrentFace->vertex[0]->vnum, CurrentFace->vertex[1]->vnum,
-                                  CurrentFace->vertex[2]->vnum);
-#endif
-                        if (RayTriangleIntersection(ScaledActualVector,
-                                                    ActualDirectionCosines[CurrentFace->vertex[0]->vnum - 1],
-                                                    ActualDirectionCosines[CurrentFace->vertex[1]->vnum - 1],
-                                                    ActualDirectionCosines[CurrentFace->vertex[2]->vnum - 1]))
-                            break;
-                    }
-                    CurrentFace = CurrentFace->next;
-                }
-                while (CurrentFace != ActualConvexHull.faces);
-                if (CurrentFace == ActualConvexHull.faces)
-                {
-                    // Find the three nearest points and build a transform
-                    std::map<double, const AlignmentDatabaseEntry *> NearestMap;
-                    for (InMemoryDatabase::AlignmentDatabaseType::const_iterator Itr = SyncPoints.begin();
-                            Itr != SyncPoints.end(); Itr++)
-                    {
-                        INDI::IEquatorialCoordinates RaDec;
-                        TelescopeDirectionVector ActualDirectionCosine;
-                        RaDec.rightascension  = (*Itr).RightAscension;
-                        RaDec.declination = (*Itr).Declination;
-                        if (ApproximateMountAlignment == ZENITH)
-                        {
-                            INDI::IHorizontalCoordinates ActualPoint;
-                            EquatorialToHorizontal(&RaDec, &Position, (*Itr).ObservationJulianDate, &ActualPoint);
-                            ActualDirectionCosine = TelescopeDirectionVectorFromAltitudeAzimuth(ActualPoint);
-                        }
-                        else
-                        {
-                            ActualDirectionCosine = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec);
-                        }
-                        NearestMap[(ActualDirectionCosine - ActualVector).Length()] = &(*Itr);
-                    }
-                    // First compute local horizontal coordinates for the three sync points
-                    std::map<double, const AlignmentDatabaseEntry *>::const_iterator Nearest = NearestMap.begin();
-                    const AlignmentDatabaseEntry *pEntry1                                    = (*Nearest).second;
-                    Nearest++;
-                    const AlignmentDatabaseEntry *pEntry2 = (*Nearest).second;
-                    Nearest++;
-                    const AlignmentDatabaseEntry *pEntry3 = (*Nearest).second;
-                    INDI::IEquatorialCoordinates RaDec1;
-                    INDI::IEquatorialCoordinates RaDec2;
-                    INDI::IEquatorialCoordinates RaDec3;
-                    TelescopeDirectionVector ActualDirectionCosine1;
-                    TelescopeDirectionVector ActualDirectionCosine2;
-                    TelescopeDirectionVector ActualDirectionCosine3;
-                    RaDec1.declination = pEntry1->Declination;
-                    RaDec1.rightascension  = pEntry1->RightAscension;
-                    RaDec2.declination = pEntry2->Declination;
-                    RaDec2.rightascension  = pEntry2->RightAscension;
-                    RaDec3.declination = pEntry3->Declination;
-                    RaDec3.rightascension = pEntry3->RightAscension;
-
-                    if (ApproximateMountAlignment == ZENITH)
-                    {
-                        INDI::IHorizontalCoordinates ActualSyncPoint1;
-                        INDI::IHorizontalCoordinates ActualSyncPoint2;
-                        INDI::IHorizontalCoordinates ActualSyncPoint3;
-                        EquatorialToHorizontal(&RaDec1, &Position, pEntry1->ObservationJulianDate, &ActualSyncPoint1);
-                        EquatorialToHorizontal(&RaDec2, &Position, pEntry2->ObservationJulianDate, &ActualSyncPoint2);
-                        EquatorialToHorizontal(&RaDec3, &Position, pEntry3->ObservationJulianDate, &ActualSyncPoint3);
-
-                        // Now express these coordinates as normalised direction vectors (a.k.a direction cosines)
-                        ActualDirectionCosine1 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint1);
-                        ActualDirectionCosine2 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint2);
-                        ActualDirectionCosine3 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint3);
-                    }
-                    else
-                    {
-                        ActualDirectionCosine1 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec1);
-                        ActualDirectionCosine2 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec2);
-                        ActualDirectionCosine3 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec3);
-                    }
-
-                    pComputedTransform = gsl_matrix_alloc(3, 3);
-                    CalculateTransformMatrices(ActualDirectionCosine1, ActualDirectionCosine2, ActualDirectionCosine3,
-                                               pEntry1->TelescopeDirection, pEntry2->TelescopeDirection,
-                                               pEntry3->TelescopeDirection, pComputedTransform, nullptr);
-                    pTransform = pComputedTransform;
-                }
-                else
-                    pTransform = CurrentFace->pMatrix;
-            }
-            else
+            if (HullSyncPoints.empty())
                 return false;
 
-            // OK - got an intersection - CurrentFace is pointing at the face
-            gsl_vector *pGSLActualVector = gsl_vector_alloc(3);
-            gsl_vector_set(pGSLActualVector, 0, ActualVector.x);
-            gsl_vector_set(pGSLActualVector, 1, ActualVector.y);
-            gsl_vector_set(pGSLActualVector, 2, ActualVector.z);
-            gsl_vector *pGSLApparentVector = gsl_vector_alloc(3);
-            MatrixVectorMultiply(pTransform, pGSLActualVector, pGSLApparentVector);
-            ApparentTelescopeDirectionVector.x = gsl_vector_get(pGSLApparentVector, 0);
-            ApparentTelescopeDirectionVector.y = gsl_vector_get(pGSLApparentVector, 1);
-            ApparentTelescopeDirectionVector.z = gsl_vector_get(pGSLApparentVector, 2);
-            ApparentTelescopeDirectionVector.Normalise();
-            gsl_vector_free(pGSLActualVector);
-            gsl_vector_free(pGSLApparentVector);
-            if (nullptr != pComputedTransform)
-                gsl_matrix_free(pComputedTransform);
+            // Use the conversion matrix of the actual facet the vector goes through
+            const double *Transform = FindTransform(ActualFaceLookup, ActualVector, ActualDirectionCosines,
+                                                    ApparentDirectionCosines);
+            ApparentTelescopeDirectionVector = MultiplyAndNormalise(Transform, ActualVector);
             break;
         }
     }
@@ -645,20 +563,21 @@ bool BasicMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVect
         case 2:
         case 3:
         {
-            gsl_vector *pGSLApparentVector = gsl_vector_alloc(3);
-            gsl_vector_set(pGSLApparentVector, 0, ApparentTelescopeDirectionVector.x);
-            gsl_vector_set(pGSLApparentVector, 1, ApparentTelescopeDirectionVector.y);
-            gsl_vector_set(pGSLApparentVector, 2, ApparentTelescopeDirectionVector.z);
-            gsl_vector *pGSLActualVector = gsl_vector_alloc(3);
-            MatrixVectorMultiply(pApparentToActualTransform, pGSLApparentVector, pGSLActualVector);
+            double Apparent[3] = { ApparentTelescopeDirectionVector.x, ApparentTelescopeDirectionVector.y,
+                                   ApparentTelescopeDirectionVector.z
+                                 };
+            double Actual[3];
+            gsl_vector_view GSLApparentVector = gsl_vector_view_array(Apparent, 3);
+            gsl_vector_view GSLActualVector   = gsl_vector_view_array(Actual, 3);
+            MatrixVectorMultiply(pApparentToActualTransform, &GSLApparentVector.vector, &GSLActualVector.vector);
 
-            Dump3("ApparentVector", pGSLApparentVector);
-            Dump3("ActualVector", pGSLActualVector);
+            Dump3("ApparentVector", &GSLApparentVector.vector);
+            Dump3("ActualVector", &GSLActualVector.vector);
 
             TelescopeDirectionVector ActualTelescopeDirectionVector;
-            ActualTelescopeDirectionVector.x = gsl_vector_get(pGSLActualVector, 0);
-            ActualTelescopeDirectionVector.y = gsl_vector_get(pGSLActualVector, 1);
-            ActualTelescopeDirectionVector.z = gsl_vector_get(pGSLActualVector, 2);
+            ActualTelescopeDirectionVector.x = Actual[0];
+            ActualTelescopeDirectionVector.y = Actual[1];
+            ActualTelescopeDirectionVector.z = Actual[2];
             ActualTelescopeDirectionVector.Normalise();
             if (ApproximateMountAlignment == ZENITH)
             {
@@ -671,128 +590,19 @@ bool BasicMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVect
             }
             RightAscension = ActualRaDec.rightascension;
             Declination    = ActualRaDec.declination;
-            gsl_vector_free(pGSLActualVector);
-            gsl_vector_free(pGSLApparentVector);
             break;
         }
 
         default:
         {
-            gsl_matrix *pTransform;
-            gsl_matrix *pComputedTransform = nullptr;
-            // Scale the apparent telescope direction vector to make sure it traverses the unit sphere.
-            TelescopeDirectionVector ScaledApparentVector = ApparentTelescopeDirectionVector * 2.0;
-            // Shoot the scaled vector in the into the list of apparent facets
-            // and use the conversuion matrix from the one it intersects
-            ConvexHull::tFace CurrentFace = ApparentConvexHull.faces;
-#ifdef CONVEX_HULL_DEBUGGING
-            int ApparentFaces = 0;
-#endif
-            if (nullptr != CurrentFace)
-            {
-                do
-                {
-#ifdef CONVEX_HULL_DEBUGGING
-                    ApparentFaces++;
-#endif
-                    // Ignore faces containing vertex 0 (nadir).
-                    if ((0 == CurrentFace->vertex[0]->vnum) || (0 == CurrentFace->vertex[1]->vnum) ||
-                            (0 == CurrentFace->vertex[2]->vnum))
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("Celestial to telescope - Ignoring apparent face %d", ApparentFaces);
-#endif
-                    }
-                    else
-                    {
-#ifdef CONVEX_HULL_DEBUGGING
-                        ASSDEBUGF("TelescopeToCelestial - Processing apparent face %d v1 %d v2 %d v3 %d", ApparentFaces,
-                                  CurrentFace->vertex[0]->vnum, CurrentFace->vertex[1]->vnum,
-                                  CurrentFace->vertex[2]->vnum);
-#endif
-                        if (RayTriangleIntersection(ScaledApparentVector,
-                                                    SyncPoints[CurrentFace->vertex[0]->vnum - 1].TelescopeDirection,
-                                                    SyncPoints[CurrentFace->vertex[1]->vnum - 1].TelescopeDirection,
-                                                    SyncPoints[CurrentFace->vertex[2]->vnum - 1].TelescopeDirection))
-                            break;
-                    }
-                    CurrentFace = CurrentFace->next;
-                }
-                while (CurrentFace != ApparentConvexHull.faces);
-                if (CurrentFace == ApparentConvexHull.faces)
-                {
-                    // Find the three nearest points and build a transform
-                    std::map<double, const AlignmentDatabaseEntry *> NearestMap;
-                    for (InMemoryDatabase::AlignmentDatabaseType::const_iterator Itr = SyncPoints.begin();
-                            Itr != SyncPoints.end(); Itr++)
-                    {
-                        NearestMap[((*Itr).TelescopeDirection - ApparentTelescopeDirectionVector).Length()] = &(*Itr);
-                    }
-                    // First compute local horizontal coordinates for the three sync points
-                    std::map<double, const AlignmentDatabaseEntry *>::const_iterator Nearest = NearestMap.begin();
-                    const AlignmentDatabaseEntry *pEntry1                                    = (*Nearest).second;
-                    Nearest++;
-                    const AlignmentDatabaseEntry *pEntry2 = (*Nearest).second;
-                    Nearest++;
-                    const AlignmentDatabaseEntry *pEntry3 = (*Nearest).second;
-                    INDI::IEquatorialCoordinates RaDec1;
-                    INDI::IEquatorialCoordinates RaDec2;
-                    INDI::IEquatorialCoordinates RaDec3;
-                    TelescopeDirectionVector ActualDirectionCosine1;
-                    TelescopeDirectionVector ActualDirectionCosine2;
-                    TelescopeDirectionVector ActualDirectionCosine3;
-                    RaDec1.declination = pEntry1->Declination;
-                    RaDec1.rightascension  = pEntry1->RightAscension;
-                    RaDec2.declination = pEntry2->Declination;
-                    RaDec2.rightascension  = pEntry2->RightAscension;
-                    RaDec3.declination = pEntry3->Declination;
-                    RaDec3.rightascension = pEntry3->RightAscension;
-
-                    if (ApproximateMountAlignment == ZENITH)
-                    {
-                        INDI::IHorizontalCoordinates ActualSyncPoint1;
-                        INDI::IHorizontalCoordinates ActualSyncPoint2;
-                        INDI::IHorizontalCoordinates ActualSyncPoint3;
-                        EquatorialToHorizontal(&RaDec1, &Position, pEntry1->ObservationJulianDate, &ActualSyncPoint1);
-                        EquatorialToHorizontal(&RaDec2, &Position, pEntry2->ObservationJulianDate, &ActualSyncPoint2);
-                        EquatorialToHorizontal(&RaDec3, &Position, pEntry3->ObservationJulianDate, &ActualSyncPoint3);
-
-                        // Now express these coordinates as normalised direction vectors (a.k.a direction cosines)
-                        ActualDirectionCosine1 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint1);
-                        ActualDirectionCosine2 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint2);
-                        ActualDirectionCosine3 = TelescopeDirectionVectorFromAltitudeAzimuth(ActualSyncPoint3);
-                    }
-                    else
-                    {
-                        ActualDirectionCosine1 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec1);
-                        ActualDirectionCosine2 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec2);
-                        ActualDirectionCosine3 = TelescopeDirectionVectorFromEquatorialCoordinates(RaDec3);
-                    }
-                    pComputedTransform = gsl_matrix_alloc(3, 3);
-                    CalculateTransformMatrices(pEntry1->TelescopeDirection, pEntry2->TelescopeDirection,
-                                               pEntry3->TelescopeDirection, ActualDirectionCosine1,
-                                               ActualDirectionCosine2, ActualDirectionCosine3, pComputedTransform,
-                                               nullptr);
-                    pTransform = pComputedTransform;
-                }
-                else
-                    pTransform = CurrentFace->pMatrix;
-            }
-            else
+            if (HullSyncPoints.empty())
                 return false;
 
-            // OK - got an intersection - CurrentFace is pointing at the face
-            gsl_vector *pGSLApparentVector = gsl_vector_alloc(3);
-            gsl_vector_set(pGSLApparentVector, 0, ApparentTelescopeDirectionVector.x);
-            gsl_vector_set(pGSLApparentVector, 1, ApparentTelescopeDirectionVector.y);
-            gsl_vector_set(pGSLApparentVector, 2, ApparentTelescopeDirectionVector.z);
-            gsl_vector *pGSLActualVector = gsl_vector_alloc(3);
-            MatrixVectorMultiply(pTransform, pGSLApparentVector, pGSLActualVector);
-            TelescopeDirectionVector ActualTelescopeDirectionVector;
-            ActualTelescopeDirectionVector.x = gsl_vector_get(pGSLActualVector, 0);
-            ActualTelescopeDirectionVector.y = gsl_vector_get(pGSLActualVector, 1);
-            ActualTelescopeDirectionVector.z = gsl_vector_get(pGSLActualVector, 2);
-            ActualTelescopeDirectionVector.Normalise();
+            // Use the conversion matrix of the apparent facet the vector goes through
+            const double *Transform = FindTransform(ApparentFaceLookup, ApparentTelescopeDirectionVector,
+                                                    ApparentDirectionCosines, ActualDirectionCosines);
+            TelescopeDirectionVector ActualTelescopeDirectionVector =
+                MultiplyAndNormalise(Transform, ApparentTelescopeDirectionVector);
             if (ApproximateMountAlignment == ZENITH)
             {
                 AltitudeAzimuthFromTelescopeDirectionVector(ActualTelescopeDirectionVector, ActualAltAz);
@@ -805,10 +615,6 @@ bool BasicMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVect
             // libnova works in decimal degrees so conversion is needed here
             RightAscension = ActualRaDec.rightascension;
             Declination    = ActualRaDec.declination;
-            gsl_vector_free(pGSLActualVector);
-            gsl_vector_free(pGSLApparentVector);
-            if (nullptr != pComputedTransform)
-                gsl_matrix_free(pComputedTransform);
             break;
         }
     }
@@ -953,5 +759,179 @@ bool BasicMathPlugin::RayTriangleIntersection(TelescopeDirectionVector &Ray, Tel
     return false;
 }
 
+void BasicMathPlugin::UpdateFaceLookup(ConvexHull &Hull, FaceLookup &Lookup,
+                                       std::vector<TelescopeDirectionVector> &From,
+                                       std::vector<TelescopeDirectionVector> &To)
+{
+    // Facets already on the hull keep their matrices and cells, only the new ones are computed
+    std::map<std::array<int, 3>, HullFace *> Previous;
+    for (HullFace &Face : Lookup.Faces)
+        Previous[Face.Vertices] = &Face;
+
+    std::vector<HullFace> Faces;
+    ConvexHull::tFace CurrentFace = Hull.faces;
+    if (nullptr != CurrentFace)
+    {
+        do
+        {
+            // Ignore faces containing vertex 0 (nadir).
+            if ((0 != CurrentFace->vertex[0]->vnum) && (0 != CurrentFace->vertex[1]->vnum) &&
+                    (0 != CurrentFace->vertex[2]->vnum))
+            {
+                std::array<int, 3> Vertices {{ CurrentFace->vertex[0]->vnum, CurrentFace->vertex[1]->vnum,
+                                              CurrentFace->vertex[2]->vnum
+                                            }};
+                auto Found = Previous.find(Vertices);
+                if (Found != Previous.end())
+                    Faces.push_back(std::move(*Found->second));
+                else
+                {
+                    HullFace Face;
+                    Face.Vertices = Vertices;
+                    CalculateTransformMatrices(From[Vertices[0] - 1], From[Vertices[1] - 1], From[Vertices[2] - 1],
+                                               To[Vertices[0] - 1], To[Vertices[1] - 1], To[Vertices[2] - 1],
+                                               CurrentFace->pMatrix, nullptr);
+                    CopyMatrix(CurrentFace->pMatrix, Face.Matrix);
+                    FindFaceCells(From[Vertices[0] - 1], From[Vertices[1] - 1], From[Vertices[2] - 1], Face.Cells);
+                    Faces.push_back(std::move(Face));
+                }
+            }
+            CurrentFace = CurrentFace->next;
+        }
+        while (CurrentFace != Hull.faces);
+    }
+    Lookup.Faces.swap(Faces);
+    Lookup.NearestMatrices.clear();
+
+    Lookup.Cells.resize(6 * LookupCells * LookupCells);
+    for (auto &Cell : Lookup.Cells)
+        Cell.clear();
+    for (size_t Index = 0; Index < Lookup.Faces.size(); Index++)
+        for (int Cell : Lookup.Faces[Index].Cells)
+            Lookup.Cells[Cell].push_back(static_cast<int>(Index));
+}
+
+void BasicMathPlugin::FindFaceCells(const TelescopeDirectionVector &A, const TelescopeDirectionVector &B,
+                                    const TelescopeDirectionVector &C, std::vector<int> &Cells)
+{
+    static const int BlockCells   = 4;
+    static const int LookupBlocks = LookupCells / BlockCells;
+    static const std::vector<CubeMapCell> CubeMap = MakeCubeMapCells(LookupCells);
+    static const std::vector<CubeMapCell> Blocks  = MakeCubeMapCells(LookupBlocks);
+
+    Cells.clear();
+
+    // Bounding cap of the facet, around its centroid
+    TelescopeDirectionVector Centre(A.x + B.x + C.x, A.y + B.y + C.y, A.z + B.z + C.z);
+    double CosRadius = -1.0;
+    if (Centre.Length() > 0)
+    {
+        Centre.Normalise();
+        CosRadius = std::min({ (Centre ^ A) / A.Length(), (Centre ^ B) / B.Length(), (Centre ^ C) / C.Length() });
+    }
+
+    if (CosRadius < std::cos(MaxBoundedFacet))
+    {
+        for (size_t Cell = 0; Cell < CubeMap.size(); Cell++)
+            Cells.push_back(static_cast<int>(Cell));
+        return;
+    }
+
+    // The caps overlap when their centres are closer than the sum of their radii
+    double SinRadius = std::sqrt(std::max(0.0, 1.0 - CosRadius * CosRadius));
+    auto Overlaps    = [&](const CubeMapCell & Cap)
+    {
+        return (Centre ^ Cap.Centre) >= CosRadius * Cap.CosRadius - SinRadius * Cap.SinRadius - 1e-9;
+    };
+
+    // Blocks of cells first, then the cells of the blocks the facet reaches
+    for (int Face = 0; Face < 6; Face++)
+        for (int J = 0; J < LookupBlocks; J++)
+            for (int I = 0; I < LookupBlocks; I++)
+            {
+                if (!Overlaps(Blocks[(Face * LookupBlocks + J) * LookupBlocks + I]))
+                    continue;
+                for (int j = J * BlockCells; j < (J + 1) * BlockCells; j++)
+                    for (int i = I * BlockCells; i < (I + 1) * BlockCells; i++)
+                    {
+                        int Cell = (Face * LookupCells + j) * LookupCells + i;
+                        if (Overlaps(CubeMap[Cell]))
+                            Cells.push_back(Cell);
+                    }
+            }
+}
+
+const double *BasicMathPlugin::FindTransform(FaceLookup &Lookup, const TelescopeDirectionVector &Vector,
+        std::vector<TelescopeDirectionVector> &From,
+        std::vector<TelescopeDirectionVector> &To)
+{
+    // Scale the direction vector to make sure it traverses the unit sphere.
+    TelescopeDirectionVector ScaledVector = Vector * 2.0;
+    // Shoot the scaled vector into the facets of its cell, in the order of the hull
+    // as the first one it intersects is used
+    if (!Lookup.Cells.empty())
+    {
+        for (int Index : Lookup.Cells[CubeMapCellIndex(Vector, LookupCells)])
+        {
+            HullFace &Face = Lookup.Faces[Index];
+            if (RayTriangleIntersection(ScaledVector, From[Face.Vertices[0] - 1], From[Face.Vertices[1] - 1],
+                                        From[Face.Vertices[2] - 1]))
+                return Face.Matrix;
+        }
+    }
+
+    // Find the three nearest points and build a transform
+    std::array<int, 3> Nearest {{ 0, 0, 0 }};
+    double Distances[3] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                            std::numeric_limits<double>::max()
+                          };
+    for (size_t i = 0; i < From.size(); i++)
+    {
+        double Distance = (From[i] - Vector).Length();
+        for (int k = 0; k < 3; k++)
+        {
+            if (Distance < Distances[k])
+            {
+                for (int l = 2; l > k; l--)
+                {
+                    Distances[l] = Distances[l - 1];
+                    Nearest[l]   = Nearest[l - 1];
+                }
+                Distances[k] = Distance;
+                Nearest[k]   = static_cast<int>(i);
+                break;
+            }
+        }
+    }
+
+    auto Found = Lookup.NearestMatrices.find(Nearest);
+    if (Found == Lookup.NearestMatrices.end())
+    {
+        CalculateTransformMatrices(From[Nearest[0]], From[Nearest[1]], From[Nearest[2]], To[Nearest[0]],
+                                   To[Nearest[1]], To[Nearest[2]], pScratchTransform, nullptr);
+        std::array<double, 9> Matrix;
+        CopyMatrix(pScratchTransform, Matrix.data());
+        Found = Lookup.NearestMatrices.emplace(Nearest, Matrix).first;
+    }
+    return Found->second.data();
+}
+
+void BasicMathPlugin::CopyMatrix(gsl_matrix *pMatrix, double *Matrix)
+{
+    for (size_t Row = 0; Row < 3; Row++)
+        for (size_t Column = 0; Column < 3; Column++)
+            Matrix[Row * 3 + Column] = gsl_matrix_get(pMatrix, Row, Column);
+}
+
+TelescopeDirectionVector BasicMathPlugin::MultiplyAndNormalise(const double *Matrix,
+        const TelescopeDirectionVector &Vector)
+{
+    TelescopeDirectionVector Result(Matrix[0] * Vector.x + Matrix[1] * Vector.y + Matrix[2] * Vector.z,
+                                    Matrix[3] * Vector.x + Matrix[4] * Vector.y + Matrix[5] * Vector.z,
+                                    Matrix[6] * Vector.x + Matrix[7] * Vector.y + Matrix[8] * Vector.z);
+    Result.Normalise();
+    return Result;
+}
+
 } // namespace AlignmentSubsystem
 } // namespace INDI
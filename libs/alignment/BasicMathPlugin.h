@@ -13,6 +13,10 @@
 
 #include <gsl/gsl_matrix.h>
 
+#include <array>
+#include <map>
+#include <vector>
+
 namespace INDI
 {
 namespace AlignmentSubsystem
@@ -94,6 +98,68 @@ class BasicMathPlugin : public AlignmentSubsystemForMathPlugins
         bool RayTriangleIntersection(TelescopeDirectionVector &Ray, TelescopeDirectionVector &TriangleVertex1,
                                      TelescopeDirectionVector &TriangleVertex2, TelescopeDirectionVector &TriangleVertex3);
 
+        /// \brief A triangular facet of a convex hull, with its transformation matrix to the other hull
+        struct HullFace
+        {
+            /// Vertex numbers of the corners, the sync points being numbered from 1
+            std::array<int, 3> Vertices;
+            /// Row major transformation matrix
+            double Matrix[9];
+            /// Cells of the cube map the facet may reach into
+            std::vector<int> Cells;
+        };
+
+        /// \brief Cube map lookup of the facets of a convex hull
+        ///
+        /// The unit sphere is projected on the six faces of a cube, each split in LookupCells by LookupCells cells.
+        /// Every cell lists the facets whose spherical triangle may reach into it, so that a ray is only tested
+        /// against the few facets around it whatever the number of sync points.
+        struct FaceLookup
+        {
+            /// Facets not touching the nadir, in the order of the hull
+            std::vector<HullFace> Faces;
+            /// Indexes in Faces of the facets of each cell, in increasing order
+            std::vector<std::vector<int>> Cells;
+            /// Transformation matrices of the nearest three sync points, used outside of the facets
+            std::map<std::array<int, 3>, std::array<double, 9>> NearestMatrices;
+        };
+
+        /// \brief Cells along an edge of a cube map face
+        static const int LookupCells = 16;
+
+        /// \brief Refresh the facets of a hull and their cube map cells
+        /// \param[in] Hull The convex hull
+        /// \param[in] Lookup The lookup of the hull, the facets still on the hull keep their matrices and cells
+        /// \param[in] From Direction cosines of the sync points in the frame of the hull
+        /// \param[in] To Direction cosines of the sync points in the other frame
+        void UpdateFaceLookup(ConvexHull &Hull, FaceLookup &Lookup, std::vector<TelescopeDirectionVector> &From,
+                              std::vector<TelescopeDirectionVector> &To);
+
+        /// \brief List the cube map cells the spherical triangle of a facet may reach into
+        /// \param[in] A The first vertex of the facet
+        /// \param[in] B The second vertex of the facet
+        /// \param[in] C The third vertex of the facet
+        /// \param[out] Cells The indexes of the cells
+        static void FindFaceCells(const TelescopeDirectionVector &A, const TelescopeDirectionVector &B,
+                                  const TelescopeDirectionVector &C, std::vector<int> &Cells);
+
+        /// \brief Find the transformation matrix for a direction
+        /// \param[in] Lookup The lookup of the hull to search
+        /// \param[in] Vector The normalised direction
+        /// \param[in] From Direction cosines of the sync points in the frame of the hull
+        /// \param[in] To Direction cosines of the sync points in the other frame
+        /// \return The matrix of the facet the direction goes through, or else the one of the nearest three sync points
+        const double *FindTransform(FaceLookup &Lookup, const TelescopeDirectionVector &Vector,
+                                    std::vector<TelescopeDirectionVector> &From,
+                                    std::vector<TelescopeDirectionVector> &To);
+
+        /// \brief Copy a gsl matrix to a row major array
+        static void CopyMatrix(gsl_matrix *pMatrix, double *Matrix);
+
+        /// \brief Multiply a row major matrix by a vector and normalise the result
+        static TelescopeDirectionVector MultiplyAndNormalise(const double *Matrix,
+                const TelescopeDirectionVector &Vector);
+
         // Transformation matrixes for 1, 2 and 3 sync points case
         gsl_matrix *pActualToApparentTransform;
         gsl_matrix *pApparentToActualTransform;
@@ -103,6 +169,25 @@ class BasicMathPlugin : public AlignmentSubsystemForMathPlugins
         ConvexHull ApparentConvexHull;
         // Actual direction cosines for the 4+ case
         std::vector<TelescopeDirectionVector> ActualDirectionCosines;
+        // Apparent direction cosines for the 4+ case
+        std::vector<TelescopeDirectionVector> ApparentDirectionCosines;
+        // Facets and cube maps of the hulls
+        FaceLookup ActualFaceLookup;
+        FaceLookup ApparentFaceLookup;
+        // Scratch matrix for the transformations computed in the 4+ case
+        gsl_matrix *pScratchTransform;
+
+        // What the hulls were built from, so that they are only extended when sync points are appended
+        struct HullSyncPoint
+        {
+            double ObservationJulianDate;
+            double RightAscension;
+            double Declination;
+            TelescopeDirectionVector TelescopeDirection;
+        };
+        std::vector<HullSyncPoint> HullSyncPoints;
+        IGeographicCoordinates HullPosition { 0, 0, 0 };
+        MountAlignment_t HullAlignment { ZENITH };
 };
 
 } // namespace AlignmentSubsystem
@@ -80,6 +80,8 @@ bool NearestMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
     const auto &SyncPoints = pInMemoryDatabase->GetAlignmentDatabase();
     // Clear all extended alignment points so we can re-create them.
     ExtendedAlignmentPoints.clear();
+    CelestialPoints.Clear();
+    TelescopePoints.Clear();
 
     IGeographicCoordinates Position;
     if (!pInMemoryDatabase->GetDatabaseReferencePosition(Position))
@@ -122,8 +124,13 @@ bool NearestMathPlugin::Initialise(InMemoryDatabase *pInMemoryDatabase)
         oneEntry.TelescopeAltitude = TelescopeAltAz.altitude;
 
         ExtendedAlignmentPoints.push_back(oneEntry);
+        CelestialPoints.AddPoint(oneEntry.CelestialAzimuth, oneEntry.CelestialAltitude);
+        TelescopePoints.AddPoint(oneEntry.TelescopeAzimuth, oneEntry.TelescopeAltitude);
     }
 
+    CelestialPoints.Build();
+    TelescopePoints.Build();
+
     return true;
 }
 
@@ -166,7 +173,9 @@ bool NearestMathPlugin::TransformCelestialToTelescope(const double RightAscensio
     }
 
     // If we have sync points, then get the Nearest Point
-    ExtendedAlignmentDatabaseEntry nearest = GetNearestPoint(CelestialAltAz.azimuth, CelestialAltAz.altitude, true);
+    const ExtendedAlignmentDatabaseEntry *nearest = GetNearestPoint(CelestialAltAz.azimuth, CelestialAltAz.altitude, true);
+    if (nearest == nullptr)
+        return false;
 
     INDI::IEquatorialCoordinates TelescopeRADE;
 
@@ -176,13 +185,13 @@ bool NearestMathPlugin::TransformCelestialToTelescope(const double RightAscensio
     if (ApproximateMountAlignment == ZENITH)
     {
         INDI::IHorizontalCoordinates TelescopeAltAz;
-        AltitudeAzimuthFromTelescopeDirectionVector(nearest.TelescopeDirection, TelescopeAltAz);
-        HorizontalToEquatorial(&TelescopeAltAz, &Position, nearest.ObservationJulianDate, &TelescopeRADE);
+        AltitudeAzimuthFromTelescopeDirectionVector(nearest->TelescopeDirection, TelescopeAltAz);
+        HorizontalToEquatorial(&TelescopeAltAz, &Position, nearest->ObservationJulianDate, &TelescopeRADE);
     }
     // Equatorial? Transform nearest directly to telescope RA/DE
     else
     {
-        EquatorialCoordinatesFromTelescopeDirectionVector(nearest.TelescopeDirection, TelescopeRADE);
+        EquatorialCoordinatesFromTelescopeDirectionVector(nearest->TelescopeDirection, TelescopeRADE);
     }
 
     // Adjust the Celestial coordinates to account for the offset between the nearest point and the telescope
@@ -190,8 +199,8 @@ bool NearestMathPlugin::TransformCelestialToTelescope(const double RightAscensio
     // Means Final Telescope RA = 5 - (4-3) = 4
     // So we can issue GOTO to RA ~4, and it should up near Celestial RA ~5
     INDI::IEquatorialCoordinates TransformedTelescopeRADE = CelestialRADE;
-    TransformedTelescopeRADE.rightascension -= (nearest.RightAscension - TelescopeRADE.rightascension);
-    TransformedTelescopeRADE.declination -= (nearest.Declination - TelescopeRADE.declination);
+    TransformedTelescopeRADE.rightascension -= (nearest->RightAscension - TelescopeRADE.rightascension);
+    TransformedTelescopeRADE.declination -= (nearest->Declination - TelescopeRADE.declination);
 
     // Final step is to convert transformed telescope coordinates to a direction vector
     if (ApproximateMountAlignment == ZENITH)
@@ -261,19 +270,21 @@ bool NearestMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVe
     }
 
     // Find the nearest point to our telescope now
-    ExtendedAlignmentDatabaseEntry nearest = GetNearestPoint(TelescopeAltAz.azimuth, TelescopeAltAz.altitude, false);
+    const ExtendedAlignmentDatabaseEntry *nearest = GetNearestPoint(TelescopeAltAz.azimuth, TelescopeAltAz.altitude, false);
+    if (nearest == nullptr)
+        return false;
 
     // Now get the nearest telescope in equatorial coordinates.
     INDI::IEquatorialCoordinates NearestTelescopeRADE;
     if (ApproximateMountAlignment == ZENITH)
     {
-        INDI::IHorizontalCoordinates NearestTelescopeAltAz {nearest.TelescopeAzimuth, nearest.TelescopeAltitude};
-        HorizontalToEquatorial(&NearestTelescopeAltAz, &Position, nearest.ObservationJulianDate, &NearestTelescopeRADE);
+        INDI::IHorizontalCoordinates NearestTelescopeAltAz {nearest->TelescopeAzimuth, nearest->TelescopeAltitude};
+        HorizontalToEquatorial(&NearestTelescopeAltAz, &Position, nearest->ObservationJulianDate, &NearestTelescopeRADE);
     }
     // Equatorial?
     else
     {
-        EquatorialCoordinatesFromTelescopeDirectionVector(nearest.TelescopeDirection, NearestTelescopeRADE);
+        EquatorialCoordinatesFromTelescopeDirectionVector(nearest->TelescopeDirection, NearestTelescopeRADE);
     }
 
     // Adjust the Telescope coordinates to account for the offset between the nearest point and the telescope
@@ -281,8 +292,8 @@ bool NearestMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVe
     // Means Final Telescope RA = 5 + (4-3) = 6
     // So a telescope reporting ~5 hours should actually be pointing to ~6 hours in the sky.
     INDI::IEquatorialCoordinates TransformedCelestialRADE = TelescopeRADE;
-    TransformedCelestialRADE.rightascension += (nearest.RightAscension - NearestTelescopeRADE.rightascension);
-    TransformedCelestialRADE.declination += (nearest.Declination - NearestTelescopeRADE.declination);
+    TransformedCelestialRADE.rightascension += (nearest->RightAscension - NearestTelescopeRADE.rightascension);
+    TransformedCelestialRADE.declination += (nearest->Declination - NearestTelescopeRADE.declination);
 
     RightAscension = TransformedCelestialRADE.rightascension;
     Declination = TransformedCelestialRADE.declination;
@@ -292,41 +303,17 @@ bool NearestMathPlugin::TransformTelescopeToCelestial(const TelescopeDirectionVe
 //////////////////////////////////////////////////////////////////////////////////////
 ///
 //////////////////////////////////////////////////////////////////////////////////////
-ExtendedAlignmentDatabaseEntry NearestMathPlugin::GetNearestPoint(const double Azimuth, const double Altitude,
+const ExtendedAlignmentDatabaseEntry *NearestMathPlugin::GetNearestPoint(const double Azimuth, const double Altitude,
         bool isCelestial)
 {
-    ExtendedAlignmentDatabaseEntry nearest;
-    double distance = 1e6;
-
-    for (auto &oneEntry : ExtendedAlignmentPoints)
-    {
-        double oneDistance = 0;
-
-        if (isCelestial)
-            oneDistance = SphereUnitDistance(Azimuth, oneEntry.CelestialAzimuth, Altitude, oneEntry.CelestialAltitude);
-        else
-            oneDistance = SphereUnitDistance(Azimuth, oneEntry.TelescopeAzimuth, Altitude, oneEntry.TelescopeAltitude);
-
-        if (oneDistance < distance)
-        {
-            nearest = oneEntry;
-            distance = oneDistance;
-        }
-    }
-
-    return nearest;
-}
-
-//////////////////////////////////////////////////////////////////////////////////////
-/// Using haversine: http://en.wikipedia.org/wiki/Haversine_formula
-//////////////////////////////////////////////////////////////////////////////////////
-double NearestMathPlugin::SphereUnitDistance(double theta1, double theta2, double phi1, double phi2)
-{
-    double sqrt_haversin_lat  = sin(((phi2 - phi1) / 2) * (M_PI / 180));
-    double sqrt_haversin_long = sin(((theta2 - theta1) / 2) * (M_PI / 180));
-    return (2 *
-            asin(sqrt((sqrt_haversin_lat * sqrt_haversin_lat) + cos(phi1 * (M_PI / 180)) * cos(phi2 * (M_PI / 180)) *
-                      (sqrt_haversin_long * sqrt_haversin_long))));
+    // The trees index the points in the order of ExtendedAlignmentPoints
+    const SphericalKDTree &Points = isCelestial ? CelestialPoints : TelescopePoints;
+    const int Index = Points.FindNearest(Azimuth, Altitude);
+
+    // No point is found for an empty tree or a NaN position
+    if (Index < 0 || Index >= static_cast<int>(ExtendedAlignmentPoints.size()))
+        return nullptr;
+    return &ExtendedAlignmentPoints[Index];
 }
 } // namespace AlignmentSubsystem
 } // namespace INDI
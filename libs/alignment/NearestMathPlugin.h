@@ -22,6 +22,7 @@
 
 #include "AlignmentSubsystemForMathPlugins.h"
 #include "ConvexHull.h"
+#include "SphericalKDTree.h"
 
 namespace INDI
 {
@@ -114,24 +115,20 @@ class NearestMathPlugin : public AlignmentSubsystemForMathPlugins
         std::vector<ExtendedAlignmentDatabaseEntry> ExtendedAlignmentPoints;
 
         /**
-         * @brief SphereUnitDistance Get distance between two points on a sphere.
-         * @param theta1 latitudal angle of object 1
-         * @param theta2 latitudal angle of object 2
-         * @param phi1 longitudal angle of object 1
-         * @param phi2 longitudal angle of object 2
-         * @return disatnce in degrees.
+         * @brief Celestial and telescope horizontal coordinates of the ExtendedAlignmentPoints, rebuilt by Initialise.
          */
-        double SphereUnitDistance(double theta1, double theta2, double phi1, double phi2);
+        SphericalKDTree CelestialPoints;
+        SphericalKDTree TelescopePoints;
 
         /**
-         * @brief GetNearestPoint Traverses the ExtendedAlignmentPoints to find the closest point in horizontal coordinates on
+         * @brief GetNearestPoint Looks up the ExtendedAlignmentPoints to find the closest point in horizontal coordinates on
          * a sphere.
          * @param Azimuth Object azimuth in degrees.
          * @param Altitude Object altitude in degrees.
          * @param isCelestial If true, compute difference between Celestial coords, otherwise compute using Telescope coords.
-         * @return Closest point in data set.
+         * @return Closest point in data set, or nullptr if there is none, as for an empty data set or a NaN position.
          */
-        ExtendedAlignmentDatabaseEntry GetNearestPoint(const double Azimuth, const double Altitude, bool isCelestial);
+        const ExtendedAlignmentDatabaseEntry *GetNearestPoint(const double Azimuth, const double Altitude, bool isCelestial);
 };
 
 } // namespace AlignmentSubsystem
@@ -0,0 +1,168 @@
+/*******************************************************************************
+ Copyright(c) 2026 Jasem Mutlaq. All rights reserved.
+
+ Nearest neighbour lookup of points on the sphere.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include "SphericalKDTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace INDI
+{
+namespace AlignmentSubsystem
+{
+
+static void UnitVector(double Azimuth, double Altitude, double Position[3])
+{
+    const double az  = Azimuth * M_PI / 180.0;
+    const double alt = Altitude * M_PI / 180.0;
+    Position[0] = cos(alt) * cos(az);
+    Position[1] = cos(alt) * sin(az);
+    Position[2] = sin(alt);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+void SphericalKDTree::Clear()
+{
+    Nodes.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+void SphericalKDTree::AddPoint(double Azimuth, double Altitude)
+{
+    Node node;
+    UnitVector(Azimuth, Altitude, node.Position);
+    node.Index = static_cast<int>(Nodes.size());
+    node.Axis  = 0;
+    Nodes.push_back(node);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+void SphericalKDTree::Build()
+{
+    // Back to the order the points were added, so that a rebuild gives the same tree
+    std::sort(Nodes.begin(), Nodes.end(), [](const Node & a, const Node & b)
+    {
+        return a.Index < b.Index;
+    });
+    Build(0, Nodes.size());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+void SphericalKDTree::Build(size_t Begin, size_t End)
+{
+    if (End - Begin < 2)
+        return;
+
+    // Split along the axis the points are the most spread on
+    double Low[3]  = { 2, 2, 2 };
+    double High[3] = { -2, -2, -2 };
+    for (size_t i = Begin; i < End; i++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            Low[axis]  = std::min(Low[axis], Nodes[i].Position[axis]);
+            High[axis] = std::max(High[axis], Nodes[i].Position[axis]);
+        }
+    }
+    int Axis = 0;
+    for (int axis = 1; axis < 3; axis++)
+    {
+        if (High[axis] - Low[axis] > High[Axis] - Low[Axis])
+            Axis = axis;
+    }
+
+    const size_t Median = Begin + (End - Begin) / 2;
+    std::nth_element(Nodes.begin() + Begin, Nodes.begin() + Median, Nodes.begin() + End,
+                     [Axis](const Node & a, const Node & b)
+    {
+        return a.Position[Axis] < b.Position[Axis];
+    });
+    Nodes[Median].Axis = Axis;
+
+    Build(Begin, Median);
+    Build(Median + 1, End);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+int SphericalKDTree::FindNearest(double Azimuth, double Altitude) const
+{
+    double Position[3];
+    UnitVector(Azimuth, Altitude, Position);
+
+    // Chords are at most 2 long, 4 squared
+    double BestDistance = 5;
+    int BestIndex = -1;
+    Search(0, Nodes.size(), Position, BestDistance, BestIndex);
+    return BestIndex;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+///
+//////////////////////////////////////////////////////////////////////////////////////
+void SphericalKDTree::Search(size_t Begin, size_t End, const double Position[3], double &BestDistance,
+                             int &BestIndex) const
+{
+    if (Begin >= End)
+        return;
+
+    const size_t Median = Begin + (End - Begin) / 2;
+    const Node &node = Nodes[Median];
+
+    const double dx = Position[0] - node.Position[0];
+    const double dy = Position[1] - node.Position[1];
+    const double dz = Position[2] - node.Position[2];
+    const double Distance = dx * dx + dy * dy + dz * dz;
+    if (Distance < BestDistance || (Distance == BestDistance && node.Index < BestIndex))
+    {
+        BestDistance = Distance;
+        BestIndex = node.Index;
+    }
+
+    if (End - Begin == 1)
+        return;
+
+    // The side of the position first, the other side only if a point there may be as close
+    const double Offset = Position[node.Axis] - node.Position[node.Axis];
+    if (Offset < 0)
+    {
+        Search(Begin, Median, Position, BestDistance, BestIndex);
+        if (Offset * Offset <= BestDistance)
+            Search(Median + 1, End, Position, BestDistance, BestIndex);
+    }
+    else
+    {
+        Search(Median + 1, End, Position, BestDistance, BestIndex);
+        if (Offset * Offset <= BestDistance)
+            Search(Begin, Median, Position, BestDistance, BestIndex);
+    }
+}
+
+} // namespace AlignmentSubsystem
+} // namespace INDI
@@ -0,0 +1,90 @@
+/*******************************************************************************
+ Copyright(c) 2026 Jasem Mutlaq. All rights reserved.
+
+ Nearest neighbour lookup of points on the sphere.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace INDI
+{
+namespace AlignmentSubsystem
+{
+
+/**
+ * @brief The SphericalKDTree class finds the nearest of a set of points on the sphere.
+ *
+ * The points are kept as unit vectors in a k-d tree, balanced on the median of the axis along which each subset is
+ * the most spread. The chord between two unit vectors grows with the angle between them, so the nearest point by
+ * chord is the nearest point on the sphere, and a query walks down a single branch of the tree in most cases.
+ * Building the tree takes O(n log n) and a query O(log n) on average, without any allocation.
+ */
+class SphericalKDTree
+{
+    public:
+        /**
+         * @brief Clear Remove all the points from the tree.
+         */
+        void Clear();
+
+        /**
+         * @brief AddPoint Add a point to the tree, to be indexed by the next call to Build.
+         * @param Azimuth Longitudal angle of the point in degrees.
+         * @param Altitude Latitudal angle of the point in degrees.
+         */
+        void AddPoint(double Azimuth, double Altitude);
+
+        /**
+         * @brief Build Index the points added so far, to be called before FindNearest once the points changed.
+         */
+        void Build();
+
+        /**
+         * @brief FindNearest Find the point closest to a position on the sphere.
+         * @param Azimuth Longitudal angle of the position in degrees.
+         * @param Altitude Latitudal angle of the position in degrees.
+         * @return Index of the nearest point in the order they were added, the lowest index among points at the same
+         * distance, or -1 if the tree is empty.
+         */
+        int FindNearest(double Azimuth, double Altitude) const;
+
+        size_t Size() const
+        {
+            return Nodes.size();
+        }
+
+    private:
+        struct Node
+        {
+            double Position[3];
+            int Index;
+            // Axis the subset under this node is split along
+            int Axis;
+        };
+
+        void Build(size_t Begin, size_t End);
+        void Search(size_t Begin, size_t End, const double Position[3], double &BestDistance, int &BestIndex) const;
+
+        // Nodes of the tree in order, the root of a subset being the median of its range
+        std::vector<Node> Nodes;
+};
+
+} // namespace AlignmentSubsystem
+} // namespace INDI
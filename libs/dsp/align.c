@@ -32,63 +32,6 @@ static int dsp_qsort_delta_diff_desc (const void *arg1, const void *arg2)
     return ((*a1).delta < (*a2).delta ? 1 : -1);
 }
 
-static int dsp_qsort_delta_diff_asc (const void *arg1, const void *arg2)
-{
-    delta_diff* a1 = (delta_diff*)arg1;
-    delta_diff* a2 = (delta_diff*)arg2;
-    return ((*a1).delta > (*a2).delta ? 1 : -1);
-}
-
-static int dsp_qsort_triangle_delta_desc(const void *arg1, const void *arg2)
-{
-    dsp_triangle* a = (dsp_triangle*)arg1;
-    dsp_triangle* b = (dsp_triangle*)arg2;
-    int ret = 0;
-    int s = 0;
-    for(s = 0; s < (*a).stars_count; s++)
-        ret |= ((*a).sizes[s] < (*b).sizes[s]);
-    return (ret ? 1 : -1);
-}
-
-static int dsp_qsort_triangle_delta_asc(const void *arg1, const void *arg2)
-{
-    dsp_triangle* a = (dsp_triangle*)arg1;
-    dsp_triangle* b = (dsp_triangle*)arg2;
-    int ret = 0;
-    int s = 0;
-    for(s = 0; s < (*a).stars_count; s++)
-        ret |= ((*a).sizes[s] > (*b).sizes[s]);
-    return (ret ? 1 : -1);
-}
-
-static int dsp_qsort_triangle_diameter_desc(const void *arg1, const void *arg2)
-{
-    dsp_triangle* a = (dsp_triangle*)arg1;
-    dsp_triangle* b = (dsp_triangle*)arg2;
-    int ret = 0;
-    int s = 0;
-    for(s = 0; s < (*a).stars_count; s++) {
-        ret |= ((*a).stars[s].diameter < (*b).stars[s].diameter);
-        ret |= ((*a).stars[s].peak < (*b).stars[s].peak);
-        ret |= ((*a).stars[s].flux < (*b).stars[s].flux);
-    }
-    return (ret ? 1 : -1);
-}
-
-static int dsp_qsort_triangle_diameter_asc(const void *arg1, const void *arg2)
-{
-    dsp_triangle* a = (dsp_triangle*)arg1;
-    dsp_triangle* b = (dsp_triangle*)arg2;
-    int ret = 0;
-    int s = 0;
-    for(s = 0; s < (*a).stars_count; s++) {
-        ret |= ((*a).stars[s].diameter > (*b).stars[s].diameter);
-        ret |= ((*a).stars[s].peak > (*b).stars[s].peak);
-        ret |= ((*a).stars[s].flux > (*b).stars[s].flux);
-    }
-    return (ret ? 1 : -1);
-}
-
 static int dsp_qsort_star_diameter_desc(const void *arg1, const void *arg2)
 {
     dsp_star* a = (dsp_star*)arg1;
@@ -96,27 +39,6 @@ static int dsp_qsort_star_diameter_desc(const void *arg1, const void *arg2)
     return ((*a).diameter < (*b).diameter ? 1 : -1);
 }
 
-static int dsp_qsort_star_diameter_asc(const void *arg1, const void *arg2)
-{
-    dsp_star* a = (dsp_star*)arg1;
-    dsp_star* b = (dsp_star*)arg2;
-    return ((*a).diameter > (*b).diameter ? 1 : -1);
-}
-
-static int dsp_qsort_double_desc (const void *arg1, const void *arg2)
-{
-    double* a = (double*)arg1;
-    double* b = (double*)arg2;
-    return ((*a) < (*b) ? 1 : -1);
-}
-
-static int dsp_qsort_double_asc (const void *arg1, const void *arg2)
-{
-    double* a = (double*)arg1;
-    double* b = (double*)arg2;
-    return ((*a) > (*b) ? 1 : -1);
-}
-
 static double calc_match_score(dsp_triangle t1, dsp_triangle t2, dsp_align_info align_info)
 {
     int x = 0;
@@ -214,6 +136,7 @@ dsp_triangle *dsp_align_calc_triangle(dsp_star* stars, int num_stars)
     for(x = 0; x < triangle->stars_count; x++) {
         for(y = x+1; y < triangle->stars_count; y++) {
             deltadiff[idx].diff = (double*)malloc(sizeof(double)*triangle->dims);
+            deltadiff[idx].delta = 0;
             for(d = 0; d < triangle->dims; d++) {
                 deltadiff[idx].diff[d] = stars[x].center.location[d]-stars[y].center.location[d];
                 deltadiff[idx].delta += pow(deltadiff[idx].diff[d], 2);
@@ -256,19 +179,21 @@ dsp_triangle *dsp_align_calc_triangle(dsp_star* stars, int num_stars)
     return triangle;
 }
 
-int dsp_align_get_offset(dsp_stream_p stream1, dsp_stream_p stream2, double tolerance, double target_score, int num_stars)
+/* Exhaustive comparison of the triangles of the two streams, used for streams not having two dimensions */
+static int dsp_align_get_offset_triangles(dsp_stream_p stream1, dsp_stream_p stream2, double tolerance, double target_score, int num_stars)
 {
     dsp_align_info *align_info;
     double decimals = pow(10, tolerance);
     double div = 0.0;
     int d, t1, t2, x, y;
     double phi = 0.0;
-    double ratio = decimals*1600.0/div;
+    double ratio;
     dsp_star *stars = (dsp_star*)malloc(sizeof(dsp_star)*num_stars);
     for(d = 0; d < stream1->dims; d++) {
         div += pow(stream2->sizes[d], 2);
     }
     div = pow(div, 0.5);
+    ratio = decimals*1600.0/div;
     pwarn("decimals: %lf\n", decimals);
     target_score = (1.0-target_score / 100.0);
     stream2->align_info.dims = stream2->dims;
@@ -337,3 +262,443 @@ int dsp_align_get_offset(dsp_stream_p stream1, dsp_stream_p stream2, double tole
         stream2->align_info.err &= ~DSP_ALIGN_ROTATED;
     return stream2->align_info.err;
 }
+
+/*
+ * Matching of two dimensional star fields. Every star forms triangles with pairs of its nearest
+ * neighbours, and each triangle is described by the ratios of its sides, which do not change with
+ * translation, rotation and scale. Triangles of the two fields with close descriptors, found with a
+ * k-d tree, propose a similarity transform, and the proposal mapping most stars of the reference onto
+ * stars of the current field within DSP_ALIGN_MATCH_RADIUS wins (RANSAC). The transform is then
+ * refined by least squares over all the matched stars.
+ */
+///Neighbours of each star forming its triangles
+#define DSP_ALIGN_NEIGHBOURS 6
+///Largest difference of the side ratios of two matching triangles
+#define DSP_ALIGN_DESCRIPTOR_TOLERANCE 0.02
+///Reference triangles with the closest side ratios paired with each current triangle
+#define DSP_ALIGN_CANDIDATES 3
+///Largest distance in pixels of two matching stars
+#define DSP_ALIGN_MATCH_RADIUS 2.0
+///Probability to pick a correct triangle pair at least once before stopping
+#define DSP_ALIGN_CONFIDENCE 0.999
+///Largest number of evaluated triangle pairs
+#define DSP_ALIGN_MAX_ITERATIONS 5000
+
+typedef struct {
+    /// Points as x,y pairs
+    double *points;
+    /// Permutation of the points ordered as an implicit tree, the median of each range splits it
+    int *index;
+    int count;
+} dsp_align_tree;
+
+typedef struct {
+    /// Vertices ordered by the length of the opposite side, shortest first
+    int vertex[3];
+} dsp_align_triangle;
+
+typedef struct {
+    int ref;
+    int cur;
+} dsp_align_pair;
+
+/// Similarity transform, cur = a * ref + b in complex notation
+typedef struct {
+    double a[2];
+    double b[2];
+} dsp_align_transform;
+
+static void dsp_align_tree_select(dsp_align_tree *tree, int lo, int hi, int k, int axis)
+{
+    while(hi - lo > 1) {
+        double pivot = tree->points[tree->index[(lo + hi) / 2] * 2 + axis];
+        int i = lo, j = hi - 1;
+        while(i <= j) {
+            while(tree->points[tree->index[i] * 2 + axis] < pivot) i++;
+            while(tree->points[tree->index[j] * 2 + axis] > pivot) j--;
+            if(i <= j) {
+                int t = tree->index[i];
+                tree->index[i++] = tree->index[j];
+                tree->index[j--] = t;
+            }
+        }
+        if(k <= j)
+            hi = j + 1;
+        else if(k >= i)
+            lo = i;
+        else
+            return;
+    }
+}
+
+static void dsp_align_tree_split(dsp_align_tree *tree, int lo, int hi, int axis)
+{
+    if(hi - lo < 2)
+        return;
+    int mid = (lo + hi) / 2;
+    dsp_align_tree_select(tree, lo, hi, mid, axis);
+    dsp_align_tree_split(tree, lo, mid, !axis);
+    dsp_align_tree_split(tree, mid + 1, hi, !axis);
+}
+
+static void dsp_align_tree_build(dsp_align_tree *tree, double *points, int count)
+{
+    int x;
+    tree->points = points;
+    tree->count = count;
+    tree->index = (int*)malloc(sizeof(int) * Max(1, count));
+    for(x = 0; x < count; x++)
+        tree->index[x] = x;
+    dsp_align_tree_split(tree, 0, count, 0);
+}
+
+/* Keeps in best the k nearest points to q, excluding the point skip, sorted by their squared distance in dist */
+static void dsp_align_tree_nearest(dsp_align_tree *tree, int lo, int hi, int axis, double *q, int skip, int k, int *best, double *dist, int *found)
+{
+    if(hi <= lo)
+        return;
+    int mid = (lo + hi) / 2;
+    int point = tree->index[mid];
+    double *p = &tree->points[point * 2];
+    double dx = p[0] - q[0], dy = p[1] - q[1];
+    double d2 = dx * dx + dy * dy;
+    if(point != skip && (*found < k || d2 < dist[*found - 1])) {
+        int x = *found < k ? (*found)++ : k - 1;
+        for(; x > 0 && dist[x - 1] > d2; x--) {
+            dist[x] = dist[x - 1];
+            best[x] = best[x - 1];
+        }
+        dist[x] = d2;
+        best[x] = point;
+    }
+    double delta = q[axis] - p[axis];
+    int near_lo = delta < 0 ? lo : mid + 1, near_hi = delta < 0 ? mid : hi;
+    int far_lo = delta < 0 ? mid + 1 : lo, far_hi = delta < 0 ? hi : mid;
+    dsp_align_tree_nearest(tree, near_lo, near_hi, !axis, q, skip, k, best, dist, found);
+    if(*found < k || delta * delta < dist[*found - 1])
+        dsp_align_tree_nearest(tree, far_lo, far_hi, !axis, q, skip, k, best, dist, found);
+}
+
+static int dsp_align_compare_triangles(const void *arg1, const void *arg2)
+{
+    const int *a = ((const dsp_align_triangle*)arg1)->vertex;
+    const int *b = ((const dsp_align_triangle*)arg2)->vertex;
+    int x;
+    for(x = 0; x < 3; x++) {
+        if(a[x] != b[x])
+            return a[x] < b[x] ? -1 : 1;
+    }
+    return 0;
+}
+
+static void dsp_align_sort3(int *v)
+{
+    int t;
+    if(v[0] > v[1]) { t = v[0]; v[0] = v[1]; v[1] = t; }
+    if(v[1] > v[2]) { t = v[1]; v[1] = v[2]; v[2] = t; }
+    if(v[0] > v[1]) { t = v[0]; v[0] = v[1]; v[1] = t; }
+}
+
+/*
+ * Builds the triangles of the stars and their descriptors, as pairs of side ratios.
+ * Returns the number of triangles, degenerate triangles are skipped.
+ */
+static int dsp_align_triangles(double *points, int count, dsp_align_tree *tree, dsp_align_triangle **triangles, double **descriptors)
+{
+    int x, i, j, n = 0;
+    int k = Min(DSP_ALIGN_NEIGHBOURS, count - 1);
+    int best[DSP_ALIGN_NEIGHBOURS];
+    double dist[DSP_ALIGN_NEIGHBOURS];
+    dsp_align_triangle *list = (dsp_align_triangle*)malloc(sizeof(dsp_align_triangle) * Max(1, count * k * (k - 1) / 2));
+    for(x = 0; x < count && k > 1; x++) {
+        int found = 0;
+        dsp_align_tree_nearest(tree, 0, tree->count, 0, &points[x * 2], x, k, best, dist, &found);
+        for(i = 0; i < found; i++) {
+            for(j = i + 1; j < found; j++) {
+                list[n].vertex[0] = x;
+                list[n].vertex[1] = best[i];
+                list[n].vertex[2] = best[j];
+                dsp_align_sort3(list[n].vertex);
+                n++;
+            }
+        }
+    }
+    // neighbouring stars build the same triangles
+    qsort(list, n, sizeof(dsp_align_triangle), dsp_align_compare_triangles);
+    *descriptors = (double*)malloc(sizeof(double) * 2 * Max(1, n));
+    int unique = 0;
+    for(x = 0; x < n; x++) {
+        if(x > 0 && !dsp_align_compare_triangles(&list[x], &list[x - 1]))
+            continue;
+        int *v = list[x].vertex;
+        double sides[3];
+        for(i = 0; i < 3; i++) {
+            double *a = &points[v[(i + 1) % 3] * 2];
+            double *b = &points[v[(i + 2) % 3] * 2];
+            sides[i] = sqrt(pow(a[0] - b[0], 2) + pow(a[1] - b[1], 2));
+        }
+        // order the vertices by the length of the opposite side
+        int order[3] = { 0, 1, 2 };
+        for(i = 1; i < 3; i++) {
+            for(j = i; j > 0 && sides[order[j - 1]] > sides[order[j]]; j--) {
+                int t = order[j];
+                order[j] = order[j - 1];
+                order[j - 1] = t;
+            }
+        }
+        double s0 = sides[order[0]], s1 = sides[order[1]], s2 = sides[order[2]];
+        if(s0 <= 0.0 || s0 + s1 <= s2 * (1.0 + DSP_ALIGN_DESCRIPTOR_TOLERANCE))
+            continue;
+        dsp_align_triangle triangle;
+        for(i = 0; i < 3; i++)
+            triangle.vertex[i] = v[order[i]];
+        list[unique] = triangle;
+        (*descriptors)[unique * 2] = s1 / s2;
+        (*descriptors)[unique * 2 + 1] = s0 / s1;
+        unique++;
+    }
+    *triangles = list;
+    return unique;
+}
+
+/* Least squares similarity transform mapping the ref points onto the cur points */
+static int dsp_align_fit(double *ref, double *cur, dsp_align_pair *pairs, int count, dsp_align_transform *transform)
+{
+    int x;
+    double mr[2] = { 0, 0 }, mc[2] = { 0, 0 };
+    double num[2] = { 0, 0 }, den = 0;
+    if(count < 2)
+        return 0;
+    for(x = 0; x < count; x++) {
+        mr[0] += ref[pairs[x].ref * 2];
+        mr[1] += ref[pairs[x].ref * 2 + 1];
+        mc[0] += cur[pairs[x].cur * 2];
+        mc[1] += cur[pairs[x].cur * 2 + 1];
+    }
+    mr[0] /= count;
+    mr[1] /= count;
+    mc[0] /= count;
+    mc[1] /= count;
+    for(x = 0; x < count; x++) {
+        double px = ref[pairs[x].ref * 2] - mr[0], py = ref[pairs[x].ref * 2 + 1] - mr[1];
+        double qx = cur[pairs[x].cur * 2] - mc[0], qy = cur[pairs[x].cur * 2 + 1] - mc[1];
+        // q times the conjugate of p
+        num[0] += qx * px + qy * py;
+        num[1] += qy * px - qx * py;
+        den += px * px + py * py;
+    }
+    if(den <= 0.0)
+        return 0;
+    transform->a[0] = num[0] / den;
+    transform->a[1] = num[1] / den;
+    transform->b[0] = mc[0] - (transform->a[0] * mr[0] - transform->a[1] * mr[1]);
+    transform->b[1] = mc[1] - (transform->a[0] * mr[1] + transform->a[1] * mr[0]);
+    return 1;
+}
+
+static void dsp_align_apply(dsp_align_transform *transform, double *p, double *out)
+{
+    out[0] = transform->a[0] * p[0] - transform->a[1] * p[1] + transform->b[0];
+    out[1] = transform->a[0] * p[1] + transform->a[1] * p[0] + transform->b[1];
+}
+
+/*
+ * Pairs each reference star with the nearest current star within DSP_ALIGN_MATCH_RADIUS of its transformed position.
+ * Gives up as soon as the pairs cannot be more than beat.
+ */
+static int dsp_align_inliers(double *ref, int ref_count, dsp_align_tree *cur, dsp_align_transform *transform, dsp_align_pair *pairs, int beat)
+{
+    int x, count = 0;
+    for(x = 0; x < ref_count && count + ref_count - x > beat; x++) {
+        double q[2], dist;
+        int best, found = 0;
+        dsp_align_apply(transform, &ref[x * 2], q);
+        dsp_align_tree_nearest(cur, 0, cur->count, 0, q, -1, 1, &best, &dist, &found);
+        if(found && dist <= DSP_ALIGN_MATCH_RADIUS * DSP_ALIGN_MATCH_RADIUS) {
+            if(pairs != NULL) {
+                pairs[count].ref = x;
+                pairs[count].cur = best;
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+static double *dsp_align_points(dsp_stream_p stream)
+{
+    int x;
+    double *points = (double*)malloc(sizeof(double) * 2 * Max(1, stream->stars_count));
+    for(x = 0; x < stream->stars_count; x++) {
+        points[x * 2] = stream->stars[x].center.location[0];
+        points[x * 2 + 1] = stream->stars[x].center.location[1];
+    }
+    return points;
+}
+
+/* Finds the transform mapping the stars of stream1 onto the stars of stream2, returns the number of matched stars */
+static int dsp_align_match(dsp_stream_p stream1, dsp_stream_p stream2, dsp_align_transform *best, double *ref_center, double *cur_center)
+{
+    int x, y, t, iterations = 0, matched = 0;
+    double *ref = dsp_align_points(stream1);
+    double *cur = dsp_align_points(stream2);
+    dsp_align_tree ref_tree, cur_tree, descriptor_tree;
+    dsp_align_triangle *ref_triangles, *cur_triangles;
+    double *ref_descriptors, *cur_descriptors;
+    dsp_align_pair *candidates;
+    int candidates_count = 0;
+    dsp_align_tree_build(&ref_tree, ref, stream1->stars_count);
+    dsp_align_tree_build(&cur_tree, cur, stream2->stars_count);
+    int ref_count = dsp_align_triangles(ref, stream1->stars_count, &ref_tree, &ref_triangles, &ref_descriptors);
+    int cur_count = dsp_align_triangles(cur, stream2->stars_count, &cur_tree, &cur_triangles, &cur_descriptors);
+    pgarb("%d reference and %d current triangles\n", ref_count, cur_count);
+
+    // pairs of triangles with close descriptors, the closest only so that dense fields do not pair every triangle
+    dsp_align_tree_build(&descriptor_tree, ref_descriptors, ref_count);
+    candidates = (dsp_align_pair*)malloc(sizeof(dsp_align_pair) * Max(1, cur_count * DSP_ALIGN_CANDIDATES));
+    for(t = 0; t < cur_count; t++) {
+        int best[DSP_ALIGN_CANDIDATES], found = 0;
+        double dist[DSP_ALIGN_CANDIDATES];
+        dsp_align_tree_nearest(&descriptor_tree, 0, ref_count, 0, &cur_descriptors[t * 2], -1, DSP_ALIGN_CANDIDATES, best, dist, &found);
+        for(x = 0; x < found && dist[x] <= DSP_ALIGN_DESCRIPTOR_TOLERANCE * DSP_ALIGN_DESCRIPTOR_TOLERANCE; x++) {
+            candidates[candidates_count].ref = best[x];
+            candidates[candidates_count++].cur = t;
+        }
+    }
+
+    // evaluate the candidates in pseudo random order, same for every run
+    unsigned int seed = 1;
+    for(x = candidates_count - 1; x > 0; x--) {
+        seed = seed * 1103515245 + 12345;
+        y = (seed >> 8) % (x + 1);
+        dsp_align_pair swap = candidates[x];
+        candidates[x] = candidates[y];
+        candidates[y] = swap;
+    }
+    double needed = DSP_ALIGN_MAX_ITERATIONS;
+    for(x = 0; x < candidates_count && iterations < Min(needed, DSP_ALIGN_MAX_ITERATIONS); x++, iterations++) {
+        dsp_align_triangle *a = &ref_triangles[candidates[x].ref];
+        dsp_align_triangle *b = &cur_triangles[candidates[x].cur];
+        dsp_align_pair pairs[3];
+        dsp_align_transform transform;
+        for(y = 0; y < 3; y++) {
+            pairs[y].ref = a->vertex[y];
+            pairs[y].cur = b->vertex[y];
+        }
+        if(!dsp_align_fit(ref, cur, pairs, 3, &transform))
+            continue;
+        // mirrored or misordered vertices do not fit
+        int fits = 1;
+        for(y = 0; y < 3 && fits; y++) {
+            double q[2];
+            dsp_align_apply(&transform, &ref[pairs[y].ref * 2], q);
+            fits = pow(q[0] - cur[pairs[y].cur * 2], 2) + pow(q[1] - cur[pairs[y].cur * 2 + 1], 2) <=
+                   DSP_ALIGN_MATCH_RADIUS * DSP_ALIGN_MATCH_RADIUS;
+        }
+        if(!fits)
+            continue;
+        int inliers = dsp_align_inliers(ref, stream1->stars_count, &cur_tree, &transform, NULL, Max(2, matched));
+        if(inliers < 3 || inliers <= matched)
+            continue;
+        matched = inliers;
+        *best = transform;
+        // share of the candidates agreeing with the best transform, bounds the remaining iterations
+        int agreeing = 0;
+        for(y = 0; y < candidates_count; y++) {
+            dsp_align_triangle *ra = &ref_triangles[candidates[y].ref];
+            dsp_align_triangle *cb = &cur_triangles[candidates[y].cur];
+            int v, agree = 1;
+            for(v = 0; v < 3 && agree; v++) {
+                double q[2];
+                dsp_align_apply(&transform, &ref[ra->vertex[v] * 2], q);
+                agree = pow(q[0] - cur[cb->vertex[v] * 2], 2) + pow(q[1] - cur[cb->vertex[v] * 2 + 1], 2) <=
+                        DSP_ALIGN_MATCH_RADIUS * DSP_ALIGN_MATCH_RADIUS;
+            }
+            agreeing += agree;
+        }
+        double ratio = (double)agreeing / candidates_count;
+        if(ratio >= 1.0)
+            needed = 1;
+        else if(ratio > 0.0)
+            needed = log(1.0 - DSP_ALIGN_CONFIDENCE) / log(1.0 - ratio);
+    }
+    pgarb("%d of %d candidate triangle pairs evaluated\n", iterations, candidates_count);
+
+    // refine over all the matched stars
+    if(matched >= 3) {
+        dsp_align_pair *pairs = (dsp_align_pair*)malloc(sizeof(dsp_align_pair) * stream1->stars_count);
+        for(t = 0; t < 2; t++) {
+            dsp_align_transform refined;
+            int count = dsp_align_inliers(ref, stream1->stars_count, &cur_tree, best, pairs, 0);
+            if(count < matched || !dsp_align_fit(ref, cur, pairs, count, &refined))
+                break;
+            *best = refined;
+            matched = count;
+        }
+        matched = dsp_align_inliers(ref, stream1->stars_count, &cur_tree, best, pairs, 0);
+        ref_center[0] = ref_center[1] = cur_center[0] = cur_center[1] = 0;
+        for(x = 0; x < matched; x++) {
+            ref_center[0] += ref[pairs[x].ref * 2] / matched;
+            ref_center[1] += ref[pairs[x].ref * 2 + 1] / matched;
+        }
+        dsp_align_apply(best, ref_center, cur_center);
+        free(pairs);
+    }
+
+    free(candidates);
+    free(descriptor_tree.index);
+    free(ref_tree.index);
+    free(cur_tree.index);
+    free(ref_triangles);
+    free(cur_triangles);
+    free(ref_descriptors);
+    free(cur_descriptors);
+    free(ref);
+    free(cur);
+    return matched;
+}
+
+int dsp_align_get_offset(dsp_stream_p stream1, dsp_stream_p stream2, double tolerance, double target_score, int num_stars)
+{
+    int d;
+    if(stream1->dims != 2 || stream2->dims != 2)
+        return dsp_align_get_offset_triangles(stream1, stream2, tolerance, target_score, num_stars);
+    double decimals = pow(10, tolerance);
+    double diagonal = sqrt(pow(stream2->sizes[0], 2) + pow(stream2->sizes[1], 2));
+    double ratio = decimals * 1600.0 / diagonal;
+    dsp_align_transform transform = { { 1, 0 }, { 0, 0 } };
+    double ref_center[2] = { 0, 0 }, cur_center[2] = { 0, 0 };
+    int matched = 0;
+    target_score = (1.0 - target_score / 100.0);
+    stream2->align_info.dims = stream2->dims;
+    stream2->align_info.triangles_count = 0;
+    stream2->align_info.decimals = decimals;
+    if(stream1->stars_count >= 3 && stream2->stars_count >= 3)
+        matched = dsp_align_match(stream1, stream2, &transform, ref_center, cur_center);
+    // share of the stars not matched
+    stream2->align_info.score = 1.0 - (double)matched / Min(stream1->stars_count, stream2->stars_count);
+    if(matched < 3)
+        stream2->align_info.score = 1.0;
+    // dsp_stream_align samples the current frame at R(-radians) (p - center + offset) / factor + center
+    double scale = sqrt(pow(transform.a[0], 2) + pow(transform.a[1], 2));
+    double radians = -atan2(transform.a[1], transform.a[0]);
+    if(radians < 0.0)
+        radians += M_PI * 2.0;
+    for(d = 0; d < 2; d++) {
+        stream2->align_info.center[d] = cur_center[d];
+        stream2->align_info.offset[d] = cur_center[d] - ref_center[d];
+        stream2->align_info.factor[d] = 1.0 / scale;
+    }
+    stream2->align_info.radians[0] = radians;
+    double phi = sqrt(pow(stream2->align_info.offset[0], 2) + pow(stream2->align_info.offset[1], 2));
+    stream2->align_info.err = 0xf;
+    if(floor(stream2->align_info.score * decimals) < floor(target_score * decimals))
+        stream2->align_info.err &= ~DSP_ALIGN_NO_MATCH;
+    if(fabs(phi * ratio * decimals) < 1.0)
+        stream2->align_info.err &= ~DSP_ALIGN_TRANSLATED;
+    if(floor(fabs(stream2->align_info.factor[0] - 1.0) * decimals) < 1)
+        stream2->align_info.err &= ~DSP_ALIGN_SCALED;
+    if(floor(fmin(radians, M_PI * 2.0 - radians) * decimals) < 1)
+        stream2->align_info.err &= ~DSP_ALIGN_ROTATED;
+    return stream2->align_info.err;
+}
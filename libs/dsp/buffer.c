@@ -27,18 +27,21 @@ void dsp_buffer_shift(dsp_stream_p stream)
         return;
     dsp_t* tmp = (dsp_t*)malloc(sizeof(dsp_t) * stream->len);
     int x, d;
-    for(x = 0; x < stream->len/2; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
+    int pos[stream->dims];
+    dsp_stream_position_init(stream, 0, pos);
+    for(x = 0; x < stream->len/2; x++, dsp_stream_position_next(stream, pos)) {
+        int y = 0;
+        int m = 1;
         for(d = 0; d < stream->dims; d++) {
             if(pos[d]<stream->sizes[d] / 2) {
-                pos[d] += stream->sizes[d] / 2;
+                y += m * (pos[d] + stream->sizes[d] / 2);
             } else {
-                pos[d] -= stream->sizes[d] / 2;
+                y += m * (pos[d] - stream->sizes[d] / 2);
             }
+            m *= stream->sizes[d];
         }
-        tmp[x] = stream->buf[dsp_stream_set_position(stream, pos)];
-        tmp[dsp_stream_set_position(stream, pos)] = stream->buf[x];
-        free(pos);
+        tmp[x] = stream->buf[y];
+        tmp[y] = stream->buf[x];
     }
     memcpy(stream->buf, tmp, stream->len * sizeof(dsp_t));
     free(tmp);
@@ -222,166 +225,256 @@ void dsp_buffer_log1(dsp_stream_p stream, double val)
 
 }
 
-static int compare( const void* a, const void* b)
+/*
+ * Linear offsets of the elements of a box centered on an element of the stream,
+ * the index of each neighbour is the index of the element plus its offset.
+ */
+static int* dsp_buffer_box_offsets(dsp_stream_p stream, dsp_stream_p box, int size)
 {
-     dsp_t int_a = * ( (dsp_t*) a );
-     dsp_t int_b = * ( (dsp_t*) b );
+    int y, dim;
+    int* offsets = (int*)malloc(sizeof(int) * box->len);
+    int mat[box->dims];
+    dsp_stream_position_init(box, 0, mat);
+    for(y = 0; y < box->len; y++, dsp_stream_position_next(box, mat)) {
+        int m = 1;
+        offsets[y] = 0;
+        for(dim = 0; dim < stream->dims; dim++) {
+            offsets[y] += m * (mat[dim] - size / 2);
+            m *= stream->sizes[dim];
+        }
+    }
+    return offsets;
+}
 
-     if ( int_a == int_b ) return 0;
-     else if ( int_a < int_b ) return -1;
-     else return 1;
+typedef struct {
+    int size;
+    int rank;
+    int integral;
+    dsp_t min;
+    int bins;
+    dsp_stream_p stream;
+} dsp_buffer_box_arguments;
+
+static dsp_stream_p dsp_buffer_box_new(dsp_stream_p stream, int size)
+{
+    int d;
+    dsp_stream_p box = dsp_stream_new();
+    for(d = 0; d < stream->dims; d++)
+        dsp_stream_add_dim(box, size);
+    return box;
+}
+
+/*
+ * Rank filters slide the box along the stream: moving to the next element each run of the box
+ * along the first dimension loses its first element and gains the one following its last.
+ * Integral samples within DSP_BUFFER_RANK_MAX_BINS levels are counted in a two level histogram,
+ * the rank is tracked by a pivot that moves by whole blocks of bins when far from the result.
+ * Other samples are kept in a sorted window.
+ */
+#define DSP_BUFFER_RANK_MAX_BINS 65536
+#define DSP_BUFFER_RANK_BLOCK_BITS 6
+#define DSP_BUFFER_RANK_BLOCK (1 << DSP_BUFFER_RANK_BLOCK_BITS)
+
+typedef struct {
+    int *fine;
+    int *coarse;
+    int bins;
+    int count;
+    int pivot;
+    int below;
+    dsp_t *sorted;
+} dsp_buffer_rank_window;
+
+static int dsp_buffer_rank_search(dsp_buffer_rank_window *window, dsp_t value)
+{
+    int low = 0, high = window->count;
+    while(low < high) {
+        int mid = (low + high) / 2;
+        if(window->sorted[mid] < value)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+static void dsp_buffer_rank_add(dsp_buffer_rank_window *window, dsp_buffer_box_arguments *arguments, dsp_t value)
+{
+    if(arguments->integral) {
+        int bin = (int)(value - arguments->min);
+        window->fine[bin]++;
+        window->coarse[bin >> DSP_BUFFER_RANK_BLOCK_BITS]++;
+        if(bin < window->pivot)
+            window->below++;
+    } else {
+        int pos = dsp_buffer_rank_search(window, value);
+        memmove(&window->sorted[pos + 1], &window->sorted[pos], sizeof(dsp_t) * (window->count - pos));
+        window->sorted[pos] = value;
+    }
+    window->count++;
+}
+
+static void dsp_buffer_rank_remove(dsp_buffer_rank_window *window, dsp_buffer_box_arguments *arguments, dsp_t value)
+{
+    if(arguments->integral) {
+        int bin = (int)(value - arguments->min);
+        window->fine[bin]--;
+        window->coarse[bin >> DSP_BUFFER_RANK_BLOCK_BITS]--;
+        if(bin < window->pivot)
+            window->below--;
+    } else {
+        int pos = dsp_buffer_rank_search(window, value);
+        memmove(&window->sorted[pos], &window->sorted[pos + 1], sizeof(dsp_t) * (window->count - pos - 1));
+    }
+    window->count--;
+}
+
+/* Value of the element of rank r, 0 being the lowest, of the window */
+static dsp_t dsp_buffer_rank_get(dsp_buffer_rank_window *window, dsp_buffer_box_arguments *arguments, int r)
+{
+    if(!arguments->integral)
+        return window->sorted[r];
+    while(window->below + window->fine[window->pivot] <= r) {
+        window->below += window->fine[window->pivot++];
+        while((window->pivot & (DSP_BUFFER_RANK_BLOCK - 1)) == 0 && window->pivot < window->bins &&
+                window->below + window->coarse[window->pivot >> DSP_BUFFER_RANK_BLOCK_BITS] <= r) {
+            window->below += window->coarse[window->pivot >> DSP_BUFFER_RANK_BLOCK_BITS];
+            window->pivot += DSP_BUFFER_RANK_BLOCK;
+        }
+    }
+    while(window->below > r) {
+        if((window->pivot & (DSP_BUFFER_RANK_BLOCK - 1)) == 0 && window->pivot >= DSP_BUFFER_RANK_BLOCK &&
+                window->below - window->coarse[(window->pivot >> DSP_BUFFER_RANK_BLOCK_BITS) - 1] > r) {
+            window->pivot -= DSP_BUFFER_RANK_BLOCK;
+            window->below -= window->coarse[window->pivot >> DSP_BUFFER_RANK_BLOCK_BITS];
+            continue;
+        }
+        window->below -= window->fine[--window->pivot];
+    }
+    return window->pivot + arguments->min;
 }
 
-static void* dsp_buffer_median_th(void* arg)
+static void dsp_buffer_rank_th(void* arg, int start, int end)
 {
-    struct {
-        int cur_th;
-        int size;
-        int median;
-        dsp_stream_p stream;
-        dsp_stream_p box;
-     } *arguments = arg;
+    dsp_buffer_box_arguments *arguments = arg;
     dsp_stream_p stream = arguments->stream;
-    dsp_stream_p box = arguments->box;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
     int size = arguments->size;
-    int median = arguments->median;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
-    int x, y, dim, idx;
-    dsp_t* sorted = (dsp_t*)malloc(pow(size, stream->dims) * sizeof(dsp_t));
-    int len = pow(size, in->dims);
+    dsp_stream_p box = dsp_buffer_box_new(stream, size);
+    int* offsets = dsp_buffer_box_offsets(stream, box, size);
+    int runs = box->len / size;
+    int x, y, idx;
+    dsp_buffer_rank_window window;
+    memset(&window, 0, sizeof(window));
+    if(arguments->integral) {
+        window.bins = arguments->bins;
+        window.fine = (int*)calloc(window.bins, sizeof(int));
+        window.coarse = (int*)calloc((window.bins >> DSP_BUFFER_RANK_BLOCK_BITS) + 1, sizeof(int));
+    } else {
+        window.sorted = (dsp_t*)malloc(sizeof(dsp_t) * box->len);
+    }
+    for(y = 0; y < box->len; y++) {
+        idx = start + offsets[y];
+        if(idx >= 0 && idx < in->len)
+            dsp_buffer_rank_add(&window, arguments, in->buf[idx]);
+    }
     for(x = start; x < end; x++) {
-        dsp_t* buf = sorted;
-        for(y = 0; y < box->len; y++) {
-            int *pos = dsp_stream_get_position(stream, x);
-            int *mat = dsp_stream_get_position(box, y);
-            for(dim = 0; dim < stream->dims; dim++) {
-                pos[dim] += mat[dim] - size / 2;
-            }
-            idx = dsp_stream_set_position(stream, pos);
-            if(idx >= 0 && idx < in->len) {
-                *buf++ = in->buf[idx];
-            }
-            free(pos);
-            free(mat);
+        // near the ends of the stream the box is partial, take the same relative rank
+        int r = window.count == box->len ? arguments->rank : arguments->rank * window.count / box->len;
+        stream->buf[x] = window.count > 0 ? dsp_buffer_rank_get(&window, arguments, r) : 0;
+        if(x + 1 == end)
+            break;
+        for(y = 0; y < runs; y++) {
+            idx = x + offsets[y * size];
+            if(idx >= 0 && idx < in->len)
+                dsp_buffer_rank_remove(&window, arguments, in->buf[idx]);
+            idx = x + 1 + offsets[y * size + size - 1];
+            if(idx >= 0 && idx < in->len)
+                dsp_buffer_rank_add(&window, arguments, in->buf[idx]);
         }
-        qsort(sorted, len, sizeof(dsp_t), compare);
-        stream->buf[x] = sorted[median*box->len/size];
     }
-    dsp_stream_free_buffer(box);
+    free(window.fine);
+    free(window.coarse);
+    free(window.sorted);
     dsp_stream_free(box);
-    free(sorted);
-    return NULL;
+    free(offsets);
 }
 
-void dsp_buffer_median(dsp_stream_p in, int size, int median)
+static void dsp_buffer_rank(dsp_stream_p in, int size, int rank)
 {
-    size_t y;
-    int d;
+    int x;
+    if(size < 1 || in->len < 1)
+        return;
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    pthread_t *th = (pthread_t *)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       int size;
-       int median;
-       dsp_stream_p stream;
-       dsp_stream_p box;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++)
-    {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].size = size;
-        thread_arguments[y].median = median;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].box = dsp_stream_new();
-        for(d = 0; d < stream->dims; d++)
-            dsp_stream_add_dim(thread_arguments[y].box, size);
-        dsp_stream_alloc_buffer(thread_arguments[y].box, thread_arguments[y].box->len);
-        pthread_create(&th[y], NULL, dsp_buffer_median_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_buffer_box_arguments arguments;
+    arguments.size = size;
+    arguments.rank = Max(0, Min(rank, (int)pow(size, in->dims) - 1));
+    arguments.stream = stream;
+    arguments.min = dsp_stats_min(in->buf, in->len);
+    dsp_t max = dsp_stats_max(in->buf, in->len);
+    arguments.integral = (max - arguments.min < DSP_BUFFER_RANK_MAX_BINS);
+    for(x = 0; x < in->len && arguments.integral; x++)
+        arguments.integral = (in->buf[x] == floor(in->buf[x]));
+    arguments.bins = arguments.integral ? (int)(max - arguments.min) + 1 : 0;
+    dsp_parallel_for(stream->len, dsp_buffer_rank_th, &arguments);
     stream->parent = NULL;
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
 }
 
-static void* dsp_buffer_sigma_th(void* arg)
+void dsp_buffer_median(dsp_stream_p in, int size, int median)
+{
+    if(size < 1)
+        return;
+    dsp_buffer_rank(in, size, median * (int)pow(size, in->dims) / size);
+}
+
+void dsp_buffer_percentile(dsp_stream_p in, int size, double percentile)
+{
+    if(size < 1)
+        return;
+    percentile = Max(0.0, Min(100.0, percentile));
+    dsp_buffer_rank(in, size, (int)(percentile * (pow(size, in->dims) - 1) / 100.0 + 0.5));
+}
+
+static void dsp_buffer_sigma_th(void* arg, int start, int end)
 {
-    struct {
-        int cur_th;
-        int size;
-        dsp_stream_p stream;
-        dsp_stream_p box;
-     } *arguments = arg;
+    dsp_buffer_box_arguments *arguments = arg;
     dsp_stream_p stream = arguments->stream;
     dsp_stream_p in = stream->parent;
-    dsp_stream_p box = arguments->box;
-    int cur_th = arguments->cur_th;
     int size = arguments->size;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
-    int x, y, dim, idx;
+    dsp_stream_p box = dsp_buffer_box_new(stream, size);
+    int x, y, idx;
     dsp_t* sigma = (dsp_t*)malloc(pow(size, stream->dims) * sizeof(dsp_t));
     int len = pow(size, in->dims);
+    int* offsets = dsp_buffer_box_offsets(stream, box, size);
     for(x = start; x < end; x++) {
         dsp_t* buf = sigma;
         for(y = 0; y < box->len; y++) {
-            int *pos = dsp_stream_get_position(stream, x);
-            int *mat = dsp_stream_get_position(box, y);
-            for(dim = 0; dim < stream->dims; dim++) {
-                pos[dim] += mat[dim] - size / 2;
-            }
-            idx = dsp_stream_set_position(stream, pos);
+            idx = x + offsets[y];
             if(idx >= 0 && idx < in->len) {
                 buf[y] = in->buf[idx];
             }
-            free(pos);
-            free(mat);
         }
         stream->buf[x] = dsp_stats_stddev(buf, len);
     }
-    dsp_stream_free_buffer(box);
     dsp_stream_free(box);
+    free(offsets);
     free(sigma);
-    return NULL;
 }
 
 void dsp_buffer_sigma(dsp_stream_p in, int size)
 {
-    size_t y;
-    int d;
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    pthread_t *th = (pthread_t *)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       int size;
-       dsp_stream_p stream;
-       dsp_stream_p box;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++)
-    {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].size = size;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].box = dsp_stream_new();
-        for(d = 0; d < stream->dims; d++)
-            dsp_stream_add_dim(thread_arguments[y].box, size);
-        pthread_create(&th[y], NULL, dsp_buffer_sigma_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_buffer_box_arguments arguments;
+    arguments.size = size;
+    arguments.stream = stream;
+    dsp_parallel_for(stream->len, dsp_buffer_sigma_th, &arguments);
     stream->parent = NULL;
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
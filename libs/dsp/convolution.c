@@ -23,18 +23,17 @@ void dsp_convolution_convolution(dsp_stream_p stream, dsp_stream_p matrix) {
     int x, y, d;
     dsp_t mn = dsp_stats_min(stream->buf, stream->len);
     dsp_t mx = dsp_stats_max(stream->buf, stream->len);
-    int* d_pos = (int*)malloc(sizeof(int)*stream->dims);
-    for(y = 0; y < matrix->len; y++) {
-        int* pos = dsp_stream_get_position(matrix, y);
+    int d_pos[stream->dims];
+    int pos[matrix->dims];
+    dsp_stream_position_init(matrix, 0, pos);
+    for(y = 0; y < matrix->len; y++, dsp_stream_position_next(matrix, pos)) {
         for(d = 0; d < stream->dims; d++) {
             d_pos[d] = stream->sizes[d]/2+pos[d]-matrix->sizes[d]/2;
         }
         x = dsp_stream_set_position(stream, d_pos);
-        free(pos);
         if(x >= 0 && x < stream->magnitude->len)
             stream->magnitude->buf[x] *= sqrt(matrix->magnitude->buf[y]);
     }
-    free(d_pos);
     dsp_fourier_idft(stream);
     dsp_buffer_stretch(stream->buf, stream->len, mn, mx);
 }
@@ -43,19 +42,180 @@ void dsp_convolution_correlation(dsp_stream_p stream, dsp_stream_p matrix) {
     int x, y, d;
     dsp_t mn = dsp_stats_min(stream->buf, stream->len);
     dsp_t mx = dsp_stats_max(stream->buf, stream->len);
-    int* d_pos = (int*)malloc(sizeof(int)*stream->dims);
+    int d_pos[stream->dims];
+    int pos[matrix->dims];
     dsp_buffer_shift(matrix->magnitude);
-    for(y = 0; y < matrix->len; y++) {
-        int* pos = dsp_stream_get_position(matrix, y);
+    dsp_stream_position_init(matrix, 0, pos);
+    for(y = 0; y < matrix->len; y++, dsp_stream_position_next(matrix, pos)) {
         for(d = 0; d < stream->dims; d++) {
             d_pos[d] = stream->sizes[d]/2+pos[d]-matrix->sizes[d]/2;
         }
         x = dsp_stream_set_position(stream, d_pos);
-        free(pos);
         stream->magnitude->buf[x] *= sqrt(matrix->magnitude->buf[y]);
     }
     dsp_buffer_shift(matrix->magnitude);
-    free(d_pos);
     dsp_fourier_idft(stream);
     dsp_buffer_stretch(stream->buf, stream->len, mn, mx);
 }
+
+typedef struct {
+    dsp_stream_p stream;
+    dsp_stream_p matrix;
+    dsp_t *in;
+    dsp_t *vector;
+    int length;
+    int dim;
+} dsp_convolution_arguments;
+
+static void dsp_convolution_direct_th(void *arg, int start, int end)
+{
+    dsp_convolution_arguments *arguments = arg;
+    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p matrix = arguments->matrix;
+    int dims = stream->dims;
+    int pos[dims], k[dims], p[dims];
+    int x, y, d;
+    dsp_stream_position_init(stream, start, pos);
+    for(x = start; x < end; x++, dsp_stream_position_next(stream, pos)) {
+        double sum = 0;
+        dsp_stream_position_init(matrix, 0, k);
+        for(y = 0; y < matrix->len; y++, dsp_stream_position_next(matrix, k)) {
+            int inside = 1;
+            for(d = 0; d < dims; d++) {
+                p[d] = pos[d] + matrix->sizes[d] / 2 - k[d];
+                if(p[d] < 0 || p[d] >= stream->sizes[d])
+                    inside = 0;
+            }
+            if(inside)
+                sum += matrix->buf[y] * arguments->in[dsp_stream_set_position(stream, p)];
+        }
+        stream->buf[x] = sum;
+    }
+}
+
+/* Convolution along one dimension */
+static void dsp_convolution_vector_th(void *arg, int start, int end)
+{
+    dsp_convolution_arguments *arguments = arg;
+    dsp_stream_p stream = arguments->stream;
+    int dim = arguments->dim;
+    int center = arguments->length / 2;
+    int stride = 1;
+    int pos[stream->dims];
+    int x, i, d;
+    for(d = 0; d < dim; d++)
+        stride *= stream->sizes[d];
+    dsp_stream_position_init(stream, start, pos);
+    for(x = start; x < end; x++, dsp_stream_position_next(stream, pos)) {
+        double sum = 0;
+        int first = Max(0, pos[dim] + center - stream->sizes[dim] + 1);
+        int last = Min(arguments->length - 1, pos[dim] + center);
+        for(i = first; i <= last; i++)
+            sum += arguments->vector[i] * arguments->in[x + (center - i) * stride];
+        stream->buf[x] = sum;
+    }
+}
+
+int dsp_convolution_separable(dsp_stream_p matrix, dsp_t *row, dsp_t *column)
+{
+    int x, y, peak = 0;
+    if(matrix->dims != 2)
+        return 0;
+    int width = matrix->sizes[0];
+    int height = matrix->sizes[1];
+    for(x = 1; x < matrix->len; x++) {
+        if(fabs(matrix->buf[x]) > fabs(matrix->buf[peak]))
+            peak = x;
+    }
+    double max = fabs(matrix->buf[peak]);
+    if(max == 0)
+        return 0;
+    for(x = 0; x < width; x++)
+        row[x] = matrix->buf[peak / width * width + x];
+    for(y = 0; y < height; y++)
+        column[y] = matrix->buf[y * width + peak % width] / matrix->buf[peak];
+    for(y = 0; y < height; y++) {
+        for(x = 0; x < width; x++) {
+            if(fabs(matrix->buf[y * width + x] - column[y] * row[x]) > max * DSP_CONVOLUTION_SEPARABLE_TOLERANCE)
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Estimated multiply-adds per element. The transforms of the padded blocks cost about
+ * DSP_CONVOLUTION_FOURIER_WEIGHT operations per element and per doubling of the block size,
+ * blocks are up to 512 elements per side or four times the kernel.
+ */
+#define DSP_CONVOLUTION_FOURIER_WEIGHT 6.0
+
+static int dsp_convolution_method(dsp_stream_p stream, dsp_stream_p matrix, int separable)
+{
+    int d;
+    double direct = matrix->len;
+    double vector = 0;
+    double padding = 1;
+    double block = 1;
+    for(d = 0; d < stream->dims; d++) {
+        int k = matrix->sizes[d];
+        int size = Min(stream->sizes[d] + k - 1, Max(512, 4 * (k - 1)));
+        padding *= (double)size / Max(1, size - k + 1);
+        block *= size;
+        vector += k;
+    }
+    double fourier = DSP_CONVOLUTION_FOURIER_WEIGHT * padding * log2(Max(2.0, block));
+    if(separable && vector <= fourier)
+        return DSP_CONVOLUTION_SEPARABLE;
+    return direct <= fourier ? DSP_CONVOLUTION_DIRECT : DSP_CONVOLUTION_FOURIER;
+}
+
+int dsp_convolution_filter(dsp_stream_p stream, dsp_stream_p matrix, int method)
+{
+    if(matrix->dims != stream->dims || matrix->len < 1)
+        return -1;
+    dsp_t *row = NULL, *column = NULL;
+    int separable = 0;
+    if(matrix->dims == 2 && (method == DSP_CONVOLUTION_AUTO || method == DSP_CONVOLUTION_SEPARABLE)) {
+        row = (dsp_t*)malloc(sizeof(dsp_t) * matrix->sizes[0]);
+        column = (dsp_t*)malloc(sizeof(dsp_t) * matrix->sizes[1]);
+        separable = dsp_convolution_separable(matrix, row, column);
+    }
+    if(method == DSP_CONVOLUTION_AUTO)
+        method = dsp_convolution_method(stream, matrix, separable);
+    else if(method == DSP_CONVOLUTION_SEPARABLE && !separable)
+        method = DSP_CONVOLUTION_DIRECT;
+
+    dsp_convolution_arguments arguments;
+    arguments.stream = stream;
+    arguments.matrix = matrix;
+    switch(method) {
+        case DSP_CONVOLUTION_FOURIER:
+            dsp_fourier_convolution(stream, matrix);
+            break;
+        case DSP_CONVOLUTION_SEPARABLE:
+            arguments.in = (dsp_t*)malloc(sizeof(dsp_t) * stream->len);
+            dsp_buffer_copy(stream->buf, arguments.in, stream->len);
+            arguments.vector = row;
+            arguments.length = matrix->sizes[0];
+            arguments.dim = 0;
+            dsp_parallel_for(stream->len, dsp_convolution_vector_th, &arguments);
+            dsp_buffer_copy(stream->buf, arguments.in, stream->len);
+            arguments.vector = column;
+            arguments.length = matrix->sizes[1];
+            arguments.dim = 1;
+            dsp_parallel_for(stream->len, dsp_convolution_vector_th, &arguments);
+            free(arguments.in);
+            break;
+        default:
+            method = DSP_CONVOLUTION_DIRECT;
+            arguments.in = (dsp_t*)malloc(sizeof(dsp_t) * stream->len);
+            dsp_buffer_copy(stream->buf, arguments.in, stream->len);
+            dsp_parallel_for(stream->len, dsp_convolution_direct_th, &arguments);
+            free(arguments.in);
+            break;
+    }
+    free(row);
+    free(column);
+    return method;
+}
@@ -48,6 +48,7 @@ extern "C" {
 #include <assert.h>
 #include <pthread.h>
 #include <time.h>
+#include "dspconfig.h"
 #ifndef M_PI
     #define M_PI 3.14159265358979323846
 #endif
@@ -73,8 +74,19 @@ extern "C" {
 */
 /**\{*/
 #define DSP_MAX_STARS 200
+#ifdef DSP_SINGLE_PRECISION
+/**
+* Samples, Fourier transforms, magnitudes and phases are single precision, transforms use fftwf.
+* Statistics (dsp_stats_mean, dsp_stats_stddev), the stretch and normalize ratios accumulate in double.
+* Precision sensitive: long sums of large values (dsp_buffer_sum, stacking) round to 24 bits of mantissa
+* and the inverse Fourier transform of large streams has a relative error in the order of 1e-6.
+*/
+typedef float dsp_t;
+typedef float complex_t[2];
+#else
 typedef double dsp_t;
 typedef double complex_t[2];
+#endif
 #define dsp_t_max 255
 #define dsp_t_min -dsp_t_max
 #define DSP_NAME_SIZE 128
@@ -82,10 +94,34 @@ typedef double complex_t[2];
 /**
 * \brief get/set the maximum number of threads allowed
 * \param value if greater than 1, set a maximum number of threads allowed
-* \return The current or new number of threads allowed during runtime
+* \return The current or new number of threads allowed during runtime, the number of online processors
+* until it is set
 */
 DLL_EXPORT unsigned long int dsp_max_threads(unsigned long value);
 
+/**
+* \brief Body of a parallel loop, processes the elements from start to end, end excluded
+*/
+typedef void (*dsp_parallel_func)(void *arg, int start, int end);
+
+/**
+* \brief Run a loop over len elements split in contiguous ranges among the libdsp worker threads
+* The workers are started on the first call and resized when dsp_max_threads changes, the calling thread
+* processes one of the ranges and returns when all are done. If the pool is already running a loop,
+* e.g. when called from inside another parallel loop, the whole range is processed by the calling thread.
+* \param len the number of elements
+* \param func the loop body, called once for each range
+* \param arg the argument passed to func
+* \sa dsp_max_threads
+*/
+DLL_EXPORT void dsp_parallel_for(int len, dsp_parallel_func func, void *arg);
+
+/**
+* \brief Get the number of threads running parallel loops
+* \return The number of started worker threads plus the calling thread, 1 before the first parallel loop
+*/
+DLL_EXPORT int dsp_parallel_threads();
+
 #ifndef DSP_DEBUG
 #define DSP_DEBUG
 /**
@@ -254,6 +290,8 @@ typedef struct dsp_star_t
     double flux;
     /// The deviation of the star
     double theta;
+    /// The half flux radius of the star
+    double hfr;
     /// The name of the star
     char name[DSP_NAME_SIZE];
 } dsp_star;
@@ -316,14 +354,14 @@ typedef union
     struct
     {
         /// Real part of the complex number
-        double real;
+        dsp_t real;
         /// Imaginary part of the complex number
-        double imaginary;
+        dsp_t imaginary;
     } *complex;
     /// Complex number type array used with libFFTW
     complex_t *pairs;
-    /// Linear double array containing complex numbers
-    double *buf;
+    /// Linear array containing complex numbers
+    dsp_t *buf;
 } dsp_complex;
 
 /**
@@ -482,7 +520,7 @@ DLL_EXPORT void dsp_fourier_2complex_t(dsp_stream_p stream);
 * \param len the input arrays length.
 * \return the array filled with the complex numbers
 */
-DLL_EXPORT void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi, complex_t *out, int len);
+DLL_EXPORT void dsp_fourier_phase_mag_array_get_complex(dsp_t* mag, dsp_t* phi, complex_t *out, int len);
 
 /**
 * \brief Obtain a complex number's array magnitudes
@@ -490,7 +528,7 @@ DLL_EXPORT void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi
 * \param len the input array length.
 * \return the array filled with the magnitudes
 */
-DLL_EXPORT double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len);
+DLL_EXPORT dsp_t* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len);
 
 /**
 * \brief Obtain a complex number's array phases
@@ -498,7 +536,63 @@ DLL_EXPORT double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int l
 * \param len the input array length.
 * \return the array filled with the phases
 */
-DLL_EXPORT double* dsp_fourier_complex_array_get_phase(dsp_complex in, int len);
+DLL_EXPORT dsp_t* dsp_fourier_complex_array_get_phase(dsp_complex in, int len);
+
+/**
+* \brief Convolve a stream with a kernel multiplying their Fourier transforms
+* Large streams are transformed in overlapping blocks (overlap-add) processed in parallel.
+* \param stream the input stream, replaced by the convolution.
+* \param matrix the kernel, with the same dimensions of the stream.
+* \sa dsp_convolution_filter
+*/
+DLL_EXPORT void dsp_fourier_convolution(dsp_stream_p stream, dsp_stream_p matrix);
+
+///Plan transforms with a fast heuristic, the default
+#define DSP_FOURIER_ESTIMATE 0
+///Plan transforms by measuring a few algorithms, takes seconds on large streams
+#define DSP_FOURIER_MEASURE 1
+///Plan transforms by measuring a wider range of algorithms
+#define DSP_FOURIER_PATIENT 2
+///Plan transforms by measuring all algorithms
+#define DSP_FOURIER_EXHAUSTIVE 3
+
+/**
+* \brief Set the rigor of the planner used by the following Fourier transforms
+* Plans are cached by the stream geometry and the transform direction, so only the first transform
+* of each geometry pays the planning cost. Higher rigor plans are faster but take longer to create,
+* importing wisdom saved by a previous run avoids the cost.
+* \param rigor one of DSP_FOURIER_ESTIMATE, DSP_FOURIER_MEASURE, DSP_FOURIER_PATIENT, DSP_FOURIER_EXHAUSTIVE
+* \sa dsp_fourier_import_wisdom
+*/
+DLL_EXPORT void dsp_fourier_set_rigor(int rigor);
+
+/**
+* \brief Set the number of threads used by each Fourier transform
+* \param threads the number of threads, effective only if FFTW was built with threads support
+* \return The number of threads set
+*/
+DLL_EXPORT int dsp_fourier_set_threads(int threads);
+
+/**
+* \brief Import FFTW wisdom, the plans found in the wisdom are created without measuring
+* \param filename the wisdom file
+* \return non zero on success
+* \sa dsp_fourier_export_wisdom
+*/
+DLL_EXPORT int dsp_fourier_import_wisdom(const char *filename);
+
+/**
+* \brief Export the FFTW wisdom accumulated by the plans created so far
+* \param filename the wisdom file
+* \return non zero on success
+* \sa dsp_fourier_import_wisdom
+*/
+DLL_EXPORT int dsp_fourier_export_wisdom(const char *filename);
+
+/**
+* \brief Destroy the cached plans not in use
+*/
+DLL_EXPORT void dsp_fourier_clear_plans();
 
 /**\}*/
 /**
@@ -562,6 +656,37 @@ DLL_EXPORT void dsp_convolution_convolution(dsp_stream_p stream, dsp_stream_p ma
 */
 DLL_EXPORT void dsp_convolution_correlation(dsp_stream_p stream, dsp_stream_p matrix);
 
+///Choose the fastest method for the kernel and stream sizes
+#define DSP_CONVOLUTION_AUTO 0
+///Sum the products of the kernel with the neighbourhood of each element
+#define DSP_CONVOLUTION_DIRECT 1
+///Convolve rows and columns with the two vectors of a separable 2D kernel
+#define DSP_CONVOLUTION_SEPARABLE 2
+///Multiply the Fourier transforms of the kernel and of overlapping blocks of the stream
+#define DSP_CONVOLUTION_FOURIER 3
+///Largest deviation from the outer product, relative to the peak of the kernel, of a separable kernel
+#define DSP_CONVOLUTION_SEPARABLE_TOLERANCE 1e-6
+
+/**
+* \brief Convolve a stream with a kernel
+* The kernel is centered on each element, samples outside the stream are zero and the output has the size of the stream.
+* \param stream the input stream, replaced by the convolution.
+* \param matrix the kernel, with the same dimensions of the stream.
+* \param method one of DSP_CONVOLUTION_AUTO, DSP_CONVOLUTION_DIRECT, DSP_CONVOLUTION_SEPARABLE or DSP_CONVOLUTION_FOURIER.
+* DSP_CONVOLUTION_SEPARABLE falls back to DSP_CONVOLUTION_DIRECT if the kernel is not separable.
+* \return The method used, -1 if the kernel and the stream dimensions differ
+*/
+DLL_EXPORT int dsp_convolution_filter(dsp_stream_p stream, dsp_stream_p matrix, int method);
+
+/**
+* \brief Check if a 2D kernel is the outer product of two vectors
+* \param matrix the kernel.
+* \param row filled with the row vector, sizes[0] elements.
+* \param column filled with the column vector, sizes[1] elements.
+* \return 1 if the kernel is separable within DSP_CONVOLUTION_SEPARABLE_TOLERANCE, 0 otherwise
+*/
+DLL_EXPORT int dsp_convolution_separable(dsp_stream_p matrix, dsp_t *row, dsp_t *column);
+
 /**\}*/
 /**
  * \defgroup dsp_Stats DSP API Buffer statistics functions
@@ -976,12 +1101,25 @@ DLL_EXPORT void dsp_buffer_log1(dsp_stream_p stream, double val);
 
 /**
 * \brief Median elements of the input stream
+* Each element is replaced by the element of rank median * size^(dims-1) of the box of side size around it.
+* Integral samples spanning up to 65536 levels are ranked with a sliding histogram, other samples with a sorted window,
+* the cost per element does not depend on sorting the box.
 * \param stream the stream on which execute
 * \param size the length of the median.
 * \param median the location of the median value.
+* \sa dsp_buffer_percentile
 */
 DLL_EXPORT void dsp_buffer_median(dsp_stream_p stream, int size, int median);
 
+/**
+* \brief Replace each element of the input stream with a percentile of the box of side size around it
+* \param stream the stream on which execute
+* \param size the side of the box.
+* \param percentile the percentile, 0 is the minimum, 50 the median and 100 the maximum of the box.
+* \sa dsp_buffer_median
+*/
+DLL_EXPORT void dsp_buffer_percentile(dsp_stream_p stream, int size, double percentile);
+
 /**
 * \brief Standard deviation of each element of the input stream within the given size
 * \param stream the stream on which execute
@@ -1006,8 +1144,8 @@ DLL_EXPORT void dsp_buffer_deviate(dsp_stream_p stream, dsp_t* deviation, dsp_t
 */
 #define dsp_buffer_reverse(buf, len) \
     ({ \
-        int i = (len - 1) / 2; \
-        int j = i + 1; \
+        int i = len / 2 - 1; \
+        int j = (len + 1) / 2; \
         __typeof(buf[0]) _x; \
         while(i >= 0) \
         { \
@@ -1252,6 +1390,28 @@ DLL_EXPORT int dsp_stream_set_position(dsp_stream_p stream, int *pos);
 */
 DLL_EXPORT int* dsp_stream_get_position(dsp_stream_p stream, int index);
 
+/**
+* \brief Fill a caller supplied array with the multidimensional positional indexes of a linear index
+* \param stream the target DSP stream.
+* \param index the position of the index on a single dimension.
+* \param pos array of stream->dims elements receiving the position of the index on each dimension.
+* Unlike dsp_stream_get_position no memory is allocated.
+* \sa dsp_stream_position_next
+* \sa dsp_stream_set_position
+*/
+DLL_EXPORT void dsp_stream_position_init(dsp_stream_p stream, int index, int *pos);
+
+/**
+* \brief Advance a multidimensional position to the next element of a DSP stream
+* \param stream the target DSP stream.
+* \param pos the position on each dimension, as filled by dsp_stream_position_init.
+* \return 0 if the position wrapped past the last element, 1 otherwise.
+* Iterating a stream with dsp_stream_position_init and dsp_stream_position_next is equivalent
+* to calling dsp_stream_get_position for every index, without dividing or allocating memory per element.
+* \sa dsp_stream_position_init
+*/
+DLL_EXPORT int dsp_stream_position_next(dsp_stream_p stream, int *pos);
+
 /**
 * \brief Execute the function callback pointed by the func field of the passed stream
 * \param stream the target DSP stream.
@@ -1384,6 +1544,29 @@ DLL_EXPORT void dsp_modulation_amplitude(dsp_stream_p stream, double samplefreq,
 */
 void dsp_recons_align(dsp_stream_p stream, dsp_stream_p matrix);
 
+/**\}*/
+/**
+ * \defgroup dsp_StarDetection DSP API Star detection functions
+*/
+/**\{*/
+
+/**
+* \brief Find the stars of a two dimensional stream and store them into its stars
+* The background and its noise are estimated on a grid of 64 pixels cells, the pixels over the local
+* background by more than threshold times the noise are joined into objects and each object covering
+* at least min_area pixels is measured: its center is the flux weighted centroid, its diameter the FWHM
+* from the second moments and its hfr the half flux radius. The stars are sorted by decreasing flux and
+* replace the previous stars of the stream, ready for dsp_align_get_offset.
+* \param stream the stream to search
+* \param roi the region of interest, an array of two regions for the columns and the rows, NULL to search the whole stream
+* \param threshold the detection threshold in standard deviations of the background noise
+* \param min_area the minimum number of pixels over the threshold of a star
+* \param max_stars the maximum number of stars kept, the brightest ones, 0 to keep them all
+* \return The number of stars found, -1 if the stream is not two dimensional or the region is empty
+* \sa dsp_align_get_offset
+*/
+DLL_EXPORT int dsp_stars_find(dsp_stream_p stream, dsp_region *roi, double threshold, int min_area, int max_stars);
+
 /**\}*/
 /**
  * \defgroup dsp_FileManagement DSP API File read/write functions
@@ -1565,11 +1748,16 @@ DLL_EXPORT void dsp_align_free_triangle(dsp_triangle *triangle);
 
 /**
 * \brief Calculate offsets, rotation and scaling of two streams giving reference alignment point
+* Two dimensional streams are matched by the triangles each star forms with its nearest neighbours,
+* candidate pairs are looked up in a k-d tree of the triangle side ratios and the similarity transform
+* agreed by most stars is found with RANSAC, so fields with hundreds of stars and spurious detections
+* align in a few milliseconds. The result is stored into the align_info of to_align, ready for dsp_stream_align,
+* its score is the fraction of stars left unmatched.
 * \param ref the reference stream
 * \param to_align the stream to be aligned
 * \param tolerance number of decimals allowed
 * \param target_score the minimum matching score to reach
-* \param num_stars number of stars for each triangle
+* \param num_stars number of stars for each triangle, used by streams with other than two dimensions
 * \return The alignment mask (bit1: translated, bit2: scaled, bit3: rotated)
 */
 DLL_EXPORT int dsp_align_get_offset(dsp_stream_p ref, dsp_stream_p to_align, double tolerance, double target_score, int num_stars);
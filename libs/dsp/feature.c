@@ -28,17 +28,16 @@ void dsp_feature_align(dsp_stream_p stream, dsp_stream_p matrix)
         int x, y, d;
         dsp_t mn = dsp_stats_min(stream->buf, stream->len);
         dsp_t mx = dsp_stats_max(stream->buf, stream->len);
-        int* d_pos = (int*)malloc(sizeof(int)*stream->dims);
-        for(y = z*stream->len; y < z*stream->len+stream->len; y++) {
-            int* pos = dsp_stream_get_position(matrix, y);
+        int d_pos[stream->dims];
+        int pos[matrix->dims];
+        dsp_stream_position_init(matrix, z*stream->len, pos);
+        for(y = z*stream->len; y < z*stream->len+stream->len; y++, dsp_stream_position_next(matrix, pos)) {
             for(d = 0; d < stream->dims; d++) {
                 d_pos[d] = stream->sizes[d]/2+pos[d]-matrix->sizes[d]/2;
             }
             x = dsp_stream_set_position(stream, d_pos);
-            free(pos);
             stream->magnitude->buf[x] *= sqrt(matrix->magnitude->buf[y]);
         }
-        free(d_pos);
         dsp_fourier_idft(stream);
         dsp_buffer_stretch(stream->buf, stream->len, mn, mx);
     }
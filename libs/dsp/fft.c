@@ -20,6 +20,225 @@
 #include "dsp.h"
 #include <fftw3.h>
 
+/* FFTW API matching dsp_t, fftw_ for double and fftwf_ for float */
+#ifdef DSP_SINGLE_PRECISION
+#define FFTW(name) fftwf_##name
+#else
+#define FFTW(name) fftw_##name
+#endif
+
+/*
+ * Plans are cached process-wide and reused by the transforms of streams with the same geometry.
+ * Each plan owns aligned input and output arrays and is checked out by one transform at a time,
+ * concurrent transforms of the same geometry get their own plan.
+ */
+#define DSP_FOURIER_PLAN_CACHE_SIZE 16
+
+typedef struct dsp_fourier_plan_t
+{
+    /// Sizes in FFTW order, the last dimension varies fastest
+    int *sizes;
+    int dims;
+    /// FFTW_FORWARD for real to complex, FFTW_BACKWARD for complex to real transforms
+    int sign;
+    unsigned int flags;
+    int threads;
+    int in_use;
+    int cached;
+    unsigned long last_used;
+    FFTW(plan) plan;
+    dsp_t *real;
+    FFTW(complex) *complex;
+    int real_len;
+    int complex_len;
+} dsp_fourier_plan;
+
+static dsp_fourier_plan plan_cache[DSP_FOURIER_PLAN_CACHE_SIZE];
+static unsigned long plan_cache_clock = 0;
+static unsigned int plan_flags = FFTW_ESTIMATE;
+static int plan_threads = 1;
+static pthread_mutex_t plan_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#ifdef HAVE_FFTW3_THREADS
+static pthread_once_t plan_threads_once = PTHREAD_ONCE_INIT;
+
+static void dsp_fourier_init_threads()
+{
+    FFTW(init_threads)();
+}
+#endif
+
+static void dsp_fourier_plan_destroy(dsp_fourier_plan *plan)
+{
+    if(plan->plan != NULL)
+        FFTW(destroy_plan)(plan->plan);
+    FFTW(free)(plan->real);
+    FFTW(free)(plan->complex);
+    free(plan->sizes);
+    plan->plan = NULL;
+    plan->real = NULL;
+    plan->complex = NULL;
+    plan->sizes = NULL;
+}
+
+static int dsp_fourier_plan_match(dsp_fourier_plan *plan, dsp_stream_p stream, int sign)
+{
+    int d;
+    if(plan->plan == NULL || plan->in_use || plan->sign != sign || plan->dims != stream->dims ||
+            plan->flags != plan_flags || plan->threads != plan_threads)
+        return 0;
+    for(d = 0; d < stream->dims; d++) {
+        if(plan->sizes[stream->dims-1-d] != stream->sizes[d])
+            return 0;
+    }
+    return 1;
+}
+
+/* Called with plan_mutex locked, planning with FFTW is not thread safe */
+static int dsp_fourier_plan_create(dsp_fourier_plan *plan, dsp_stream_p stream, int sign)
+{
+    plan->dims = stream->dims;
+    plan->sign = sign;
+    plan->flags = plan_flags;
+    plan->threads = plan_threads;
+    plan->sizes = (int*)malloc(sizeof(int)*stream->dims);
+    dsp_buffer_copy(stream->sizes, plan->sizes, stream->dims);
+    dsp_buffer_reverse(plan->sizes, stream->dims);
+    plan->real_len = stream->len;
+    plan->complex_len = stream->len / stream->sizes[0] * (stream->sizes[0] / 2 + 1);
+    plan->real = (dsp_t*)FFTW(malloc)(sizeof(dsp_t) * plan->real_len);
+    plan->complex = (FFTW(complex)*)FFTW(malloc)(sizeof(FFTW(complex)) * plan->complex_len);
+#ifdef HAVE_FFTW3_THREADS
+    pthread_once(&plan_threads_once, dsp_fourier_init_threads);
+    FFTW(plan_with_nthreads)(plan->threads);
+#endif
+    if(sign == FFTW_FORWARD)
+        plan->plan = FFTW(plan_dft_r2c)(plan->dims, plan->sizes, plan->real, plan->complex, plan->flags);
+    else
+        plan->plan = FFTW(plan_dft_c2r)(plan->dims, plan->sizes, plan->complex, plan->real, plan->flags);
+    if(plan->plan == NULL) {
+        dsp_fourier_plan_destroy(plan);
+        return 0;
+    }
+    return 1;
+}
+
+static dsp_fourier_plan *dsp_fourier_plan_acquire(dsp_stream_p stream, int sign)
+{
+    int x;
+    dsp_fourier_plan *plan = NULL;
+    pthread_mutex_lock(&plan_mutex);
+    for(x = 0; x < DSP_FOURIER_PLAN_CACHE_SIZE; x++) {
+        if(dsp_fourier_plan_match(&plan_cache[x], stream, sign)) {
+            plan = &plan_cache[x];
+            plan->in_use = 1;
+            plan->last_used = ++plan_cache_clock;
+            pthread_mutex_unlock(&plan_mutex);
+            return plan;
+        }
+    }
+    // replace an empty or the least recently used idle plan
+    for(x = 0; x < DSP_FOURIER_PLAN_CACHE_SIZE; x++) {
+        if(plan_cache[x].in_use)
+            continue;
+        if(plan == NULL || plan_cache[x].plan == NULL || plan_cache[x].last_used < plan->last_used)
+            plan = &plan_cache[x];
+        if(plan->plan == NULL)
+            break;
+    }
+    if(plan != NULL) {
+        dsp_fourier_plan_destroy(plan);
+        plan->cached = 1;
+    } else {
+        // all cached plans are busy, use a temporary one
+        plan = (dsp_fourier_plan*)calloc(1, sizeof(dsp_fourier_plan));
+        plan->cached = 0;
+    }
+    plan->in_use = 1;
+    plan->last_used = ++plan_cache_clock;
+    if(!dsp_fourier_plan_create(plan, stream, sign)) {
+        perr("Unable to create the FFTW plan\n");
+        plan->in_use = 0;
+        if(!plan->cached)
+            free(plan);
+        plan = NULL;
+    }
+    pthread_mutex_unlock(&plan_mutex);
+    return plan;
+}
+
+static void dsp_fourier_plan_release(dsp_fourier_plan *plan)
+{
+    pthread_mutex_lock(&plan_mutex);
+    if(plan->cached) {
+        plan->in_use = 0;
+    } else {
+        dsp_fourier_plan_destroy(plan);
+        free(plan);
+    }
+    pthread_mutex_unlock(&plan_mutex);
+}
+
+void dsp_fourier_set_rigor(int rigor)
+{
+    pthread_mutex_lock(&plan_mutex);
+    switch(rigor) {
+        case DSP_FOURIER_MEASURE:
+            plan_flags = FFTW_MEASURE;
+            break;
+        case DSP_FOURIER_PATIENT:
+            plan_flags = FFTW_PATIENT;
+            break;
+        case DSP_FOURIER_EXHAUSTIVE:
+            plan_flags = FFTW_EXHAUSTIVE;
+            break;
+        default:
+            plan_flags = FFTW_ESTIMATE;
+            break;
+    }
+    pthread_mutex_unlock(&plan_mutex);
+}
+
+int dsp_fourier_set_threads(int threads)
+{
+#ifdef HAVE_FFTW3_THREADS
+    pthread_mutex_lock(&plan_mutex);
+    plan_threads = Max(1, threads);
+    pthread_mutex_unlock(&plan_mutex);
+    return plan_threads;
+#else
+    (void)threads;
+    return 1;
+#endif
+}
+
+int dsp_fourier_import_wisdom(const char *filename)
+{
+    pthread_mutex_lock(&plan_mutex);
+    int ret = FFTW(import_wisdom_from_filename)(filename);
+    pthread_mutex_unlock(&plan_mutex);
+    return ret;
+}
+
+int dsp_fourier_export_wisdom(const char *filename)
+{
+    pthread_mutex_lock(&plan_mutex);
+    int ret = FFTW(export_wisdom_to_filename)(filename);
+    pthread_mutex_unlock(&plan_mutex);
+    return ret;
+}
+
+void dsp_fourier_clear_plans()
+{
+    int x;
+    pthread_mutex_lock(&plan_mutex);
+    for(x = 0; x < DSP_FOURIER_PLAN_CACHE_SIZE; x++) {
+        if(!plan_cache[x].in_use)
+            dsp_fourier_plan_destroy(&plan_cache[x]);
+    }
+    pthread_mutex_unlock(&plan_mutex);
+}
+
 static void dsp_fourier_dft_magnitude(dsp_stream_p stream)
 {
     if(stream->magnitude)
@@ -37,18 +256,21 @@ void dsp_fourier_2dsp(dsp_stream_p stream)
     int x, y;
     complex_t *dft = (complex_t*)malloc(sizeof(complex_t) * stream->len);
     memcpy(dft, stream->dft.pairs, sizeof(complex_t) * stream->len);
+    // only the position on the first dimension is needed, it wraps every sizes[0] elements
+    int pos = 0;
     y = 0;
     for(x = 0; x < stream->len && y < stream->len; x++) {
-        int *pos = dsp_stream_get_position(stream, x);
-        if(pos[0] <= stream->sizes[0] / 2) {
+        if(pos <= stream->sizes[0] / 2) {
             stream->dft.pairs[x][0] = dft[y][0];
             stream->dft.pairs[x][1] = dft[y][1];
             stream->dft.pairs[stream->len-1-x][0] = dft[y][0];
             stream->dft.pairs[stream->len-1-x][1] = dft[y][1];
             y++;
         }
-        free(pos);
+        if(++pos == stream->sizes[0])
+            pos = 0;
     }
+    free(dft);
     dsp_fourier_dft_magnitude(stream);
     dsp_buffer_shift(stream->magnitude);
     dsp_fourier_dft_phase(stream);
@@ -65,23 +287,24 @@ void dsp_fourier_2complex_t(dsp_stream_p stream)
     complex_t *dft = (complex_t*)malloc(sizeof(complex_t) * stream->len);
     memcpy(dft, stream->dft.pairs, sizeof(complex_t) * stream->len);
     dsp_buffer_set(stream->dft.buf, stream->len*2, 0);
+    int pos = 0;
     y = 0;
     for(x = 0; x < stream->len; x++) {
-        int *pos = dsp_stream_get_position(stream, x);
-        if(pos[0] <= stream->sizes[0] / 2) {
+        if(pos <= stream->sizes[0] / 2) {
             stream->dft.pairs[y][0] = dft[x][0];
             stream->dft.pairs[y][1] = dft[x][1];
             y++;
         }
-        free(pos);
+        if(++pos == stream->sizes[0])
+            pos = 0;
     }
     free(dft);
 }
 
-double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len)
+dsp_t* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len)
 {
     int i;
-    double* out = (double*)malloc(sizeof(double) * len);
+    dsp_t* out = (dsp_t*)malloc(sizeof(dsp_t) * len);
     for(i = 0; i < len; i++) {
         double real = in.complex[i].real;
         double imaginary = in.complex[i].imaginary;
@@ -90,10 +313,10 @@ double* dsp_fourier_complex_array_get_magnitude(dsp_complex in, int len)
     return out;
 }
 
-double* dsp_fourier_complex_array_get_phase(dsp_complex in, int len)
+dsp_t* dsp_fourier_complex_array_get_phase(dsp_complex in, int len)
 {
     int i;
-    double* out = (double*)malloc(sizeof(double) * len);
+    dsp_t* out = (dsp_t*)malloc(sizeof(dsp_t) * len);
     for(i = 0; i < len; i++) {
         out [i] = 0;
         if (in.complex[i].real != 0) {
@@ -112,7 +335,7 @@ double* dsp_fourier_complex_array_get_phase(dsp_complex in, int len)
     return out;
 }
 
-void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi, complex_t* out, int len)
+void dsp_fourier_phase_mag_array_get_complex(dsp_t* mag, dsp_t* phi, complex_t* out, int len)
 {
     int i;
     for(i = 0; i < len; i++) {
@@ -123,70 +346,196 @@ void dsp_fourier_phase_mag_array_get_complex(double* mag, double* phi, complex_t
     }
 }
 
-static void* dsp_stream_dft_th(void* arg)
+typedef struct {
+    int exp;
+    dsp_stream_p streams[2];
+} dsp_stream_dft_arguments;
+
+static void dsp_stream_dft_th(void* arg, int start, int end)
 {
-    struct {
-        int exp;
-       dsp_stream_p stream;
-    } *arguments = arg;
-    dsp_fourier_dft(arguments->stream, arguments->exp);
-    return NULL;
+    dsp_stream_dft_arguments *arguments = arg;
+    int x;
+    for(x = start; x < end; x++)
+        dsp_fourier_dft(arguments->streams[x], arguments->exp);
 }
 void dsp_fourier_dft(dsp_stream_p stream, int exp)
 {
     if(exp < 1)
         return;
-    double* buf = (double*)malloc(sizeof(double) * stream->len);
+    dsp_fourier_plan *plan = dsp_fourier_plan_acquire(stream, FFTW_FORWARD);
+    if(plan == NULL)
+        return;
     if(stream->phase == NULL)
         stream->phase = dsp_stream_copy(stream);
     if(stream->magnitude == NULL)
         stream->magnitude = dsp_stream_copy(stream);
     dsp_buffer_set(stream->dft.buf, stream->len * 2, 0);
-    dsp_buffer_copy(stream->buf, buf, stream->len);
-    int *sizes = (int*)malloc(sizeof(int)*stream->dims);
-    dsp_buffer_copy(stream->sizes, sizes, stream->dims);
-    dsp_buffer_reverse(sizes, stream->dims);
-    fftw_plan plan = fftw_plan_dft_r2c(stream->dims, sizes, buf, stream->dft.pairs, FFTW_ESTIMATE_PATIENT);
-    fftw_execute(plan);
-    fftw_free(plan);
-    free(sizes);
-    free(buf);
+    dsp_buffer_copy(stream->buf, plan->real, stream->len);
+    FFTW(execute)(plan->plan);
+    memcpy(stream->dft.pairs, plan->complex, sizeof(FFTW(complex)) * plan->complex_len);
+    dsp_fourier_plan_release(plan);
     dsp_fourier_2dsp(stream);
     if(exp > 1) {
-        exp--;
-        pthread_t th[2];
-        struct {
-           int exp;
-           dsp_stream_p stream;
-        } thread_arguments[2];
-        thread_arguments[0].exp = exp;
-        thread_arguments[0].stream = stream->phase;
-        pthread_create(&th[0], NULL, dsp_stream_dft_th, &thread_arguments[0]);
-        thread_arguments[1].exp = exp;
-        thread_arguments[1].stream = stream->magnitude;
-        pthread_create(&th[1], NULL, dsp_stream_dft_th, &thread_arguments[1]);
-        pthread_join(th[0], NULL);
-        pthread_join(th[1], NULL);
+        dsp_stream_dft_arguments arguments = { exp - 1, { stream->phase, stream->magnitude } };
+        dsp_parallel_for(2, dsp_stream_dft_th, &arguments);
     }
 }
 
 void dsp_fourier_idft(dsp_stream_p stream)
 {
-    double *buf = (double*)malloc(sizeof(double)*stream->len);
+    dsp_fourier_plan *plan = dsp_fourier_plan_acquire(stream, FFTW_BACKWARD);
+    if(plan == NULL)
+        return;
     dsp_t mn = dsp_stats_min(stream->buf, stream->len);
     dsp_t mx = dsp_stats_max(stream->buf, stream->len);
-    dsp_buffer_set(buf, stream->len, 0);
     dsp_fourier_2complex_t(stream);
-    int *sizes = (int*)malloc(sizeof(int)*stream->dims);
-    dsp_buffer_copy(stream->sizes, sizes, stream->dims);
-    dsp_buffer_reverse(sizes, stream->dims);
-    fftw_plan plan = fftw_plan_dft_c2r(stream->dims, sizes, stream->dft.pairs, buf, FFTW_ESTIMATE_PATIENT);
-    fftw_execute(plan);
-    fftw_free(plan);
-    free(sizes);
+    memcpy(plan->complex, stream->dft.pairs, sizeof(FFTW(complex)) * plan->complex_len);
+    FFTW(execute)(plan->plan);
+    dsp_t *buf = plan->real;
     dsp_buffer_stretch(buf, stream->len, mn, mx);
     dsp_buffer_copy(buf, stream->buf, stream->len);
+    dsp_fourier_plan_release(plan);
     dsp_buffer_shift(stream->magnitude);
     dsp_buffer_shift(stream->phase);
-    free(buf);
+}
+
+/*
+ * Convolution by products of transforms, overlap-add. The stream is cut in blocks, each block is padded
+ * by the kernel size minus one so the circular convolution of the padded block equals the linear one,
+ * and its convolution is added to the output at the block origin. Streams up to DSP_FOURIER_TILE
+ * elements per side are transformed as a single block.
+ */
+#define DSP_FOURIER_TILE 512
+
+typedef struct {
+    dsp_stream_p stream;
+    dsp_stream_p tile;
+    dsp_t *in;
+    int *block;
+    int *tiles;
+    int *center;
+    FFTW(complex) *kernel;
+    pthread_mutex_t mutex;
+} dsp_fourier_convolution_arguments;
+
+/* Smallest size not lower than n without prime factors greater than 7, fast to transform */
+static int dsp_fourier_good_size(int n)
+{
+    for(;; n++) {
+        int m = n;
+        while(m % 2 == 0) m /= 2;
+        while(m % 3 == 0) m /= 3;
+        while(m % 5 == 0) m /= 5;
+        while(m % 7 == 0) m /= 7;
+        if(m == 1)
+            return n;
+    }
+}
+
+static void dsp_fourier_convolution_th(void *arg, int start, int end)
+{
+    dsp_fourier_convolution_arguments *arguments = arg;
+    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p tile = arguments->tile;
+    int dims = stream->dims;
+    int origin[dims], p[dims], pos[dims];
+    int t, x, d;
+    dsp_fourier_plan *forward = dsp_fourier_plan_acquire(tile, FFTW_FORWARD);
+    dsp_fourier_plan *backward = dsp_fourier_plan_acquire(tile, FFTW_BACKWARD);
+    if(forward == NULL || backward == NULL)
+        goto release;
+    double scale = 1.0 / tile->len;
+    for(t = start; t < end; t++) {
+        int rest = t;
+        for(d = 0; d < dims; d++) {
+            origin[d] = (rest % arguments->tiles[d]) * arguments->block[d];
+            rest /= arguments->tiles[d];
+        }
+        dsp_stream_position_init(tile, 0, p);
+        for(x = 0; x < tile->len; x++, dsp_stream_position_next(tile, p)) {
+            int inside = 1;
+            for(d = 0; d < dims; d++) {
+                pos[d] = origin[d] + p[d];
+                if(p[d] >= arguments->block[d] || pos[d] >= stream->sizes[d])
+                    inside = 0;
+            }
+            forward->real[x] = inside ? arguments->in[dsp_stream_set_position(stream, pos)] : 0;
+        }
+        FFTW(execute)(forward->plan);
+        for(x = 0; x < forward->complex_len; x++) {
+            double re = forward->complex[x][0] * arguments->kernel[x][0] - forward->complex[x][1] * arguments->kernel[x][1];
+            double im = forward->complex[x][0] * arguments->kernel[x][1] + forward->complex[x][1] * arguments->kernel[x][0];
+            backward->complex[x][0] = re * scale;
+            backward->complex[x][1] = im * scale;
+        }
+        FFTW(execute)(backward->plan);
+        // neighbour blocks overlap by the kernel size minus one
+        pthread_mutex_lock(&arguments->mutex);
+        dsp_stream_position_init(tile, 0, p);
+        for(x = 0; x < tile->len; x++, dsp_stream_position_next(tile, p)) {
+            int inside = 1;
+            for(d = 0; d < dims; d++) {
+                pos[d] = origin[d] + p[d] - arguments->center[d];
+                if(pos[d] < 0 || pos[d] >= stream->sizes[d])
+                    inside = 0;
+            }
+            if(inside)
+                stream->buf[dsp_stream_set_position(stream, pos)] += backward->real[x];
+        }
+        pthread_mutex_unlock(&arguments->mutex);
+    }
+release:
+    if(forward != NULL)
+        dsp_fourier_plan_release(forward);
+    if(backward != NULL)
+        dsp_fourier_plan_release(backward);
+}
+
+void dsp_fourier_convolution(dsp_stream_p stream, dsp_stream_p matrix)
+{
+    int d, x, count = 1;
+    if(matrix->dims != stream->dims)
+        return;
+    int dims = stream->dims;
+    int block[dims], tiles[dims], center[dims], pos[dims];
+    dsp_fourier_convolution_arguments arguments;
+    arguments.tile = dsp_stream_new();
+    for(d = 0; d < dims; d++) {
+        int k = matrix->sizes[d];
+        int full = stream->sizes[d] + k - 1;
+        int size = dsp_fourier_good_size(full <= DSP_FOURIER_TILE ? full : Max(DSP_FOURIER_TILE, 4 * (k - 1)));
+        block[d] = size - k + 1;
+        tiles[d] = (stream->sizes[d] + block[d] - 1) / block[d];
+        center[d] = k / 2;
+        count *= tiles[d];
+        dsp_stream_add_dim(arguments.tile, size);
+    }
+    dsp_fourier_plan *plan = dsp_fourier_plan_acquire(arguments.tile, FFTW_FORWARD);
+    if(plan == NULL) {
+        dsp_stream_free(arguments.tile);
+        return;
+    }
+    dsp_buffer_set(plan->real, plan->real_len, 0);
+    dsp_stream_position_init(matrix, 0, pos);
+    for(x = 0; x < matrix->len; x++, dsp_stream_position_next(matrix, pos))
+        plan->real[dsp_stream_set_position(arguments.tile, pos)] = matrix->buf[x];
+    FFTW(execute)(plan->plan);
+    arguments.kernel = (FFTW(complex)*)FFTW(malloc)(sizeof(FFTW(complex)) * plan->complex_len);
+    memcpy(arguments.kernel, plan->complex, sizeof(FFTW(complex)) * plan->complex_len);
+    dsp_fourier_plan_release(plan);
+
+    arguments.stream = stream;
+    arguments.in = (dsp_t*)malloc(sizeof(dsp_t) * stream->len);
+    dsp_buffer_copy(stream->buf, arguments.in, stream->len);
+    dsp_buffer_set(stream->buf, stream->len, 0);
+    arguments.block = block;
+    arguments.tiles = tiles;
+    arguments.center = center;
+    pthread_mutex_init(&arguments.mutex, NULL);
+    dsp_parallel_for(count, dsp_fourier_convolution_th, &arguments);
+    pthread_mutex_destroy(&arguments.mutex);
+
+    FFTW(free)(arguments.kernel);
+    free(arguments.in);
+    dsp_stream_free(arguments.tile);
 }
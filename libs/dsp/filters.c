@@ -43,14 +43,14 @@ void dsp_filter_lowpass(dsp_stream_p stream, double Frequency)
         radius += pow(stream->sizes[d]/2.0, 2);
     }
     radius = sqrt(radius);
+    int pos[stream->dims];
     dsp_fourier_dft(stream, 1);
-    for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
+    dsp_stream_position_init(stream, 0, pos);
+    for(x = 0; x < stream->len; x++, dsp_stream_position_next(stream, pos)) {
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist>Frequency)
@@ -67,14 +67,14 @@ void dsp_filter_highpass(dsp_stream_p stream, double Frequency)
         radius += pow(stream->sizes[d]/2.0, 2);
     }
     radius = sqrt(radius);
+    int pos[stream->dims];
     dsp_fourier_dft(stream, 1);
-    for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
+    dsp_stream_position_init(stream, 0, pos);
+    for(x = 0; x < stream->len; x++, dsp_stream_position_next(stream, pos)) {
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist<Frequency)
@@ -91,14 +91,14 @@ void dsp_filter_bandreject(dsp_stream_p stream, double LowFrequency, double High
         radius += pow(stream->sizes[d]/2.0, 2);
     }
     radius = sqrt(radius);
+    int pos[stream->dims];
     dsp_fourier_dft(stream, 1);
-    for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
+    dsp_stream_position_init(stream, 0, pos);
+    for(x = 0; x < stream->len; x++, dsp_stream_position_next(stream, pos)) {
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist<HighFrequency&&dist>LowFrequency)
@@ -115,14 +115,14 @@ void dsp_filter_bandpass(dsp_stream_p stream, double LowFrequency, double HighFr
         radius += pow(stream->sizes[d]/2.0, 2);
     }
     radius = sqrt(radius);
+    int pos[stream->dims];
     dsp_fourier_dft(stream, 1);
-    for(x = 0; x < stream->len; x++) {
-        int* pos = dsp_stream_get_position(stream, x);
+    dsp_stream_position_init(stream, 0, pos);
+    for(x = 0; x < stream->len; x++, dsp_stream_position_next(stream, pos)) {
         double dist = 0.0;
         for(d = 0; d < stream->dims; d++) {
             dist += pow(stream->sizes[d]/2.0-pos[d], 2);
         }
-        free(pos);
         dist = sqrt(dist);
         dist *= M_PI/radius;
         if(dist>HighFrequency||dist<LowFrequency)
@@ -0,0 +1,155 @@
+/*
+*   DSP API - a digital signal processing library for astronomy usage
+*   Copyright © 2017-2022  Ilia Platone
+*
+*   This program is free software; you can redistribute it and/or
+*   modify it under the terms of the GNU Lesser General Public
+*   License as published by the Free Software Foundation; either
+*   version 3 of the License, or (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*   Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program; if not, write to the Free Software Foundation,
+*   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "dsp.h"
+#include <stdint.h>
+
+/*
+ * Process-wide worker pool, started by the first parallel loop and resized when dsp_max_threads changes.
+ * The calling thread runs a share of every loop, so dsp_max_threads(0)-1 workers are started.
+ * The pool runs one loop at a time: loops started while it is busy, including loops nested
+ * in a running one, are run entirely by the calling thread.
+ */
+
+typedef struct dsp_parallel_job_t
+{
+    dsp_parallel_func func;
+    void *arg;
+    int len;
+    int chunks;
+    int next;
+    int done;
+} dsp_parallel_job;
+
+static pthread_mutex_t pool_busy = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static pthread_t *pool_threads = NULL;
+/* Number of started workers, changed under both locks so that reading it under either one is enough */
+static int pool_size = 0;
+static int pool_wanted = 0;
+static int pool_quit = 0;
+static unsigned long pool_generation = 0;
+static dsp_parallel_job pool_job;
+
+/* Called with pool_mutex locked, runs chunks of the current loop until none is left */
+static void dsp_parallel_run()
+{
+    while(pool_job.next < pool_job.chunks) {
+        int chunk = pool_job.next++;
+        int start = (int)((long)chunk * pool_job.len / pool_job.chunks);
+        int end = (int)((long)(chunk + 1) * pool_job.len / pool_job.chunks);
+        pthread_mutex_unlock(&pool_mutex);
+        pool_job.func(pool_job.arg, start, end);
+        pthread_mutex_lock(&pool_mutex);
+        if(++pool_job.done == pool_job.chunks)
+            pthread_cond_signal(&pool_done);
+    }
+}
+
+static void* dsp_parallel_worker(void *arg)
+{
+    unsigned long generation = (unsigned long)(uintptr_t)arg;
+    pthread_mutex_lock(&pool_mutex);
+    for(;;) {
+        while(generation == pool_generation && !pool_quit)
+            pthread_cond_wait(&pool_start, &pool_mutex);
+        if(pool_quit)
+            break;
+        generation = pool_generation;
+        dsp_parallel_run();
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    return NULL;
+}
+
+/* Called with pool_busy locked */
+static void dsp_parallel_resize(int size)
+{
+    int x, started = 0;
+    if(size == pool_wanted)
+        return;
+    if(pool_size > 0) {
+        pthread_mutex_lock(&pool_mutex);
+        pool_quit = 1;
+        pthread_cond_broadcast(&pool_start);
+        pthread_mutex_unlock(&pool_mutex);
+        for(x = 0; x < pool_size; x++)
+            pthread_join(pool_threads[x], NULL);
+        pool_quit = 0;
+    }
+    free(pool_threads);
+    pool_threads = NULL;
+    pool_wanted = size;
+    if(size > 0) {
+        pool_threads = (pthread_t*)malloc(sizeof(pthread_t) * size);
+        for(x = 0; x < size; x++) {
+            if(pthread_create(&pool_threads[x], NULL, dsp_parallel_worker, (void*)(uintptr_t)pool_generation) != 0) {
+                perr("Started %d of %d worker threads\n", started, size);
+                break;
+            }
+            started++;
+        }
+    }
+    pthread_mutex_lock(&pool_mutex);
+    pool_size = started;
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+void dsp_parallel_for(int len, dsp_parallel_func func, void *arg)
+{
+    int chunks;
+    if(len < 1)
+        return;
+    if(pthread_mutex_trylock(&pool_busy) != 0) {
+        func(arg, 0, len);
+        return;
+    }
+    dsp_parallel_resize((int)dsp_max_threads(0) - 1);
+    chunks = Min(len, pool_size + 1);
+    if(chunks < 2) {
+        pthread_mutex_unlock(&pool_busy);
+        func(arg, 0, len);
+        return;
+    }
+    pthread_mutex_lock(&pool_mutex);
+    pool_job.func = func;
+    pool_job.arg = arg;
+    pool_job.len = len;
+    pool_job.chunks = chunks;
+    pool_job.next = 0;
+    pool_job.done = 0;
+    pool_generation++;
+    pthread_cond_broadcast(&pool_start);
+    dsp_parallel_run();
+    while(pool_job.done < pool_job.chunks)
+        pthread_cond_wait(&pool_done, &pool_mutex);
+    pthread_mutex_unlock(&pool_mutex);
+    pthread_mutex_unlock(&pool_busy);
+}
+
+int dsp_parallel_threads()
+{
+    int threads;
+    pthread_mutex_lock(&pool_mutex);
+    threads = pool_size + 1;
+    pthread_mutex_unlock(&pool_mutex);
+    return threads;
+}
@@ -0,0 +1,465 @@
+/*
+*   DSP API - a digital signal processing library for astronomy usage
+*   Copyright © 2017-2022  Ilia Platone
+*
+*   This program is free software; you can redistribute it and/or
+*   modify it under the terms of the GNU Lesser General Public
+*   License as published by the Free Software Foundation; either
+*   version 3 of the License, or (at your option) any later version.
+*
+*   This program is distributed in the hope that it will be useful,
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*   Lesser General Public License for more details.
+*
+*   You should have received a copy of the GNU Lesser General Public License
+*   along with this program; if not, write to the Free Software Foundation,
+*   Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "dsp.h"
+
+/*
+ * Star detection in two dimensional streams. The background and the noise are estimated
+ * on a coarse grid, as the median and the median absolute deviation of each cell, and are
+ * interpolated bilinearly between the cell centers. Each row of the region of interest is
+ * scanned for runs of pixels above the local threshold, the runs touching the runs of the
+ * previous row are joined into objects (8-connectivity) and every object large enough is
+ * measured over a box around it. Grid cells, row blocks and objects are processed in parallel.
+ */
+///Side in pixels of the cells of the background grid
+#define DSP_STARS_GRID 64
+///Largest number of pixels sampled in each cell of the background grid
+#define DSP_STARS_GRID_SAMPLES 256
+///Rows scanned by each parallel job
+#define DSP_STARS_BLOCK 32
+///Standard deviations of a normal distribution in its median absolute deviation
+#define DSP_STARS_MAD_SIGMA 1.4826
+///Full width at half maximum of a normal distribution in standard deviations
+#define DSP_STARS_FWHM_SIGMA 2.35482
+///Iterations of the windowed centroid
+#define DSP_STARS_WINDOW_ITERATIONS 5
+
+typedef struct {
+    int y;
+    /// First pixel and the one past the last pixel of the run
+    int start;
+    int end;
+} dsp_stars_run;
+
+typedef struct {
+    dsp_stars_run *runs;
+    int count;
+    int size;
+} dsp_stars_runs;
+
+typedef struct {
+    double x;
+    double y;
+    double peak;
+    double flux;
+    double hfr;
+    double fwhm;
+    int valid;
+} dsp_stars_object;
+
+typedef struct {
+    dsp_stream_p stream;
+    /// Region of interest
+    int x0, y0, width, height;
+    /// Background grid
+    int columns, rows;
+    double *background;
+    double *noise;
+    double threshold;
+    int min_area;
+    dsp_stars_runs *blocks;
+    /// Runs grouped by object
+    dsp_stars_run *runs;
+    int *first;
+    dsp_stars_object *objects;
+} dsp_stars_context;
+
+static void dsp_stars_runs_add(dsp_stars_runs *runs, int y, int start, int end)
+{
+    if(runs->count == runs->size) {
+        runs->size = Max(16, runs->size * 2);
+        runs->runs = (dsp_stars_run*)realloc(runs->runs, sizeof(dsp_stars_run) * runs->size);
+    }
+    runs->runs[runs->count].y = y;
+    runs->runs[runs->count].start = start;
+    runs->runs[runs->count++].end = end;
+}
+
+static double dsp_stars_select(double *values, int count, int k)
+{
+    int lo = 0, hi = count - 1;
+    while(lo < hi) {
+        double pivot = values[(lo + hi) / 2];
+        int i = lo, j = hi;
+        while(i <= j) {
+            while(values[i] < pivot) i++;
+            while(values[j] > pivot) j--;
+            if(i <= j) {
+                double t = values[i];
+                values[i++] = values[j];
+                values[j--] = t;
+            }
+        }
+        if(k <= j)
+            hi = j;
+        else if(k >= i)
+            lo = i;
+        else
+            break;
+    }
+    return values[k];
+}
+
+static void dsp_stars_grid_th(void *arg, int start, int end)
+{
+    dsp_stars_context *ctx = arg;
+    dsp_stream_p stream = ctx->stream;
+    double samples[DSP_STARS_GRID_SAMPLES];
+    int cell;
+    for(cell = start; cell < end; cell++) {
+        int x0 = ctx->x0 + (cell % ctx->columns) * DSP_STARS_GRID;
+        int y0 = ctx->y0 + (cell / ctx->columns) * DSP_STARS_GRID;
+        int x1 = Min(x0 + DSP_STARS_GRID, ctx->x0 + ctx->width);
+        int y1 = Min(y0 + DSP_STARS_GRID, ctx->y0 + ctx->height);
+        int step = (int)ceil(sqrt((double)(x1 - x0) * (y1 - y0) / DSP_STARS_GRID_SAMPLES));
+        int x, y, count = 0;
+        for(y = y0; y < y1; y += step) {
+            for(x = x0; x < x1 && count < DSP_STARS_GRID_SAMPLES; x += step)
+                samples[count++] = stream->buf[x + y * stream->sizes[0]];
+        }
+        double median = dsp_stars_select(samples, count, count / 2);
+        for(x = 0; x < count; x++)
+            samples[x] = fabs(samples[x] - median);
+        ctx->background[cell] = median;
+        ctx->noise[cell] = DSP_STARS_MAD_SIGMA * dsp_stars_select(samples, count, count / 2);
+    }
+}
+
+/* Interpolates the rows of the grid at row y into background and noise */
+static void dsp_stars_grid_row(dsp_stars_context *ctx, int y, double *background, double *noise)
+{
+    double fy = (double)(y - ctx->y0) / DSP_STARS_GRID - 0.5;
+    int row = Max(0, Min(ctx->rows - 2, (int)floor(fy)));
+    double t = ctx->rows > 1 ? Max(0.0, Min(1.0, fy - row)) : 0.0;
+    int next = Min(ctx->rows - 1, row + 1);
+    int x;
+    for(x = 0; x < ctx->columns; x++) {
+        background[x] = ctx->background[x + row * ctx->columns] * (1.0 - t) + ctx->background[x + next * ctx->columns] * t;
+        noise[x] = ctx->noise[x + row * ctx->columns] * (1.0 - t) + ctx->noise[x + next * ctx->columns] * t;
+    }
+}
+
+/* Interpolates the background of the grid at x, y */
+static double dsp_stars_grid_at(dsp_stars_context *ctx, int x, int y)
+{
+    double fx = (double)(x - ctx->x0) / DSP_STARS_GRID - 0.5;
+    double fy = (double)(y - ctx->y0) / DSP_STARS_GRID - 0.5;
+    int column = Max(0, Min(ctx->columns - 2, (int)floor(fx)));
+    int row = Max(0, Min(ctx->rows - 2, (int)floor(fy)));
+    double tx = ctx->columns > 1 ? Max(0.0, Min(1.0, fx - column)) : 0.0;
+    double ty = ctx->rows > 1 ? Max(0.0, Min(1.0, fy - row)) : 0.0;
+    double *top = &ctx->background[row * ctx->columns];
+    double *bottom = &ctx->background[Min(ctx->rows - 1, row + 1) * ctx->columns];
+    int right = Min(ctx->columns - 1, column + 1);
+    return (top[column] * (1.0 - tx) + top[right] * tx) * (1.0 - ty) + (bottom[column] * (1.0 - tx) + bottom[right] * tx) * ty;
+}
+
+/* Interpolates a row of the grid, as given by dsp_stars_grid_row, over all the columns of the region */
+static void dsp_stars_grid_line(dsp_stars_context *ctx, double *row, double *line)
+{
+    int column, x = 0;
+    for(; x < Min(ctx->width, DSP_STARS_GRID / 2); x++)
+        line[x] = row[0];
+    for(column = 1; column < ctx->columns; column++) {
+        int center = Min(ctx->width, column * DSP_STARS_GRID + DSP_STARS_GRID / 2);
+        double slope = (row[column] - row[column - 1]) / DSP_STARS_GRID;
+        double value = row[column - 1] + slope * (x - (column - 1) * DSP_STARS_GRID - DSP_STARS_GRID / 2);
+        for(; x < center; x++, value += slope)
+            line[x] = value;
+    }
+    for(; x < ctx->width; x++)
+        line[x] = row[ctx->columns - 1];
+}
+
+static void dsp_stars_scan_th(void *arg, int start, int end)
+{
+    dsp_stars_context *ctx = arg;
+    dsp_stream_p stream = ctx->stream;
+    double background[ctx->columns], noise[ctx->columns];
+    double *level = (double*)malloc(sizeof(double) * ctx->width);
+    int block;
+    for(block = start; block < end; block++) {
+        dsp_stars_runs *runs = &ctx->blocks[block];
+        int y0 = ctx->y0 + block * DSP_STARS_BLOCK;
+        int y1 = Min(y0 + DSP_STARS_BLOCK, ctx->y0 + ctx->height);
+        int x, y;
+        for(y = y0; y < y1; y++) {
+            dsp_t *row = &stream->buf[y * stream->sizes[0]];
+            int run = -1;
+            dsp_stars_grid_row(ctx, y, background, noise);
+            for(x = 0; x < ctx->columns; x++)
+                background[x] += ctx->threshold * noise[x];
+            dsp_stars_grid_line(ctx, background, level);
+            for(x = ctx->x0; x < ctx->x0 + ctx->width; x++) {
+                if(row[x] > level[x - ctx->x0]) {
+                    if(run < 0)
+                        run = x;
+                    continue;
+                }
+                if(run >= 0)
+                    dsp_stars_runs_add(runs, y, run, x);
+                run = -1;
+            }
+            if(run >= 0)
+                dsp_stars_runs_add(runs, y, run, x);
+        }
+    }
+    free(level);
+}
+
+static int dsp_stars_root(int *parent, int x)
+{
+    while(parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+static void dsp_stars_join(int *parent, int a, int b)
+{
+    a = dsp_stars_root(parent, a);
+    b = dsp_stars_root(parent, b);
+    if(a < b)
+        parent[b] = a;
+    else if(b < a)
+        parent[a] = b;
+}
+
+static void dsp_stars_measure_th(void *arg, int start, int end)
+{
+    dsp_stars_context *ctx = arg;
+    dsp_stream_p stream = ctx->stream;
+    int o;
+    for(o = start; o < end; o++) {
+        dsp_stars_object *object = &ctx->objects[o];
+        int r, x, y, area = 0;
+        int left = ctx->x0 + ctx->width, right = 0, top = ctx->y0 + ctx->height, bottom = 0;
+        object->valid = 0;
+        for(r = ctx->first[o]; r < ctx->first[o + 1]; r++) {
+            area += ctx->runs[r].end - ctx->runs[r].start;
+            left = Min(left, ctx->runs[r].start);
+            right = Max(right, ctx->runs[r].end);
+            top = Min(top, ctx->runs[r].y);
+            bottom = Max(bottom, ctx->runs[r].y + 1);
+        }
+        if(area < ctx->min_area)
+            continue;
+        // the wings of the star below the threshold are measured as well
+        int margin = Max(2, Max(right - left, bottom - top) / 2);
+        left = Max(ctx->x0, left - margin);
+        right = Min(ctx->x0 + ctx->width, right + margin);
+        top = Max(ctx->y0, top - margin);
+        bottom = Min(ctx->y0 + ctx->height, bottom + margin);
+        double flux = 0, positive = 0, sx = 0, sy = 0, peak = 0;
+        int w = right - left;
+        double *weights = (double*)malloc(sizeof(double) * w * (bottom - top));
+        for(y = top; y < bottom; y++) {
+            for(x = left; x < right; x++) {
+                double v = stream->buf[x + y * stream->sizes[0]] - dsp_stars_grid_at(ctx, x, y);
+                weights[x - left + (y - top) * w] = v;
+                flux += v;
+                peak = Max(peak, v);
+                // the centroid is steadier without the negative noise, the moments need it to stay unbiased
+                v = Max(0.0, v);
+                positive += v;
+                sx += v * x;
+                sy += v * y;
+            }
+        }
+        if(flux <= 0 || positive <= 0) {
+            free(weights);
+            continue;
+        }
+        object->x = sx / positive;
+        object->y = sy / positive;
+        double sr = 0, sr2 = 0;
+        for(y = top; y < bottom; y++) {
+            for(x = left; x < right; x++) {
+                double v = weights[x - left + (y - top) * w];
+                double r2 = pow(x - object->x, 2) + pow(y - object->y, 2);
+                sr += v * sqrt(r2);
+                sr2 += v * r2;
+            }
+        }
+        object->peak = peak;
+        object->flux = flux;
+        object->hfr = sr / flux;
+        object->fwhm = DSP_STARS_FWHM_SIGMA * sqrt(Max(0.0, sr2) / flux / 2.0);
+        object->valid = sr > 0 && sr2 > 0;
+        // refine the centroid within a gaussian window as wide as the star, the noise far from the center is ignored
+        double window = 2.0 * pow(Max(0.5, object->fwhm / DSP_STARS_FWHM_SIGMA), 2);
+        double *wx = (double*)malloc(sizeof(double) * (w + bottom - top));
+        double *wy = &wx[w];
+        int i;
+        for(i = 0; i < DSP_STARS_WINDOW_ITERATIONS && object->valid; i++) {
+            double sw = 0, dx = 0, dy = 0;
+            for(x = left; x < right; x++)
+                wx[x - left] = exp(-pow(x - object->x, 2) / window);
+            for(y = top; y < bottom; y++)
+                wy[y - top] = exp(-pow(y - object->y, 2) / window);
+            for(y = top; y < bottom; y++) {
+                for(x = left; x < right; x++) {
+                    double v = weights[x - left + (y - top) * w] * wx[x - left] * wy[y - top];
+                    sw += v;
+                    dx += v * (x - object->x);
+                    dy += v * (y - object->y);
+                }
+            }
+            if(sw <= 0)
+                break;
+            object->x += 2.0 * dx / sw;
+            object->y += 2.0 * dy / sw;
+        }
+        free(wx);
+        free(weights);
+    }
+}
+
+static int dsp_stars_compare_flux_desc(const void *arg1, const void *arg2)
+{
+    const dsp_stars_object *a = arg1;
+    const dsp_stars_object *b = arg2;
+    return a->flux > b->flux ? -1 : a->flux < b->flux ? 1 : 0;
+}
+
+int dsp_stars_find(dsp_stream_p stream, dsp_region *roi, double threshold, int min_area, int max_stars)
+{
+    dsp_stars_context ctx;
+    int x, y, o;
+    if(stream == NULL || stream->buf == NULL || stream->dims != 2)
+        return -1;
+    ctx.stream = stream;
+    ctx.x0 = 0;
+    ctx.y0 = 0;
+    ctx.width = stream->sizes[0];
+    ctx.height = stream->sizes[1];
+    if(roi != NULL) {
+        ctx.x0 = Max(0, roi[0].start);
+        ctx.y0 = Max(0, roi[1].start);
+        ctx.width = Min(stream->sizes[0], roi[0].start + roi[0].len) - ctx.x0;
+        ctx.height = Min(stream->sizes[1], roi[1].start + roi[1].len) - ctx.y0;
+    }
+    if(ctx.width < 1 || ctx.height < 1)
+        return -1;
+    ctx.threshold = threshold;
+    ctx.min_area = Max(1, min_area);
+    ctx.columns = (ctx.width + DSP_STARS_GRID - 1) / DSP_STARS_GRID;
+    ctx.rows = (ctx.height + DSP_STARS_GRID - 1) / DSP_STARS_GRID;
+    ctx.background = (double*)malloc(sizeof(double) * ctx.columns * ctx.rows);
+    ctx.noise = (double*)malloc(sizeof(double) * ctx.columns * ctx.rows);
+    dsp_parallel_for(ctx.columns * ctx.rows, dsp_stars_grid_th, &ctx);
+
+    int blocks = (ctx.height + DSP_STARS_BLOCK - 1) / DSP_STARS_BLOCK;
+    ctx.blocks = (dsp_stars_runs*)calloc(blocks, sizeof(dsp_stars_runs));
+    dsp_parallel_for(blocks, dsp_stars_scan_th, &ctx);
+
+    // the blocks hold the runs ordered by row and column, join the runs touching the previous row
+    int count = 0;
+    for(x = 0; x < blocks; x++)
+        count += ctx.blocks[x].count;
+    dsp_stars_run *runs = (dsp_stars_run*)malloc(sizeof(dsp_stars_run) * Max(1, count));
+    int *parent = (int*)malloc(sizeof(int) * Max(1, count));
+    count = 0;
+    for(x = 0; x < blocks; x++) {
+        if(ctx.blocks[x].count > 0)
+            memcpy(&runs[count], ctx.blocks[x].runs, sizeof(dsp_stars_run) * ctx.blocks[x].count);
+        count += ctx.blocks[x].count;
+        free(ctx.blocks[x].runs);
+    }
+    free(ctx.blocks);
+    int previous = 0, previous_end = 0, current = 0;
+    while(current < count) {
+        int current_end = current;
+        while(current_end < count && runs[current_end].y == runs[current].y)
+            current_end++;
+        if(previous_end > previous && runs[previous].y != runs[current].y - 1)
+            previous = previous_end;
+        int p = previous;
+        for(x = current; x < current_end; x++) {
+            parent[x] = x;
+            while(p < previous_end && runs[p].end < runs[x].start)
+                p++;
+            for(y = p; y < previous_end && runs[y].start <= runs[x].end; y++)
+                dsp_stars_join(parent, x, y);
+        }
+        previous = current;
+        previous_end = current_end;
+        current = current_end;
+    }
+
+    // group the runs by object
+    int objects = 0;
+    int *label = (int*)malloc(sizeof(int) * Max(1, count));
+    for(x = 0; x < count; x++) {
+        int root = dsp_stars_root(parent, x);
+        label[x] = root == x ? objects++ : label[root];
+    }
+    ctx.first = (int*)calloc(objects + 1, sizeof(int));
+    for(x = 0; x < count; x++)
+        ctx.first[label[x] + 1]++;
+    for(o = 0; o < objects; o++)
+        ctx.first[o + 1] += ctx.first[o];
+    ctx.runs = (dsp_stars_run*)malloc(sizeof(dsp_stars_run) * Max(1, count));
+    for(x = 0; x < count; x++)
+        parent[x] = ctx.first[label[x]]++;
+    for(x = 0; x < count; x++)
+        ctx.runs[parent[x]] = runs[x];
+    for(o = objects; o > 0; o--)
+        ctx.first[o] = ctx.first[o - 1];
+    ctx.first[0] = 0;
+    free(label);
+    free(parent);
+    free(runs);
+
+    ctx.objects = (dsp_stars_object*)malloc(sizeof(dsp_stars_object) * Max(1, objects));
+    dsp_parallel_for(objects, dsp_stars_measure_th, &ctx);
+    int found = 0;
+    for(o = 0; o < objects; o++) {
+        if(ctx.objects[o].valid)
+            ctx.objects[found++] = ctx.objects[o];
+    }
+    qsort(ctx.objects, found, sizeof(dsp_stars_object), dsp_stars_compare_flux_desc);
+    if(max_stars > 0)
+        found = Min(found, max_stars);
+    pgarb("%d objects found, %d stars kept\n", objects, found);
+
+    for(x = 0; x < stream->stars_count; x++)
+        free(stream->stars[x].center.location);
+    stream->stars_count = 0;
+    for(o = 0; o < found; o++) {
+        double location[2] = { ctx.objects[o].x, ctx.objects[o].y };
+        dsp_star star;
+        memset(&star, 0, sizeof(dsp_star));
+        star.center.dims = 2;
+        star.center.location = location;
+        star.diameter = ctx.objects[o].fwhm;
+        star.peak = ctx.objects[o].peak;
+        star.flux = ctx.objects[o].flux;
+        star.hfr = ctx.objects[o].hfr;
+        dsp_stream_add_star(stream, star);
+    }
+
+    free(ctx.objects);
+    free(ctx.runs);
+    free(ctx.first);
+    free(ctx.background);
+    free(ctx.noise);
+    return found;
+}
@@ -18,12 +18,23 @@
 */
 
 #include "dsp.h"
+#include <unistd.h>
 static int dsp_debug = 0;
 static char* dsp_app_name = NULL;
 
 static int DSP_MAX_THREADS = 1;
 
-static unsigned long MAX_THREADS = 1;
+/* 0 until set by the application, the number of online processors is used meanwhile */
+static unsigned long MAX_THREADS = 0;
+static unsigned long DEFAULT_THREADS = 1;
+static pthread_once_t default_threads_once = PTHREAD_ONCE_INIT;
+
+static void dsp_default_threads()
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if(cpus > 0)
+        DEFAULT_THREADS = (unsigned long)cpus;
+}
 
 static FILE *out = NULL;
 static FILE *err = NULL;
@@ -34,6 +45,10 @@ unsigned long int dsp_max_threads(unsigned long value)
         MAX_THREADS = value;
         DSP_MAX_THREADS = value;
     }
+    if(MAX_THREADS == 0) {
+        pthread_once(&default_threads_once, dsp_default_threads);
+        return DEFAULT_THREADS;
+    }
     return MAX_THREADS;
 }
 
@@ -83,9 +98,9 @@ void dsp_stream_alloc_buffer(dsp_stream_p stream, int len)
         stream->buf = (dsp_t*)malloc(sizeof(dsp_t) * len);
     }
     if(stream->dft.buf != NULL) {
-        stream->dft.buf = (double*)realloc(stream->dft.buf, sizeof(double) * len * 2);
+        stream->dft.buf = (dsp_t*)realloc(stream->dft.buf, sizeof(dsp_t) * len * 2);
     } else {
-        stream->dft.buf = (double*)malloc(sizeof(double) * len * 2);
+        stream->dft.buf = (dsp_t*)malloc(sizeof(dsp_t) * len * 2);
     }
     if(stream->location != NULL) {
         stream->location = (dsp_location*)realloc(stream->location, sizeof(dsp_location) * (stream->len));
@@ -343,6 +358,7 @@ void dsp_stream_add_star(dsp_stream_p stream, dsp_star star)
     stream->stars[stream->stars_count].peak = star.peak;
     stream->stars[stream->stars_count].flux = star.flux;
     stream->stars[stream->stars_count].theta = star.theta;
+    stream->stars[stream->stars_count].hfr = star.hfr;
     stream->stars[stream->stars_count].center.dims = star.center.dims;
     stream->stars[stream->stars_count].center.location = (double*)malloc(sizeof(double)*star.center.dims);
     for(d = 0; d < star.center.dims; d++)
@@ -449,17 +465,39 @@ void dsp_stream_del_triangle(dsp_stream_p stream, int index)
  * @return
  */
 int* dsp_stream_get_position(dsp_stream_p stream, int index) {
-    int dim = 0;
-    int y = 0;
-    int m = 1;
     int* pos = (int*)malloc(sizeof(int) * stream->dims);
+    dsp_stream_position_init(stream, index, pos);
+    return pos;
+}
+
+/**
+ * @brief dsp_stream_position_init
+ * @param stream
+ * @param index
+ * @param pos
+ */
+void dsp_stream_position_init(dsp_stream_p stream, int index, int* pos) {
+    int dim = 0;
     for (dim = 0; dim < stream->dims; dim++) {
-        y = index / m;
-        y %= stream->sizes[dim];
-        m *= stream->sizes[dim];
-        pos[dim] = y;
+        pos[dim] = index % stream->sizes[dim];
+        index /= stream->sizes[dim];
     }
-    return pos;
+}
+
+/**
+ * @brief dsp_stream_position_next
+ * @param stream
+ * @param pos
+ * @return
+ */
+int dsp_stream_position_next(dsp_stream_p stream, int* pos) {
+    int dim = 0;
+    for (dim = 0; dim < stream->dims; dim++) {
+        if (++pos[dim] < stream->sizes[dim])
+            return 1;
+        pos[dim] = 0;
+    }
+    return 0;
 }
 
 /**
@@ -479,22 +517,17 @@ int dsp_stream_set_position(dsp_stream_p stream, int* pos) {
     return index;
 }
 
-static void* dsp_stream_align_th(void* arg)
+static void dsp_stream_align_th(void* arg, int start, int end)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int y;
-    for(y = start; y < end; y++)
+    int it[stream->dims];
+    int pos[stream->dims];
+    dsp_stream_position_init(stream, start, it);
+    for(y = start; y < end; y++, dsp_stream_position_next(stream, it))
     {
-        int *pos = dsp_stream_get_position(stream, y);
+        memcpy(pos, it, sizeof(int) * stream->dims);
         int dim;
         for (dim = 1; dim < stream->dims; dim++) {
             pos[dim] -= stream->align_info.center[dim];
@@ -516,11 +549,9 @@ static void* dsp_stream_align_th(void* arg)
             pos[dim-1] += stream->align_info.center[dim-1];
         }
         int x = dsp_stream_set_position(in, pos);
-        free(pos);
         if(x >= 0 && x < in->len)
             stream->buf[y] = in->buf[x];
     }
-    return NULL;
 }
 
 void dsp_stream_align(dsp_stream_p in)
@@ -528,20 +559,7 @@ void dsp_stream_align(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_align_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, dsp_stream_align_th, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -552,22 +570,17 @@ void dsp_stream_align(dsp_stream_p in)
  * @param in
  */
 
-static void* dsp_stream_crop_th(void* arg)
+static void dsp_stream_crop_th(void* arg, int start, int end)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int y;
-    for(y = start; y < end; y++)
+    int it[stream->dims];
+    int pos[stream->dims];
+    dsp_stream_position_init(stream, start, it);
+    for(y = start; y < end; y++, dsp_stream_position_next(stream, it))
     {
-        int *pos = dsp_stream_get_position(stream, y);
+        memcpy(pos, it, sizeof(int) * stream->dims);
         int dim;
         int allow = 1;
         for (dim = 0; dim < stream->dims; dim++) {
@@ -581,9 +594,7 @@ static void* dsp_stream_crop_th(void* arg)
         }
         else
             stream->buf[y] = 0;
-        free(pos);
     }
-    return NULL;
 }
 
 void dsp_stream_crop(dsp_stream_p in)
@@ -591,20 +602,7 @@ void dsp_stream_crop(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_crop_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, dsp_stream_crop_th, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -634,22 +632,17 @@ void dsp_stream_translate(dsp_stream_p in)
  * @param arg
  * @return
  */
-static void* dsp_stream_scale_th(void* arg)
+static void dsp_stream_scale_th(void* arg, int start, int end)
 {
-    struct {
-        int cur_th;
-        dsp_stream_p stream;
-     } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int y, d;
-    for(y = start; y < end; y++)
+    int it[stream->dims];
+    int pos[stream->dims];
+    dsp_stream_position_init(stream, start, it);
+    for(y = start; y < end; y++, dsp_stream_position_next(stream, it))
     {
-        int* pos = dsp_stream_get_position(stream, y);
+        memcpy(pos, it, sizeof(int) * stream->dims);
         double factor = 0.0;
         for(d = 0; d < stream->dims; d++) {
             pos[d] -= stream->align_info.center[d];
@@ -661,9 +654,7 @@ static void* dsp_stream_scale_th(void* arg)
         int x = dsp_stream_set_position(in, pos);
         if(x >= 0 && x < in->len)
             stream->buf[y] += in->buf[x]/(factor*stream->dims);
-        free(pos);
     }
-    return NULL;
 }
 
 void dsp_stream_scale(dsp_stream_p in)
@@ -671,41 +662,23 @@ void dsp_stream_scale(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_scale_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, dsp_stream_scale_th, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
 }
 
-static void* dsp_stream_rotate_th(void* arg)
+static void dsp_stream_rotate_th(void* arg, int start, int end)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } *arguments = arg;
-    dsp_stream_p stream = arguments->stream;
+    dsp_stream_p stream = arg;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int y;
-    for(y = start; y < end; y++)
+    int it[stream->dims];
+    int pos[stream->dims];
+    dsp_stream_position_init(stream, start, it);
+    for(y = start; y < end; y++, dsp_stream_position_next(stream, it))
     {
-        int *pos = dsp_stream_get_position(stream, y);
+        memcpy(pos, it, sizeof(int) * stream->dims);
         int dim;
         for (dim = 1; dim < stream->dims; dim++) {
             pos[dim] -= stream->align_info.center[dim];
@@ -721,11 +694,9 @@ static void* dsp_stream_rotate_th(void* arg)
             pos[dim-1] += stream->align_info.center[dim-1];
         }
         int x = dsp_stream_set_position(in, pos);
-        free(pos);
         if(x >= 0 && x < in->len)
             stream->buf[y] = in->buf[x];
     }
-    return NULL;
 }
 
 void dsp_stream_rotate(dsp_stream_p in)
@@ -733,20 +704,7 @@ void dsp_stream_rotate(dsp_stream_p in)
     dsp_stream_p stream = dsp_stream_copy(in);
     dsp_buffer_set(stream->buf, stream->len, 0);
     stream->parent = in;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        pthread_create(&th[y], NULL, dsp_stream_rotate_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_parallel_for(stream->len, dsp_stream_rotate_th, stream);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -767,52 +725,34 @@ static double stack_delegate_subtraction(double x, double y)
     return fmax(0.0, x - y);
 }
 
-static void* dsp_stream_stack_th(void* arg)
+typedef struct {
+    dsp_stream_p stream;
+    double(*delegate)(double, double);
+} dsp_stream_stack_arguments;
+
+static void dsp_stream_stack_th(void* arg, int start, int end)
 {
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } *arguments = arg;
+    dsp_stream_stack_arguments *arguments = arg;
     double(*delegate)(double, double) = arguments->delegate;
     dsp_stream_p stream = arguments->stream;
     dsp_stream_p in = stream->parent;
-    int cur_th = arguments->cur_th;
-    int start = cur_th * stream->len / dsp_max_threads(0);
-    int end = start + stream->len / dsp_max_threads(0);
-    end = Min(stream->len, end);
     int y;
-    for(y = start; y < end; y++)
+    int pos[stream->dims];
+    dsp_stream_position_init(stream, start, pos);
+    for(y = start; y < end; y++, dsp_stream_position_next(stream, pos))
     {
-        int *pos = dsp_stream_get_position(stream, y);
         int x = dsp_stream_set_position(in, pos);
-        free(pos);
         if(x >= 0 && x < in->len)
             stream->buf[y] = delegate(stream->buf[y], in->buf[x]);
     }
-    return NULL;
 }
 
 void dsp_stream_sum(dsp_stream_p in, dsp_stream_p str)
 {
     dsp_stream_p stream = dsp_stream_copy(in);
     stream->parent = str;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].delegate = stack_delegate_sum;
-        pthread_create(&th[y], NULL, dsp_stream_stack_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_stream_stack_arguments arguments = { stream, stack_delegate_sum };
+    dsp_parallel_for(stream->len, dsp_stream_stack_th, &arguments);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -822,22 +762,8 @@ void dsp_stream_multiply(dsp_stream_p in, dsp_stream_p str)
 {
     dsp_stream_p stream = dsp_stream_copy(in);
     stream->parent = str;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].delegate = stack_delegate_multiply;
-        pthread_create(&th[y], NULL, dsp_stream_stack_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_stream_stack_arguments arguments = { stream, stack_delegate_multiply };
+    dsp_parallel_for(stream->len, dsp_stream_stack_th, &arguments);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -847,22 +773,8 @@ void dsp_stream_subtract(dsp_stream_p in, dsp_stream_p str)
 {
     dsp_stream_p stream = dsp_stream_copy(in);
     stream->parent = str;
-    size_t y;
-    pthread_t *th = (pthread_t*)malloc(sizeof(pthread_t)*dsp_max_threads(0));
-    struct {
-       int cur_th;
-       dsp_stream_p stream;
-       double(*delegate)(double, double);
-    } thread_arguments[dsp_max_threads(0)];
-    for(y = 0; y < dsp_max_threads(0); y++) {
-        thread_arguments[y].cur_th = y;
-        thread_arguments[y].stream = stream;
-        thread_arguments[y].delegate = stack_delegate_subtraction;
-        pthread_create(&th[y], NULL, dsp_stream_stack_th, &thread_arguments[y]);
-    }
-    for(y = 0; y < dsp_max_threads(0); y++)
-        pthread_join(th[y], NULL);
-    free(th);
+    dsp_stream_stack_arguments arguments = { stream, stack_delegate_subtraction };
+    dsp_parallel_for(stream->len, dsp_stream_stack_th, &arguments);
     dsp_buffer_copy(stream->buf, in->buf, stream->len);
     dsp_stream_free_buffer(stream);
     dsp_stream_free(stream);
@@ -89,14 +89,25 @@ bool Convolution::ISNewBLOB(const char *dev, const char *name, int sizes[], int
 }
 
 bool Convolution::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per_sample)
+{
+    Frame frame(buf, dims, sizes, bits_per_sample);
+    return processFrame(&frame);
+}
+
+bool Convolution::processFrame(Frame *frame)
 {
     if(!PluginActive) return false;
     if(!matrix_loaded) return false;
-    setStream(buf, dims, sizes, bits_per_sample);
-    dsp_fourier_dft(stream, 1);
-    dsp_fourier_dft(matrix, 1);
-    dsp_convolution_convolution(stream, matrix);
-    return Interface::processBLOB(getStream(), stream->dims, stream->sizes, bits_per_sample);
+    if(!setStream(frame->getStream())) return false;
+    double min = dsp_stats_min(stream->buf, stream->len);
+    double max = dsp_stats_max(stream->buf, stream->len);
+    if(dsp_convolution_filter(stream, matrix, DSP_CONVOLUTION_AUTO) < 0)
+    {
+        LOGF_ERROR("Matrix dimensions (%d) do not match the frame dimensions (%d)", matrix->dims, stream->dims);
+        return false;
+    }
+    dsp_buffer_stretch(stream->buf, stream->len, min, max);
+    return sendStream(stream, frame->getBPS());
 }
 
 Wavelets::Wavelets(INDI::DefaultDevice *dev) : Interface(dev, DSP_WAVELETS, "WAVELETS", "Wavelets")
@@ -140,16 +151,23 @@ bool Wavelets::ISNewNumber(const char *dev, const char *name, double *values, ch
 }
 
 bool Wavelets::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per_sample)
+{
+    Frame frame(buf, dims, sizes, bits_per_sample);
+    return processFrame(&frame);
+}
+
+bool Wavelets::processFrame(Frame *frame)
 {
     if(!PluginActive) return false;
-    setStream(buf, dims, sizes, bits_per_sample);
-    double min = dsp_stats_min(stream->buf, stream->len);
-    double max = dsp_stats_max(stream->buf, stream->len);
-    dsp_stream_p out = dsp_stream_copy(stream);
+    dsp_stream_p in = frame->getStream();
+    // the layers are added to the copy of the input
+    if(!setStream(in)) return false;
+    double min = dsp_stats_min(in->buf, in->len);
+    double max = dsp_stats_max(in->buf, in->len);
     for (int i = 0; i < WaveletsNP.nnp; i++)
     {
         int size = (i + 1) * 3;
-        dsp_stream_p tmp = dsp_stream_copy(stream);
+        dsp_stream_p tmp = dsp_stream_copy(in);
         dsp_stream_p matrix = dsp_stream_new();
         dsp_stream_add_dim(matrix, size);
         dsp_stream_add_dim(matrix, size);
@@ -162,21 +180,19 @@ bool Wavelets::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per
                                             (y) * M_PI / static_cast<double>(size));
             }
         }
-        dsp_fourier_dft(tmp, 1);
-        dsp_fourier_dft(matrix, 1);
-        dsp_convolution_convolution(tmp, matrix);
-        dsp_buffer_sub(tmp, matrix->buf, matrix->len);
-        dsp_buffer_mul1(tmp, WaveletsNP.np[i].value / 8.0);
-        dsp_buffer_sum(out, tmp->buf, tmp->len);
-        dsp_buffer_normalize(tmp->buf, min, max, tmp->len);
+        // the separable kernel is smoothed in two one dimensional passes
+        dsp_buffer_div1(matrix, dsp_stats_val_sum(matrix->buf, matrix->len));
+        dsp_convolution_filter(tmp, matrix, DSP_CONVOLUTION_AUTO);
+        // detail layer: the frame minus its smoothed copy
+        dsp_buffer_sub(tmp, in->buf, in->len);
+        dsp_buffer_mul1(tmp, -WaveletsNP.np[i].value / 8.0);
+        dsp_buffer_sum(stream, tmp->buf, tmp->len);
         dsp_stream_free_buffer(matrix);
         dsp_stream_free(matrix);
         dsp_stream_free_buffer(tmp);
         dsp_stream_free(tmp);
     }
-    dsp_stream_free_buffer(stream);
-    dsp_stream_free(stream);
-    stream = dsp_stream_copy(out);
-    return Interface::processBLOB(getStream(), stream->dims, stream->sizes, bits_per_sample);
+    dsp_buffer_normalize(stream->buf, stream->len, min, max);
+    return sendStream(stream, frame->getBPS());
 }
 }
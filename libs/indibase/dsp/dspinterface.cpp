@@ -26,6 +26,7 @@
 #include "indicom.h"
 #include "libastro.h"
 #include "indiutility.h"
+#include "sharedblob.h"
 
 #include <fitsio.h>
 
@@ -45,6 +46,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <mutex>
 
 static std::string regex_replace_compat(const std::string &input, const std::string &pattern, const std::string &replace)
 {
@@ -191,20 +193,29 @@ uint8_t* Interface::Callback(uint8_t* buf, uint32_t ndims, int* dims, int bits_p
     return nullptr;
 }
 
+// plugins run concurrently, while FITS writing switches the process locale
+static std::mutex uploadMutex;
+
+bool Interface::getUploadMode(bool &sendCapture, bool &saveCapture)
+{
+    sendCapture = (m_Device->getSwitch("UPLOAD_MODE")[0].getState() == ISS_ON
+                   || m_Device->getSwitch("UPLOAD_MODE")[2].getState() == ISS_ON);
+    saveCapture = (m_Device->getSwitch("UPLOAD_MODE")[1].getState() == ISS_ON
+                   || m_Device->getSwitch("UPLOAD_MODE")[2].getState() == ISS_ON);
+    return sendCapture || saveCapture;
+}
+
 bool Interface::processBLOB(uint8_t* buffer, uint32_t ndims, int* dims, int bits_per_sample)
 {
     bool success = false;
     if(PluginActive)
     {
-        bool sendCapture = (m_Device->getSwitch("UPLOAD_MODE")[0].getState() == ISS_ON
-                            || m_Device->getSwitch("UPLOAD_MODE")[2].getState() == ISS_ON);
-        bool saveCapture = (m_Device->getSwitch("UPLOAD_MODE")[1].getState() == ISS_ON
-                            || m_Device->getSwitch("UPLOAD_MODE")[2].getState() == ISS_ON);
-
-        if (sendCapture || saveCapture)
+        bool sendCapture, saveCapture;
+        if (getUploadMode(sendCapture, saveCapture))
         {
             if (buffer)
             {
+                std::lock_guard<std::mutex> lock(uploadMutex);
                 setSizes(ndims, dims);
                 setBPS(bits_per_sample);
                 LOGF_INFO("%s processing done.", m_Label);
@@ -216,7 +227,7 @@ bool Interface::processBLOB(uint8_t* buffer, uint32_t ndims, int* dims, int bits
 
                 if (!strcmp(captureExtention, "fits"))
                 {
-                    success = sendFITS(buffer, sendCapture, saveCapture);
+                    success = sendFITS(buffer, false, sendCapture, saveCapture);
                 }
                 else
                 {
@@ -228,6 +239,64 @@ bool Interface::processBLOB(uint8_t* buffer, uint32_t ndims, int* dims, int bits
     return success;
 }
 
+bool Interface::sendStream(dsp_stream_p out, int bits_per_sample)
+{
+    if (!PluginActive || out == nullptr || out->buf == nullptr)
+        return false;
+    bool sendCapture, saveCapture;
+    if (!getUploadMode(sendCapture, saveCapture))
+        return false;
+
+    std::lock_guard<std::mutex> lock(uploadMutex);
+    setSizes(out->dims, out->sizes);
+    setBPS(bits_per_sample);
+    LOGF_INFO("%s processing done.", m_Label);
+
+    if (!strcmp(captureExtention, "fits"))
+        return sendFITS(out->buf, true, sendCapture, saveCapture);
+
+    size_t len = static_cast<size_t>(out->len) * abs(bits_per_sample) / 8;
+    void *blob = IDSharedBlobAlloc(len);
+    if (blob == nullptr)
+    {
+        LOGF_ERROR("Error: failed to allocate memory: %lu", len);
+        return false;
+    }
+    switch (bits_per_sample)
+    {
+        case 8:
+            dsp_buffer_copy(out->buf, (static_cast<uint8_t *>(blob)), out->len);
+            break;
+        case 16:
+            dsp_buffer_copy(out->buf, (static_cast<uint16_t *>(blob)), out->len);
+            break;
+        case 32:
+            dsp_buffer_copy(out->buf, (static_cast<uint32_t *>(blob)), out->len);
+            break;
+        case 64:
+            dsp_buffer_copy(out->buf, (static_cast<unsigned long *>(blob)), out->len);
+            break;
+        case -32:
+            dsp_buffer_copy(out->buf, (static_cast<float *>(blob)), out->len);
+            break;
+        case -64:
+            dsp_buffer_copy(out->buf, (static_cast<double *>(blob)), out->len);
+            break;
+        default:
+            DEBUGF(INDI::Logger::DBG_ERROR, "Unsupported bits per sample value %d", bits_per_sample);
+            IDSharedBlobFree(blob);
+            return false;
+    }
+    bool success = uploadFile(blob, len, sendCapture, saveCapture, captureExtention);
+    IDSharedBlobFree(blob);
+    return success;
+}
+
+bool Interface::processFrame(Frame *frame)
+{
+    return processBLOB(frame->getBuffer(), frame->getDims(), frame->getSizes(), frame->getBPS());
+}
+
 void Interface::Activated()
 {
     m_Device->defineProperty(&FitsBP);
@@ -369,7 +438,7 @@ dsp_stream_p Interface::loadFITS(char* buffer, int len)
     return loaded_stream;
 }
 
-bool Interface::sendFITS(uint8_t *buf, bool sendCapture, bool saveCapture)
+bool Interface::sendFITS(const void *buf, bool dspSamples, bool sendCapture, bool saveCapture)
 {
     int img_type  = USHORT_IMG;
     int byte_type = TUSHORT;
@@ -429,23 +498,31 @@ bool Interface::sendFITS(uint8_t *buf, bool sendCapture, bool saveCapture)
         naxes[i] = BufferSizes[i];
     char error_status[MAXINDINAME];
 
-    //  Now we have to send fits format data to the client
-    memsize = 5760;
-    memptr  = malloc(memsize);
+    // stream samples are converted by cfitsio while writing, no intermediate buffer of the output type
+    if (dspSamples)
+        byte_type = sizeof(dsp_t) == sizeof(double) ? TDOUBLE : TFLOAT;
+
+    //  Now we have to send fits format data to the client, in a shared buffer allocated for the whole file.
+    //  8640 = 2880 * 3 which is sufficient for most headers, the file size is kept in memsize as it grows.
+    size_t allocated = 8640 + nelements * (abs(getBPS()) / 8);
+    memsize = 2880;
+    memptr  = IDSharedBlobAlloc(allocated);
     if (!memptr)
     {
-        LOGF_ERROR("Error: failed to allocate memory: %lu", memsize);
+        LOGF_ERROR("Error: failed to allocate memory: %lu", allocated);
+        free(naxes);
         return false;
     }
 
-    fits_create_memfile(&fptr, &memptr, &memsize, 2880, realloc, &status);
+    fits_create_memfile(&fptr, &memptr, &memsize, 2880, IDSharedBlobRealloc, &status);
 
     if (status)
     {
         fits_report_error(stderr, status); /* print out any error messages */
         fits_get_errstatus(status, error_status);
         fits_close_file(fptr, &status);
-        free(memptr);
+        IDSharedBlobFree(memptr);
+        free(naxes);
         LOGF_ERROR("FITS Error: %s", error_status);
         return false;
     }
@@ -457,7 +534,8 @@ bool Interface::sendFITS(uint8_t *buf, bool sendCapture, bool saveCapture)
         fits_report_error(stderr, status); /* print out any error messages */
         fits_get_errstatus(status, error_status);
         fits_close_file(fptr, &status);
-        free(memptr);
+        IDSharedBlobFree(memptr);
+        free(naxes);
         LOGF_ERROR("FITS Error: %s", error_status);
         return false;
     }
@@ -466,21 +544,31 @@ bool Interface::sendFITS(uint8_t *buf, bool sendCapture, bool saveCapture)
 
     fits_write_img(fptr, byte_type, 1, nelements, buf, &status);
 
+    // Samples out of range of the image type, like the DC term of a magnitude, are clipped
+    if (status == NUM_OVERFLOW)
+    {
+        LOG_DEBUG("FITS samples out of range were clipped.");
+        status = 0;
+    }
+
     if (status)
     {
         fits_report_error(stderr, status); /* print out any error messages */
         fits_get_errstatus(status, error_status);
         fits_close_file(fptr, &status);
-        free(memptr);
+        IDSharedBlobFree(memptr);
+        free(naxes);
         LOGF_ERROR("FITS Error: %s", error_status);
         return false;
     }
     fits_close_file(fptr, &status);
 
-    uploadFile(memptr, memsize, sendCapture, saveCapture, captureExtention);
+    free(naxes);
 
-    free(memptr);
-    return true;
+    bool uploaded = uploadFile(memptr, memsize, sendCapture, saveCapture, captureExtention);
+
+    IDSharedBlobFree(memptr);
+    return uploaded;
 }
 
 bool Interface::uploadFile(const void *fitsData, size_t totalBytes, bool sendCapture, bool saveCapture, const char* format)
@@ -662,6 +750,15 @@ bool Interface::setStream(void *buf, uint32_t dims, int *sizes, int bits_per_sam
     return true;
 }
 
+bool Interface::setStream(dsp_stream_p in)
+{
+    if(in == nullptr) return false;
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+    stream = dsp_stream_copy(in);
+    return true;
+}
+
 bool Interface::setMagnitude(void *buf, uint32_t dims, int *sizes, int bits_per_sample)
 {
     if(stream == nullptr) return false;
@@ -745,9 +842,9 @@ bool Interface::setReal(void *buf, uint32_t dims, int *sizes, int bits_per_sampl
     for(uint32_t d = 0; d < dims; d++)
         if(sizes[d] != stream->sizes[d]) return false;
     if(stream->dft.buf == nullptr)
-        stream->dft.buf = (double*)malloc(sizeof(double) * stream->len * 2);
+        stream->dft.buf = (dsp_t*)malloc(sizeof(dsp_t) * stream->len * 2);
     else
-        stream->dft.buf = (double*)realloc(stream->dft.buf, sizeof(double) * stream->len * 2);
+        stream->dft.buf = (dsp_t*)realloc(stream->dft.buf, sizeof(dsp_t) * stream->len * 2);
     switch (bits_per_sample)
     {
         case 8:
@@ -781,31 +878,31 @@ bool Interface::setImaginary(void *buf, uint32_t dims, int *sizes, int bits_per_
     for(uint32_t d = 0; d < dims; d++)
         if(sizes[d] != stream->sizes[d]) return false;
     if(stream->dft.buf == nullptr)
-        stream->dft.buf = (double*)malloc(sizeof(double) * stream->len * 2);
+        stream->dft.buf = (dsp_t*)malloc(sizeof(dsp_t) * stream->len * 2);
     else
-        stream->dft.buf = (double*)realloc(stream->dft.buf, sizeof(double) * stream->len * 2);
+        stream->dft.buf = (dsp_t*)realloc(stream->dft.buf, sizeof(dsp_t) * stream->len * 2);
     switch (bits_per_sample)
     {
         case 8:
-            dsp_buffer_copy_stepping((static_cast<uint8_t *>(buf)), ((double*)&stream->dft.buf[1]), stream->len, stream->len * 2, 1, 2);
+            dsp_buffer_copy_stepping((static_cast<uint8_t *>(buf)), (&stream->dft.buf[1]), stream->len, stream->len * 2, 1, 2);
             break;
         case 16:
-            dsp_buffer_copy_stepping((static_cast<uint16_t *>(buf)), ((double*)&stream->dft.buf[1]), stream->len, stream->len * 2, 1,
+            dsp_buffer_copy_stepping((static_cast<uint16_t *>(buf)), (&stream->dft.buf[1]), stream->len, stream->len * 2, 1,
                                      2);
             break;
         case 32:
-            dsp_buffer_copy_stepping((static_cast<uint32_t *>(buf)), ((double*)&stream->dft.buf[1]), stream->len, stream->len * 2, 1,
+            dsp_buffer_copy_stepping((static_cast<uint32_t *>(buf)), (&stream->dft.buf[1]), stream->len, stream->len * 2, 1,
                                      2);
             break;
         case 64:
-            dsp_buffer_copy_stepping((static_cast<unsigned long *>(buf)), ((double*)&stream->dft.buf[1]), stream->len, stream->len * 2,
+            dsp_buffer_copy_stepping((static_cast<unsigned long *>(buf)), (&stream->dft.buf[1]), stream->len, stream->len * 2,
                                      1, 2);
             break;
         case -32:
-            dsp_buffer_copy_stepping((static_cast<float *>(buf)), ((double*)&stream->dft.buf[1]), stream->len, stream->len * 2, 1, 2);
+            dsp_buffer_copy_stepping((static_cast<float *>(buf)), (&stream->dft.buf[1]), stream->len, stream->len * 2, 1, 2);
             break;
         case -64:
-            dsp_buffer_copy_stepping((static_cast<double *>(buf)), ((double*)&stream->dft.buf[1]), stream->len, stream->len * 2, 1, 2);
+            dsp_buffer_copy_stepping((static_cast<double *>(buf)), (&stream->dft.buf[1]), stream->len, stream->len * 2, 1, 2);
             break;
         default:
             return false;
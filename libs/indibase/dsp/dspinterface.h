@@ -22,6 +22,7 @@
 
 #include "indidevapi.h"
 #include "dsp.h"
+#include "frame.h"
 
 #include <fitsio.h>
 #include <functional>
@@ -99,6 +100,23 @@ class Interface
          */
         virtual bool processBLOB(uint8_t* buf, uint32_t ndims, int* dims, int bits_per_sample);
 
+        /**
+         * @brief processFrame Process a frame shared with the other plugins, called by DSP::Manager.
+         * The default implementation passes the input buffer of the frame to processBLOB.
+         * Plugins overriding it must not modify the streams of the frame and may run concurrently with other plugins.
+         * @param frame The frame to process
+         * @return True if successful, false otherwise.
+         */
+        virtual bool processFrame(Frame *frame);
+
+        /**
+         * @brief isActive True if the plugin was activated by the client.
+         */
+        bool isActive() const
+        {
+            return PluginActive;
+        }
+
         /**
          * @brief setSizes Set the returned file dimensions and corresponding sizes.
          * @param num Number of dimensions.
@@ -175,7 +193,7 @@ class Interface
          */
         dsp_stream_p loadFITS(char* buf, int len);
 
-        bool PluginActive;
+        bool PluginActive { false };
 
         IBLOBVectorProperty FitsBP;
         IBLOB FitsB;
@@ -200,6 +218,17 @@ class Interface
         const char *m_Label {  nullptr };
         Type m_Type {  DSP_NONE };
         bool setStream(void *buf, uint32_t dims, int *sizes, int bits_per_sample);
+        bool setStream(dsp_stream_p in);
+
+        /**
+         * @brief sendStream Send and save a result stream, propagated as by processBLOB.
+         * The samples are converted once, straight into a shared BLOB buffer sized for the whole file,
+         * without the intermediate buffers of getStream() and processBLOB.
+         * @param out The stream to send, not modified and may be shared
+         * @param bits_per_sample Bit depth of the samples of the BLOB
+         * @return True if successful, false otherwise.
+         */
+        bool sendStream(dsp_stream_p out, int bits_per_sample);
         bool setMagnitude(void *buf, uint32_t dims, int *sizes, int bits_per_sample);
         bool setPhase(void *buf, uint32_t dims, int *sizes, int bits_per_sample);
         bool setReal(void *buf, uint32_t dims, int *sizes, int bits_per_sample);
@@ -221,7 +250,8 @@ class Interface
 
         void fits_update_key_s(fitsfile *fptr, int type, std::string name, void *p, std::string explanation, int *status);
         void addFITSKeywords(fitsfile *fptr);
-        bool sendFITS(uint8_t *buf, bool sendCapture, bool saveCapture);
+        bool getUploadMode(bool &sendCapture, bool &saveCapture);
+        bool sendFITS(const void *buf, bool dspSamples, bool sendCapture, bool saveCapture);
         bool uploadFile(const void *fitsData, size_t totalBytes, bool sendIntegration, bool saveIntegration, const char* format);
         int getFileIndex(const char *dir, const char *prefix, const char *ext);
 };
@@ -0,0 +1,124 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    DSP frame processing context
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "frame.h"
+
+#include <cstdlib>
+
+namespace DSP
+{
+
+Frame::Frame(uint8_t *buf, uint32_t dims, int *sizes, int bits_per_sample) : m_Buffer(buf), m_Dims(dims),
+    m_Sizes(sizes), m_BPS(bits_per_sample)
+{
+    switch (bits_per_sample)
+    {
+        case 8:
+        case 16:
+        case 32:
+        case 64:
+        case -32:
+        case -64:
+            m_Valid = true;
+            break;
+        default:
+            break;
+    }
+}
+
+Frame::~Frame()
+{
+    if (m_Fourier != nullptr)
+    {
+        dsp_stream_free_buffer(m_Fourier);
+        dsp_stream_free(m_Fourier);
+    }
+    if (m_Stream != nullptr)
+    {
+        if (m_Wrapped)
+            m_Stream->buf = nullptr;
+        dsp_stream_free_buffer(m_Stream);
+        dsp_stream_free(m_Stream);
+    }
+}
+
+dsp_stream_p Frame::getStream()
+{
+    if (!m_Valid)
+        return nullptr;
+    std::call_once(m_StreamOnce, [this]()
+    {
+        dsp_stream_p converted = dsp_stream_new();
+        for (uint32_t dim = 0; dim < m_Dims; dim++)
+            dsp_stream_add_dim(converted, m_Sizes[dim]);
+        if (m_BPS == sampleBits<dsp_t>())
+        {
+            // the samples are already dsp_t, the stream reads them in place,
+            // it still owns the companion buffers read by dsp_stream_copy and the transforms
+            dsp_stream_set_buffer(converted, m_Buffer, converted->len);
+            converted->dft.buf = static_cast<dsp_t*>(malloc(sizeof(dsp_t) * converted->len * 2));
+            converted->location = static_cast<dsp_location*>(realloc(converted->location, sizeof(dsp_location) * converted->len));
+            m_Wrapped = true;
+            m_Stream = converted;
+            return;
+        }
+        dsp_stream_alloc_buffer(converted, converted->len);
+        switch (m_BPS)
+        {
+            case 8:
+                dsp_buffer_copy((static_cast<uint8_t *>(m_Buffer)), converted->buf, converted->len);
+                break;
+            case 16:
+                dsp_buffer_copy((reinterpret_cast<uint16_t *>(m_Buffer)), converted->buf, converted->len);
+                break;
+            case 32:
+                dsp_buffer_copy((reinterpret_cast<uint32_t *>(m_Buffer)), converted->buf, converted->len);
+                break;
+            case 64:
+                dsp_buffer_copy((reinterpret_cast<unsigned long *>(m_Buffer)), converted->buf, converted->len);
+                break;
+            case -32:
+                dsp_buffer_copy((reinterpret_cast<float *>(m_Buffer)), converted->buf, converted->len);
+                break;
+            case -64:
+                dsp_buffer_copy((reinterpret_cast<double *>(m_Buffer)), converted->buf, converted->len);
+                break;
+        }
+        m_Stream = converted;
+    });
+    return m_Stream;
+}
+
+dsp_stream_p Frame::getFourier()
+{
+    dsp_stream_p stream = getStream();
+    if (stream == nullptr)
+        return nullptr;
+    std::call_once(m_FourierOnce, [this, stream]()
+    {
+        // transformed on a copy, the plugins keep reading the input meanwhile
+        dsp_stream_p fourier = dsp_stream_copy(stream);
+        dsp_fourier_dft(fourier, 1);
+        m_Fourier = fourier;
+    });
+    return m_Fourier;
+}
+}
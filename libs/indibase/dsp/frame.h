@@ -0,0 +1,128 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    DSP frame processing context
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include "dsp.h"
+
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+
+namespace DSP
+{
+/**
+ * @brief The Frame class holds the results shared by the DSP plugins processing the same frame.
+ *
+ * The input buffer is read in place through getView(), converted into a dsp_stream the first time a plugin
+ * requests it and transformed the first time a plugin requests the forward Fourier transform. Input buffers
+ * already holding dsp_t samples are wrapped by the stream without any copy. The stream and the transform are
+ * read only for the plugins, which copy them before any change.
+ * All methods are safe to call from the concurrent plugins of DSP::Manager.
+ */
+class Frame
+{
+    public:
+        /**
+         * @param buf The input buffer, must outlive the frame
+         * @param dims Number of the dimensions of the input buffer
+         * @param sizes Sizes of the dimensions of the input buffer
+         * @param bits_per_sample Bit depth of the input buffer, negative for floating point samples
+         */
+        Frame(uint8_t *buf, uint32_t dims, int *sizes, int bits_per_sample);
+        ~Frame();
+
+        Frame(const Frame &) = delete;
+        Frame &operator=(const Frame &) = delete;
+
+        uint8_t *getBuffer() const
+        {
+            return m_Buffer;
+        }
+        uint32_t getDims() const
+        {
+            return m_Dims;
+        }
+        int *getSizes() const
+        {
+            return m_Sizes;
+        }
+        int getBPS() const
+        {
+            return m_BPS;
+        }
+
+        /**
+         * @brief isValid False if the bit depth of the input buffer is not supported.
+         */
+        bool isValid() const
+        {
+            return m_Valid;
+        }
+
+        /**
+         * @brief getView The input buffer read in place as samples of type T.
+         * @return The input buffer, nullptr if the samples of the input are not of type T.
+         */
+        template <typename T>
+        const T *getView() const
+        {
+            if (!m_Valid || sampleBits<T>() != m_BPS)
+                return nullptr;
+            return reinterpret_cast<const T *>(m_Buffer);
+        }
+
+        /**
+         * @brief getStream The input buffer as a dsp_stream, converted on the first call.
+         * @return The shared stream, nullptr if the frame is not valid.
+         */
+        dsp_stream_p getStream();
+
+        /**
+         * @brief getFourier The forward Fourier transform of the input, computed on the first call.
+         * @return The shared stream holding the transform, with magnitude and phase streams, nullptr if the frame is not valid.
+         */
+        dsp_stream_p getFourier();
+
+        /**
+         * @brief sampleBits The bits per sample value of the samples of type T, negative for floating point types.
+         */
+        template <typename T>
+        static constexpr int sampleBits()
+        {
+            return std::is_floating_point<T>::value ? -static_cast<int>(sizeof(T) * 8) : static_cast<int>(sizeof(T) * 8);
+        }
+
+    private:
+        uint8_t *m_Buffer { nullptr };
+        uint32_t m_Dims { 0 };
+        int *m_Sizes { nullptr };
+        int m_BPS { 0 };
+        bool m_Valid { false };
+        // the stream buffer is the input buffer
+        bool m_Wrapped { false };
+
+        dsp_stream_p m_Stream { nullptr };
+        std::once_flag m_StreamOnce;
+        dsp_stream_p m_Fourier { nullptr };
+        std::once_flag m_FourierOnce;
+};
+}
@@ -26,8 +26,8 @@
 #include <cerrno>
 #include <cstring>
 #include <algorithm>
-#include <thread>
 #include <chrono>
+#include <vector>
 
 namespace DSP
 {
@@ -130,14 +130,36 @@ bool Manager::saveConfigItems(FILE *fp)
 
 bool Manager::processBLOB(uint8_t* buf, uint32_t ndims, int* dims, int bits_per_sample)
 {
-    bool r = false;
-    r |= convolution->processBLOB(buf, ndims, dims, bits_per_sample);
-    r |= dft->processBLOB(buf, ndims, dims, bits_per_sample);
-    r |= idft->processBLOB(buf, ndims, dims, bits_per_sample);
-    r |= spectrum->processBLOB(buf, ndims, dims, bits_per_sample);
-    r |= histogram->processBLOB(buf, ndims, dims, bits_per_sample);
-    r |= wavelets->processBLOB(buf, ndims, dims, bits_per_sample);
-    return r;
+    std::vector<Interface*> active;
+    for (Interface *plugin : std::initializer_list<Interface*> { convolution, dft, idft, spectrum, histogram, wavelets })
+    {
+        if (plugin->isActive())
+            active.push_back(plugin);
+    }
+    if (active.empty())
+        return false;
+
+    // The input is converted once and its transform computed once, by the first plugin needing it
+    Frame frame(buf, ndims, dims, bits_per_sample);
+    if (!frame.isValid())
+        return false;
+
+    // The plugins only read the frame, they run in parallel on the libdsp worker pool, which has a thread per
+    // processor unless dsp_max_threads limits it, or serially on the caller if the pool is busy with another loop.
+    // The libdsp loops nested in the plugins then run serially on their plugin's thread.
+    // A single active plugin runs on the caller and its loops use the pool.
+    std::vector<char> results(active.size(), false);
+    auto process = [&](int start, int end)
+    {
+        for (int i = start; i < end; i++)
+            results[i] = active[i]->processFrame(&frame);
+    };
+    dsp_parallel_for(static_cast<int>(active.size()), [](void *arg, int start, int end)
+    {
+        (*static_cast<decltype(process) *>(arg))(start, end);
+    }, &process);
+
+    return std::find(results.begin(), results.end(), true) != results.end();
 }
 void Manager::setCaptureFileExtension(const char *ext)
 {
@@ -41,12 +41,19 @@ FourierTransform::~FourierTransform()
 }
 
 bool FourierTransform::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per_sample)
+{
+    Frame frame(buf, dims, sizes, bits_per_sample);
+    return processFrame(&frame);
+}
+
+bool FourierTransform::processFrame(Frame *frame)
 {
     if(!PluginActive) return false;
-    setStream(buf, dims, sizes, bits_per_sample);
+    dsp_stream_p fourier = frame->getFourier();
+    if(fourier == nullptr) return false;
 
-    dsp_fourier_dft(stream, 1);
-    return Interface::processBLOB(getMagnitude(), stream->magnitude->dims, stream->magnitude->sizes, bits_per_sample);
+    // the magnitude is owned by the frame, it is sent without copying it
+    return sendStream(fourier->magnitude, frame->getBPS());
 }
 
 InverseFourierTransform::InverseFourierTransform(INDI::DefaultDevice *dev) : Interface(dev, DSP_IDFT, "IDFT", "IDFT")
@@ -72,19 +79,27 @@ void InverseFourierTransform::Deactivated()
 }
 
 bool InverseFourierTransform::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per_sample)
+{
+    Frame frame(buf, dims, sizes, bits_per_sample);
+    return processFrame(&frame);
+}
+
+bool InverseFourierTransform::processFrame(Frame *frame)
 {
     if(!PluginActive) return false;
     if(!phase_loaded) return false;
-    setStream(buf, dims, sizes, bits_per_sample);
+    dsp_stream_p in = frame->getStream();
+    if(!setStream(in)) return false;
     if (phase->dims != stream->dims) return false;
     for (int d = 0; d < stream->dims; d++)
         if (phase->sizes[d] != stream->sizes[d])
             return false;
-    setMagnitude(buf, dims, sizes, bits_per_sample);
-    stream->phase = phase;
+    // the input is the magnitude, the stream owns copies as they are freed with it
+    stream->magnitude = dsp_stream_copy(in);
+    stream->phase = dsp_stream_copy(phase);
     dsp_buffer_set(stream->buf, stream->len, 0);
     dsp_fourier_idft(stream);
-    return Interface::processBLOB(getStream(), stream->dims, stream->sizes, bits_per_sample);
+    return sendStream(stream, frame->getBPS());
 }
 
 bool InverseFourierTransform::ISNewBLOB(const char *dev, const char *name, int sizes[], int blobsizes[], char *blobs[],
@@ -122,13 +137,22 @@ Spectrum::~Spectrum()
 }
 
 bool Spectrum::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per_sample)
+{
+    Frame frame(buf, dims, sizes, bits_per_sample);
+    return processFrame(&frame);
+}
+
+bool Spectrum::processFrame(Frame *frame)
 {
     if(!PluginActive) return false;
-    setStream(buf, dims, sizes, bits_per_sample);
+    dsp_stream_p fourier = frame->getFourier();
+    if(fourier == nullptr) return false;
 
-    dsp_fourier_dft(stream, 1);
-    double *histo = dsp_stats_histogram(stream->magnitude, 4096);
-    return Interface::processBLOB(static_cast<uint8_t*>(static_cast<void*>(histo)), 1, new int{4096}, -64);
+    int size = 4096;
+    double *histo = dsp_stats_histogram(fourier->magnitude, size);
+    bool success = Interface::processBLOB(static_cast<uint8_t*>(static_cast<void*>(histo)), 1, &size, -64);
+    free(histo);
+    return success;
 }
 
 
@@ -141,11 +165,20 @@ Histogram::~Histogram()
 }
 
 bool Histogram::processBLOB(uint8_t *buf, uint32_t dims, int *sizes, int bits_per_sample)
+{
+    Frame frame(buf, dims, sizes, bits_per_sample);
+    return processFrame(&frame);
+}
+
+bool Histogram::processFrame(Frame *frame)
 {
     if(!PluginActive) return false;
-    setStream(buf, dims, sizes, bits_per_sample);
+    if(!frame->isValid()) return false;
 
-    double *histo = dsp_stats_histogram(stream, 4096);
-    return Interface::processBLOB(static_cast<uint8_t*>(static_cast<void*>(histo)), 1, new int{4096}, -64);
+    int size = 4096;
+    double *histo = dsp_stats_histogram(frame->getStream(), size);
+    bool success = Interface::processBLOB(static_cast<uint8_t*>(static_cast<void*>(histo)), 1, &size, -64);
+    free(histo);
+    return success;
 }
 }
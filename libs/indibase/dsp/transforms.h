@@ -32,6 +32,7 @@ class FourierTransform : public Interface
     public:
         FourierTransform(INDI::DefaultDevice *dev);
         virtual bool processBLOB(uint8_t *out, uint32_t dims, int *sizes, int bits_per_sample) override;
+        virtual bool processFrame(Frame *frame) override;
 
     protected:
         ~FourierTransform();
@@ -44,6 +45,7 @@ class InverseFourierTransform : public Interface
         bool ISNewBLOB(const char *dev, const char *name, int sizes[], int blobsizes[], char *blobs[], char *formats[],
                        char *names[], int n) override;
         virtual bool processBLOB(uint8_t *out, uint32_t dims, int *sizes, int bits_per_sample) override;
+        virtual bool processFrame(Frame *frame) override;
 
     protected:
         ~InverseFourierTransform();
@@ -63,6 +65,7 @@ class Spectrum : public Interface
     public:
         Spectrum(INDI::DefaultDevice *dev);
         virtual bool processBLOB(uint8_t *out, uint32_t dims, int *sizes, int bits_per_sample) override;
+        virtual bool processFrame(Frame *frame) override;
 
     protected:
         ~Spectrum();
@@ -73,6 +76,7 @@ class Histogram : public Interface
     public:
         Histogram(INDI::DefaultDevice *dev);
         virtual bool processBLOB(uint8_t *out, uint32_t dims, int *sizes, int bits_per_sample) override;
+        virtual bool processFrame(Frame *frame) override;
 
     protected:
         ~Histogram();
@@ -34,6 +34,7 @@
 #include <libnova/ln_types.h>
 #include <libnova/precession.h>
 
+#include <algorithm>
 #include <regex>
 
 #include <dirent.h>
@@ -78,6 +79,19 @@ SensorInterface::SensorInterface()
 
 SensorInterface::~SensorInterface()
 {
+    // The derived driver is already destroyed, so the queued integrations are discarded.
+    // Drivers upload them with waitIntegrationsComplete() in their own destructor.
+    {
+        std::lock_guard<std::mutex> lock(completionLock);
+        completionExit = true;
+        completionPending -= completionQueue.size();
+        completionQueue.clear();
+        completionReady.notify_one();
+        completionDone.notify_all();
+    }
+    if (completionThread.joinable())
+        completionThread.join();
+
     free(Buffer);
     BufferSize = 0;
     Buffer = nullptr;
@@ -753,7 +767,7 @@ void SensorInterface::fits_update_key_s(fitsfile *fptr, int type, std::string na
     fits_update_key(fptr, type, name.c_str(), p, const_cast<char *>(explanation.c_str()), status);
 }
 
-void* SensorInterface::sendFITS(uint8_t *buf, int len)
+void* SensorInterface::sendFITS(uint8_t *buf, int len, int bps)
 {
     bool sendIntegration = (UploadS[0].s == ISS_ON || UploadS[2].s == ISS_ON);
     bool saveIntegration = (UploadS[1].s == ISS_ON || UploadS[2].s == ISS_ON);
@@ -768,7 +782,7 @@ void* SensorInterface::sendFITS(uint8_t *buf, int len)
     int nelements = 0;
     std::string bit_depth;
     char error_status[MAXRBUF];
-    switch (getBPS())
+    switch (bps)
     {
         case 8:
             byte_type = TBYTE;
@@ -807,7 +821,7 @@ void* SensorInterface::sendFITS(uint8_t *buf, int len)
             break;
 
         default:
-            DEBUGF(Logger::DBG_ERROR, "Unsupported bits per sample value %d", getBPS());
+            DEBUGF(Logger::DBG_ERROR, "Unsupported bits per sample value %d", bps);
             return nullptr;
     }
     naxes[0] = len;
@@ -876,20 +890,97 @@ bool SensorInterface::IntegrationComplete()
     // Reset POLLMS to default value
     setCurrentPollingPeriod(getPollingPeriod());
 
-    if(HasDSP())
+    std::unique_lock<std::mutex> lock(completionLock);
+    if (!completionThread.joinable())
+        completionThread = std::thread(&SensorInterface::completionWorker, this);
+
+    // Backpressure, the worker itself never waits on its own queue
+    if (std::this_thread::get_id() != completionThread.get_id())
     {
-        uint8_t* buf = (uint8_t*)malloc(getBufferSize());
-        memcpy(buf, getBuffer(), getBufferSize());
-        DSP->processBLOB(buf, 1, new int[1] { getBufferSize() * 8 / getBPS() }, getBPS());
-        free(buf);
+        completionDone.wait(lock, [this]()
+        {
+            return completionPending < completionDepth;
+        });
     }
-    // Run async
-    std::thread(&SensorInterface::IntegrationCompletePrivate, this).detach();
+    completionPending++;
+
+    Completion completion;
+    if (!completionBuffers.empty())
+    {
+        completion.buffer.swap(completionBuffers.back());
+        completionBuffers.pop_back();
+    }
+    lock.unlock();
+
+    // The driver may reuse its buffer as soon as it is copied
+    completion.buffer.assign(getBuffer(), getBuffer() + getBufferSize());
+    completion.bps = getBPS();
+    completion.dsp = HasDSP();
+
+    lock.lock();
+    completionQueue.push_back(std::move(completion));
+    completionReady.notify_one();
 
     return true;
 }
 
-bool SensorInterface::IntegrationCompletePrivate()
+void SensorInterface::completionWorker()
+{
+    std::unique_lock<std::mutex> lock(completionLock);
+    while (true)
+    {
+        completionReady.wait(lock, [this]()
+        {
+            return completionExit || !completionQueue.empty();
+        });
+        if (completionExit)
+            return;
+
+        Completion completion = std::move(completionQueue.front());
+        completionQueue.pop_front();
+        lock.unlock();
+
+        int size = static_cast<int>(completion.buffer.size());
+        if (completion.dsp)
+        {
+            int dims[1] = { size * 8 / abs(completion.bps) };
+            DSP->processBLOB(completion.buffer.data(), 1, dims, completion.bps);
+        }
+        IntegrationCompletePrivate(completion.buffer.data(), size, completion.bps);
+
+        lock.lock();
+        if (completionBuffers.size() < completionDepth)
+            completionBuffers.push_back(std::move(completion.buffer));
+        completionPending--;
+        completionDone.notify_all();
+    }
+}
+
+void SensorInterface::setIntegrationQueueDepth(size_t depth)
+{
+    std::lock_guard<std::mutex> lock(completionLock);
+    completionDepth = std::max<size_t>(1, depth);
+    if (completionBuffers.size() > completionDepth)
+        completionBuffers.resize(completionDepth);
+    completionDone.notify_all();
+}
+
+size_t SensorInterface::getIntegrationQueueDepth()
+{
+    std::lock_guard<std::mutex> lock(completionLock);
+    return completionDepth;
+}
+
+void SensorInterface::waitIntegrationsComplete()
+{
+    std::unique_lock<std::mutex> lock(completionLock);
+    completionDone.wait(lock, [this]()
+    {
+        return completionPending == 0;
+    });
+}
+
+bool SensorInterface::IntegrationCompletePrivate(uint8_t *buf, int size, int bps)
 {
     bool sendIntegration = (UploadS[0].s == ISS_ON || UploadS[2].s == ISS_ON);
     bool saveIntegration = (UploadS[1].s == ISS_ON || UploadS[2].s == ISS_ON);
@@ -900,11 +991,11 @@ bool SensorInterface::IntegrationCompletePrivate()
         void* blob = nullptr;
         if (!strcmp(getIntegrationFileExtension(), "fits"))
         {
-            blob = sendFITS(getBuffer(), getBufferSize() * 8 / abs(getBPS()));
+            blob = sendFITS(buf, size * 8 / abs(bps), bps);
         }
         else
         {
-            uploadFile(getBuffer(), getBufferSize(), sendIntegration,
+            uploadFile(buf, size, sendIntegration,
                        saveIntegration);
         }
 
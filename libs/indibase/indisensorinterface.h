@@ -32,6 +32,9 @@
 #include <stdint.h>
 #include <mutex>
 #include <thread>
+#include <condition_variable>
+#include <deque>
+#include <vector>
 #include <stream/streammanager.h>
 #include <connectionplugins/connectionserial.h>
 #include <connectionplugins/connectiontcp.h>
@@ -296,6 +299,27 @@ class SensorInterface : public DefaultDevice
          */
         virtual bool IntegrationComplete();
 
+        /**
+         * @brief setIntegrationQueueDepth Set how many completed integrations may wait to be uploaded.
+         * IntegrationComplete copies the buffer and returns, the integrations are then processed and uploaded
+         * in order by a worker thread. Once depth integrations are pending, IntegrationComplete blocks until
+         * the oldest one is uploaded.
+         * @param depth number of pending integrations, at least 1. Defaults to 4.
+         */
+        void setIntegrationQueueDepth(size_t depth);
+
+        /**
+         * @return number of completed integrations that may wait to be uploaded.
+         */
+        size_t getIntegrationQueueDepth();
+
+        /**
+         * @brief waitIntegrationsComplete Wait until all the completed integrations are uploaded.
+         * The worker calls the virtual functions of the driver, so drivers must call it in their destructor,
+         * the integrations still queued when SensorInterface is destroyed are discarded.
+         */
+        void waitIntegrationsComplete();
+
         /** \brief perform handshake with device to check communication */
         virtual bool Handshake();
 
@@ -552,7 +576,26 @@ class SensorInterface : public DefaultDevice
         void getMinMax(double *min, double *max, uint8_t *buf, int len, int bpp);
         int getFileIndex(const char *dir, const char *prefix, const char *ext);
 
-        bool IntegrationCompletePrivate();
-        void* sendFITS(uint8_t* buf, int len);
+        bool IntegrationCompletePrivate(uint8_t *buf, int size, int bps);
+        void* sendFITS(uint8_t* buf, int len, int bps);
+
+        // Completed integrations, copied into recycled buffers and uploaded in order by the completion worker
+        struct Completion
+        {
+            std::vector<uint8_t> buffer;
+            int bps { 0 };
+            bool dsp { false };
+        };
+        void completionWorker();
+
+        std::deque<Completion> completionQueue;
+        std::vector<std::vector<uint8_t>> completionBuffers;
+        size_t completionDepth { 4 };
+        size_t completionPending { 0 };
+        bool completionExit { false };
+        std::mutex completionLock;
+        std::condition_variable completionReady;
+        std::condition_variable completionDone;
+        std::thread completionThread;
 };
 }
@@ -61,6 +61,7 @@
 #include "ccvt_types.h"
 //#include "indidevapi.h"
 #include "jpegutils.h"
+#include "dsp.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -71,6 +72,22 @@ static float RGBYUV04187[256], RGBYUV00813[256];
 
 void InitLookupTable(void);
 
+/* Frames of at least this many pixels are converted in strips of rows by the libdsp worker pool */
+#define CCVT_PARALLEL_PIXELS (512 * 1024)
+
+static void ccvt_rows(long rows, long pixels, dsp_parallel_func func, void *arg)
+{
+    if (pixels >= CCVT_PARALLEL_PIXELS)
+        dsp_parallel_for((int)rows, func, arg);
+    else
+        func(arg, 0, (int)rows);
+}
+
+static inline int ccvt_sat(int c)
+{
+    return c < 0 ? 0 : (c > 255 ? 255 : c);
+}
+
 /* YUYV: two Y's and one U/V */
 #if 0
 void ccvt_yuyv_rgb32(int width, int height, const void *src, void *dst)
@@ -78,467 +95,576 @@ void ccvt_yuyv_rgb32(int width, int height, const void *src, void *dst)
 }
 #endif
 
-void ccvt_yuyv_bgr32(int width, int height, const void *src, void *dst)
+struct ccvt_yuyv_rows
 {
-    const unsigned char *s;
-    PIXTYPE_bgr32 *d;
-    int l, c;
-    int r, g, b, cr, cg, cb, y1, y2;
-
-    l = height;
-    s = src;
-    d = dst;
-    while (l--)
+    int pairs;
+    const unsigned char *src;
+    unsigned char *dst;
+};
+
+/*
+ * One row of YUYV to pixels of size bytes, with red, green and blue at the given offsets. Inlined with constant
+ * offsets, the loop has no branch left and is vectorized by the compiler.
+ */
+static inline void ccvt_yuyv_row(const unsigned char *s, unsigned char *d, int pairs, int size, int r, int g, int b)
+{
+    int c;
+
+    for (c = 0; c < pairs; c++)
     {
-        c = width >> 1;
-        while (c--)
-        {
-            y1 = *s++;
-            cb = ((*s - 128) * 454) >> 8;
-            cg = (*s++ - 128) * 88;
-            y2 = *s++;
-            cr = ((*s - 128) * 359) >> 8;
-            cg = (cg + (*s++ - 128) * 183) >> 8;
-
-            r = y1 + cr;
-            b = y1 + cb;
-            g = y1 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-            r = y2 + cr;
-            b = y2 + cb;
-            g = y2 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-        }
+        int y1 = s[4 * c];
+        int u  = s[4 * c + 1] - 128;
+        int y2 = s[4 * c + 2];
+        int v  = s[4 * c + 3] - 128;
+        int cb = (u * 454) >> 8;
+        int cg = (u * 88 + v * 183) >> 8;
+        int cr = (v * 359) >> 8;
+        unsigned char *p = d + 2 * size * c;
+
+        p[r]        = ccvt_sat(y1 + cr);
+        p[g]        = ccvt_sat(y1 - cg);
+        p[b]        = ccvt_sat(y1 + cb);
+        p[size + r] = ccvt_sat(y2 + cr);
+        p[size + g] = ccvt_sat(y2 - cg);
+        p[size + b] = ccvt_sat(y2 + cb);
     }
 }
 
+/* Rows follow each other without padding, an odd last column is left out */
+static void ccvt_yuyv_bgr32_rows(void *arg, int start, int end)
+{
+    const struct ccvt_yuyv_rows *a = arg;
+    long l;
+
+    for (l = start; l < end; l++)
+        ccvt_yuyv_row(a->src + l * a->pairs * 4, a->dst + l * a->pairs * 8, a->pairs, 4, 2, 1, 0);
+}
+
+static void ccvt_yuyv_bgr24_rows(void *arg, int start, int end)
+{
+    const struct ccvt_yuyv_rows *a = arg;
+    long l;
+
+    for (l = start; l < end; l++)
+        ccvt_yuyv_row(a->src + l * a->pairs * 4, a->dst + l * a->pairs * 6, a->pairs, 3, 2, 1, 0);
+}
+
+static void ccvt_yuyv_rgb24_rows(void *arg, int start, int end)
+{
+    const struct ccvt_yuyv_rows *a = arg;
+    long l;
+
+    for (l = start; l < end; l++)
+        ccvt_yuyv_row(a->src + l * a->pairs * 4, a->dst + l * a->pairs * 6, a->pairs, 3, 0, 1, 2);
+}
+
+void ccvt_yuyv_bgr32(int width, int height, const void *src, void *dst)
+{
+    struct ccvt_yuyv_rows a = { width >> 1, src, dst };
+    ccvt_rows(height, (long)width * height, ccvt_yuyv_bgr32_rows, &a);
+}
+
 void ccvt_yuyv_bgr24(int width, int height, const void *src, void *dst)
 {
-    const unsigned char *s;
-    PIXTYPE_bgr24 *d;
-    int l, c;
-    int r, g, b, cr, cg, cb, y1, y2;
-
-    l = height;
-    s = src;
-    d = dst;
-    while (l--)
-    {
-        c = width >> 1;
-        while (c--)
-        {
-            y1 = *s++;
-            cb = ((*s - 128) * 454) >> 8;
-            cg = (*s++ - 128) * 88;
-            y2 = *s++;
-            cr = ((*s - 128) * 359) >> 8;
-            cg = (cg + (*s++ - 128) * 183) >> 8;
-
-            r = y1 + cr;
-            b = y1 + cb;
-            g = y1 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-            r = y2 + cr;
-            b = y2 + cb;
-            g = y2 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->b = b;
-            d->g = g;
-            d->r = r;
-            d++;
-        }
-    }
+    struct ccvt_yuyv_rows a = { width >> 1, src, dst };
+    ccvt_rows(height, (long)width * height, ccvt_yuyv_bgr24_rows, &a);
 }
 
 void ccvt_yuyv_rgb24(int width, int height, const void *src, void *dst)
 {
-    const unsigned char *s;
-    PIXTYPE_rgb24 *d;
-    int l, c;
-    int r, g, b, cr, cg, cb, y1, y2;
-
-    l = height;
-    s = src;
-    d = dst;
-    while (l--)
+    struct ccvt_yuyv_rows a = { width >> 1, src, dst };
+    ccvt_rows(height, (long)width * height, ccvt_yuyv_rgb24_rows, &a);
+}
+
+struct ccvt_yuyv_420p_rows
+{
+    int width;
+    const unsigned char *src;
+    unsigned char *y, *u, *v;
+};
+
+/* Pairs of rows, the U/V values of the two rows are averaged */
+static void ccvt_yuyv_420p_rows(void *arg, int start, int end)
+{
+    const struct ccvt_yuyv_420p_rows *a = arg;
+    const int width = a->width;
+    long l;
+    int j;
+
+    for (l = start; l < end; l++)
     {
-        c = width >> 1;
-        while (c--)
+        const unsigned char *s1 = a->src + 4 * l * width;
+        const unsigned char *s2 = s1 + 2 * width;
+        unsigned char *dy = a->y + 2 * l * width;
+        unsigned char *du = a->u + l * (width / 2);
+        unsigned char *dv = a->v + l * (width / 2);
+
+        for (j = 0; j < width; j++)
         {
-            y1 = *s++;
-            cb = ((*s - 128) * 454) >> 8;
-            cg = (*s++ - 128) * 88;
-            y2 = *s++;
-            cr = ((*s - 128) * 359) >> 8;
-            cg = (cg + (*s++ - 128) * 183) >> 8;
-
-            r = y1 + cr;
-            b = y1 + cb;
-            g = y1 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->r = r;
-            d->g = g;
-            d->b = b;
-            d++;
-            r = y2 + cr;
-            b = y2 + cb;
-            g = y2 - cg;
-            SAT(r);
-            SAT(g);
-            SAT(b);
-            d->r = r;
-            d->g = g;
-            d->b = b;
-            d++;
+            dy[j]         = s1[2 * j];
+            dy[width + j] = s2[2 * j];
+        }
+        for (j = 0; j < width / 2; j++)
+        {
+            du[j] = (s1[4 * j + 1] + s2[4 * j + 1]) / 2;
+            dv[j] = (s1[4 * j + 3] + s2[4 * j + 3]) / 2;
         }
     }
 }
 
 void ccvt_yuyv_420p(int width, int height, const void *src, void *dsty, void *dstu, void *dstv)
 {
-    int n, l, j;
-    const unsigned char *s1, *s2;
-    unsigned char *dy, *du, *dv;
+    struct ccvt_yuyv_420p_rows a;
 
     /* Disregard last column/line if width/height is odd */
     width -= width % 2;
-    height -= height %2;
-
-    dy = (unsigned char *)dsty;
-    du = (unsigned char *)dstu;
-    dv = (unsigned char *)dstv;
-    s1 = (unsigned char *)src;
-    s2 = s1; /* keep pointer */
-    n  = width * height;
-    for (; n > 0; n--)
-    {
-        *dy = *s1;
-        dy++;
-        s1 += 2;
-    }
+    height -= height % 2;
+
+    a.width = width;
+    a.src   = src;
+    a.y     = dsty;
+    a.u     = dstu;
+    a.v     = dstv;
+    ccvt_rows(height / 2, (long)width * height, ccvt_yuyv_420p_rows, &a);
+}
 
-    /* Two options here: average U/V values, or skip every second row */
-    s1 = s2; /* restore pointer */
-    s1++;    /* point to U */
-    for (l = 0; l < height; l += 2)
-    {
-        s2 = s1 + width * 2; /* odd line */
-        for (j = 0; j < width; j += 2)
-        {
-            *du = (*s1 + *s2) / 2;
-            du++;
-            s1 += 2;
-            s2 += 2;
-            *dv = (*s1 + *s2) / 2;
-            dv++;
-            s1 += 2;
-            s2 += 2;
-        }
-        s1 = s2;
+/*
+ * Bayer demosaics. Inside the frame, a pixel gets the colours it misses from the average of the two or four
+ * nearest pixels of each colour. The kinds of pixels are named after their place in the BGGR pattern, the RGGB
+ * pattern is the BGGR one with red and blue swapped and the GRBG one is shifted by a column.
+ */
+enum
+{
+    BAYER_B,  /* blue, red on the diagonals */
+    BAYER_BG, /* green between blues, reds above and below */
+    BAYER_GR, /* green between reds, blues above and below */
+    BAYER_R   /* red, blue on the diagonals */
+};
+
+/*
+ * Interior pixels of a row, of two kinds alternating from the first one. Inlined with constant kinds and colour
+ * offsets, the loop has no branch left and is vectorized by the compiler. The sums are never negative, shifts give
+ * the same averages as the divisions.
+ */
+#define CCVT_BAYER_SPAN(type, suffix)                                                                                 \
+    static inline void ccvt_bayer_pixel_##suffix(type *d, const type *p, long w, int kind, int r, int b)              \
+    {                                                                                                                 \
+        switch (kind)                                                                                                 \
+        {                                                                                                             \
+            case BAYER_B:                                                                                             \
+                d[r] = (p[-w - 1] + p[-w + 1] + p[w - 1] + p[w + 1]) >> 2;                                            \
+                d[1] = (p[-1] + p[1] + p[w] + p[-w]) >> 2;                                                            \
+                d[b] = p[0];                                                                                          \
+                break;                                                                                                \
+            case BAYER_BG:                                                                                            \
+                d[r] = (p[w] + p[-w]) >> 1;                                                                           \
+                d[1] = p[0];                                                                                          \
+                d[b] = (p[-1] + p[1]) >> 1;                                                                           \
+                break;                                                                                                \
+            case BAYER_GR:                                                                                            \
+                d[r] = (p[-1] + p[1]) >> 1;                                                                           \
+                d[1] = p[0];                                                                                          \
+                d[b] = (p[w] + p[-w]) >> 1;                                                                           \
+                break;                                                                                                \
+            default:                                                                                                  \
+                d[r] = p[0];                                                                                          \
+                d[1] = (p[-1] + p[1] + p[-w] + p[w]) >> 2;                                                            \
+                d[b] = (p[-w - 1] + p[-w + 1] + p[w - 1] + p[w + 1]) >> 2;                                            \
+                break;                                                                                                \
+        }                                                                                                             \
+    }                                                                                                                 \
+                                                                                                                      \
+    static inline void ccvt_bayer_span_##suffix(type *d, const type *p, long w, long count, int first, int second,    \
+            int r, int b)                                                                                             \
+    {                                                                                                                 \
+        long c;                                                                                                       \
+                                                                                                                      \
+        for (c = 0; c + 1 < count; c += 2)                                                                            \
+        {                                                                                                             \
+            ccvt_bayer_pixel_##suffix(d + 3 * c, p + c, w, first, r, b);                                              \
+            ccvt_bayer_pixel_##suffix(d + 3 * c + 3, p + c + 1, w, second, r, b);                                     \
+        }                                                                                                             \
+        if (c < count)                                                                                                \
+            ccvt_bayer_pixel_##suffix(d + 3 * c, p + c, w, first, r, b);                                              \
     }
+
+CCVT_BAYER_SPAN(unsigned char, 8)
+CCVT_BAYER_SPAN(unsigned short, 16)
+
+struct ccvt_bayer_rows
+{
+    void *dst;
+    const void *src;
+    long width;
+    long height;
+};
+
+static inline int ccvt_bayer_load(const void *src, int wide, long i)
+{
+    return wide ? ((const unsigned short *)src)[i] : ((const unsigned char *)src)[i];
 }
 
-void bayer2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+static inline void ccvt_bayer_store(void *dst, int wide, long i, int value)
 {
-    long int i;
-    unsigned char *rawpt, *scanpt;
-    long int size;
+    if (wide)
+        ((unsigned short *)dst)[i] = value;
+    else
+        ((unsigned char *)dst)[i] = value;
+}
 
-    rawpt  = src;
-    scanpt = dst;
-    size   = WIDTH * HEIGHT;
+/*
+ * Any pixel i of a BGGR frame, red written at offset r and blue at the other end. The edges are interpolated from
+ * the neighbours they have. The kind of pixel goes with the parity of i, rather than the one of its column.
+ */
+static void ccvt_bggr_pixel(void *dst, const void *src, int wide, long i, long WIDTH, long HEIGHT, int r)
+{
+#define RAW(offset) ccvt_bayer_load(src, wide, i + (offset))
+    int R, G, B;
 
-    for (i = 0; i < size; i++)
+    if ((i / WIDTH) % 2 == 0)
     {
-        if ((i / WIDTH) % 2 == 0)
+        if ((i % 2) == 0)
         {
-            if ((i % 2) == 0)
+            /* B */
+            if ((i > WIDTH) && ((i % WIDTH) > 0))
             {
-                /* B */
-                if ((i > WIDTH) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4;                                                                               /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
-                    *scanpt++ = *rawpt;                                                                  /* B */
-                }
-                else
-                {
-                    /* first line or left column */
-                    *scanpt++ = *(rawpt + WIDTH + 1);                  /* R */
-                    *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
-                    *scanpt++ = *rawpt;                                /* B */
-                }
+                R = (RAW(-WIDTH - 1) + RAW(-WIDTH + 1) + RAW(WIDTH - 1) + RAW(WIDTH + 1)) / 4;
+                G = (RAW(-1) + RAW(1) + RAW(WIDTH) + RAW(-WIDTH)) / 4;
+                B = RAW(0);
             }
             else
             {
-                /* (B)G */
-                if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
-                }
-                else
-                {
-                    /* first line or right column */
-                    *scanpt++ = *(rawpt + WIDTH); /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - 1);     /* B */
-                }
+                /* first line or left column */
+                R = RAW(WIDTH + 1);
+                G = (RAW(1) + RAW(WIDTH)) / 2;
+                B = RAW(0);
             }
         }
         else
         {
-            if ((i % 2) == 0)
+            /* (B)G */
+            if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
             {
-                /* G(R) */
-                if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
-                }
-                else
-                {
-                    /* bottom line or left column */
-                    *scanpt++ = *(rawpt + 1);     /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - WIDTH); /* B */
-                }
+                R = (RAW(WIDTH) + RAW(-WIDTH)) / 2;
+                G = RAW(0);
+                B = (RAW(-1) + RAW(1)) / 2;
             }
             else
             {
-                /* R */
-                if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = *rawpt;                                                                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4; /* B */
-                }
-                else
-                {
-                    /* bottom line or right column */
-                    *scanpt++ = *rawpt;                                /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
-                    *scanpt++ = *(rawpt - WIDTH - 1);                  /* B */
-                }
+                /* first line or right column */
+                R = RAW(WIDTH);
+                G = RAW(0);
+                B = RAW(-1);
             }
         }
-        rawpt++;
     }
-}
-
-void bayer16_2_rgb24(unsigned short *dst, unsigned short *src, long int WIDTH, long int HEIGHT)
-{
-    long int i;
-    unsigned short *rawpt, *scanpt;
-    long int size;
-
-    rawpt  = src;
-    scanpt = dst;
-    size   = WIDTH * HEIGHT;
-
-    for (i = 0; i < size; i++)
+    else
     {
-        if ((i / WIDTH) % 2 == 0)
+        if ((i % 2) == 0)
         {
-            if ((i % 2) == 0)
+            /* G(R) */
+            if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
             {
-                /* B */
-                if ((i > WIDTH) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4;                                                                               /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
-                    *scanpt++ = *rawpt;                                                                  /* B */
-                }
-                else
-                {
-                    /* first line or left column */
-                    *scanpt++ = *(rawpt + WIDTH + 1);                  /* R */
-                    *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
-                    *scanpt++ = *rawpt;                                /* B */
-                }
+                R = (RAW(-1) + RAW(1)) / 2;
+                G = RAW(0);
+                B = (RAW(WIDTH) + RAW(-WIDTH)) / 2;
             }
             else
             {
-                /* (B)G */
-                if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
-                }
-                else
-                {
-                    /* first line or right column */
-                    *scanpt++ = *(rawpt + WIDTH); /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - 1);     /* B */
-                }
+                /* bottom line or left column */
+                R = RAW(1);
+                G = RAW(0);
+                B = RAW(-WIDTH);
             }
         }
         else
         {
-            if ((i % 2) == 0)
+            /* R */
+            if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
             {
-                /* G(R) */
-                if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
-                }
-                else
-                {
-                    /* bottom line or left column */
-                    *scanpt++ = *(rawpt + 1);     /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt - WIDTH); /* B */
-                }
+                R = RAW(0);
+                G = (RAW(-1) + RAW(1) + RAW(-WIDTH) + RAW(WIDTH)) / 4;
+                B = (RAW(-WIDTH - 1) + RAW(-WIDTH + 1) + RAW(WIDTH - 1) + RAW(WIDTH + 1)) / 4;
             }
             else
             {
-                /* R */
-                if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = *rawpt;                                                                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4; /* B */
-                }
-                else
-                {
-                    /* bottom line or right column */
-                    *scanpt++ = *rawpt;                                /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
-                    *scanpt++ = *(rawpt - WIDTH - 1);                  /* B */
-                }
+                /* bottom line or right column */
+                R = RAW(0);
+                G = (RAW(-1) + RAW(-WIDTH)) / 2;
+                B = RAW(-WIDTH - 1);
             }
         }
-        rawpt++;
     }
+#undef RAW
+
+    ccvt_bayer_store(dst, wide, 3 * i + r, R);
+    ccvt_bayer_store(dst, wide, 3 * i + 1, G);
+    ccvt_bayer_store(dst, wide, 3 * i + 2 - r, B);
 }
 
-void bayer_rggb_2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+/* Interior pixels of a row of a BGGR frame from pixel i on */
+static inline void ccvt_bggr_span(const struct ccvt_bayer_rows *a, long i, int wide, int first, int second, int r)
 {
-    long int i;
-    unsigned char *rawpt, *scanpt;
-    long int size;
+    if (wide)
+        ccvt_bayer_span_16((unsigned short *)a->dst + 3 * i, (const unsigned short *)a->src + i, a->width,
+                           a->width - 2, first, second, r, 2 - r);
+    else
+        ccvt_bayer_span_8((unsigned char *)a->dst + 3 * i, (const unsigned char *)a->src + i, a->width, a->width - 2,
+                          first, second, r, 2 - r);
+}
 
-    rawpt  = src;
-    scanpt = dst;
-    size   = WIDTH * HEIGHT;
+/* Rows of a BGGR frame, the first and last rows and columns go through ccvt_bggr_pixel */
+static inline void ccvt_bggr_rows(const struct ccvt_bayer_rows *a, int start, int end, int wide, int r)
+{
+    const long WIDTH = a->width, HEIGHT = a->height;
+    long row, col;
 
-    for (i = 0; i < size; i++)
+    for (row = start; row < end; row++)
     {
-        if ((i / WIDTH) % 2 == 0) //wenn zeile grade
+        const long i    = row * WIDTH;
+        const int even  = (row % 2) == 0;
+        const int first = (i + 1) % 2 == 0;
+
+        if (WIDTH < 3 || (even ? row == 0 : row == HEIGHT - 1))
         {
-            if ((i % 2) == 0) //spalte gerade
-            {
-                /* B */
-                if ((i > WIDTH) && ((i % WIDTH) > 0)) // wenn nicht erste zeile oder linke spalte
-                {
-                    *scanpt++ = *rawpt;                                                                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt + WIDTH) + *(rawpt - WIDTH)) / 4; /* G */
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4; /* B */
-                }
-                else
-                {
-                    /* first line or left column */
-                    *scanpt++ = *rawpt;                                /* R */
-                    *scanpt++ = (*(rawpt + 1) + *(rawpt + WIDTH)) / 2; /* G */
-                    *scanpt++ = *(rawpt + WIDTH + 1);                  /* B */
-                }
-            }
-            else
-            {
-                /* (B)G */
-                if ((i > WIDTH) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* B */
-                }
-                else
-                {
-                    /* first line or right column */
-                    *scanpt++ = *(rawpt - 1);     /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt + WIDTH); /* B */
-                }
-            }
+            for (col = 0; col < WIDTH; col++)
+                ccvt_bggr_pixel(a->dst, a->src, wide, i + col, WIDTH, HEIGHT, r);
+            continue;
         }
+
+        ccvt_bggr_pixel(a->dst, a->src, wide, i, WIDTH, HEIGHT, r);
+        if (even && first)
+            ccvt_bggr_span(a, i + 1, wide, BAYER_B, BAYER_BG, r);
+        else if (even)
+            ccvt_bggr_span(a, i + 1, wide, BAYER_BG, BAYER_B, r);
+        else if (first)
+            ccvt_bggr_span(a, i + 1, wide, BAYER_GR, BAYER_R, r);
         else
+            ccvt_bggr_span(a, i + 1, wide, BAYER_R, BAYER_GR, r);
+        ccvt_bggr_pixel(a->dst, a->src, wide, i + WIDTH - 1, WIDTH, HEIGHT, r);
+    }
+}
+
+static void ccvt_bggr8_rows(void *arg, int start, int end)
+{
+    ccvt_bggr_rows(arg, start, end, 0, 0);
+}
+
+static void ccvt_rggb8_rows(void *arg, int start, int end)
+{
+    ccvt_bggr_rows(arg, start, end, 0, 2);
+}
+
+static void ccvt_bggr16_rows(void *arg, int start, int end)
+{
+    ccvt_bggr_rows(arg, start, end, 1, 0);
+}
+
+void bayer2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+{
+    struct ccvt_bayer_rows a = { dst, src, WIDTH, HEIGHT };
+    ccvt_rows(HEIGHT, WIDTH * HEIGHT, ccvt_bggr8_rows, &a);
+}
+
+void bayer16_2_rgb24(unsigned short *dst, unsigned short *src, long int WIDTH, long int HEIGHT)
+{
+    struct ccvt_bayer_rows a = { dst, src, WIDTH, HEIGHT };
+    ccvt_rows(HEIGHT, WIDTH * HEIGHT, ccvt_bggr16_rows, &a);
+}
+
+void bayer_rggb_2rgb24(unsigned char *dst, unsigned char *src, long int WIDTH, long int HEIGHT)
+{
+    struct ccvt_bayer_rows a = { dst, src, WIDTH, HEIGHT };
+    ccvt_rows(HEIGHT, WIDTH * HEIGHT, ccvt_rggb8_rows, &a);
+}
+
+/* Any pixel of a GRBG frame, edges included */
+static void ccvt_grbg_pixel(unsigned char *dst, const unsigned char *src, long WIDTH, long HEIGHT, long row, long col)
+{
+	long int width=WIDTH;
+	int RED = 0;
+	int GREEN = 1;
+	int BLUE = 2;
+	//General case:
+	if(row % 2 == 0) { //GRGRGR Row
+		if(col % 2 == 0) {//Over Green
+			//TODO: Double check 1st/last row
+			if (col != 0 && col != WIDTH -1) { // NORMAL
+			dst[(row*width+col)*3+RED]=(src[row*width+col+1]+src[row*width+col-1])/2; // Reds are to L/R
+			} else { //EDGE
+				if (col == 0) { dst[(row*width+col)*3+RED]=src[row*width+col+1];}
+				if (col == WIDTH -1 ) { dst[(row*width+col)*3+RED]=src[row*width+col-1]; }
+			}
+			dst[(row*width+col)*3+GREEN]=src[row*width+col];
+			if (row !=0 && row !=HEIGHT-1) { // NORMAL
+			dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; //Blues are above and below.
+			} else { // EDGE
+				if (row == 0) {dst[(row*width+col)*3+BLUE]=src[(row+1)*width+col];}
+				if (row == WIDTH -1) {dst[(row*width+col)*3+BLUE]=src[(row-1)*width+col];}
+			}
+		} else { // Over RED
+			dst[(row*width+col)*3+RED]=src[row*width+col]; 
+			if (col != WIDTH -1 && row !=0 ) { // NORMAL (Left side and bottom count as normal
+			dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
+			dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
+			} else { // EDGE
+				if (col != WIDTH -1 && row == 0) {
+					//Corner && Side: 
+					//     
+					//,G*G.
+					//,BGB.
+					//,....
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row)*width+col+1]+src[(row)*width+col+1])/3;
+					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row+1)*width+col-1])/2;
+				} 
+
+				if (col == WIDTH -1 && row !=0 ) {
+					//Side
+					//...
+					//.BG
+					//.GR
+					//.BG
+					//...
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row)*width+col-1])/3;
+					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/2;
+					
+				}
+				if (col == WIDTH -1 && row ==0) {
+					//Corner (col=max, row=0)
+					//
+					//.G*
+					//.BG
+					//...
+					dst[(row*width+col)*3+GREEN]=(src[(row-1)*width+col]+src[(row+0)*width+col-1]+src[(row+1)*width+col])/3;
+					dst[(row*width+col)*3+BLUE]=src[(row+1)*width+col-1];
+				}
+				if (col == 1 && row !=0) { //Unnecessary Left here to explain why 
+					//Side && Corner (col=1, row=max)
+					// .....
+					// BGBG..
+					// G*GR
+					// BGBG..
+					// ,,,,,, 
+					// NORMAL
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
+					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
+				}
+				if (row == HEIGHT -1) {//Unnecessary Left here to explain why 
+					//Bottom row (would actually be HEIGHT -2 it still looks like a normal pixel for us
+					// ,.....
+					// ,.BGBG..
+					// ,.G*RG..
+					// ,.BGBG..
+					//        
+					// NORMAL
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
+					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
+					
+				}
+			}
+		}
+	} else { //BRBRBR Row
+		//if (col != 0 && col != WIDTH -1 && row != 0 && row != HEIGHT-1) {
+		if (col % 2 == 0) {//Over Blue
+			dst[(row*width+col)*3+BLUE]=src[row*width+col];
+			if ( col != 0 && row != HEIGHT -1) { //Normal 
+				// Enough clearance to use this:
+				// RGR
+				// G*G
+				// RGR
+				dst[(row*width+col)*3+RED]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4;//Reds are caddy corner and below.
+				dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
+			} else { // EDGE CASES over blue
+				if (col == 0 && row != HEIGHT -1) {
+					//  ,,,,,,,
+					//  GRGRGR.
+					//  *GBGBG.
+					//  GRGRGR.
+					//  .......
+					dst[(row*width+col)*3+RED]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1])/2;
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
+				}
+				if (row == HEIGHT -1 && col !=0) {
+					//  ........
+					//  .GRGRGR.
+					//  .BG*GBG.
+					dst[(row*width+col)*3+RED]=(src[(row-1)*width+col+1]+src[(row-1)*width+col-1])/2;
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
+				}
+				if (row == HEIGHT -1 && col ==0) {
+					//  .....
+					//  GRGR.
+					//  *GBG.
+					dst[(row*width+col)*3+RED]=(src[(row-1)*width+col+1]+src[(row-1)*width+col-1])/2;
+					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
+				}
+				
+			}
+		} else { // Over Green
+			dst[(row*width+col)*3+GREEN]=src[row*width+col]; // Over Green Pixel
+			if (col != WIDTH -1 && row != HEIGHT -1) { //NORMAL 
+				// Enough clearance to use this:
+				// GRG
+				// B*B
+				// GRG
+				
+				dst[(row*width+col)*3+RED]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; // Reds are above/below
+				dst[(row*width+col)*3+BLUE]=(src[row*width+col+1]+src[row*width+col-1])/2; //Blues are left/right
+			} else {
+				if (col == WIDTH -1 && row != HEIGHT -1) {
+					// ,,,,,
+					// .GRGR
+					// .BGB*
+					// .GRGR
+					// .....
+					dst[(row*width+col)*3+RED]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; // Reds are above/below
+					dst[(row*width+col)*3+BLUE]=src[row*width+col-1]; //Blue is left
+				}
+				if (row == HEIGHT -1 && col != WIDTH -1) {
+					// .....
+					// .GRGR
+					// .B*BG
+					dst[(row*width+col)*3+RED]=src[(row-1)*width+col]; // Red is above
+					dst[(row*width+col)*3+BLUE]=(src[row*width+col+1]+src[row*width+col-1])/2; //Blues are left/right
+				}
+				if (row == HEIGHT -1 && col == WIDTH -1) {
+					// ...
+					// .GR
+					// .B*
+					dst[(row*width+col)*3+RED]=src[(row-1)*width+col]; // Red is above
+					dst[(row*width+col)*3+BLUE]=src[row*width+col-1]; //Blue is left
+				}
+			}
+		}
+	}
+}
+
+static void ccvt_grbg_rows(void *arg, int start, int end)
+{
+    const struct ccvt_bayer_rows *a = arg;
+    const long WIDTH = a->width, HEIGHT = a->height;
+    unsigned char *dst = a->dst;
+    const unsigned char *src = a->src;
+    long row, col;
+
+    for (row = start; row < end; row++)
+    {
+        const long i = row * WIDTH;
+
+        if (WIDTH < 3 || row == 0 || row == HEIGHT - 1)
         {
-            if ((i % 2) == 0)
-            {
-                /* G(R) */
-                if ((i < (WIDTH * (HEIGHT - 1))) && ((i % WIDTH) > 0))
-                {
-                    *scanpt++ = (*(rawpt + WIDTH) + *(rawpt - WIDTH)) / 2; /* R */
-                    *scanpt++ = *rawpt;                                    /* G */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1)) / 2;         /* B */
-                }
-                else
-                {
-                    /* bottom line or left column */
-                    *scanpt++ = *(rawpt - WIDTH); /* R */
-                    *scanpt++ = *rawpt;           /* G */
-                    *scanpt++ = *(rawpt + 1);     /* B */
-                }
-            }
-            else
-            {
-                /* R */
-                if (i < (WIDTH * (HEIGHT - 1)) && ((i % WIDTH) < (WIDTH - 1)))
-                {
-                    *scanpt++ =
-                        (*(rawpt - WIDTH - 1) + *(rawpt - WIDTH + 1) + *(rawpt + WIDTH - 1) + *(rawpt + WIDTH + 1)) /
-                        4;                                                                               /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt + 1) + *(rawpt - WIDTH) + *(rawpt + WIDTH)) / 4; /* G */
-                    *scanpt++ = *rawpt;                                                                  /* B */
-                }
-                else
-                {
-                    /* bottom line or right column */
-                    *scanpt++ = *(rawpt - WIDTH - 1);                  /* R */
-                    *scanpt++ = (*(rawpt - 1) + *(rawpt - WIDTH)) / 2; /* G */
-                    *scanpt++ = *rawpt;                                /* B */
-                }
-            }
+            for (col = 0; col < WIDTH; col++)
+                ccvt_grbg_pixel(dst, src, WIDTH, HEIGHT, row, col);
+            continue;
         }
-        rawpt++;
+
+        ccvt_grbg_pixel(dst, src, WIDTH, HEIGHT, row, 0);
+        /* GRGR rows are red and green between reds, BGBG rows green between blues and blue */
+        if (row % 2 == 0)
+            ccvt_bayer_span_8(dst + 3 * (i + 1), src + i + 1, WIDTH, WIDTH - 2, BAYER_R, BAYER_GR, 0, 2);
+        else
+            ccvt_bayer_span_8(dst + 3 * (i + 1), src + i + 1, WIDTH, WIDTH - 2, BAYER_BG, BAYER_B, 0, 2);
+        ccvt_grbg_pixel(dst, src, WIDTH, HEIGHT, row, WIDTH - 1);
     }
 }
 
@@ -553,169 +679,8 @@ void bayer_grbg_to_rgb24(unsigned char *dst, unsigned char *src, long int WIDTH,
 	// Output is
 	// RGBRGBRGBRGBRGB row width = 3x width
 	// RGBRGBRGBRGBRGB each pixel = 3 bytes
-	
-	long int row;
-	long int col;
-	long int width=WIDTH;
-	int RED = 0;
-	int GREEN = 1;
-	int BLUE = 2;
-	for (row = 0; row < HEIGHT; row++) {
-		for (col = 0; col < WIDTH; col++) {
-			//General case:
-			if(row % 2 == 0) { //GRGRGR Row
-				if(col % 2 == 0) {//Over Green
-					//TODO: Double check 1st/last row
-					if (col != 0 && col != WIDTH -1) { // NORMAL
-					dst[(row*width+col)*3+RED]=(src[row*width+col+1]+src[row*width+col-1])/2; // Reds are to L/R
-					} else { //EDGE
-						if (col == 0) { dst[(row*width+col)*3+RED]=src[row*width+col+1];}
-						if (col == WIDTH -1 ) { dst[(row*width+col)*3+RED]=src[row*width+col-1]; }
-					}
-					dst[(row*width+col)*3+GREEN]=src[row*width+col];
-					if (row !=0 && row !=HEIGHT-1) { // NORMAL
-					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; //Blues are above and below.
-					} else { // EDGE
-						if (row == 0) {dst[(row*width+col)*3+BLUE]=src[(row+1)*width+col];}
-						if (row == WIDTH -1) {dst[(row*width+col)*3+BLUE]=src[(row-1)*width+col];}
-					}
-				} else { // Over RED
-					dst[(row*width+col)*3+RED]=src[row*width+col]; 
-					if (col != WIDTH -1 && row !=0 ) { // NORMAL (Left side and bottom count as normal
-					dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
-					dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
-					} else { // EDGE
-						if (col != WIDTH -1 && row == 0) {
-							//Corner && Side: 
-							//     
-							//,G*G.
-							//,BGB.
-							//,....
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row)*width+col+1]+src[(row)*width+col+1])/3;
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row+1)*width+col-1])/2;
-						} 
-
-						if (col == WIDTH -1 && row !=0 ) {
-							//Side
-							//...
-							//.BG
-							//.GR
-							//.BG
-							//...
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row)*width+col-1])/3;
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/2;
-							
-						}
-						if (col == WIDTH -1 && row ==0) {
-							//Corner (col=max, row=0)
-							//
-							//.G*
-							//.BG
-							//...
-							dst[(row*width+col)*3+GREEN]=(src[(row-1)*width+col]+src[(row+0)*width+col-1]+src[(row+1)*width+col])/3;
-							dst[(row*width+col)*3+BLUE]=src[(row+1)*width+col-1];
-						}
-						if (col == 1 && row !=0) { //Unnecessary Left here to explain why 
-							//Side && Corner (col=1, row=max)
-							// .....
-							// BGBG..
-							// G*GR
-							// BGBG..
-							// ,,,,,, 
-							// NORMAL
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
-						}
-						if (row == HEIGHT -1) {//Unnecessary Left here to explain why 
-							//Bottom row (would actually be HEIGHT -2 it still looks like a normal pixel for us
-							// ,.....
-							// ,.BGBG..
-							// ,.G*RG..
-							// ,.BGBG..
-							//        
-							// NORMAL
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
-							dst[(row*width+col)*3+BLUE]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4; //Blues are caddy corner and below.
-							
-						}
-					}
-				}
-			} else { //BRBRBR Row
-				//if (col != 0 && col != WIDTH -1 && row != 0 && row != HEIGHT-1) {
-				if (col % 2 == 0) {//Over Blue
-					dst[(row*width+col)*3+BLUE]=src[row*width+col];
-					if ( col != 0 && row != HEIGHT -1) { //Normal 
-						// Enough clearance to use this:
-						// RGR
-						// G*G
-						// RGR
-						dst[(row*width+col)*3+RED]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1]+src[(row+1)*width+col-1]+src[(row-1)*width+col-1])/4;//Reds are caddy corner and below.
-						dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/4; //GREENS are in all 4 directions
-					} else { // EDGE CASES over blue
-						if (col == 0 && row != HEIGHT -1) {
-							//  ,,,,,,,
-							//  GRGRGR.
-							//  *GBGBG.
-							//  GRGRGR.
-							//  .......
-							dst[(row*width+col)*3+RED]=(src[(row+1)*width+col+1]+src[(row-1)*width+col+1])/2;
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
-						}
-						if (row == HEIGHT -1 && col !=0) {
-							//  ........
-							//  .GRGRGR.
-							//  .BG*GBG.
-							dst[(row*width+col)*3+RED]=(src[(row-1)*width+col+1]+src[(row-1)*width+col-1])/2;
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
-						}
-						if (row == HEIGHT -1 && col ==0) {
-							//  .....
-							//  GRGR.
-							//  *GBG.
-							dst[(row*width+col)*3+RED]=(src[(row-1)*width+col+1]+src[(row-1)*width+col-1])/2;
-							dst[(row*width+col)*3+GREEN]=(src[(row+1)*width+col]+src[(row-1)*width+col]+src[(row+0)*width+col+1]+src[(row+0)*width+col-1])/3;
-						}
-						
-					}
-				} else { // Over Green
-					dst[(row*width+col)*3+GREEN]=src[row*width+col]; // Over Green Pixel
-					if (col != WIDTH -1 && row != HEIGHT -1) { //NORMAL 
-						// Enough clearance to use this:
-						// GRG
-						// B*B
-						// GRG
-						
-						dst[(row*width+col)*3+RED]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; // Reds are above/below
-						dst[(row*width+col)*3+BLUE]=(src[row*width+col+1]+src[row*width+col-1])/2; //Blues are left/right
-					} else {
-						if (col == WIDTH -1 && row != HEIGHT -1) {
-							// ,,,,,
-							// .GRGR
-							// .BGB*
-							// .GRGR
-							// .....
-							dst[(row*width+col)*3+RED]=(src[(row+1)*width+col]+src[(row-1)*width+col])/2; // Reds are above/below
-							dst[(row*width+col)*3+BLUE]=src[row*width+col-1]; //Blue is left
-						}
-						if (row == HEIGHT -1 && col != WIDTH -1) {
-							// .....
-							// .GRGR
-							// .B*BG
-							dst[(row*width+col)*3+RED]=src[(row-1)*width+col]; // Red is above
-							dst[(row*width+col)*3+BLUE]=(src[row*width+col+1]+src[row*width+col-1])/2; //Blues are left/right
-						}
-						if (row == HEIGHT -1 && col == WIDTH -1) {
-							// ...
-							// .GR
-							// .B*
-							dst[(row*width+col)*3+RED]=src[(row-1)*width+col]; // Red is above
-							dst[(row*width+col)*3+BLUE]=src[row*width+col-1]; //Blue is left
-						}
-					}
-				}
-			}
-		}
-	}
+	struct ccvt_bayer_rows a = { dst, src, WIDTH, HEIGHT };
+	ccvt_rows(HEIGHT, WIDTH * HEIGHT, ccvt_grbg_rows, &a);
 }
 
 int mjpegtoyuv420p(unsigned char *map, unsigned char *cap_map, int width, int height, unsigned int size)
@@ -50,6 +50,16 @@ bool EncoderInterface::setSize(uint16_t width, uint16_t height)
     return true;
 }
 
+void EncoderInterface::setQuality(uint8_t quality)
+{
+    this->quality = quality;
+}
+
+void EncoderInterface::setPreviewWidth(uint16_t width)
+{
+    maxPreviewWidth = width;
+}
+
 bool EncoderInterface::setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t pixelDepth)
 {
     this->pixelFormat = pixelFormat;
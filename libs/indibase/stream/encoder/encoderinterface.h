@@ -29,6 +29,7 @@
 #include <cstdlib>
 #include <stdint.h>
 
+#include <atomic>
 #include <vector>
 
 namespace INDI
@@ -53,6 +54,12 @@ class EncoderInterface
 
         virtual bool setSize(uint16_t width, uint16_t height);
 
+        // Quality 1-100 used by lossy encoders
+        virtual void setQuality(uint8_t quality);
+
+        // Maximum width of the uploaded frame, larger frames are downscaled. 0 keeps the full size.
+        virtual void setPreviewWidth(uint16_t width);
+
         virtual bool upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint32_t nbytes, bool isCompressed = false) = 0;
 
         const char *getName();
@@ -63,6 +70,9 @@ class EncoderInterface
         INDI_PIXEL_FORMAT pixelFormat;            // INDI Pixel Format
         uint8_t pixelDepth = 8;                   // Bits per Pixels
         uint16_t rawWidth, rawHeight;
+        // Set by the client thread while the stream thread encodes
+        std::atomic<int> quality { 85 };
+        std::atomic<int> maxPreviewWidth { 640 };
 };
 
 }
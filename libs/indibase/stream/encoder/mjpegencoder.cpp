@@ -23,40 +23,208 @@
 #include "stream/streammanager.h"
 #include "indiccd.h"
 #include <cmath>
+#include <cstring>
+#include <algorithm>
 #include <zlib.h>
 #include <jpeglib.h>
 #include <jerror.h>
 
-static void init_destination(j_compress_ptr cinfo)
+#ifdef HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+namespace INDI
 {
-    INDI_UNUSED(cinfo);
-    /* No work necessary here */
-}
 
-static boolean empty_output_buffer(j_compress_ptr cinfo)
+/**
+ * @brief Compressor keeps the libjpeg state and output buffer across frames.
+ * libjpeg-turbo provides the SIMD accelerated color conversion, DCT and entropy coding behind this API.
+ */
+struct MJPEGEncoder::Compressor
+{
+    // Destination manager writing into a growing vector, pub must be the first member
+    struct Destination
+    {
+        jpeg_destination_mgr pub;
+        std::vector<uint8_t> *buffer;
+    };
+
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr jerr;
+    Destination destination;
+
+    std::vector<uint8_t> output;
+    std::vector<JSAMPROW> rows;
+    std::vector<uint32_t> sums;      // downscale accumulator
+
+    // Parameters of the last frame, tables are recomputed only when they change
+    uint16_t width = 0;
+    int components = 0;
+    int quality = 0;
+    bool restart = false;
+
+    Compressor()
+    {
+        cinfo.err = jpeg_std_error(&jerr);
+        jpeg_create_compress(&cinfo);
+
+        destination.pub.init_destination    = initDestination;
+        destination.pub.empty_output_buffer = emptyOutputBuffer;
+        destination.pub.term_destination    = termDestination;
+        destination.buffer = &output;
+        cinfo.dest = &destination.pub;
+    }
+
+    ~Compressor()
+    {
+        jpeg_destroy_compress(&cinfo);
+    }
+
+    void compress(const uint8_t *src, uint16_t width, uint16_t height, int stride, int components, int quality,
+                  bool restart)
+    {
+        if (width != this->width || components != this->components || quality != this->quality || restart != this->restart)
+        {
+            cinfo.image_width      = width;
+            cinfo.image_height     = height;
+            cinfo.input_components = components;
+            cinfo.in_color_space   = (components == 3) ? JCS_RGB : JCS_GRAYSCALE;
+            jpeg_set_defaults(&cinfo);
+            jpeg_set_quality(&cinfo, quality, TRUE);
+            // One restart interval per MCU row, so strips can be joined
+            cinfo.restart_in_rows = restart ? 1 : 0;
+
+            this->width      = width;
+            this->components = components;
+            this->quality    = quality;
+            this->restart    = restart;
+        }
+        cinfo.image_height = height;
+
+        rows.resize(height);
+        for (uint16_t i = 0; i < height; ++i)
+            rows[i] = const_cast<JSAMPROW>(src + static_cast<size_t>(i) * stride);
+
+        jpeg_start_compress(&cinfo, TRUE);
+        while (cinfo.next_scanline < height)
+            jpeg_write_scanlines(&cinfo, rows.data() + cinfo.next_scanline, height - cinfo.next_scanline);
+        jpeg_finish_compress(&cinfo);
+    }
+
+    static void initDestination(j_compress_ptr cinfo)
+    {
+        Destination *dest = reinterpret_cast<Destination *>(cinfo->dest);
+        dest->buffer->resize(std::max<size_t>(dest->buffer->capacity(), 64 * 1024));
+        dest->pub.next_output_byte = dest->buffer->data();
+        dest->pub.free_in_buffer   = dest->buffer->size();
+    }
+
+    static boolean emptyOutputBuffer(j_compress_ptr cinfo)
+    {
+        Destination *dest = reinterpret_cast<Destination *>(cinfo->dest);
+        size_t used = dest->buffer->size();
+        dest->buffer->resize(used * 2);
+        dest->pub.next_output_byte = dest->buffer->data() + used;
+        dest->pub.free_in_buffer   = dest->buffer->size() - used;
+        return TRUE;
+    }
+
+    static void termDestination(j_compress_ptr cinfo)
+    {
+        Destination *dest = reinterpret_cast<Destination *>(cinfo->dest);
+        dest->buffer->resize(dest->buffer->size() - dest->pub.free_in_buffer);
+    }
+};
+
+/**
+ * @brief Average scale x scale blocks of rows [y0, y1) of the downscaled frame.
+ */
+template <int components>
+static void downscale(const uint8_t *src, int srcStride, uint8_t *dst, int dstWidth, int scale,
+                      int y0, int y1, std::vector<uint32_t> &sums)
 {
-    INDI_UNUSED(cinfo);
-    /* No work necessary here */
-    return TRUE;
+    const int dstStride = dstWidth * components;
+    const uint32_t area = scale * scale;
+
+    sums.resize(dstStride);
+
+    for (int y = y0; y < y1; ++y)
+    {
+        std::fill(sums.begin(), sums.end(), 0);
+
+        for (int dy = 0; dy < scale; ++dy)
+        {
+            const uint8_t *pixel = src + static_cast<size_t>(y * scale + dy) * srcStride;
+            uint32_t *sum = sums.data();
+            for (int x = 0; x < dstWidth; ++x, sum += components)
+            {
+                for (int dx = 0; dx < scale; ++dx, pixel += components)
+                    for (int c = 0; c < components; ++c)
+                        sum[c] += pixel[c];
+            }
+        }
+
+        uint8_t *out = dst + static_cast<size_t>(y) * dstStride;
+        for (int i = 0; i < dstStride; ++i)
+            out[i] = (sums[i] + area / 2) / area;
+    }
 }
 
-static void term_destination(j_compress_ptr cinfo)
+static void downscale(const uint8_t *src, int srcStride, uint8_t *dst, int dstWidth, int components, int scale,
+                      int y0, int y1, std::vector<uint32_t> &sums)
 {
-    INDI_UNUSED(cinfo);
-    /* no work necessary here */
+    if (components == 3)
+        downscale<3>(src, srcStride, dst, dstWidth, scale, y0, y1, sums);
+    else
+        downscale<1>(src, srcStride, dst, dstWidth, scale, y0, y1, sums);
 }
 
-namespace INDI
+/**
+ * @brief Find the entropy coded data of a JPEG image.
+ * @param sofHeight set to the offset of the image height in the frame header
+ * @return offset of the first byte after the SOS header, or 0 if not found
+ */
+static size_t findScanData(const std::vector<uint8_t> &jpeg, size_t *sofHeight)
 {
+    size_t pos = 2; // SOI
+    while (pos + 4 <= jpeg.size() && jpeg[pos] == 0xFF)
+    {
+        uint8_t marker = jpeg[pos + 1];
+        size_t length  = (jpeg[pos + 2] << 8) | jpeg[pos + 3];
+
+        if (marker == 0xC0 || marker == 0xC1)
+            *sofHeight = pos + 5;
+
+        pos += 2 + length;
+
+        if (marker == 0xDA)
+            return pos;
+    }
+    return 0;
+}
 
 MJPEGEncoder::MJPEGEncoder()
 {
     name = "MJPEG";
+    compressors.emplace_back(new Compressor());
 }
 
 MJPEGEncoder::~MJPEGEncoder()
 {
-    delete [] jpegBuffer;
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        workersAboutToQuit = true;
+        workStart.notify_all();
+    }
+
+    for (auto &worker : workers)
+        worker.join();
+
+#ifdef HAVE_TURBOJPEG
+    if (tjHandle)
+        tjDestroy(tjHandle);
+    tjFree(tjBuffer);
+#endif
 }
 
 const char *MJPEGEncoder::getDeviceName()
@@ -73,134 +241,216 @@ bool MJPEGEncoder::upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint3
         return false;
     }
 
-    INDI_UNUSED(nbytes);
-    int bufsize = rawWidth * rawHeight * ((pixelFormat == INDI_RGB) ? 3 : 1);
-    if (bufsize != jpegBufferSize)
+    components   = (pixelFormat == INDI_RGB) ? 3 : 1;
+    sourceStride = static_cast<uint32_t>(rawWidth) * components;
+
+    if (nbytes < static_cast<uint64_t>(sourceStride) * rawHeight)
     {
-        delete [] jpegBuffer;
-        jpegBuffer = new uint8_t[bufsize];
-        jpegBufferSize = bufsize;
+        LOGF_ERROR("Frame size %u is less than expected %llu bytes.", nbytes,
+                   static_cast<unsigned long long>(sourceStride) * rawHeight);
+        return false;
     }
 
-    // Scale image DOWN by this factor
-    // 640 is now selected arbitrary to test mpeg streaming performance
-    int scale = std::max(1, static_cast<int>(std::floor(rawWidth / SCALE_WIDTH)));
-    if (pixelFormat == INDI_RGB)
-        jpeg_compress_8u_rgb(buffer, rawWidth, rawHeight, rawWidth * 3, scale, jpegBuffer, &bufsize, 85);
+    // Read the settings once so that all strips of the frame use the same ones
+    frameQuality = quality;
+    const int maxWidth = maxPreviewWidth;
+
+    // Scale image DOWN by integer factor to fit the preview width
+    scale = 1;
+    if (maxWidth > 0 && rawWidth > maxWidth)
+        scale = (rawWidth + maxWidth - 1) / maxWidth;
+
+    previewWidth  = rawWidth / scale;
+    previewHeight = rawHeight / scale;
+    source = buffer;
+
+    if (scale > 1)
+        previewBuffer.resize(static_cast<size_t>(previewWidth) * previewHeight * components);
+
+    // Split large frames into strips of whole MCU rows, each strip is downscaled and encoded by one thread
+    const uint16_t mcuRows = (components == 3) ? 16 : 8;
+    size_t stripCount = 1;
+    if (static_cast<uint32_t>(rawWidth) * rawHeight >= PARALLEL_MIN_PIXELS)
+    {
+        size_t threads = std::max(1u, std::thread::hardware_concurrency());
+        stripCount = std::max<size_t>(1, std::min<size_t>(threads, previewHeight / MIN_STRIP_ROWS));
+    }
+
+    uint16_t stripHeight = ((previewHeight + stripCount - 1) / stripCount + mcuRows - 1) / mcuRows * mcuRows;
+    strips.clear();
+    for (uint16_t y = 0; y < previewHeight; y += stripHeight)
+        strips.push_back(Strip{y, static_cast<uint16_t>(std::min<int>(stripHeight, previewHeight - y))});
+
+    restartMarkers = strips.size() > 1;
+
+    if (strips.size() == 1)
+    {
+        const uint8_t *frame = buffer;
+        int stride = sourceStride;
+        if (scale > 1)
+        {
+            downscale(buffer, sourceStride, previewBuffer.data(), previewWidth, components, scale, 0, previewHeight,
+                      compressors[0]->sums);
+            frame  = previewBuffer.data();
+            stride = previewWidth * components;
+        }
+
+#ifdef HAVE_TURBOJPEG
+        if (tjHandle == nullptr)
+            tjHandle = tjInitCompress();
+
+        if (tjHandle != nullptr &&
+                tjCompress2(tjHandle, frame, previewWidth, stride, previewHeight, (components == 3) ? TJPF_RGB : TJPF_GRAY,
+                            &tjBuffer, &tjBufferSize, (components == 3) ? TJSAMP_420 : TJSAMP_GRAY, frameQuality, 0) == 0)
+        {
+            bp->setBlob(tjBuffer);
+            bp->setBlobLen(tjBufferSize);
+            bp->setSize(tjBufferSize);
+            bp->setFormat(".stream_jpg");
+            return true;
+        }
+#endif
+        compressors[0]->compress(frame, previewWidth, previewHeight, stride, components, frameQuality, false);
+        jpegFrame.swap(compressors[0]->output);
+    }
     else
-        jpeg_compress_8u_gray(buffer, rawWidth, rawHeight, rawWidth, scale, jpegBuffer, &bufsize, 85);
+    {
+        // Start workers on first use, strip 0 is encoded by the calling thread
+        while (compressors.size() < strips.size())
+            compressors.emplace_back(new Compressor());
+        while (workers.size() + 1 < strips.size())
+            workers.emplace_back(&MJPEGEncoder::workerThread, this, workers.size() + 1, workGeneration);
+
+        {
+            std::lock_guard<std::mutex> lock(workMutex);
+            workPending = strips.size() - 1;
+            ++workGeneration;
+            workStart.notify_all();
+        }
+
+        encodeStrip(0);
+
+        {
+            std::unique_lock<std::mutex> lock(workMutex);
+            workDone.wait(lock, [this]()
+            {
+                return workPending == 0;
+            });
+        }
+
+        if (joinStrips(jpegFrame) == false)
+        {
+            LOG_ERROR("Failed to join JPEG strips.");
+            return false;
+        }
+    }
 
-    bp->setBlob(jpegBuffer);
-    bp->setBlobLen(bufsize);
-    bp->setSize(bufsize);
+    bp->setBlob(jpegFrame.data());
+    bp->setBlobLen(jpegFrame.size());
+    bp->setSize(jpegFrame.size());
     bp->setFormat(".stream_jpg");
 
     return true;
 }
 
-/*
-FROM: https://svn.csail.mit.edu/rrg_pods/jpeg-utils/
+void MJPEGEncoder::workerThread(size_t index, uint64_t generation)
+{
+    std::unique_lock<std::mutex> lock(workMutex);
+    for (;;)
+    {
+        workStart.wait(lock, [&]()
+        {
+            return workersAboutToQuit || workGeneration != generation;
+        });
 
-Name:         jpeg-utils
-Maintainers:  Albert Huang <albert@csail.mit.edu>
-Summary:      Wrapper functions around libjpeg to simplify JPEG compression and
-              decompression with in-memory buffers.
-Description:
-  note: This is a simple enough library that you could just copy the .c
-  and .h files in to your own programs.
+        if (workersAboutToQuit)
+            break;
 
-  To use the library, link against -ljpeg-utils, or use
-  pkg-config --cflags --libs jpeg-utils
+        generation = workGeneration;
 
-Requirements:
-  libjpeg62
+        if (index >= strips.size())
+            continue;
 
-  For faster performance, install libjpeg-turbo, an SSE-accelerated
-  library that is ABI compatible with libjpeg62.
-*/
+        lock.unlock();
+        encodeStrip(index);
+        lock.lock();
 
-int MJPEGEncoder::jpeg_compress_8u_gray (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale,
-        uint8_t * dest,
-        int * destsize, int quality)
+        if (--workPending == 0)
+            workDone.notify_all();
+    }
+}
+
+void MJPEGEncoder::encodeStrip(size_t index)
 {
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    struct jpeg_destination_mgr jdest;
-    int out_size = *destsize;
-
-    cinfo.err = jpeg_std_error (&jerr);
-    jpeg_create_compress (&cinfo);
-    jdest.next_output_byte = dest;
-    jdest.free_in_buffer = out_size;
-    jdest.init_destination = init_destination;
-    jdest.empty_output_buffer = empty_output_buffer;
-    jdest.term_destination = term_destination;
-    cinfo.dest = &jdest;
-
-    cinfo.image_width = width;
-    cinfo.image_height = height;
-#if JPEG_LIB_VERSION >= 70
-    cinfo.scale_denom = scale;
-#else
-    INDI_UNUSED(scale);
-#endif
-    cinfo.input_components = 1;
-    cinfo.in_color_space = JCS_GRAYSCALE;
-    jpeg_set_defaults (&cinfo);
-    jpeg_set_quality (&cinfo, quality, TRUE);
+    const Strip &strip = strips[index];
+    Compressor *compressor = compressors[index].get();
+
+    const uint8_t *frame = source + static_cast<size_t>(strip.y) * sourceStride;
+    int stride = sourceStride;
 
-    jpeg_start_compress (&cinfo, TRUE);
-    while (cinfo.next_scanline < height)
+    if (scale > 1)
     {
-        JSAMPROW row = (JSAMPROW)(src + cinfo.next_scanline * stride);
-        jpeg_write_scanlines (&cinfo, &row, 1);
+        downscale(source, sourceStride, previewBuffer.data(), previewWidth, components, scale,
+                  strip.y, strip.y + strip.height, compressor->sums);
+        stride = previewWidth * components;
+        frame  = previewBuffer.data() + static_cast<size_t>(strip.y) * stride;
     }
 
-    jpeg_finish_compress (&cinfo);
-    *destsize = out_size - jdest.free_in_buffer;
-    jpeg_destroy_compress (&cinfo);
-    return 0;
+    compressor->compress(frame, previewWidth, strip.height, stride, components, frameQuality, restartMarkers);
 }
 
-int MJPEGEncoder::jpeg_compress_8u_rgb (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale,
-                                        uint8_t * dest, int * destsize, int quality)
+bool MJPEGEncoder::joinStrips(std::vector<uint8_t> &output)
 {
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    struct jpeg_destination_mgr jdest;
-    int out_size = *destsize;
-
-    cinfo.err = jpeg_std_error (&jerr);
-    jpeg_create_compress (&cinfo);
-    jdest.next_output_byte = dest;
-    jdest.free_in_buffer = out_size;
-    jdest.init_destination = init_destination;
-    jdest.empty_output_buffer = empty_output_buffer;
-    jdest.term_destination = term_destination;
-    cinfo.dest = &jdest;
-
-    cinfo.image_width = width;
-    cinfo.image_height = height;
-#if JPEG_LIB_VERSION >= 70
-    cinfo.scale_denom = scale;
-#else
-    INDI_UNUSED(scale);
-#endif
-    cinfo.input_components = 3;
-    cinfo.in_color_space = JCS_RGB;
-    jpeg_set_defaults (&cinfo);
-    jpeg_set_quality (&cinfo, quality, TRUE);
+    const uint16_t mcuRows = (components == 3) ? 16 : 8;
 
-    jpeg_start_compress (&cinfo, TRUE);
-    while (cinfo.next_scanline < height)
+    output.clear();
+
+    size_t intervals = 0; // restart intervals written so far
+    for (size_t i = 0; i < strips.size(); ++i)
     {
-        JSAMPROW row = (JSAMPROW)(src + cinfo.next_scanline * stride);
-        jpeg_write_scanlines (&cinfo, &row, 1);
+        const std::vector<uint8_t> &jpeg = compressors[i]->output;
+        size_t sofHeight = 0;
+        size_t scanData  = findScanData(jpeg, &sofHeight);
+
+        if (scanData == 0 || sofHeight == 0 || jpeg.size() < scanData + 2 || jpeg[jpeg.size() - 2] != 0xFF
+                || jpeg[jpeg.size() - 1] != 0xD9)
+            return false;
+
+        if (i == 0)
+        {
+            // Headers of the first strip, with the height of the whole frame
+            output.insert(output.end(), jpeg.begin(), jpeg.begin() + scanData);
+            output[sofHeight]     = previewHeight >> 8;
+            output[sofHeight + 1] = previewHeight & 0xFF;
+        }
+        else
+        {
+            // Restart marker between strips
+            output.push_back(0xFF);
+            output.push_back(0xD0 + ((intervals - 1) & 7));
+        }
+
+        // Entropy coded data without EOI, restart markers renumbered to continue the sequence
+        size_t start = output.size();
+        output.insert(output.end(), jpeg.begin() + scanData, jpeg.end() - 2);
+        if (intervals > 0)
+        {
+            for (size_t j = start; j + 1 < output.size(); ++j)
+            {
+                if (output[j] == 0xFF && output[j + 1] >= 0xD0 && output[j + 1] <= 0xD7)
+                {
+                    output[j + 1] = 0xD0 + ((output[j + 1] - 0xD0 + intervals) & 7);
+                    ++j;
+                }
+            }
+        }
+
+        intervals += (strips[i].height + mcuRows - 1) / mcuRows;
     }
-    jpeg_finish_compress (&cinfo);
-    *destsize = out_size - jdest.free_in_buffer;
-    jpeg_destroy_compress (&cinfo);
-    return 0;
+
+    output.push_back(0xFF);
+    output.push_back(0xD9);
+    return true;
 }
 
 }
@@ -23,13 +23,22 @@
 
 #include "encoderinterface.h"
 
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 namespace INDI
 {
 
 /**
  * @brief The MJPEGEncoder class encodes frames in JPEG format before transmitting them to the client.
  *
- * The quality is now hard-coded at 70 when encoding the JPEG image. Further compression is not supported.
+ * Frames wider than the preview width are downscaled by an integer factor before encoding.
+ * Compressor state is kept across frames. Large frames are split into horizontal strips that are encoded
+ * in parallel with one restart interval per MCU row, and the strips are joined into a single baseline JPEG.
+ * Small frames are encoded with TurboJPEG when available.
  */
 class MJPEGEncoder : public EncoderInterface
 {
@@ -40,16 +49,52 @@ class MJPEGEncoder : public EncoderInterface
         virtual bool upload(INDI::WidgetViewBlob *bp, const uint8_t *buffer, uint32_t nbytes, bool isCompressed = false) override;
 
     private:
+        struct Compressor;
+        struct Strip
+        {
+            uint16_t y, height;          // output rows
+        };
+
         const char *getDeviceName();
-        int jpeg_compress_8u_gray (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale, uint8_t * dest,
-                                   int * destsize, int quality);
-        int jpeg_compress_8u_rgb (const uint8_t * src, uint16_t width, uint16_t height, int stride, int scale, uint8_t * dest,
-                                  int * destsize, int quality);
-        uint8_t *jpegBuffer = nullptr;
-        uint16_t jpegBufferSize = 1;
 
-        static const int SCALE_WIDTH = 640;
+        // Downscale rows of the source frame into the preview frame and encode them
+        void encodeStrip(size_t index);
+        void workerThread(size_t index, uint64_t generation);
+        bool joinStrips(std::vector<uint8_t> &output);
+
+        std::vector<std::unique_ptr<Compressor>> compressors;
+        std::vector<std::thread> workers;
+        std::vector<Strip> strips;
+
+        std::mutex workMutex;
+        std::condition_variable workStart;
+        std::condition_variable workDone;
+        uint64_t workGeneration = 0;
+        size_t workPending = 0;
+        bool workersAboutToQuit = false;
+
+        // Current frame
+        const uint8_t *source = nullptr;
+        uint32_t sourceStride = 0;
+        uint16_t scale = 1;
+        int frameQuality = 85;
+        uint16_t previewWidth = 0, previewHeight = 0;
+        uint8_t components = 1;
+        bool restartMarkers = false;
+
+        std::vector<uint8_t> previewBuffer;
+        std::vector<uint8_t> jpegFrame;
+
+#ifdef HAVE_TURBOJPEG
+        void *tjHandle = nullptr;
+        uint8_t *tjBuffer = nullptr;
+        unsigned long tjBufferSize = 0;
+#endif
 
+        // Frames smaller than this are encoded in one piece
+        static const uint32_t PARALLEL_MIN_PIXELS = 512 * 1024;
+        // Strips are at least this number of rows
+        static const uint16_t MIN_STRIP_ROWS = 64;
 };
 
 }
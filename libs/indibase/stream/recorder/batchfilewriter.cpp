@@ -0,0 +1,315 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    Batch File Writer
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "batchfilewriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define ERRMSGSIZ 1024
+
+namespace INDI
+{
+
+BatchFileWriter::BatchFileWriter(size_t batchSize, size_t batchCount)
+    : batchSize((batchSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT)
+{
+    if (batchCount < 2)
+        batchCount = 2;
+
+    for (size_t i = 0; i < batchCount; ++i)
+    {
+        void *buffer = nullptr;
+        if (posix_memalign(&buffer, ALIGNMENT, this->batchSize) == 0)
+            buffers.push_back(static_cast<uint8_t *>(buffer));
+    }
+}
+
+BatchFileWriter::~BatchFileWriter()
+{
+    close();
+
+    for (uint8_t *buffer : buffers)
+        free(buffer);
+}
+
+bool BatchFileWriter::open(const char *filename, uint32_t options, char *errmsg)
+{
+    if (isOpen())
+        close();
+
+    if (buffers.size() < 2)
+    {
+        snprintf(errmsg, ERRMSGSIZ, "recorder open error, cannot allocate write buffers");
+        return false;
+    }
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    direct = false;
+#ifdef O_DIRECT
+    if (options & DIRECT_IO)
+    {
+        fd = ::open(filename, flags | O_DIRECT, 0644);
+        direct = (fd >= 0);
+    }
+#endif
+
+    // Not supported by the file system (e.g. tmpfs), use the page cache
+    if (fd < 0)
+        fd = ::open(filename, flags, 0644);
+
+    if (fd < 0)
+    {
+        snprintf(errmsg, ERRMSGSIZ, "recorder open error %d, %s\n", errno, strerror(errno));
+        return false;
+    }
+
+    preallocate = (options & PREALLOCATE);
+    failed = false;
+    isAboutToQuit = false;
+    appended = written = allocated = 0;
+
+    filled.clear();
+    available.assign(buffers.begin(), buffers.end());
+    inFlight = 0;
+
+    current.data = available.front();
+    current.used = 0;
+    available.pop_front();
+
+    thread = std::thread(&BatchFileWriter::run, this);
+    return true;
+}
+
+bool BatchFileWriter::write(const void *data, size_t size)
+{
+    if (!isOpen() || failed)
+        return false;
+
+    const uint8_t *source = static_cast<const uint8_t *>(data);
+    appended += size;
+
+    while (size > 0)
+    {
+        size_t chunk = std::min(size, batchSize - current.used);
+        memcpy(current.data + current.used, source, chunk);
+        current.used += chunk;
+        source += chunk;
+        size -= chunk;
+
+        if (current.used == batchSize && submit() == false)
+            return false;
+    }
+
+    return true;
+}
+
+bool BatchFileWriter::submit()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    filled.push_back(current);
+    ++inFlight;
+    filledChanged.notify_one();
+
+    availableChanged.wait(lock, [this]()
+    {
+        return !available.empty() || failed;
+    });
+
+    if (failed)
+    {
+        current = {nullptr, 0};
+        return false;
+    }
+
+    current.data = available.front();
+    current.used = 0;
+    available.pop_front();
+    return true;
+}
+
+bool BatchFileWriter::flush()
+{
+    if (!isOpen())
+        return false;
+
+    if (current.data != nullptr && current.used > 0 && failed == false)
+    {
+        // the tail is not aligned, it's written by writeBatch without O_DIRECT
+        if (submit() == false)
+            return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    availableChanged.wait(lock, [this]()
+    {
+        return inFlight == 0 || failed;
+    });
+
+    return !failed;
+}
+
+bool BatchFileWriter::writeAt(uint64_t offset, const void *data, size_t size)
+{
+    if (!isOpen())
+        return false;
+
+#ifdef O_DIRECT
+    if (direct)
+    {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+        direct = false;
+    }
+#endif
+
+    const uint8_t *source = static_cast<const uint8_t *>(data);
+    while (size > 0)
+    {
+        ssize_t n = pwrite(fd, source, size, offset);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        source += n;
+        offset += n;
+        size   -= n;
+    }
+    return true;
+}
+
+bool BatchFileWriter::close()
+{
+    if (!isOpen())
+        return true;
+
+    bool ok = flush();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isAboutToQuit = true;
+        filledChanged.notify_all();
+    }
+
+    if (thread.joinable())
+        thread.join();
+
+    // release space preallocated past the end of data
+    if (allocated > written && ftruncate(fd, written) != 0)
+        ok = false;
+
+    if (::close(fd) != 0)
+        ok = false;
+
+    fd = -1;
+    current = {nullptr, 0};
+    return ok;
+}
+
+void BatchFileWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        filledChanged.wait(lock, [this]()
+        {
+            return !filled.empty() || isAboutToQuit;
+        });
+
+        if (filled.empty())
+            break;
+
+        Batch batch = filled.front();
+        filled.pop_front();
+
+        lock.unlock();
+        bool ok = failed == false && writeBatch(batch);
+        lock.lock();
+
+        if (!ok)
+            failed = true;
+
+        available.push_back(batch.data);
+        --inFlight;
+        availableChanged.notify_all();
+    }
+}
+
+bool BatchFileWriter::writeBatch(const Batch &batch)
+{
+#ifdef __linux__
+    if (preallocate && written + batch.used > allocated)
+    {
+        if (fallocate(fd, FALLOC_FL_KEEP_SIZE, allocated, PREALLOCATE_STEP) == 0)
+            allocated += PREALLOCATE_STEP;
+        else
+            preallocate = false; // not supported, do not try again
+    }
+#endif
+
+    size_t size = batch.used;
+    const uint8_t *data = batch.data;
+
+#ifdef O_DIRECT
+    // Only the last batch can be partial. Write the aligned part directly and the rest through the page cache.
+    if (direct && (size % ALIGNMENT) != 0)
+    {
+        size_t aligned = size / ALIGNMENT * ALIGNMENT;
+        if (aligned > 0 && writeAll(data, aligned) == false)
+            return false;
+
+        data += aligned;
+        size -= aligned;
+
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+        direct = false;
+    }
+#endif
+
+    return writeAll(data, size);
+}
+
+bool BatchFileWriter::writeAll(const uint8_t *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data    += n;
+        size    -= n;
+        written += n;
+    }
+    return true;
+}
+
+}
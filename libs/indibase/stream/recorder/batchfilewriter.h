@@ -0,0 +1,156 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    Batch File Writer
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+namespace INDI
+{
+
+/**
+ * @brief The BatchFileWriter class appends data to a file in large aligned batches written by a dedicated thread.
+ *
+ * Data passed to write() is copied into the current batch. Full batches are handed to the writer thread
+ * and the caller continues with the next free batch, so the caller only waits when all batches are in flight.
+ * Nothing is ever dropped.
+ *
+ * Optionally the file is opened with O_DIRECT to bypass the page cache, and disk space is preallocated
+ * ahead of the writes with fallocate. Both options silently fall back when the file system does not support them.
+ */
+class BatchFileWriter
+{
+    public:
+        enum Options
+        {
+            DIRECT_IO   = 1 << 0,
+            PREALLOCATE = 1 << 1
+        };
+
+        // O_DIRECT requires buffers, offsets and sizes aligned to the logical block size
+        static const size_t ALIGNMENT        = 4096;
+        static const size_t DEFAULT_BATCH    = 8 * 1024 * 1024;
+        static const size_t DEFAULT_BATCHES  = 4;
+        static const uint64_t PREALLOCATE_STEP = 256 * 1024 * 1024;
+
+    public:
+        /**
+         * @param batchSize size of a single batch, rounded up to ALIGNMENT
+         * @param batchCount number of batches, at least two
+         */
+        explicit BatchFileWriter(size_t batchSize = DEFAULT_BATCH, size_t batchCount = DEFAULT_BATCHES);
+        ~BatchFileWriter();
+
+    public:
+        /**
+         * @brief Create the file and start the writer thread
+         * @param options bitwise OR of Options
+         * @param errmsg error message buffer, as for RecorderInterface::open
+         */
+        bool open(const char *filename, uint32_t options, char *errmsg);
+
+        /**
+         * @brief Append data to the file, blocks only if all batches are waiting for the disk
+         * @return false if a previous write failed
+         */
+        bool write(const void *data, size_t size);
+
+        /**
+         * @brief Write all pending data to the file and wait for the writer thread
+         */
+        bool flush();
+
+        /**
+         * @brief Overwrite already flushed data, e.g. a file header
+         */
+        bool writeAt(uint64_t offset, const void *data, size_t size);
+
+        /**
+         * @brief Flush, trim preallocated space and close the file
+         */
+        bool close();
+
+        bool isOpen() const
+        {
+            return fd >= 0;
+        }
+
+        /**
+         * @brief Number of bytes appended since open
+         */
+        uint64_t size() const
+        {
+            return appended;
+        }
+
+        /**
+         * @brief True if the file is opened with O_DIRECT
+         */
+        bool isDirect() const
+        {
+            return direct;
+        }
+
+    protected:
+        struct Batch
+        {
+            uint8_t *data;
+            size_t used;
+        };
+
+        void run();
+        bool writeBatch(const Batch &batch);
+        bool writeAll(const uint8_t *data, size_t size);
+        bool submit();
+
+    protected:
+        size_t batchSize;
+        std::vector<uint8_t *> buffers;
+
+        int fd = -1;
+        std::atomic<bool> direct {false};
+        bool preallocate = false;
+        std::atomic<bool> failed {false};
+        bool isAboutToQuit = false;
+
+        uint64_t appended = 0;     // bytes passed to write()
+        uint64_t written = 0;      // bytes written to the file by the writer thread
+        uint64_t allocated = 0;    // bytes preallocated with fallocate
+
+        Batch current {nullptr, 0};
+        std::deque<Batch> filled;
+        std::deque<uint8_t *> available;
+        size_t inFlight = 0;
+
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable filledChanged;
+        std::condition_variable availableChanged;
+};
+
+}
@@ -71,6 +71,11 @@ class RecorderInterface
             m_FPS = FPS;
             return true;
         }
+        // Set write options, see BatchFileWriter::Options. Ignored by recorders that do not support them.
+        virtual void setWriteOptions(uint32_t options)
+        {
+            m_WriteOptions = options;
+        }
         virtual bool open(const char *filename, char *errmsg)                          = 0;
         virtual bool close()                                                           = 0;
         // when frame is in known encoding format
@@ -83,6 +88,7 @@ class RecorderInterface
     protected:
         const char *name;
         float m_FPS = 1;
+        uint32_t m_WriteOptions = 0;
 };
 
 }
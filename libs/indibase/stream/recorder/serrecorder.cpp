@@ -33,7 +33,6 @@
 #include <cstring>
 #include <sys/time.h>
 
-
 #define ERRMSGSIZ 1024
 
 namespace INDI
@@ -53,66 +52,46 @@ SER_Recorder::SER_Recorder()
     // always default to. LITTLE_ENDIAN appears to be ignored by them leading to garbled data.
     serh.LittleEndian = SER_BIG_ENDIAN;
     isRecordingActive = false;
-    f = nullptr;
 
     jpegBuffer = static_cast<uint8_t*>(malloc(1));
 }
 
 SER_Recorder::~SER_Recorder()
 {
+    if (stampFile)
+        fclose(stampFile);
     free(jpegBuffer);
 }
 
-bool SER_Recorder::is_little_endian()
+void SER_Recorder::put_int_le(uint8_t *buffer, uint32_t i)
 {
-    unsigned int magic        = 0x00000001;
-    unsigned char black_magic = *(unsigned char *)&magic;
-    return black_magic == 0x01;
-}
-
-void SER_Recorder::write_int_le(uint32_t *i)
-{
-    if (is_little_endian())
-        fwrite((i), sizeof(uint32_t), 1, f);
-    else
-    {
-        unsigned char *c = (unsigned char *)i;
-        fwrite((c + 3), sizeof(char), 1, f);
-        fwrite((c + 2), sizeof(char), 1, f);
-        fwrite((c + 1), sizeof(char), 1, f);
-        fwrite((c), sizeof(char), 1, f);
-    }
+    buffer[0] = i & 0xFF;
+    buffer[1] = (i >> 8) & 0xFF;
+    buffer[2] = (i >> 16) & 0xFF;
+    buffer[3] = (i >> 24) & 0xFF;
 }
 
-void SER_Recorder::write_long_int_le(uint64_t *i)
+void SER_Recorder::put_long_int_le(uint8_t *buffer, uint64_t i)
 {
-    if (is_little_endian())
-    {
-        fwrite(((uint32_t *)i), sizeof(int), 1, f);
-        fwrite(((uint32_t *)(i) + 1), sizeof(int), 1, f);
-    }
-    else
-    {
-        write_int_le((uint32_t *)(i) + 1);
-        write_int_le((uint32_t *)(i));
-    }
+    put_int_le(buffer, i & 0xFFFFFFFF);
+    put_int_le(buffer + 4, i >> 32);
 }
 
-void SER_Recorder::write_header(ser_header *s)
+void SER_Recorder::serialize_header(const ser_header *s, uint8_t *buffer)
 {
-    fwrite((s->FileID), sizeof(char), 14, f);
-    write_int_le(&(s->LuID));
-    write_int_le(&(s->ColorID));
-    write_int_le(&(s->LittleEndian));
-    write_int_le(&(s->ImageWidth));
-    write_int_le(&(s->ImageHeight));
-    write_int_le(&(s->PixelDepth));
-    write_int_le(&(s->FrameCount));
-    fwrite((s->Observer), sizeof(char), 40, f);
-    fwrite((s->Instrume), sizeof(char), 40, f);
-    fwrite((s->Telescope), sizeof(char), 40, f);
-    write_long_int_le(&(s->DateTime));
-    write_long_int_le(&(s->DateTime_UTC));
+    memcpy(buffer, s->FileID, 14);
+    put_int_le(buffer + 14, s->LuID);
+    put_int_le(buffer + 18, s->ColorID);
+    put_int_le(buffer + 22, s->LittleEndian);
+    put_int_le(buffer + 26, s->ImageWidth);
+    put_int_le(buffer + 30, s->ImageHeight);
+    put_int_le(buffer + 34, s->PixelDepth);
+    put_int_le(buffer + 38, s->FrameCount);
+    memcpy(buffer + 42, s->Observer, 40);
+    memcpy(buffer + 82, s->Instrume, 40);
+    memcpy(buffer + 122, s->Telescope, 40);
+    put_long_int_le(buffer + 162, s->DateTime);
+    put_long_int_le(buffer + 170, s->DateTime_UTC);
 }
 
 bool SER_Recorder::setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t pixelDepth)
@@ -175,15 +154,34 @@ bool SER_Recorder::open(const char *filename, char *errmsg)
     if (isRecordingActive)
         return false;
     serh.FrameCount = 0;
-    if ((f = fopen(filename, "w")) == nullptr)
+    if (writer.open(filename, m_WriteOptions, errmsg) == false)
+        return false;
+
+    if (stampFile)
+        fclose(stampFile);
+    stampFile = tmpfile();
+    if (stampFile == nullptr)
     {
-        snprintf(errmsg, ERRMSGSIZ, "recorder open error %d, %s\n", errno, strerror(errno));
+        snprintf(errmsg, ERRMSGSIZ, "recorder open error, cannot create timestamp file. %s", strerror(errno));
+        writer.close();
         return false;
     }
 
     serh.DateTime     = getLocalTimeStamp();
     serh.DateTime_UTC = getUTCTimeStamp();
-    write_header(&serh);
+
+    // Header is rewritten on close with the final frame count
+    uint8_t header[SER_HEADER_SIZE];
+    serialize_header(&serh, header);
+    if (writer.write(header, sizeof(header)) == false)
+    {
+        snprintf(errmsg, ERRMSGSIZ, "recorder open error, cannot write SER header");
+        writer.close();
+        fclose(stampFile);
+        stampFile = nullptr;
+        return false;
+    }
+
     frame_size        = serh.ImageWidth * serh.ImageHeight * (serh.PixelDepth <= 8 ? 1 : 2) * number_of_planes;
     isRecordingActive = true;
 
@@ -194,22 +192,21 @@ bool SER_Recorder::open(const char *filename, char *errmsg)
 
 bool SER_Recorder::close()
 {
-    if (f)
+    bool ok = true;
+
+    if (writer.isOpen())
     {
         // Write all timestamps
-        for (auto value : frameStamps)
-            write_long_int_le(&value);
+        ok = writeTimestamps();
 
-        frameStamps.clear();
-
-        fseek(f, 0L, SEEK_SET);
-        write_header(&serh);
-        fclose(f);
-        f = nullptr;
+        uint8_t header[SER_HEADER_SIZE];
+        serialize_header(&serh, header);
+        ok = writer.flush() && writer.writeAt(0, header, sizeof(header)) && ok;
+        ok = writer.close() && ok;
     }
 
     isRecordingActive = false;
-    return true;
+    return ok;
 }
 
 bool SER_Recorder::writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t timestamp)
@@ -253,10 +250,15 @@ bool SER_Recorder::writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t ti
     }
 #endif
 
-    if(timestamp)
-        frameStamps.push_back(timestamp * m_sepaseconds_per_microsecond);
-    else
-        frameStamps.push_back(getUTCTimeStamp());
+    uint8_t stamp[8];
+    put_long_int_le(stamp, timestamp ? timestamp * m_sepaseconds_per_microsecond : getUTCTimeStamp());
+    frameStamps.insert(frameStamps.end(), stamp, stamp + sizeof(stamp));
+    if (frameStamps.size() >= STAMP_BATCH)
+    {
+        if (fwrite(frameStamps.data(), 1, frameStamps.size(), stampFile) != frameStamps.size())
+            return false;
+        frameStamps.clear();
+    }
 
     // Not technically pixel format, but let's use this for now.
     if (m_PixelFormat == INDI_JPG)
@@ -269,14 +271,39 @@ bool SER_Recorder::writeFrame(const uint8_t *frame, uint32_t nbytes, uint64_t ti
         serh.ImageWidth = w;
         serh.ImageHeight = h;
         serh.ColorID = (naxis == 3) ? SER_RGB : SER_MONO;
-        fwrite(jpegBuffer, 1, memsize, f);
+        if (writer.write(jpegBuffer, memsize) == false)
+            return false;
     }
-    else
-        fwrite(frame, 1, nbytes, f);
+    else if (writer.write(frame, nbytes) == false)
+        return false;
+
     serh.FrameCount += 1;
     return true;
 }
 
+bool SER_Recorder::writeTimestamps()
+{
+    bool ok = stampFile != nullptr;
+
+    if (ok)
+    {
+        // Spilled timestamps first, then the ones still in memory
+        std::vector<uint8_t> buffer(STAMP_BATCH);
+        size_t n;
+        ok = fflush(stampFile) == 0 && fseek(stampFile, 0, SEEK_SET) == 0;
+        while (ok && (n = fread(buffer.data(), 1, buffer.size(), stampFile)) > 0)
+            ok = writer.write(buffer.data(), n);
+        ok = ok && ferror(stampFile) == 0;
+
+        fclose(stampFile);
+        stampFile = nullptr;
+    }
+
+    ok = ok && writer.write(frameStamps.data(), frameStamps.size());
+    frameStamps.clear();
+    return ok;
+}
+
 // Copyright (C) 2015 Chris Garry
 //
 
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "recorderinterface.h"
+#include "batchfilewriter.h"
 
 #include <cstdint>
 #include <stdio.h>
@@ -61,6 +62,9 @@ enum ser_color_id
 #define SER_BIG_ENDIAN    0
 #define SER_LITTLE_ENDIAN 1
 
+// Size of the serialized header, the ser_header struct is not packed
+#define SER_HEADER_SIZE   178
+
 namespace INDI
 {
 
@@ -93,17 +97,21 @@ class SER_Recorder : public RecorderInterface
 
     protected:
         uint64_t utcTo64BitTS();
-        bool is_little_endian();
-        void write_int_le(uint32_t *i);
-        void write_long_int_le(uint64_t *i);
-        void write_header(ser_header *s);
+        static void put_int_le(uint8_t *buffer, uint32_t i);
+        static void put_long_int_le(uint8_t *buffer, uint64_t i);
+        static void serialize_header(const ser_header *s, uint8_t *buffer);
+        bool writeTimestamps();
         ser_header serh;
         bool isRecordingActive = false, isStreamingActive = false;
-        FILE *f;
+        BatchFileWriter writer;
         uint32_t frame_size;
         uint32_t number_of_planes;
         uint16_t rawWidth = 0, rawHeight = 0;
-        std::vector<uint64_t> frameStamps;
+        // Trailer timestamps, already serialized as little endian and appended after the last frame on close.
+        // They are spilled to a temporary file every STAMP_BATCH bytes, so long recordings use bounded memory.
+        static const size_t STAMP_BATCH = 64 * 1024;
+        std::vector<uint8_t> frameStamps;
+        FILE *stampFile = nullptr;
 
     private:
         // From pipp_timestamp.h
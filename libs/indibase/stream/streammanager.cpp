@@ -24,11 +24,11 @@
 #include <config.h>
 #include "streammanager.h"
 #include "streammanager_p.h"
+#include "recorder/batchfilewriter.h"
 #include "indiccd.h"
 #include "indisensorinterface.h"
 #include "indilogger.h"
 #include "indiutility.h"
-#include "indisinglethreadpool.h"
 #include "indielapsedtimer.h"
 
 #include <cerrno>
@@ -61,17 +61,25 @@ StreamManagerPrivate::StreamManagerPrivate(DefaultDevice *defaultDevice)
 
     LOGF_DEBUG("Using default encoder (%s)", encoder->getName());
 
-    framesThread = std::thread(&StreamManagerPrivate::asyncStreamThread, this);
+    framesIncoming.start([this](const SharedFrame &frame)
+    {
+        processFrame(frame);
+    });
+    framesRecord.start([this](const SharedFrame &frame)
+    {
+        recordFrame(frame);
+    });
+    framesPreview.start([this](const SharedFrame &frame)
+    {
+        previewFrame(frame);
+    });
 }
 
 StreamManagerPrivate::~StreamManagerPrivate()
 {
-    if (framesThread.joinable())
-    {
-        framesThreadTerminate = true;
-        framesIncoming.abort();
-        framesThread.join();
-    }
+    framesIncoming.stop();
+    framesRecord.stop();
+    framesPreview.stop();
 }
 
 StreamManager::StreamManager(DefaultDevice *mainDevice)
@@ -120,6 +128,14 @@ bool StreamManagerPrivate::initProperties()
     FpsNP[FPS_AVERAGE].fill("AVG_FPS", "Average (1 sec.)", "%.2f", 0.0, 999.0, 0.0, 30);
     FpsNP.fill(getDeviceName(), "FPS", "FPS", STREAM_TAB, IP_RO, 60, IPS_IDLE);
 
+    /* Pipeline Statistics */
+    PipelineNP[PIPELINE_INCOMING_DROPPED].fill("INCOMING_DROPPED", "Dropped (buffer full)", "%.f",   0, 1e12, 0, 0);
+    PipelineNP[PIPELINE_RECORD_FPS      ].fill("RECORD_FPS",       "Record FPS",            "%.2f",  0, 999,  0, 0);
+    PipelineNP[PIPELINE_RECORD_QUEUE    ].fill("RECORD_QUEUE",     "Record queue",          "%.f",   0, 1e12, 0, 0);
+    PipelineNP[PIPELINE_PREVIEW_FPS     ].fill("PREVIEW_FPS",      "Preview FPS",           "%.2f",  0, 999,  0, 0);
+    PipelineNP[PIPELINE_PREVIEW_DROPPED ].fill("PREVIEW_DROPPED",  "Preview dropped",       "%.f",   0, 1e12, 0, 0);
+    PipelineNP.fill(getDeviceName(), "STREAM_PIPELINE", "Pipeline", STREAM_TAB, IP_RO, 60, IPS_IDLE);
+
     /* Record Frames */
     /* File */
     // @INDI_STANDARD_PROPERTY@
@@ -136,6 +152,11 @@ bool StreamManagerPrivate::initProperties()
     RecordOptionsNP.fill(getDeviceName(), "RECORD_OPTIONS",
                          "Record Options", STREAM_TAB, IP_RW, 60, IPS_IDLE);
 
+    /* Record I/O */
+    RecordIOSP[RECORD_IO_DIRECT     ].fill("RECORD_IO_DIRECT",      "Direct I/O",  ISS_OFF);
+    RecordIOSP[RECORD_IO_PREALLOCATE].fill("RECORD_IO_PREALLOCATE", "Preallocate", ISS_OFF);
+    RecordIOSP.fill(getDeviceName(), "RECORD_IO", "Record I/O", STREAM_TAB, IP_RW, ISR_NOFMANY, 0, IPS_IDLE);
+
     /* Record Switch */
     // @INDI_STANDARD_PROPERTY@
     RecordStreamSP[RECORD_ON   ].fill("RECORD_ON",          "Record On",         ISS_OFF);
@@ -165,6 +186,11 @@ bool StreamManagerPrivate::initProperties()
     else
         EncoderSP.fill(getDeviceName(), "CCD_STREAM_ENCODER",    "Encoder", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
 
+    // Encoder Options
+    EncoderOptionsNP[ENCODER_QUALITY      ].fill("QUALITY",       "Quality",       "%.f", 1, 100,   1,  85);
+    EncoderOptionsNP[ENCODER_PREVIEW_WIDTH].fill("PREVIEW_WIDTH", "Preview width", "%.f", 0, 65535, 16, 640);
+    EncoderOptionsNP.fill(getDeviceName(), "STREAM_ENCODER_OPTIONS", "Encoder Options", STREAM_TAB, IP_RW, 0, IPS_IDLE);
+
     // Recorder Selector
     // @INDI_STANDARD_PROPERTY@
     RecorderSP[RECORDER_RAW].fill("SER", "SER", ISS_ON);
@@ -204,11 +230,14 @@ void StreamManagerPrivate::ISGetProperties(const char *dev)
         if (hasStreamingExposure)
             currentDevice->defineProperty(StreamExposureNP);
         currentDevice->defineProperty(FpsNP);
+        currentDevice->defineProperty(PipelineNP);
         currentDevice->defineProperty(RecordStreamSP);
         currentDevice->defineProperty(RecordFileTP);
         currentDevice->defineProperty(RecordOptionsNP);
+        currentDevice->defineProperty(RecordIOSP);
         currentDevice->defineProperty(StreamFrameNP);
         currentDevice->defineProperty(EncoderSP);
+        currentDevice->defineProperty(EncoderOptionsNP);
         currentDevice->defineProperty(RecorderSP);
         currentDevice->defineProperty(LimitsNP);
     }
@@ -238,11 +267,14 @@ bool StreamManagerPrivate::updateProperties()
         if (hasStreamingExposure)
             currentDevice->defineProperty(StreamExposureNP);
         currentDevice->defineProperty(FpsNP);
+        currentDevice->defineProperty(PipelineNP);
         currentDevice->defineProperty(RecordStreamSP);
         currentDevice->defineProperty(RecordFileTP);
         currentDevice->defineProperty(RecordOptionsNP);
+        currentDevice->defineProperty(RecordIOSP);
         currentDevice->defineProperty(StreamFrameNP);
         currentDevice->defineProperty(EncoderSP);
+        currentDevice->defineProperty(EncoderOptionsNP);
         currentDevice->defineProperty(RecorderSP);
         currentDevice->defineProperty(LimitsNP);
     }
@@ -253,11 +285,14 @@ bool StreamManagerPrivate::updateProperties()
         if (hasStreamingExposure)
             currentDevice->deleteProperty(StreamExposureNP.getName());
         currentDevice->deleteProperty(FpsNP.getName());
+        currentDevice->deleteProperty(PipelineNP.getName());
         currentDevice->deleteProperty(RecordFileTP.getName());
         currentDevice->deleteProperty(RecordStreamSP.getName());
         currentDevice->deleteProperty(RecordOptionsNP.getName());
+        currentDevice->deleteProperty(RecordIOSP.getName());
         currentDevice->deleteProperty(StreamFrameNP.getName());
         currentDevice->deleteProperty(EncoderSP.getName());
+        currentDevice->deleteProperty(EncoderOptionsNP.getName());
         currentDevice->deleteProperty(RecorderSP.getName());
         currentDevice->deleteProperty(LimitsNP.getName());
     }
@@ -301,6 +336,7 @@ void StreamManagerPrivate::newFrame(const uint8_t * buffer, uint32_t nbytes, uin
     if (FPSAverage.newFrame())
     {
         FpsNP[1].setValue(FPSAverage.framesPerSecond());
+        updatePipelineStatistics();
     }
 
     if (FPSFast.newFrame())
@@ -310,22 +346,29 @@ void StreamManagerPrivate::newFrame(const uint8_t * buffer, uint32_t nbytes, uin
             std::thread([&]()
         {
             FpsNP.apply();
+            PipelineNP.apply();
             fastFPSUpdate.unlock();
         }).detach();
     }
 
     if (isStreaming || (isRecording && !isRecordingAboutToClose))
     {
-        size_t allocatedSize = nbytes * framesIncoming.size() / 1024 / 1024; // allocated size in MB
+        // frames waiting for the recorder are still held in memory
+        size_t queuedFrames  = framesIncoming.size() + framesRecord.size();
+        size_t allocatedSize = nbytes * queuedFrames / 1024 / 1024; // allocated size in MB
         if (allocatedSize > LimitsNP[LIMITS_BUFFER_MAX].getValue())
         {
+            ++incomingDropped;
             LOG_WARN("Frame buffer is full, skipping frame...");
             return;
         }
 
-        std::vector<uint8_t> copyBuffer(buffer, buffer + nbytes); // copy the frame
+        std::shared_ptr<TimeFrame> frame = std::make_shared<TimeFrame>();
+        frame->time      = FPSFast.deltaTime();
+        frame->timestamp = timestamp;
+        frame->frame.assign(buffer, buffer + nbytes); // copy the frame
 
-        framesIncoming.push(TimeFrame{FPSFast.deltaTime(), timestamp, std::move(copyBuffer)}); // push it into the queue
+        framesIncoming.push(std::move(frame)); // push it into the queue
     }
 
     if (isRecording && !isRecordingAboutToClose)
@@ -339,7 +382,8 @@ void StreamManagerPrivate::newFrame(const uint8_t * buffer, uint32_t nbytes, uin
         )
         {
             LOG_INFO("Waiting for all buffered frames to be recorded");
-            framesIncoming.waitForEmpty();
+            framesIncoming.waitForIdle();
+            framesRecord.waitForIdle();
             // duplicated message
 #if 0
             LOGF_INFO(
@@ -425,95 +469,104 @@ void StreamManagerPrivate::subframe(
     }
 }
 
-void StreamManagerPrivate::asyncStreamThread()
+void StreamManagerPrivate::processFrame(const SharedFrame &sourceFrame)
 {
-    TimeFrame sourceTimeFrame;
-    sourceTimeFrame.time = 0;
-
-    std::vector<uint8_t> subframeBuffer;  // Subframe buffer for recording/streaming
-    std::vector<uint8_t> downscaleBuffer; // Downscale buffer for streaming
+    FrameInfo srcFrameInfo = updateSourceFrameInfo();
 
-    INDI::SingleThreadPool previewThreadPool;
-    INDI::ElapsedTimer previewElapsed;
+    SharedFrame frame = sourceFrame;
 
-    while(!framesThreadTerminate)
+    // Source buffer size may be equal or larger than frame info size
+    // as some driver still retain full unbinned window size even when binning the output
+    // frame
+    if (PixelFormat != INDI_JPG && frame->frame.size() < srcFrameInfo.totalSize())
     {
-        if (framesIncoming.pop(sourceTimeFrame) == false)
-            continue;
-
-        FrameInfo srcFrameInfo = updateSourceFrameInfo();
-
-        std::vector<uint8_t> *sourceBuffer = &sourceTimeFrame.frame;
+        LOGF_ERROR("Source buffer size %d is less than frame size %d, skipping frame...", frame->frame.size(),
+                   srcFrameInfo.totalSize());
+        return;
+    }
 
-        // Source buffer size may be equal or larger than frame info size
-        // as some driver still retain full unbinned window size even when binning the output
-        // frame
-        if (PixelFormat != INDI_JPG && sourceBuffer->size() < srcFrameInfo.totalSize())
-        {
-            LOGF_ERROR("Source buffer size %d is less than frame size %d, skipping frame...", sourceBuffer->size(),
-                       srcFrameInfo.totalSize());
-            continue;
-        }
+    // Check if we need to subframe
+    if (
+        PixelFormat != INDI_JPG &&
+        dstFrameInfo.pixels() != 0 &&
+        dstFrameInfo != srcFrameInfo
+    )
+    {
+        std::shared_ptr<TimeFrame> subframeFrame = std::make_shared<TimeFrame>();
+        subframeFrame->time      = frame->time;
+        subframeFrame->timestamp = frame->timestamp;
+        subframeFrame->frame.resize(dstFrameInfo.totalSize());
+        subframe(frame->frame.data(), srcFrameInfo, subframeFrame->frame.data(), dstFrameInfo);
 
-        // Check if we need to subframe
-        if (
-            PixelFormat != INDI_JPG &&
-            dstFrameInfo.pixels() != 0 &&
-            dstFrameInfo != srcFrameInfo
-        )
-        {
-            subframeBuffer.resize(dstFrameInfo.totalSize());
-            subframe(sourceBuffer->data(), srcFrameInfo, subframeBuffer.data(), dstFrameInfo);
+        frame = std::move(subframeFrame);
+    }
 
-            sourceBuffer = &subframeBuffer;
-        }
+    // For recording, queue every frame. The recorder stage never drops frames,
+    // when it is full the incoming stage waits and the incoming buffer limit applies.
+    if (isRecording && !isRecordingAboutToClose)
+    {
+        size_t maxBytes = LimitsNP[LIMITS_BUFFER_MAX].getValue() * 1024 * 1024;
+        framesRecord.setDepth(std::max<size_t>(1, maxBytes / std::max<size_t>(1, frame->frame.size())));
+        framesRecord.push(frame);
+    }
 
-        // For recording, save immediately.
-        {
-            std::lock_guard<std::mutex> lock(recordMutex);
-            if (
-                isRecording && !isRecordingAboutToClose &&
-                recordStream(sourceBuffer->data(), sourceBuffer->size(), sourceTimeFrame.time, sourceTimeFrame.timestamp) == false
-            )
-            {
-                LOG_ERROR("Recording failed.");
-                isRecordingAboutToClose = true;
-            }
-        }
+    // For streaming, you can reduce the number of frames by setting a frame limit.
+    // The preview stage keeps the latest frames only, so a slow encoder does not hold the recorder.
+    if (isStreaming && FPSPreview.newFrame())
+    {
+        framesPreview.push(std::move(frame));
+    }
+}
 
-        // For streaming, downscale to 8bit if higher than 8bit to reduce bandwidth
-        // You can reduce the number of frames by setting a frame limit.
-        if (isStreaming && FPSPreview.newFrame())
-        {
-            // Downscale to 8bit always for streaming to reduce bandwidth
-            if (PixelFormat != INDI_JPG && PixelDepth > 8)
-            {
-                // Allocale new buffer if size changes
-                downscaleBuffer.resize(dstFrameInfo.pixels());
+void StreamManagerPrivate::recordFrame(const SharedFrame &frame)
+{
+    std::lock_guard<std::mutex> lock(recordMutex);
+    if (
+        isRecording && !isRecordingAboutToClose &&
+        recordStream(frame->frame.data(), frame->frame.size(), frame->time, frame->timestamp) == false
+    )
+    {
+        LOG_ERROR("Recording failed.");
+        isRecordingAboutToClose = true;
+    }
+}
 
-                // Apply gamma
-                gammaLut16.apply(
-                    reinterpret_cast<const uint16_t*>(sourceBuffer->data()),
-                    downscaleBuffer.size(),
-                    downscaleBuffer.data()
-                );
+void StreamManagerPrivate::previewFrame(const SharedFrame &frame)
+{
+    const uint8_t *buffer = frame->frame.data();
+    size_t nbytes = frame->frame.size();
 
-                sourceBuffer = &downscaleBuffer;
-            }
+    // Downscale to 8bit always for streaming to reduce bandwidth
+    if (PixelFormat != INDI_JPG && PixelDepth > 8)
+    {
+        // Allocale new buffer if size changes, the source buffer may be larger than the frame
+        size_t components = (PixelFormat == INDI_RGB) ? 3 : 1;
+        previewBuffer.resize(std::min(dstFrameInfo.pixels() * components, nbytes / sizeof(uint16_t)));
+
+        // Apply gamma
+        gammaLut16.apply(
+            reinterpret_cast<const uint16_t*>(buffer),
+            previewBuffer.size(),
+            previewBuffer.data()
+        );
+
+        buffer = previewBuffer.data();
+        nbytes = previewBuffer.size();
+    }
 
-            //uploadStream(sourceBuffer->data(), sourceBuffer->size());
-            previewThreadPool.start(std::bind([this, &previewElapsed](const std::atomic_bool & isAboutToQuit,
-                                              std::vector<uint8_t> frame)
-            {
-                INDI_UNUSED(isAboutToQuit);
-                previewElapsed.start();
-                uploadStream(frame.data(), frame.size());
-                StreamTimeNP[0].setValue(previewElapsed.nsecsElapsed() / 1000000000.0);
-                StreamTimeNP.apply();
+    previewElapsed.start();
+    uploadStream(buffer, nbytes);
+    StreamTimeNP[0].setValue(previewElapsed.nsecsElapsed() / 1000000000.0);
+    StreamTimeNP.apply();
+}
 
-            }, std::placeholders::_1, std::move(*sourceBuffer)));
-        }
-    }
+void StreamManagerPrivate::updatePipelineStatistics()
+{
+    PipelineNP[PIPELINE_INCOMING_DROPPED].setValue(incomingDropped);
+    PipelineNP[PIPELINE_RECORD_FPS      ].setValue(framesRecord.framesPerSecond());
+    PipelineNP[PIPELINE_RECORD_QUEUE    ].setValue(framesRecord.size());
+    PipelineNP[PIPELINE_PREVIEW_FPS     ].setValue(framesPreview.framesPerSecond());
+    PipelineNP[PIPELINE_PREVIEW_DROPPED ].setValue(framesPreview.droppedFrames());
 }
 
 void StreamManagerPrivate::setSize(uint16_t width, uint16_t height)
@@ -660,6 +713,13 @@ bool StreamManagerPrivate::startRecording()
 
     recorder->setFPS(FpsNP[FPS_AVERAGE].getValue());
 
+    uint32_t writeOptions = 0;
+    if (RecordIOSP[RECORD_IO_DIRECT].getState() == ISS_ON)
+        writeOptions |= BatchFileWriter::DIRECT_IO;
+    if (RecordIOSP[RECORD_IO_PREALLOCATE].getState() == ISS_ON)
+        writeOptions |= BatchFileWriter::PREALLOCATE;
+    recorder->setWriteOptions(writeOptions);
+
     /* pattern substitution */
     recordfiledir.assign(RecordFileTP[0].getText());
     expfiledir = expand(recordfiledir, patterns);
@@ -708,6 +768,7 @@ bool StreamManagerPrivate::startRecording()
     }
 #endif
     FPSRecorder.reset();
+    framesRecord.resetStatistics();
     frameCountDivider = 0;
 
     if (isStreaming == false)
@@ -885,6 +946,21 @@ bool StreamManagerPrivate::ISNewSwitch(const char * dev, const char * name, ISSt
         return true;
     }
 
+    // Record I/O
+    if (RecordIOSP.isNameMatch(name))
+    {
+        if (isRecording)
+        {
+            LOG_WARN("Recording device is busy");
+            return true;
+        }
+
+        RecordIOSP.update(states, names, n);
+        RecordIOSP.setState(IPS_OK);
+        RecordIOSP.apply();
+        return true;
+    }
+
     // Recorder Selection
     if (RecorderSP.isNameMatch(name))
     {
@@ -977,6 +1053,22 @@ bool StreamManagerPrivate::ISNewNumber(const char * dev, const char * name, doub
         return true;
     }
 
+    /* Encoder Options */
+    if (EncoderOptionsNP.isNameMatch(name))
+    {
+        EncoderOptionsNP.update(values, names, n);
+
+        for (EncoderInterface * oneEncoder : encoderManager.getEncoderList())
+        {
+            oneEncoder->setQuality(EncoderOptionsNP[ENCODER_QUALITY].getValue());
+            oneEncoder->setPreviewWidth(EncoderOptionsNP[ENCODER_PREVIEW_WIDTH].getValue());
+        }
+
+        EncoderOptionsNP.setState(IPS_OK);
+        EncoderOptionsNP.apply();
+        return true;
+    }
+
     /* Record Options */
     if (RecordOptionsNP.isNameMatch(name))
     {
@@ -1059,6 +1151,8 @@ bool StreamManagerPrivate::setStream(bool enable)
             FPSFast.reset();
             FPSPreview.reset();
             FPSPreview.setTimeWindow(1000.0 / LimitsNP[LIMITS_PREVIEW_FPS].getValue());
+            framesPreview.resetStatistics();
+            incomingDropped = 0;
             frameCountDivider = 0;
 
             if(currentDevice->getDriverInterface() & INDI::DefaultDevice::CCD_INTERFACE)
@@ -1151,8 +1245,10 @@ bool StreamManager::saveConfigItems(FILE * fp)
 {
     D_PTR(StreamManager);
     d->EncoderSP.save(fp);
+    d->EncoderOptionsNP.save(fp);
     d->RecordFileTP.save(fp);
     d->RecordOptionsNP.save(fp);
+    d->RecordIOSP.save(fp);
     d->RecorderSP.save(fp);
     d->LimitsNP.save(fp);
     return true;
@@ -27,12 +27,14 @@
 #include "recorder/recordermanager.h"
 #include "encoder/encodermanager.h"
 #include "fpsmeter.h"
-#include "uniquequeue.h"
+#include "streamstage.h"
 #include "gammalut16.h"
+#include "indielapsedtimer.h"
 
 #include <atomic>
 #include <string>
 #include <map>
+#include <memory>
 #include <thread>
 
 #include "indiccdchip.h"
@@ -120,10 +122,36 @@ class StreamManagerPrivate
         void setSize(uint16_t width, uint16_t height);
         bool setPixelFormat(INDI_PIXEL_FORMAT pixelFormat, uint8_t pixelDepth);
 
+        // Processing for streaming
+        typedef struct
+        {
+            double time;
+            uint64_t timestamp;
+            std::vector<uint8_t> frame;
+        } TimeFrame;
+
+        // Frames are shared between the record and the preview stages without copying
+        typedef std::shared_ptr<const TimeFrame> SharedFrame;
+
+        /**
+         * @brief Incoming stage, subframes the frame and forwards it to the record and preview stages
+         */
+        void processFrame(const SharedFrame &frame);
+
+        /**
+         * @brief Record stage, writes the frame using the selected recorder
+         */
+        void recordFrame(const SharedFrame &frame);
+
+        /**
+         * @brief Preview stage, downscales the frame to 8 bits and uploads it using the selected encoder
+         */
+        void previewFrame(const SharedFrame &frame);
+
         /**
-         * @brief Thread processing frames and forwarding to recording and preview
+         * @brief Copy stage statistics to the pipeline property
          */
-        void asyncStreamThread();
+        void updatePipelineStatistics();
 
         // helpers
         static std::string expand(const std::string &fname, const std::map<std::string, std::string> &patterns);
@@ -198,6 +226,10 @@ class StreamManagerPrivate
         /* Record Options */
         INDI::PropertyNumber RecordOptionsNP {2};
 
+        /* Record I/O. Direct I/O and disk space preallocation for raw recorders */
+        INDI::PropertySwitch RecordIOSP {2};
+        enum { RECORD_IO_DIRECT, RECORD_IO_PREALLOCATE };
+
         // Stream Frame
         INDI::PropertyNumber StreamFrameNP {4};
 
@@ -208,6 +240,10 @@ class StreamManagerPrivate
         INDI::PropertySwitch EncoderSP {2};
         enum { ENCODER_RAW, ENCODER_MJPEG };
 
+        // Encoder Options. Quality of lossy encoders and maximum width of the preview frame.
+        INDI::PropertyNumber EncoderOptionsNP {2};
+        enum { ENCODER_QUALITY, ENCODER_PREVIEW_WIDTH };
+
         // Recorder Selector. Static but should be implemented as a dynamic plugin interface
         INDI::PropertySwitch RecorderSP {2};
         enum { RECORDER_RAW, RECORDER_OGV };
@@ -216,6 +252,17 @@ class StreamManagerPrivate
         INDI::PropertyNumber LimitsNP {2};
         enum { LIMITS_BUFFER_MAX, LIMITS_PREVIEW_FPS };
 
+        // Pipeline statistics. Frames per second and dropped frames for each stage.
+        INDI::PropertyNumber PipelineNP {5};
+        enum
+        {
+            PIPELINE_INCOMING_DROPPED,
+            PIPELINE_RECORD_FPS,
+            PIPELINE_RECORD_QUEUE,
+            PIPELINE_PREVIEW_FPS,
+            PIPELINE_PREVIEW_DROPPED
+        };
+
         std::atomic<bool> isStreaming { false };
         std::atomic<bool> isRecording { false };
         std::atomic<bool> isRecordingAboutToClose { false };
@@ -244,22 +291,21 @@ class StreamManagerPrivate
         uint16_t rawWidth = 0, rawHeight = 0;
         std::string Format;
 
-        // Processing for streaming
-        typedef struct
-        {
-            double time;
-            uint64_t timestamp;
-            std::vector<uint8_t> frame;
-        } TimeFrame;
-
-        std::thread              framesThread;   // async incoming frames processing
-        std::atomic<bool>        framesThreadTerminate {false};
-        UniqueQueue<TimeFrame>   framesIncoming;
+        // Preview keeps only the latest frames, recording must not lose any frame
+        static constexpr size_t PREVIEW_QUEUE_DEPTH = 2;
 
         std::mutex               fastFPSUpdate;
         std::mutex               recordMutex;
 
         GammaLut16               gammaLut16;
+        std::vector<uint8_t>     previewBuffer;  // Downscale buffer for streaming
+        INDI::ElapsedTimer       previewElapsed;
+
+        std::atomic<uint64_t>    incomingDropped {0};
+
+        StreamStage<SharedFrame> framesIncoming {StreamStage<SharedFrame>::DROP_NEVER};
+        StreamStage<SharedFrame> framesRecord   {StreamStage<SharedFrame>::DROP_NEVER};
+        StreamStage<SharedFrame> framesPreview  {StreamStage<SharedFrame>::DROP_OLDEST, PREVIEW_QUEUE_DEPTH};
 };
 
 }
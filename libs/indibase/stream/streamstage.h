@@ -0,0 +1,304 @@
+/*
+    Copyright (C) 2026 Jasem Mutlaq (mutlaqja@ikarustech.com)
+    Stream pipeline stage
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include "fpsmeter.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+
+namespace INDI
+{
+
+/**
+ * \class StreamStage template
+ * \brief The StreamStage class is a single consumer of a streaming pipeline with its own bounded queue and worker thread.
+ *
+ * Frames are usually passed as reference counted pointers, so several stages can consume the same frame
+ * without copying it. When the queue is full, the drop policy decides what happens with the new frame:
+ * - DROP_NEVER:  the producer is blocked until the worker makes room (e.g. recording),
+ * - DROP_OLDEST: the oldest queued frame is discarded and counted (e.g. preview).
+ *
+ * The stage counts processed frames per second and dropped frames, so they can be published as properties.
+ */
+template <typename T>
+class StreamStage
+{
+    public:
+        enum DropPolicy
+        {
+            DROP_NEVER,
+            DROP_OLDEST
+        };
+
+        using Process = std::function<void(const T &)>;
+
+    public:
+        /**
+         * @param policy what to do when the queue is full
+         * @param depth maximum number of queued frames, 0 for unlimited
+         */
+        explicit StreamStage(DropPolicy policy, size_t depth = 0);
+        ~StreamStage();
+
+    public:
+        /**
+         * @brief Start the worker thread, every frame pushed to the stage is passed to the function
+         */
+        void start(const Process &process);
+
+        /**
+         * @brief Stop the worker thread, queued frames are discarded
+         * @note It must not be called from the process function, the worker cannot join itself.
+         */
+        void stop();
+
+        /**
+         * @brief Push frame to the stage queue, apply the drop policy if the queue is full
+         * @return false if the stage is stopped
+         */
+        bool push(T data);
+
+        /**
+         * @brief Wait until all queued frames are processed, including the one being processed
+         */
+        void waitForIdle() const;
+
+        /**
+         * @brief Change maximum number of queued frames, 0 for unlimited
+         */
+        void setDepth(size_t depth);
+
+        /**
+         * @brief Reset frame and drop counters
+         */
+        void resetStatistics();
+
+    public:
+        /**
+         * @brief Number of queued frames
+         */
+        size_t size() const;
+
+        /**
+         * @brief Number of frames discarded by the drop policy since last reset
+         */
+        uint64_t droppedFrames() const;
+
+        /**
+         * @brief Number of frames processed since last reset
+         */
+        uint64_t processedFrames() const;
+
+        /**
+         * @brief Number of frames processed per second, measured in one second window
+         */
+        double framesPerSecond() const;
+
+    protected:
+        void run();
+
+    protected:
+        const DropPolicy policy;
+        size_t depth;
+
+        Process process;
+        std::thread thread;
+        bool isAboutToQuit {true};
+
+        std::deque<T> queue;
+        size_t pending {0}; // queued and currently processed frames
+
+        mutable std::mutex mutex;
+        mutable std::condition_variable increase;
+        mutable std::condition_variable decrease;
+
+        FPSMeter fpsMeter {1000};
+        std::atomic<double> fps {0};
+        std::atomic<uint64_t> dropped {0};
+        std::atomic<uint64_t> processed {0};
+};
+
+// implementation
+template <typename T>
+inline StreamStage<T>::StreamStage(DropPolicy policy, size_t depth)
+    : policy(policy)
+    , depth(depth)
+{ }
+
+template <typename T>
+inline StreamStage<T>::~StreamStage()
+{
+    stop();
+}
+
+template <typename T>
+inline void StreamStage<T>::start(const Process &process)
+{
+    stop();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    this->process = process;
+    isAboutToQuit = false;
+    thread = std::thread(&StreamStage<T>::run, this);
+}
+
+template <typename T>
+inline void StreamStage<T>::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isAboutToQuit = true;
+        pending -= queue.size();
+        queue.clear();
+        increase.notify_all();
+        decrease.notify_all();
+    }
+
+    if (thread.joinable())
+        thread.join();
+}
+
+template <typename T>
+inline bool StreamStage<T>::push(T data)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (depth > 0 && queue.size() >= depth)
+    {
+        if (policy == DROP_OLDEST)
+        {
+            while (queue.size() >= depth)
+            {
+                queue.pop_front();
+                --pending;
+                ++dropped;
+            }
+        }
+        else
+        {
+            decrease.wait(lock, [this]()
+            {
+                return isAboutToQuit || queue.size() < depth;
+            });
+        }
+    }
+
+    if (isAboutToQuit)
+        return false;
+
+    queue.push_back(std::move(data));
+    ++pending;
+    increase.notify_one();
+    return true;
+}
+
+template <typename T>
+inline void StreamStage<T>::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        increase.wait(lock, [this]()
+        {
+            return isAboutToQuit || !queue.empty();
+        });
+
+        if (isAboutToQuit)
+            break;
+
+        T data = std::move(queue.front());
+        queue.pop_front();
+        decrease.notify_all();
+
+        lock.unlock();
+        process(data);
+        data = T();
+        lock.lock();
+
+        ++processed;
+        if (fpsMeter.newFrame())
+            fps = fpsMeter.framesPerSecond();
+
+        --pending;
+        decrease.notify_all();
+    }
+}
+
+template <typename T>
+inline void StreamStage<T>::waitForIdle() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    decrease.wait(lock, [this]()
+    {
+        return isAboutToQuit || pending == 0;
+    });
+}
+
+template <typename T>
+inline void StreamStage<T>::setDepth(size_t depth)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->depth = depth;
+    decrease.notify_all();
+}
+
+template <typename T>
+inline void StreamStage<T>::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    fpsMeter.reset();
+    fps = 0;
+    dropped = 0;
+    processed = 0;
+}
+
+template <typename T>
+inline size_t StreamStage<T>::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+template <typename T>
+inline uint64_t StreamStage<T>::droppedFrames() const
+{
+    return dropped;
+}
+
+template <typename T>
+inline uint64_t StreamStage<T>::processedFrames() const
+{
+    return processed;
+}
+
+template <typename T>
+inline double StreamStage<T>::framesPerSecond() const
+{
+    return fps;
+}
+
+}
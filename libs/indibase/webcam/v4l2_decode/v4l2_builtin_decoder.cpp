@@ -61,10 +61,81 @@
 
 //#include "indilogger.h"
 #include "ccvt.h"
+#include "dsp.h"
 #include "v4l2_colorspace.h"
 
 #include <cstring> // memcpy
 
+namespace
+{
+
+// Frames of at least this many pixels are decoded in strips of rows by the libdsp worker pool
+constexpr unsigned int ParallelPixels = 512 * 1024;
+
+template <typename Rows>
+void decodeRows(unsigned int width, unsigned int height, const Rows &rows)
+{
+    if (width * height < ParallelPixels)
+    {
+        rows(0, height);
+        return;
+    }
+    dsp_parallel_for(height, [](void *arg, int start, int end)
+    {
+        (*static_cast<const Rows *>(arg))(start, end);
+    }, const_cast<Rows *>(&rows));
+}
+
+// Reorder a row of packed 4:2:2 pixels to YUYV, the template arguments being the offsets of Y, U, Y and V in a pair
+template <int Y1, int U, int Y2, int V>
+void repackYUYV(const unsigned char *src, unsigned char *dest, unsigned int pairs)
+{
+    for (unsigned int j = 0; j < pairs; j++)
+    {
+        dest[4 * j]     = src[4 * j + Y1];
+        dest[4 * j + 1] = src[4 * j + U];
+        dest[4 * j + 2] = src[4 * j + Y2];
+        dest[4 * j + 3] = src[4 * j + V];
+    }
+}
+
+// Expand a row of RGB555 pixels to RGB24
+void expandRGB555(const unsigned char *src, unsigned char *dest, unsigned int width, const char *lut5)
+{
+    for (unsigned int j = 0; j < width; j++)
+    {
+        const unsigned char low = src[2 * j], high = src[2 * j + 1];
+        dest[3 * j]     = lut5[(high & 0x7C) >> 2];                        // R
+        dest[3 * j + 1] = lut5[((high & 0x03) << 3) | ((low & 0xE0) >> 5)]; // G
+        dest[3 * j + 2] = lut5[low & 0x1F];                                // B
+    }
+}
+
+// Expand a row of RGB565 pixels to RGB24
+void expandRGB565(const unsigned char *src, unsigned char *dest, unsigned int width, const char *lut5,
+                  const char *lut6)
+{
+    for (unsigned int j = 0; j < width; j++)
+    {
+        const unsigned char low = src[2 * j], high = src[2 * j + 1];
+        dest[3 * j]     = lut5[(high & 0xF8) >> 3];                        // R
+        dest[3 * j + 1] = lut6[((high & 0x07) << 3) | ((low & 0xE0) >> 5)]; // G
+        dest[3 * j + 2] = lut5[low & 0x1F];                                // B
+    }
+}
+
+// Split a row of interleaved chroma samples to two planes
+void splitUV(const unsigned char *src, unsigned char *first, unsigned char *second, unsigned int count)
+{
+    for (unsigned int j = 0; j < count; j++)
+    {
+        first[j]  = src[2 * j];
+        second[j] = src[2 * j + 1];
+    }
+}
+
+}
+
 V4L2_Builtin_Decoder::V4L2_Builtin_Decoder()
 {
     unsigned int i;
@@ -254,23 +325,19 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf,
                     dest  = VBuf;
                     destv = UBuf;
                 }
-                for (unsigned int i = 0; i < (unsigned int)crop.c.height / 2; i++)
+                const unsigned int count = (crop.c.width + 1) / 2;
+                const unsigned int bytesperline = fmt.fmt.pix.bytesperline;
+                decodeRows(crop.c.width, crop.c.height / 2, [=](unsigned int start, unsigned int end)
                 {
-                    unsigned char *s = src;
-                    for (unsigned int j = 0; j < (unsigned int)crop.c.width; j += 2)
-                    {
-                        *(dest++)  = *(s++);
-                        *(destv++) = *(s++);
-                    }
-                    src += fmt.fmt.pix.bytesperline;
-                }
+                    for (unsigned int i = start; i < end; i++)
+                        splitUV(src + i * bytesperline, dest + i * count, destv + i * count, count);
+                });
             }
             else
             {
                 unsigned char *src   = frame;
                 unsigned char *dest  = YBuf;
                 unsigned char *destv = VBuf;
-                unsigned char *s = nullptr;
 
                 for (unsigned int i = 0; i < bufheight; i++)
                 {
@@ -285,17 +352,13 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf,
                     dest  = VBuf;
                     destv = UBuf;
                 }
-                for (unsigned int i = 0; i < bufheight / 2; i++)
+                const unsigned int count = (bufwidth + 1) / 2;
+                const unsigned int bytesperline = fmt.fmt.pix.bytesperline;
+                decodeRows(bufwidth, bufheight / 2, [=](unsigned int start, unsigned int end)
                 {
-                    s = src;
-                    //IDLog("NV12: converting UV line %d at %p, offset %d, pUbuf %p offset %d,  pVbuf %p offset %d\n", i, s, s- (frame + (fmt.fmt.pix.bytesperline * bufheight)), dest, dest-UBuf, destv, destv-VBuf);
-                    for (unsigned int j = 0; j < bufwidth; j += 2)
-                    {
-                        *(dest++)  = *(s++);
-                        *(destv++) = *(s++);
-                    }
-                    src += fmt.fmt.pix.bytesperline;
-                }
+                    for (unsigned int i = start; i < end; i++)
+                        splitUV(src + i * bytesperline, dest + i * count, destv + i * count, count);
+                });
             }
             break;
 
@@ -324,7 +387,6 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf,
         {
             unsigned char *src = nullptr;
             unsigned char *dest = yuyvBuffer;
-            unsigned char *s = nullptr, *s1 = nullptr, *s2 = nullptr, *s3 = nullptr, *s4 = nullptr;
 
             if (useSoftCrop && doCrop)
             {
@@ -336,43 +398,29 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf,
                 src = frame;
                 //IDLog("Decoding UYVY  %dx%d frame at %lx\n", width, height, src);
             }
-            for (int i = 0; i < (int)bufheight; i++)
+            const unsigned int pairs = bufwidth / 2;
+            const unsigned int bytesperline = fmt.fmt.pix.bytesperline;
+            const unsigned int pixelformat = fmt.fmt.pix.pixelformat;
+            decodeRows(bufwidth, bufheight, [=](unsigned int start, unsigned int end)
             {
-                s = src;
-                switch (fmt.fmt.pix.pixelformat)
-                {
-                    case V4L2_PIX_FMT_UYVY:
-                        s1 = (s + 1);
-                        s2 = (s);
-                        s3 = (s + 3);
-                        s4 = (s + 2);
-                        break;
-                    case V4L2_PIX_FMT_VYUY:
-                        s1 = (s + 1);
-                        s2 = (s + 2);
-                        s3 = (s + 3);
-                        s4 = (s);
-                        break;
-                    case V4L2_PIX_FMT_YVYU:
-                        s1 = (s);
-                        s2 = (s + 3);
-                        s3 = (s + 2);
-                        s4 = (s + 1);
-                        break;
-                }
-                for (int j = 0; j < (int)(bufwidth / 2); j++)
+                for (unsigned int i = start; i < end; i++)
                 {
-                    *(dest++) = *(s1);
-                    *(dest++) = *(s2);
-                    *(dest++) = *(s3);
-                    *(dest++) = *(s4);
-                    s1 += 4;
-                    s2 += 4;
-                    s3 += 4;
-                    s4 += 4;
+                    const unsigned char *s = src + i * bytesperline;
+                    unsigned char *d = dest + i * pairs * 4;
+                    switch (pixelformat)
+                    {
+                        case V4L2_PIX_FMT_UYVY:
+                            repackYUYV<1, 0, 3, 2>(s, d, pairs);
+                            break;
+                        case V4L2_PIX_FMT_VYUY:
+                            repackYUYV<1, 2, 3, 0>(s, d, pairs);
+                            break;
+                        case V4L2_PIX_FMT_YVYU:
+                            repackYUYV<0, 3, 2, 1>(s, d, pairs);
+                            break;
+                    }
                 }
-                src += fmt.fmt.pix.bytesperline;
-            }
+            });
         }
         break;
 
@@ -410,18 +458,14 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf,
             {
                 src = frame;
             }
-            for (unsigned int i = 0; i < bufheight; i++)
+            const unsigned int width = bufwidth;
+            const unsigned int bytesperline = fmt.fmt.pix.bytesperline;
+            const char *red = lut5;
+            decodeRows(bufwidth, bufheight, [=](unsigned int start, unsigned int end)
             {
-                unsigned char *s = src;
-                for (unsigned int j = 0; j < bufwidth; j++)
-                {
-                    *(dest++) = lut5[((*(s + 1) & 0x7C) >> 2)];                        // R
-                    *(dest++) = lut5[(((*(s + 1) & 0x03) << 3) | ((*(s) & 0xE0) >> 5))]; // G
-                    *(dest++) = lut5[((*s) & 0x1F)];                                   // B
-                    s += 2;
-                }
-                src += fmt.fmt.pix.bytesperline;
-            }
+                for (unsigned int i = start; i < end; i++)
+                    expandRGB555(src + i * bytesperline, dest + i * width * 3, width, red);
+            });
         }
         break;
 
@@ -437,18 +481,14 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf,
             {
                 src = frame;
             }
-            for (unsigned int i = 0; i < bufheight; i++)
+            const unsigned int width = bufwidth;
+            const unsigned int bytesperline = fmt.fmt.pix.bytesperline;
+            const char *red = lut5, *green = lut6;
+            decodeRows(bufwidth, bufheight, [=](unsigned int start, unsigned int end)
             {
-                unsigned char *s = src;
-                for (unsigned int j = 0; j < bufwidth; j++)
-                {
-                    *(dest++) = lut5[((*(s + 1) & 0xF8) >> 3)];                        // R
-                    *(dest++) = lut6[(((*(s + 1) & 0x07) << 3) | ((*(s) & 0xE0) >> 5))]; // G
-                    *(dest++) = lut5[((*s) & 0x1F)];                                   // B
-                    s += 2;
-                }
-                src += fmt.fmt.pix.bytesperline;
-            }
+                for (unsigned int i = start; i < end; i++)
+                    expandRGB565(src + i * bytesperline, dest + i * width * 3, width, red, green);
+            });
         }
         break;
 
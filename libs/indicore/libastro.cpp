@@ -34,6 +34,7 @@
 #include "indicom.h"
 
 #include <math.h>
+#include <mutex>
 
 #include <libnova/precession.h>
 #include <libnova/aberration.h>
@@ -96,6 +97,203 @@ void J2000toObserved(IEquatorialCoordinates *J2000pos, double jd, IEquatorialCoo
     observed->declination = libnova_observed.dec;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////
+// Batch conversions, the terms of an epoch are computed once and kept for the next calls
+//////////////////////////////////////////////////////////////////////////////////////////////
+struct EpochTerms
+{
+    double jd;
+    // J2000 to the true equator and equinox of the epoch, and back
+    double forward[3][3];
+    double reverse[3][3];
+    // annual aberration, displacing the unit vector of every position
+    double aberration[3];
+};
+
+static const size_t EpochCacheSize = 4;
+static std::mutex epochLock;
+static EpochTerms epochCache[EpochCacheSize];
+static size_t epochCount = 0;
+static size_t epochNext = 0;
+static double epochTolerance = 1.0 / 1440.0;
+
+static void toVector(double ra, double dec, double v[3])
+{
+    double cosDec = cos(DEG_TO_RAD(dec));
+    v[0] = cosDec * cos(DEG_TO_RAD(ra));
+    v[1] = cosDec * sin(DEG_TO_RAD(ra));
+    v[2] = sin(DEG_TO_RAD(dec));
+}
+
+// the vector does not need to be normalised
+static void fromVector(const double v[3], double *ra, double *dec)
+{
+    *ra = range360(RAD_TO_DEG(atan2(v[1], v[0])));
+    *dec = RAD_TO_DEG(atan2(v[2], sqrt(v[0] * v[0] + v[1] * v[1])));
+}
+
+static void rotate(const double m[3][3], const double u[3], double v[3])
+{
+    for (int i = 0; i < 3; i++)
+        v[i] = m[i][0] * u[0] + m[i][1] * u[1] + m[i][2] * u[2];
+}
+
+// the rotation ln_get_equ_prec2 applies, recovered from an orthonormal basis
+// kept away from the poles where libnova switches to a less precise formula
+static void precessionMatrix(double fromJD, double toJD, double m[3][3])
+{
+    static const double basis[3][3] =
+    {
+        { 1 / sqrt(3.0), 1 / sqrt(3.0), 1 / sqrt(3.0) },
+        { 1 / sqrt(2.0), -1 / sqrt(2.0), 0 },
+        { 1 / sqrt(6.0), 1 / sqrt(6.0), -2 / sqrt(6.0) }
+    };
+
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            m[i][j] = 0;
+
+    for (int k = 0; k < 3; k++)
+    {
+        ln_equ_posn mean, precessed;
+        fromVector(basis[k], &mean.ra, &mean.dec);
+        ln_get_equ_prec2(&mean, fromJD, toJD, &precessed);
+        double image[3];
+        toVector(precessed.ra, precessed.dec, image);
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                m[i][j] += image[i] * basis[k][j];
+    }
+}
+
+// rotation from the mean to the true equator and equinox, of which ln_get_equ_nut is the first order
+static void nutationMatrix(double jd, double m[3][3])
+{
+    struct ln_nutation nut;
+    ln_get_nutation(jd, &nut);
+
+    double meanObliquity = DEG_TO_RAD(nut.ecliptic);
+    double trueObliquity = DEG_TO_RAD(nut.ecliptic + nut.obliquity);
+    double longitude = DEG_TO_RAD(nut.longitude);
+
+    double sinM = sin(meanObliquity), cosM = cos(meanObliquity);
+    double sinT = sin(trueObliquity), cosT = cos(trueObliquity);
+    double sinL = sin(longitude), cosL = cos(longitude);
+
+    m[0][0] = cosL;
+    m[0][1] = -sinL * cosM;
+    m[0][2] = -sinL * sinM;
+    m[1][0] = sinL * cosT;
+    m[1][1] = cosL * cosT * cosM + sinT * sinM;
+    m[1][2] = cosL * cosT * sinM - sinT * cosM;
+    m[2][0] = sinL * sinT;
+    m[2][1] = cosL * sinT * cosM - cosT * sinM;
+    m[2][2] = cosL * sinT * sinM + cosT * cosM;
+}
+
+// ln_get_equ_aber moves every position by the projection of the same vector, the velocity
+// of the Earth with the terms of its eccentricity, read here from two positions on the equator
+static void aberrationVector(double jd, double v[3])
+{
+    ln_equ_posn mean = {0, 0}, apparent;
+    ln_get_equ_aber(&mean, jd, &apparent);
+    v[1] = DEG_TO_RAD(remainder(apparent.ra - mean.ra, 360.0));
+    v[2] = DEG_TO_RAD(apparent.dec - mean.dec);
+
+    mean = {90, 0};
+    ln_get_equ_aber(&mean, jd, &apparent);
+    v[0] = -DEG_TO_RAD(remainder(apparent.ra - mean.ra, 360.0));
+}
+
+static EpochTerms getEpochTerms(double jd)
+{
+    std::lock_guard<std::mutex> guard(epochLock);
+
+    for (size_t i = 0; i < epochCount; i++)
+    {
+        if (fabs(epochCache[i].jd - jd) <= epochTolerance)
+            return epochCache[i];
+    }
+
+    EpochTerms terms;
+    terms.jd = jd;
+
+    double precession[3][3], nutation[3][3];
+    precessionMatrix(JD2000, jd, precession);
+    nutationMatrix(jd, nutation);
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            terms.forward[i][j] = nutation[i][0] * precession[0][j] + nutation[i][1] * precession[1][j] + nutation[i][2] *
+                                  precession[2][j];
+
+    // precessing back goes through libnova again, as ObservedToJ2000 does
+    precessionMatrix(jd, JD2000, precession);
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            terms.reverse[i][j] = precession[i][0] * nutation[j][0] + precession[i][1] * nutation[j][1] + precession[i][2] *
+                                  nutation[j][2];
+
+    aberrationVector(jd, terms.aberration);
+
+    epochCache[epochNext] = terms;
+    epochNext = (epochNext + 1) % EpochCacheSize;
+    if (epochCount < EpochCacheSize)
+        epochCount++;
+    return terms;
+}
+
+void SetEpochTolerance(double days)
+{
+    std::lock_guard<std::mutex> guard(epochLock);
+    epochTolerance = fabs(days);
+}
+
+double GetEpochTolerance()
+{
+    std::lock_guard<std::mutex> guard(epochLock);
+    return epochTolerance;
+}
+
+void J2000toObserved(const IEquatorialCoordinates *J2000pos, size_t count, double jd, IEquatorialCoordinates *observed)
+{
+    const EpochTerms terms = getEpochTerms(jd);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        double u[3], v[3];
+        toVector(J2000pos[i].rightascension * 15.0, J2000pos[i].declination, u);
+        // precession and nutation, then aberration
+        rotate(terms.forward, u, v);
+        for (int k = 0; k < 3; k++)
+            v[k] += terms.aberration[k];
+
+        double ra, dec;
+        fromVector(v, &ra, &dec);
+        observed[i].rightascension = ra / 15.0;
+        observed[i].declination = dec;
+    }
+}
+
+void ObservedToJ2000(const IEquatorialCoordinates *observed, size_t count, double jd, IEquatorialCoordinates *J2000pos)
+{
+    const EpochTerms terms = getEpochTerms(jd);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        double u[3], v[3];
+        toVector(observed[i].rightascension * 15.0, observed[i].declination, u);
+        // aberration removed, then nutation and precession
+        for (int k = 0; k < 3; k++)
+            u[k] -= terms.aberration[k];
+        rotate(terms.reverse, u, v);
+
+        double ra, dec;
+        fromVector(v, &ra, &dec);
+        J2000pos[i].rightascension = ra / 15.0;
+        J2000pos[i].declination = dec;
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 /// apply or remove nutation
 //////////////////////////////////////////////////////////////////////////////////////////////
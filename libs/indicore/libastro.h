@@ -30,11 +30,13 @@
 
 #include <libnova/utility.h>
 
+#include <cstddef>
+
 namespace INDI
 {
 
-#define RAD_TO_DEG(rad) (rad * 180.0/M_PI)
-#define DEG_TO_RAD(deg) (deg * M_PI/180.0)
+#define RAD_TO_DEG(rad) ((rad) * 180.0/M_PI)
+#define DEG_TO_RAD(deg) ((deg) * M_PI/180.0)
 
 /**
  * \defgroup Position Structures
@@ -93,6 +95,42 @@ void ObservedToJ2000(IEquatorialCoordinates *observed, double jd, IEquatorialCoo
 */
 void J2000toObserved(IEquatorialCoordinates *J2000pos, double jd, IEquatorialCoordinates * observed);
 
+/**
+* \brief ObservedToJ2000 converts count observed positions of the epoch jd to J2000 catalogue positions
+*   The precession, nutation and aberration of the epoch are computed once and applied as a rotation matrix
+*   and a vector. The results agree with the single position conversion, which is first order, to a few
+*   milliarcseconds away from the poles.
+* \param observed positions
+* \param count number of positions
+* \param jd Julian day epoch of the observed positions
+* \param J2000pos returns the catalogue positions, may be the observed array
+*/
+void ObservedToJ2000(const IEquatorialCoordinates *observed, size_t count, double jd, IEquatorialCoordinates *J2000pos);
+
+/**
+* \brief J2000toObserved converts count J2000 catalogue positions to observed positions for the epoch jd
+*   The precession, nutation and aberration of the epoch are computed once and applied as a rotation matrix
+*   and a vector. The results agree with the single position conversion, which is first order, to a few
+*   milliarcseconds away from the poles.
+* \param J2000pos J2000 catalogue positions
+* \param count number of positions
+* \param jd Julian day epoch of the observed positions
+* \param observed returns the observed positions, may be the J2000pos array
+*/
+void J2000toObserved(const IEquatorialCoordinates *J2000pos, size_t count, double jd, IEquatorialCoordinates *observed);
+
+/**
+* \brief SetEpochTolerance sets how far in days a Julian date may be from a cached epoch for the batch conversions
+*   to reuse its terms. The default of one minute keeps the error under a milliarcsecond, 0 only reuses the terms
+*   of the exact same Julian date.
+*/
+void SetEpochTolerance(double days);
+
+/**
+* \brief GetEpochTolerance returns how far in days a Julian date may be from a cached epoch to reuse its terms.
+*/
+double GetEpochTolerance();
+
 /**
  * @brief EquatorialToHorizontal Calculate horizontal coordinates from equatorial coordinates.
  * @param object Equatorial Object Coordinates in INDI standaard (RA Hours, DE degrees).
@@ -21,11 +21,16 @@
 #include "config.h"
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <stdio.h>
+#include <vector>
 
 #include <indilogger.h>
+#include <alignment/SphericalKDTree.h>
 
 #include "alignment_scope.h"
 
@@ -151,6 +156,155 @@ TEST(ALIGNMENT_TEST, Test_ThreeSyncPointsAltAz)
     ASSERT_DOUBLE_EQ(round(testPointAz, 1), round(roundTripAz, 1));
 }
 
+// Sync points spread over the sky along a spiral, from 60 degrees south up to the north pole
+static void SpiralSyncPoint(int Index, int Count, double &ra, double &dec)
+{
+    ra  = range24(Index * 24.0 * 0.6180339887);
+    dec = std::asin(-0.866 + 1.866 * (Index + 0.5) / Count) * 180.0 / M_PI;
+}
+
+// A mount whose axes are off by a few arcminutes, differently across the sky
+static void MountModel(double ra, double dec, double &mountRA, double &mountDec)
+{
+    mountRA  = range24(ra + 0.01 + 0.005 * std::sin(dec * M_PI / 180.0));
+    mountDec = rangeDec(dec + 0.05 * std::cos(dec * M_PI / 180.0));
+}
+
+TEST(ALIGNMENT_TEST, Test_ManySyncPointsEquatorial)
+{
+    const int Count = 300;
+    const double RAOffset = 0.05;
+
+    Scope s(INDI::AlignmentSubsystem::MathPluginManagement::EQUATORIAL);
+    ASSERT_TRUE(s.updateLocation(29.05, 48.15, 0));
+    s.Handshake();
+
+    // A mount off by a rotation around the pole, every facet of the hull has the same transformation
+    for (int i = 0; i < Count; i++)
+    {
+        double ra, dec;
+        SpiralSyncPoint(i, Count, ra, dec);
+        ASSERT_TRUE(s.AddAlignmentEntryEquatorial(ra, dec, range24(ra + RAOffset), dec));
+    }
+
+    int Conversions = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (double dec = -85; dec <= 85; dec += 5)
+    {
+        for (double ra = 0.1; ra < 24; ra += 0.5)
+        {
+            double mountRA, mountDec;
+            ASSERT_TRUE(s.SkyToTelescopeEquatorial(ra, dec, mountRA, mountDec));
+            EXPECT_NEAR(std::remainder(mountRA - (ra + RAOffset), 24.0), 0, 1e-6) << ra << " " << dec;
+            EXPECT_NEAR(mountDec, dec, 1e-6) << ra << " " << dec;
+
+            double skyRA, skyDec;
+            ASSERT_TRUE(s.TelescopeEquatorialToSky(mountRA, mountDec, skyRA, skyDec));
+            EXPECT_NEAR(std::remainder(skyRA - ra, 24.0), 0, 1e-6) << ra << " " << dec;
+            EXPECT_NEAR(skyDec, dec, 1e-6) << ra << " " << dec;
+            Conversions += 2;
+        }
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / Conversions;
+    printf("%d sync points, %.2f us per conversion\n", Count, us);
+    RecordProperty("ConversionNanoseconds", static_cast<int>(us * 1000));
+}
+
+TEST(ALIGNMENT_TEST, Test_SyncPointsAddedIncrementally)
+{
+    const int Count = 120;
+
+    // Every sync extends the hulls of the first scope
+    Scope incremental(INDI::AlignmentSubsystem::MathPluginManagement::EQUATORIAL);
+    ASSERT_TRUE(incremental.updateLocation(29.05, 48.15, 0));
+    incremental.Handshake();
+    for (int i = 0; i < Count; i++)
+    {
+        double ra, dec, mountRA, mountDec;
+        SpiralSyncPoint(i, Count, ra, dec);
+        MountModel(ra, dec, mountRA, mountDec);
+        ASSERT_TRUE(incremental.AddAlignmentEntryEquatorial(ra, dec, mountRA, mountDec));
+    }
+
+    // The second one builds them at once from the same database
+    Scope rebuilt(INDI::AlignmentSubsystem::MathPluginManagement::EQUATORIAL);
+    ASSERT_TRUE(rebuilt.updateLocation(29.05, 48.15, 0));
+    rebuilt.Handshake();
+    rebuilt.GetAlignmentDatabase() = incremental.GetAlignmentDatabase();
+    rebuilt.Initialise(&rebuilt);
+
+    for (double dec = -85; dec <= 85; dec += 2.5)
+    {
+        for (double ra = 0.05; ra < 24; ra += 0.25)
+        {
+            double mountRA, mountDec, expectedRA, expectedDec;
+            ASSERT_TRUE(incremental.SkyToTelescopeEquatorial(ra, dec, mountRA, mountDec));
+            ASSERT_TRUE(rebuilt.SkyToTelescopeEquatorial(ra, dec, expectedRA, expectedDec));
+            EXPECT_NEAR(mountRA, expectedRA, 1e-9) << ra << " " << dec;
+            EXPECT_NEAR(mountDec, expectedDec, 1e-9) << ra << " " << dec;
+
+            // Within the sync points the model is followed to a few tens of arcseconds
+            if (dec > -55)
+            {
+                double modelRA, modelDec;
+                MountModel(ra, dec, modelRA, modelDec);
+                EXPECT_NEAR(std::remainder(mountRA - modelRA, 24.0) * 15 * std::cos(dec * M_PI / 180), 0, 0.005)
+                        << ra << " " << dec;
+                EXPECT_NEAR(mountDec, modelDec, 0.005) << ra << " " << dec;
+            }
+        }
+    }
+}
+
+// Great circle distance in degrees, as the nearest math plugin used to compare its sync points
+static double HaversineDistance(double az1, double alt1, double az2, double alt2)
+{
+    double sinHalfAlt = std::sin((alt2 - alt1) / 2 * M_PI / 180);
+    double sinHalfAz  = std::sin((az2 - az1) / 2 * M_PI / 180);
+    return 2 * std::asin(std::sqrt(sinHalfAlt * sinHalfAlt + std::cos(alt1 * M_PI / 180) * std::cos(alt2 * M_PI / 180) *
+                                   sinHalfAz * sinHalfAz)) * 180 / M_PI;
+}
+
+TEST(ALIGNMENT_TEST, Test_NearestPointMatchesLinearScan)
+{
+    INDI::AlignmentSubsystem::SphericalKDTree tree;
+    EXPECT_EQ(tree.FindNearest(10, 20), -1);
+
+    // Random points, a few of them repeated, and a run along the horizon where many share an axis value
+    std::vector<std::pair<double, double>> points;
+    srand(49);
+    for (int i = 0; i < 2000; i++)
+        points.push_back({rand() * 360.0 / RAND_MAX, std::asin(2.0 * rand() / RAND_MAX - 1) * 180 / M_PI});
+    for (int i = 0; i < 50; i++)
+        points.push_back(points[i * 7]);
+    for (int i = 0; i < 100; i++)
+        points.push_back({i * 3.6, 0});
+
+    for (const auto &point : points)
+        tree.AddPoint(point.first, point.second);
+    tree.Build();
+    ASSERT_EQ(tree.Size(), points.size());
+
+    for (int i = 0; i < 5000; i++)
+    {
+        double az  = rand() * 360.0 / RAND_MAX;
+        double alt = i % 10 ? std::asin(2.0 * rand() / RAND_MAX - 1) * 180 / M_PI : 0;
+
+        double expected = 1e6;
+        for (const auto &point : points)
+            expected = std::min(expected, HaversineDistance(az, alt, point.first, point.second));
+
+        int nearest = tree.FindNearest(az, alt);
+        ASSERT_GE(nearest, 0);
+        EXPECT_NEAR(HaversineDistance(az, alt, points[nearest].first, points[nearest].second), expected, 1e-9)
+                << az << " " << alt;
+    }
+
+    // Of points at the same place, the first one added is returned
+    for (int i = 0; i < 50; i++)
+        EXPECT_EQ(tree.FindNearest(points[i * 7].first, points[i * 7].second), i * 7);
+}
+
 int main(int argc, char **argv)
 {
     INDI::Logger::getInstance().configure("", INDI::Logger::file_off,
@@ -0,0 +1,139 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    Nearest sync point lookup benchmark
+
+    Finds the sync point nearest to random positions on the sky, as the nearest math plugin does on every
+    celestial to telescope conversion and back, with the former linear haversine scan of the sync points and
+    with the SphericalKDTree built over them. Both lookups are checked to pick points at the same distance.
+
+    Usage: bench_alignment_nearest [points] [queries]
+    Defaults to sweeping 100 to 20000 synthetic sync points with 20000 queries each.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "alignment/SphericalKDTree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using INDI::AlignmentSubsystem::SphericalKDTree;
+
+struct Position
+{
+    double azimuth;
+    double altitude;
+};
+
+// Haversine distance in radians, as the nearest math plugin computed it
+static double sphereUnitDistance(const Position &a, const Position &b)
+{
+    double sinHalfAlt = sin((b.altitude - a.altitude) / 2 * (M_PI / 180));
+    double sinHalfAz  = sin((b.azimuth - a.azimuth) / 2 * (M_PI / 180));
+    return 2 * asin(sqrt(sinHalfAlt * sinHalfAlt + cos(a.altitude * (M_PI / 180)) * cos(b.altitude * (M_PI / 180)) *
+                         sinHalfAz * sinHalfAz));
+}
+
+static int linearNearest(const std::vector<Position> &points, const Position &target)
+{
+    int nearest = -1;
+    double distance = 1e6;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        double oneDistance = sphereUnitDistance(target, points[i]);
+        if (oneDistance < distance)
+        {
+            nearest = static_cast<int>(i);
+            distance = oneDistance;
+        }
+    }
+    return nearest;
+}
+
+// Uniformly spread over the sky
+static Position randomPosition(uint32_t &seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    double azimuth = (seed >> 8) / 16777216.0 * 360;
+    seed = seed * 1664525u + 1013904223u;
+    double altitude = asin((seed >> 8) / 8388608.0 - 1) * 180 / M_PI;
+    return { azimuth, altitude };
+}
+
+static void run(int count, int queries)
+{
+    uint32_t seed = 1;
+    std::vector<Position> points;
+    for (int i = 0; i < count; i++)
+        points.push_back(randomPosition(seed));
+
+    std::vector<Position> targets;
+    for (int i = 0; i < queries; i++)
+        targets.push_back(randomPosition(seed));
+
+    auto start = std::chrono::steady_clock::now();
+    SphericalKDTree tree;
+    for (const auto &point : points)
+        tree.AddPoint(point.azimuth, point.altitude);
+    tree.Build();
+    double build = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<int> linear(queries), indexed(queries);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < queries; i++)
+        linear[i] = linearNearest(points, targets[i]);
+    double scan = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < queries; i++)
+        indexed[i] = tree.FindNearest(targets[i].azimuth, targets[i].altitude);
+    double lookup = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int mismatches = 0;
+    for (int i = 0; i < queries; i++)
+    {
+        double expected = sphereUnitDistance(targets[i], points[linear[i]]);
+        if (std::fabs(sphereUnitDistance(targets[i], points[indexed[i]]) - expected) > 1e-12)
+            mismatches++;
+    }
+
+    printf("%6d points  build %8.3f ms  linear %9.3f us  tree %6.3f us  %8.1fx  %d mismatches\n", count, build * 1000,
+           scan * 1e6 / queries, lookup * 1e6 / queries, scan / lookup, mismatches);
+}
+
+int main(int argc, char *argv[])
+{
+    int queries = argc > 2 ? atoi(argv[2]) : 20000;
+    if (queries < 1)
+        queries = 1;
+
+    printf("Nearest sync point of %d random positions\n\n", queries);
+
+    if (argc > 1)
+    {
+        run(std::max(1, atoi(argv[1])), queries);
+        return 0;
+    }
+
+    for (int count : { 100, 1000, 5000, 20000 })
+        run(count, queries);
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    Alpaca camera bridge ImageArray response benchmark
+
+    Builds the response body of an ImageArray request for a synthetic frame, as JSON like
+    CameraBridge::formatImageAsJSON and as ImageBytes, and reports the time per response, the body
+    size and the peak memory of a response, measured in a child process for each format.
+
+    Usage: bench_alpaca_imagebytes [width] [height] [bits] [repeats]
+    Defaults to 3 responses of a 16 bit 4144x2822 (11.7 MP) frame.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "drivers/alpaca/bridges/camera_image_bytes.h"
+
+#ifdef _USE_SYSTEM_JSONLIB
+#include <nlohmann/json.hpp>
+#else
+#include <indijson.hpp>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+static int width  = 4144;
+static int height = 2822;
+static int bits   = 16;
+
+// the JSON path of the camera bridge, array[x][y] of Int32 wrapped in the Alpaca response
+static size_t jsonResponse(const std::vector<uint8_t> &rawData)
+{
+    json imageArray = json::array();
+    for (int x = 0; x < width; x++)
+    {
+        json column = json::array();
+        for (int y = 0; y < height; y++)
+        {
+            int pixelIndex = (y * width + x);
+            int32_t pixelValue = 0;
+            switch (bits)
+            {
+                case 8:
+                    pixelValue = static_cast<int32_t>(rawData[pixelIndex]);
+                    break;
+                case 16:
+                    pixelValue = static_cast<int32_t>(reinterpret_cast<const uint16_t*>(rawData.data())[pixelIndex]);
+                    break;
+                case 32:
+                    pixelValue = static_cast<int32_t>(reinterpret_cast<const uint32_t*>(rawData.data())[pixelIndex]);
+                    break;
+            }
+            column.push_back(pixelValue);
+        }
+        imageArray.push_back(column);
+    }
+    json response =
+    {
+        {"Value", imageArray},
+        {"ClientTransactionID", 0},
+        {"ServerTransactionID", 0},
+        {"ErrorNumber", 0},
+        {"ErrorMessage", ""}
+    };
+    return response.dump().size();
+}
+
+static size_t imageBytesResponse(const std::vector<uint8_t> &rawData)
+{
+    std::string body;
+    AlpacaImageBytes::encode(body, rawData.data(), width, height, bits, 2);
+    return body.size();
+}
+
+// peak resident memory of a child building one response, above the one of a child doing nothing
+static double peakMB(const std::function<void()> &run)
+{
+    // memory freed by the previous runs is returned first, the child would reuse it otherwise
+    malloc_trim(0);
+    auto measure = [](const std::function<void()> &body)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            body();
+            _exit(0);
+        }
+        int status = 0;
+        struct rusage usage;
+        wait4(pid, &status, 0, &usage);
+        return usage.ru_maxrss / 1024.0;
+    };
+    return measure(run) - measure([]() {});
+}
+
+static void report(const char *name, size_t (*response)(const std::vector<uint8_t> &), const std::vector<uint8_t> &rawData,
+                   int repeats)
+{
+    size_t size = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+        size = response(rawData);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+    double mb = peakMB([&]()
+    {
+        response(rawData);
+    });
+    printf("%-12s %10.1f ms  body %8.1f MB (%5.2fx raw)  peak %8.1f MB\n", name, ms, size / 1048576.0,
+           static_cast<double>(size) / rawData.size(), mb);
+}
+
+int main(int argc, char *argv[])
+{
+    width       = argc > 1 ? atoi(argv[1]) : 4144;
+    height      = argc > 2 ? atoi(argv[2]) : 2822;
+    bits        = argc > 3 ? atoi(argv[3]) : 16;
+    int repeats = argc > 4 ? atoi(argv[4]) : 3;
+    if (repeats < 1)
+        repeats = 1;
+    if (bits != 8 && bits != 16 && bits != 32)
+    {
+        fprintf(stderr, "Unsupported bit depth %d\n", bits);
+        return 1;
+    }
+
+    // sky background with noise, as a camera frame would hold
+    std::vector<uint8_t> rawData(static_cast<size_t>(width) * height * bits / 8);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < rawData.size() * 8 / bits; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        uint32_t value = (bits == 8 ? 20 : 1200) + (seed >> 24) % (bits == 8 ? 40 : 400);
+        switch (bits)
+        {
+            case 8:
+                rawData[i] = value;
+                break;
+            case 16:
+                reinterpret_cast<uint16_t*>(rawData.data())[i] = value;
+                break;
+            default:
+                reinterpret_cast<uint32_t*>(rawData.data())[i] = value;
+                break;
+        }
+    }
+
+    printf("ImageArray of a %dx%d %d bit frame (%.1f MB), %d responses each\n\n", width, height, bits,
+           rawData.size() / 1048576.0, repeats);
+    report("JSON", &jsonResponse, rawData, repeats);
+    report("ImageBytes", &imageBytesResponse, rawData, repeats);
+    return 0;
+}
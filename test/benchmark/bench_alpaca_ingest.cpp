@@ -0,0 +1,147 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    Alpaca camera image ingestion benchmark
+
+    Converts synthetic ImageBytes payloads into 16 bit INDI frames, with the former loops of the
+    Alpaca CCD driver, a conversion walking the Alpaca order followed by a separate byte by byte
+    vertical flip, with the same loops writing the transposed pixel they skipped, and with the tiled
+    single pass AlpacaImage::toFrame, for each element type.
+
+    Usage: bench_alpaca_ingest [width] [height] [repeats]
+    Defaults to 5 frames of 6248x4176 pixels.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "drivers/ccd/alpaca_image.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static uint32_t width  = 6248;
+static uint32_t height = 4176;
+
+// the former conversion, walking the source in Alpaca order and averaging the planes
+// with transpose set, each pixel is written at its place in the frame rather than in the source order
+template <typename T>
+static void formerConvert(const uint8_t *src_buffer, uint16_t *dst_buffer, uint32_t planes, bool transpose)
+{
+    const T *src = reinterpret_cast<const T *>(src_buffer);
+    size_t dst_index = 0;
+    for (uint32_t x = 0; x < width; x++)
+    {
+        for (uint32_t y = 0; y < height; y++)
+        {
+            size_t index = transpose ? static_cast<size_t>(y) * width + x : dst_index;
+            dst_index++;
+            if (planes == 1)
+            {
+                dst_buffer[index] = static_cast<uint16_t>(src[static_cast<size_t>(x) * height + y]);
+                continue;
+            }
+            int64_t sum = 0;
+            for (uint32_t p = 0; p < planes; p++)
+                sum += src[(static_cast<size_t>(x) * height + y) * planes + p];
+            dst_buffer[index] = static_cast<uint16_t>(sum / planes);
+        }
+    }
+}
+
+// the former vertical flip, swapping the rows byte by byte
+static void formerFlip(uint16_t *frame)
+{
+    uint8_t *buffer = reinterpret_cast<uint8_t *>(frame);
+    size_t row_size = width * sizeof(uint16_t);
+    for (uint32_t y = 0; y < height / 2; y++)
+    {
+        uint8_t *top_row = buffer + (y * row_size);
+        uint8_t *bottom_row = buffer + ((height - 1 - y) * row_size);
+        for (size_t i = 0; i < row_size; i++)
+        {
+            uint8_t temp = top_row[i];
+            top_row[i] = bottom_row[i];
+            bottom_row[i] = temp;
+        }
+    }
+}
+
+template <typename T>
+static void run(const char *name, int type, uint32_t planes, int repeats)
+{
+    size_t count = static_cast<size_t>(width) * height * planes;
+    std::vector<uint8_t> payload(count * sizeof(T));
+    T *samples = reinterpret_cast<T *>(payload.data());
+    uint32_t seed = 1;
+    for (size_t i = 0; i < count; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        samples[i] = static_cast<T>(sizeof(T) == 1 ? seed >> 24 : 1000 + (seed >> 20));
+    }
+    std::vector<uint16_t> frame(static_cast<size_t>(width) * height);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+    {
+        formerConvert<T>(payload.data(), frame.data(), planes, false);
+        formerFlip(frame.data());
+    }
+    double former = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+    {
+        formerConvert<T>(payload.data(), frame.data(), planes, true);
+        formerFlip(frame.data());
+    }
+    double transposed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+        AlpacaImage::toFrame(payload.data(), type, width, height, planes, true, frame.data());
+    double fused = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+    // the frame is the transposed and flipped payload
+    bool valid = true;
+    for (uint32_t y = 0; y < height && valid; y += 97)
+        for (uint32_t x = 0; x < width && valid && planes == 1; x += 89)
+            if (sizeof(T) == 2 && frame[static_cast<size_t>(height - 1 - y) * width + x] != samples[static_cast<size_t>(x) * height + y])
+                valid = false;
+
+    printf("%-8s %u plane%s  former %8.1f ms  transposed %8.1f ms  tiled %8.1f ms  %5.2fx%s\n", name, planes,
+           planes > 1 ? "s" : " ", former, transposed, fused, transposed / fused, valid ? "" : "  MISMATCH");
+}
+
+int main(int argc, char *argv[])
+{
+    width       = argc > 1 ? atoi(argv[1]) : 6248;
+    height      = argc > 2 ? atoi(argv[2]) : 4176;
+    int repeats = argc > 3 ? atoi(argv[3]) : 5;
+    if (repeats < 1)
+        repeats = 1;
+
+    printf("ImageBytes ingestion of %ux%u frames, %d frames each\n\n", width, height, repeats);
+    run<uint8_t>("Byte", AlpacaImage::Byte, 1, repeats);
+    run<uint16_t>("UInt16", AlpacaImage::UInt16, 1, repeats);
+    run<int32_t>("Int32", AlpacaImage::Int32, 1, repeats);
+    run<float>("Single", AlpacaImage::Single, 1, repeats);
+    run<double>("Double", AlpacaImage::Double, 1, repeats);
+    run<uint16_t>("UInt16", AlpacaImage::UInt16, 3, repeats);
+    return 0;
+}
@@ -0,0 +1,148 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    DSP star field alignment benchmark
+
+    Matches synthetic star fields with dsp_align_get_offset, varying the star count, rotation,
+    scale and the fraction of lost and spurious stars, and reports the time per match and
+    whether the transform was recovered within half a pixel. The target score is 50%, so fields
+    with more lost stars are flagged even when recovered.
+
+    Usage: bench_dsp_align [repeats] [width] [height]
+    Defaults to 10 matches of each field on a 4096x4096 frame.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "dsp.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static int width  = 4096;
+static int height = 4096;
+
+static dsp_stream_p createStream(const std::vector<double> &x, const std::vector<double> &y)
+{
+    dsp_stream_p stream = dsp_stream_new();
+    dsp_stream_add_dim(stream, width);
+    dsp_stream_add_dim(stream, height);
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        double location[2] = { x[i], y[i] };
+        dsp_star star {};
+        star.center.dims = 2;
+        star.center.location = location;
+        star.diameter = 3;
+        dsp_stream_add_star(stream, star);
+    }
+    return stream;
+}
+
+static void destroyStream(dsp_stream_p stream)
+{
+    for (int i = 0; i < stream->stars_count; i++)
+        free(stream->stars[i].center.location);
+    dsp_stream_free(stream);
+}
+
+static void transform(double angle, double scale, double x, double y, double &tx, double &ty)
+{
+    double cx = width / 2.0, cy = height / 2.0;
+    tx = scale * (cos(angle) * (x - cx) - sin(angle) * (y - cy)) + cx + 17.5;
+    ty = scale * (sin(angle) * (x - cx) + cos(angle) * (y - cy)) + cy - 23.25;
+}
+
+static void run(int count, double angle, double scale, double outliers, int repeats)
+{
+    std::mt19937 random(count);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::normal_distribution<double> noise(0, 0.1);
+    std::vector<double> rx, ry, cx, cy;
+    for (int i = 0; i < count; i++)
+    {
+        double x = uniform(random) * width, y = uniform(random) * height, tx, ty;
+        rx.push_back(x);
+        ry.push_back(y);
+        if (uniform(random) < outliers)
+            continue;
+        transform(angle, scale, x, y, tx, ty);
+        cx.push_back(tx + noise(random));
+        cy.push_back(ty + noise(random));
+    }
+    for (int i = 0; i < count * outliers; i++)
+    {
+        cx.push_back(uniform(random) * width);
+        cy.push_back(uniform(random) * height);
+    }
+
+    dsp_stream_p ref = createStream(rx, ry);
+    dsp_stream_p cur = createStream(cx, cy);
+
+    int err = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+        err = dsp_align_get_offset(ref, cur, 2, 50, 3);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+    // dsp_stream_align samples the current frame at these positions for the reference stars
+    dsp_align_info &info = cur->align_info;
+    double worst = 0;
+    for (int i = 0; i < count; i++)
+    {
+        double px = rx[i] - info.center[0] + info.offset[0];
+        double py = ry[i] - info.center[1] + info.offset[1];
+        double r = -info.radians[0], tx, ty;
+        transform(angle, scale, rx[i], ry[i], tx, ty);
+        worst = fmax(worst, hypot((cos(r) * px - sin(r) * py) / info.factor[0] + info.center[0] - tx,
+                                  (sin(r) * px + cos(r) * py) / info.factor[1] + info.center[1] - ty));
+    }
+
+    printf("%6d stars %7.2f rad %5.2fx %4.0f%% outliers %10.2f ms  score %.2f  %s%s\n", count, angle, scale, outliers * 100,
+           ms, info.score, worst < 0.5 ? "recovered" : "failed", err & DSP_ALIGN_NO_MATCH ? ", below target score" : "");
+
+    destroyStream(ref);
+    destroyStream(cur);
+}
+
+int main(int argc, char *argv[])
+{
+    int repeats = argc > 1 ? atoi(argv[1]) : 10;
+    width       = argc > 2 ? atoi(argv[2]) : 4096;
+    height      = argc > 3 ? atoi(argv[3]) : 4096;
+    if (repeats < 1)
+        repeats = 1;
+
+    printf("Star field alignment on %dx%d frames, %d matches each\n\n", width, height, repeats);
+
+    for (int count : { 50, 100, 250, 500, 1000 })
+        run(count, 0.4, 1.0, 0.1, repeats);
+    printf("\n");
+    for (double angle : { 0.0, 0.05, 1.5, 3.1 })
+        run(250, angle, 1.0, 0.1, repeats);
+    printf("\n");
+    for (double scale : { 0.8, 0.95, 1.05, 1.25 })
+        run(250, 0.4, scale, 0.1, repeats);
+    printf("\n");
+    for (double outliers : { 0.0, 0.2, 0.4, 0.5 })
+        run(250, 0.4, 1.0, outliers, repeats);
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    DSP BLOB ingestion and output benchmark
+
+    Runs the path of a frame through an in place DSP plugin, from the driver buffer to the FITS BLOB,
+    as it was done before DSP::Frame, and as it is done now: the input read in place, converted once
+    into the working stream, and written by cfitsio straight from the stream samples into a shared
+    buffer allocated for the whole file. Reports the time per frame, the full frame passes done by each
+    path and the peak memory of a frame, measured in a child process for each path.
+
+    Usage: bench_dsp_blob [width] [height] [repeats]
+    Defaults to 10 frames of 6248x4176 pixels.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "dsp.h"
+#include "dsp/frame.h"
+#include "sharedblob.h"
+
+#include <fitsio.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int width  = 6248;
+static int height = 4176;
+
+// the work of an in place plugin, the same for both paths
+static void process(dsp_stream_p stream)
+{
+    dsp_buffer_stretch(stream->buf, stream->len, 0, 65535);
+}
+
+static size_t writeFITS(void *memptr, size_t memsize, void *(*reallocator)(void *, size_t), int datatype,
+                        const void *samples, void **out)
+{
+    fitsfile *fptr = nullptr;
+    int status = 0;
+    long naxes[2] = { width, height };
+    fits_create_memfile(&fptr, &memptr, &memsize, 2880, reallocator, &status);
+    fits_create_img(fptr, USHORT_IMG, 2, naxes, &status);
+    fits_write_img(fptr, datatype, 1, static_cast<long>(width) * height, const_cast<void*>(samples), &status);
+    fits_close_file(fptr, &status);
+    *out = memptr;
+    return status ? 0 : memsize;
+}
+
+// before: eager conversion, copy into the plugin stream, conversion back to the BLOB samples,
+// then a FITS file growing from 5760 bytes
+template <typename T>
+static size_t legacyPath(const T *input, int, int &passes)
+{
+    dsp_stream_p frame = dsp_stream_new();
+    dsp_stream_add_dim(frame, width);
+    dsp_stream_add_dim(frame, height);
+    dsp_stream_alloc_buffer(frame, frame->len);
+    dsp_buffer_copy(input, frame->buf, frame->len);
+    dsp_stream_p stream = dsp_stream_copy(frame);
+    process(stream);
+    uint16_t *blob = static_cast<uint16_t*>(malloc(sizeof(uint16_t) * stream->len));
+    dsp_buffer_copy(stream->buf, blob, stream->len);
+    void *memptr = nullptr;
+    size_t size = writeFITS(malloc(5760), 5760, realloc, TUSHORT, blob, &memptr);
+    free(memptr);
+    free(blob);
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+    dsp_stream_free_buffer(frame);
+    dsp_stream_free(frame);
+    // conversion, copy, plugin, conversion back, FITS write
+    passes = 5;
+    return size;
+}
+
+// now: the input read in place, one working copy for the plugin, the stream written into a shared BLOB
+template <typename T>
+static size_t framePath(const T *input, int bps, int &passes)
+{
+    int sizes[2] = { width, height };
+    DSP::Frame frame(reinterpret_cast<uint8_t*>(const_cast<T*>(input)), 2, sizes, bps);
+    dsp_stream_p stream = dsp_stream_copy(frame.getStream());
+    process(stream);
+    void *memptr = nullptr;
+    size_t allocated = 8640 + static_cast<size_t>(stream->len) * sizeof(uint16_t);
+    size_t size = writeFITS(IDSharedBlobAlloc(allocated), 2880, IDSharedBlobRealloc,
+                            sizeof(dsp_t) == sizeof(double) ? TDOUBLE : TFLOAT, stream->buf, &memptr);
+    IDSharedBlobFree(memptr);
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+    // conversion unless wrapped, working copy, plugin, FITS write
+    passes = (bps == DSP::Frame::sampleBits<dsp_t>() ? 3 : 4);
+    return size;
+}
+
+// peak resident memory of a child running one frame, above the one of a child doing nothing
+static double peakMB(const std::function<void()> &run)
+{
+    auto measure = [](const std::function<void()> &body)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            body();
+            _exit(0);
+        }
+        int status = 0;
+        struct rusage usage;
+        wait4(pid, &status, 0, &usage);
+        return usage.ru_maxrss / 1024.0;
+    };
+    return measure(run) - measure([]() {});
+}
+
+template <typename T>
+static void report(const char *name, int bps, int repeats)
+{
+    std::vector<T> input(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < input.size(); i++)
+        input[i] = static_cast<T>((i * 2654435761u) % 60000);
+
+    int passes = 0;
+    size_t size = 0;
+    for (auto path : { &legacyPath<T>, &framePath<T> })
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; i++)
+            size = path(input.data(), bps, passes);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+        double mb = peakMB([&]()
+        {
+            int unused;
+            path(input.data(), bps, unused);
+        });
+        printf("%-14s %-7s %10.1f ms  %d full frame passes  peak %8.1f MB  FITS %zu bytes\n", name,
+               path == &legacyPath<T> ? "before" : "now", ms, passes, mb, size);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    width       = argc > 1 ? atoi(argv[1]) : 6248;
+    height      = argc > 2 ? atoi(argv[2]) : 4176;
+    int repeats = argc > 3 ? atoi(argv[3]) : 10;
+    if (repeats < 1)
+        repeats = 1;
+
+    printf("Frames of %dx%d pixels (%.1f MB of 16 bit samples), %d frames each\n\n", width, height,
+           width * 2.0 * height / 1048576.0, repeats);
+
+    report<uint16_t>("16 bit input", 16, repeats);
+    report<dsp_t>("dsp_t input", DSP::Frame::sampleBits<dsp_t>(), repeats);
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    DSP Fourier transform benchmark
+
+    Reports the sustained rate of forward and inverse transforms of same sized frames,
+    planning every transform (as without the plan cache) and reusing the cached plans.
+
+    Usage: bench_dsp_fft [width] [height] [frames] [threads] [rigor] [wisdom file]
+    rigor: 0 estimate, 1 measure, 2 patient, 3 exhaustive. Defaults to 1024x1024, 100 frames, 1 thread, estimate.
+    If a wisdom file is given it is imported before and exported after the run, run twice to see
+    the first frame latency of measured plans drop.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "dsp.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+static dsp_stream_p createStream(int width, int height)
+{
+    dsp_stream_p stream = dsp_stream_new();
+    dsp_stream_add_dim(stream, width);
+    dsp_stream_add_dim(stream, height);
+    dsp_stream_alloc_buffer(stream, stream->len);
+    return stream;
+}
+
+static void fillStream(dsp_stream_p stream, int frame)
+{
+    for (int i = 0; i < stream->len; i++)
+        stream->buf[i] = (i * 31 + frame * 7) % 4096;
+}
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// returns the time of the first frame, fills the sustained frames per second
+static double run(dsp_stream_p stream, int frames, bool planEveryFrame, double &fps)
+{
+    double first = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        if (planEveryFrame)
+            dsp_fourier_clear_plans();
+
+        auto frameStart = std::chrono::steady_clock::now();
+        fillStream(stream, frame);
+        dsp_fourier_dft(stream, 1);
+        dsp_fourier_idft(stream);
+
+        if (frame == 0)
+        {
+            first = elapsed(frameStart);
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    fps = frames > 1 ? (frames - 1) / (elapsed(start) / 1000) : 0;
+    return first;
+}
+
+int main(int argc, char *argv[])
+{
+    int width   = argc > 1 ? atoi(argv[1]) : 1024;
+    int height  = argc > 2 ? atoi(argv[2]) : 1024;
+    int frames  = argc > 3 ? atoi(argv[3]) : 100;
+    int threads = argc > 4 ? atoi(argv[4]) : 1;
+    int rigor   = argc > 5 ? atoi(argv[5]) : DSP_FOURIER_ESTIMATE;
+    const char *wisdom = argc > 6 ? argv[6] : nullptr;
+
+    threads = dsp_fourier_set_threads(threads);
+    printf("Forward and inverse transforms of %d frames %dx%d, %d threads, rigor %d\n\n", frames, width, height, threads,
+           rigor);
+
+    dsp_stream_p stream = createStream(width, height);
+    double fps = 0, first = 0;
+
+    dsp_fourier_set_rigor(DSP_FOURIER_ESTIMATE);
+    first = run(stream, frames, true, fps);
+    printf("%-28s first frame %10.1f ms, %8.1f frames/s\n", "estimate, plan every frame", first, fps);
+
+    if (wisdom != nullptr)
+        printf("Wisdom %s %s\n", wisdom, dsp_fourier_import_wisdom(wisdom) ? "imported" : "not imported");
+
+    dsp_fourier_clear_plans();
+    dsp_fourier_set_rigor(rigor);
+    first = run(stream, frames, false, fps);
+    printf("%-28s first frame %10.1f ms, %8.1f frames/s\n", "cached plans", first, fps);
+
+    if (wisdom != nullptr && dsp_fourier_export_wisdom(wisdom) == 0)
+        fprintf(stderr, "Failed to export wisdom to %s\n", wisdom);
+
+    dsp_fourier_clear_plans();
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+    return 0;
+}
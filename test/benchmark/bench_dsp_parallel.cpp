@@ -0,0 +1,142 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    DSP worker pool benchmark
+
+    Reports the cost of dispatching an empty parallel loop, creating and joining a thread per
+    range (as libdsp did before the worker pool) and using dsp_parallel_for, then the frame rate of
+    libdsp operations on small and large frames for each thread count up to the given maximum.
+
+    Usage: bench_dsp_parallel [max threads] [frames]
+    Defaults to all available threads and 100 frames.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "dsp.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+static dsp_stream_p createStream(int width, int height)
+{
+    dsp_stream_p stream = dsp_stream_new();
+    dsp_stream_add_dim(stream, width);
+    dsp_stream_add_dim(stream, height);
+    dsp_stream_alloc_buffer(stream, stream->len);
+
+    unsigned int seed = 1;
+    for (int i = 0; i < stream->len; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        stream->buf[i] = (seed >> 16) % 4096;
+    }
+
+    stream->align_info.center[0]  = width / 2;
+    stream->align_info.center[1]  = height / 2;
+    stream->align_info.radians[0] = 0.1;
+    return stream;
+}
+
+static void destroyStream(dsp_stream_p stream)
+{
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+}
+
+// returns the number of calls per second
+static double rate(int calls, const std::function<void()> &function)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++)
+        function();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return calls / seconds;
+}
+
+static void emptyLoop(void *, int, int)
+{
+}
+
+static void *emptyThread(void *)
+{
+    return nullptr;
+}
+
+static void runOperation(const char *name, int width, int height, int frames,
+                         const std::function<void(dsp_stream_p)> &operation)
+{
+    dsp_stream_p stream = createStream(width, height);
+    double fps = rate(frames, [&]()
+    {
+        operation(stream);
+    });
+    printf("  %-24s %5dx%-5d %10.1f frames/s\n", name, width, height, fps);
+    destroyStream(stream);
+}
+
+int main(int argc, char *argv[])
+{
+    int maxThreads = argc > 1 ? atoi(argv[1]) : std::thread::hardware_concurrency();
+    int frames     = argc > 2 ? atoi(argv[2]) : 100;
+    if (maxThreads < 1)
+        maxThreads = 1;
+
+    for (int threads = 1; threads <= maxThreads; threads++)
+    {
+        dsp_max_threads(threads);
+
+        double spawned = rate(1000, [&]()
+        {
+            std::vector<pthread_t> th(threads);
+            for (int t = 0; t < threads; t++)
+                pthread_create(&th[t], nullptr, emptyThread, nullptr);
+            for (int t = 0; t < threads; t++)
+                pthread_join(th[t], nullptr);
+        });
+        double pooled = rate(1000, [&]()
+        {
+            dsp_parallel_for(threads, emptyLoop, nullptr);
+        });
+
+        printf("%d threads (%d in the pool)\n", threads, dsp_parallel_threads());
+        printf("  %-24s %10.2f us\n", "thread per range", 1e6 / spawned);
+        printf("  %-24s %10.2f us\n", "dsp_parallel_for", 1e6 / pooled);
+
+        runOperation("dsp_buffer_median 3x3", 128, 128, frames, [](dsp_stream_p s)
+        {
+            dsp_buffer_median(s, 3, 1);
+        });
+        runOperation("dsp_buffer_median 3x3", 1024, 1024, frames / 10 + 1, [](dsp_stream_p s)
+        {
+            dsp_buffer_median(s, 3, 1);
+        });
+        runOperation("dsp_stream_rotate", 128, 128, frames, [](dsp_stream_p s)
+        {
+            dsp_stream_rotate(s);
+        });
+        runOperation("dsp_stream_rotate", 1024, 1024, frames / 10 + 1, [](dsp_stream_p s)
+        {
+            dsp_stream_rotate(s);
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    DSP position iteration benchmark
+
+    Compares per element position lookup with dsp_stream_get_position (one allocation per element)
+    against dsp_stream_position_init/next, and reports the wall time of the libdsp operations
+    iterating multidimensional streams. Build it on an older revision to get the before numbers
+    of the operations, the API used by them is unchanged.
+
+    Usage: bench_dsp_position [width] [height] [threads]
+    Defaults to a 4096x4096 stream processed by all available threads.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "dsp.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+
+static dsp_stream_p createStream(int width, int height)
+{
+    dsp_stream_p stream = dsp_stream_new();
+    dsp_stream_add_dim(stream, width);
+    dsp_stream_add_dim(stream, height);
+    dsp_stream_alloc_buffer(stream, stream->len);
+
+    unsigned int seed = 1;
+    for (int i = 0; i < stream->len; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        stream->buf[i] = (seed >> 16) % 4096;
+    }
+
+    stream->align_info.center[0]  = width / 2;
+    stream->align_info.center[1]  = height / 2;
+    stream->align_info.offset[0]  = 3;
+    stream->align_info.offset[1]  = -2;
+    stream->align_info.radians[0] = 0.1;
+    stream->align_info.factor[0]  = 1.05;
+    stream->align_info.factor[1]  = 1.05;
+    stream->ROI[0].start = width / 4;
+    stream->ROI[0].len   = width / 2;
+    stream->ROI[1].start = height / 4;
+    stream->ROI[1].len   = height / 2;
+    return stream;
+}
+
+static void destroyStream(dsp_stream_p stream)
+{
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+}
+
+static double measure(const std::function<void()> &function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void runOperation(const char *name, int width, int height, const std::function<void(dsp_stream_p)> &operation)
+{
+    dsp_stream_p stream = createStream(width, height);
+    double ms = measure([&]()
+    {
+        operation(stream);
+    });
+    printf("%-32s %10.1f ms\n", name, ms);
+    destroyStream(stream);
+}
+
+int main(int argc, char *argv[])
+{
+    int width   = argc > 1 ? atoi(argv[1]) : 4096;
+    int height  = argc > 2 ? atoi(argv[2]) : 4096;
+    int threads = argc > 3 ? atoi(argv[3]) : std::thread::hardware_concurrency();
+
+    dsp_max_threads(threads > 0 ? threads : 1);
+    printf("Stream %dx%d, %lu threads\n\n", width, height, dsp_max_threads(0));
+
+    dsp_stream_p stream = createStream(width, height);
+    volatile long checksum = 0;
+
+    double legacy = measure([&]()
+    {
+        for (int x = 0; x < stream->len; x++)
+        {
+            int *pos = dsp_stream_get_position(stream, x);
+            checksum += pos[0] + pos[1];
+            free(pos);
+        }
+    });
+
+    double iterator = measure([&]()
+    {
+        int pos[2];
+        dsp_stream_position_init(stream, 0, pos);
+        for (int x = 0; x < stream->len; x++, dsp_stream_position_next(stream, pos))
+            checksum += pos[0] + pos[1];
+    });
+
+    destroyStream(stream);
+
+    printf("%-32s %10.1f ms\n", "dsp_stream_get_position loop", legacy);
+    printf("%-32s %10.1f ms\n", "dsp_stream_position_next loop", iterator);
+    printf("%-32s %10.1f x\n\n", "speedup", legacy / iterator);
+
+    runOperation("dsp_buffer_shift", width, height, [](dsp_stream_p s)
+    {
+        dsp_buffer_shift(s);
+    });
+    runOperation("dsp_buffer_median 3x3", width, height, [](dsp_stream_p s)
+    {
+        dsp_buffer_median(s, 3, 1);
+    });
+    runOperation("dsp_buffer_sigma 3x3", width, height, [](dsp_stream_p s)
+    {
+        dsp_buffer_sigma(s, 3);
+    });
+    runOperation("dsp_stream_rotate", width, height, [](dsp_stream_p s)
+    {
+        dsp_stream_rotate(s);
+    });
+    runOperation("dsp_stream_scale", width, height, [](dsp_stream_p s)
+    {
+        dsp_stream_scale(s);
+    });
+    runOperation("dsp_stream_crop", width, height, [](dsp_stream_p s)
+    {
+        dsp_stream_crop(s);
+    });
+    runOperation("dsp_stream_align", width, height, [](dsp_stream_p s)
+    {
+        dsp_stream_align(s);
+    });
+    runOperation("dsp_filter_lowpass", width, height, [](dsp_stream_p s)
+    {
+        dsp_filter_lowpass(s, 1.0);
+    });
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    DSP star detection benchmark
+
+    Builds a synthetic 16 bit frame with a background gradient, noise and gaussian stars,
+    then reports the time of dsp_stars_find on the whole frame and on a centered region of
+    interest, with the number of stars found and the centroid error of the isolated stars.
+
+    Usage: bench_dsp_stars [width] [height] [stars] [threads] [repeats]
+    Defaults to a 9576x6388 (61 MP) frame with 5000 stars processed by all available threads.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "dsp.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct Star
+{
+    double x, y;
+};
+
+static dsp_stream_p createFrame(int width, int height, int count, std::vector<Star> &stars)
+{
+    dsp_stream_p stream = dsp_stream_new();
+    dsp_stream_add_dim(stream, width);
+    dsp_stream_add_dim(stream, height);
+    dsp_stream_alloc_buffer(stream, stream->len);
+
+    std::mt19937 random(1);
+    std::normal_distribution<double> noise(0, 12);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            stream->buf[x + y * width] = (int)(800 + 200.0 * x / width + 100.0 * y / height + noise(random));
+
+    for (int i = 0; i < count; i++)
+    {
+        Star star { 10 + uniform(random) * (width - 20), 10 + uniform(random) * (height - 20) };
+        double amplitude = 300 + 20000 * pow(uniform(random), 3);
+        double sigma = 1.2 + uniform(random);
+        for (int y = (int)star.y - 8; y <= (int)star.y + 8; y++)
+            for (int x = (int)star.x - 8; x <= (int)star.x + 8; x++)
+                stream->buf[x + y * width] = Min(65535, (int)(stream->buf[x + y * width] + amplitude *
+                                                 exp(-(pow(x - star.x, 2) + pow(y - star.y, 2)) / (2 * sigma * sigma))));
+        stars.push_back(star);
+    }
+    return stream;
+}
+
+static void report(const char *name, dsp_stream_p stream, dsp_region *roi, int repeats, const std::vector<Star> &stars)
+{
+    int found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+        found = dsp_stars_find(stream, roi, 5, 4, 0);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+    // stars closer than a few pixels merge, the error of the isolated ones is reported
+    double worst = 0, sum = 0;
+    int isolated = 0;
+    for (const Star &star : stars)
+    {
+        bool alone = true;
+        for (const Star &other : stars)
+            alone &= &other == &star || hypot(other.x - star.x, other.y - star.y) > 20;
+        double best = 1e9;
+        for (int i = 0; alone && i < stream->stars_count; i++)
+            best = fmin(best, hypot(stream->stars[i].center.location[0] - star.x, stream->stars[i].center.location[1] - star.y));
+        if (alone && best < 2)
+        {
+            worst = fmax(worst, best);
+            sum += best;
+            isolated++;
+        }
+    }
+    printf("%-16s %10.1f ms  %6d stars found, centroid error of %d isolated stars: mean %.3f px, worst %.3f px\n", name, ms,
+           found, isolated, isolated > 0 ? sum / isolated : 0, worst);
+}
+
+int main(int argc, char *argv[])
+{
+    int width   = argc > 1 ? atoi(argv[1]) : 9576;
+    int height  = argc > 2 ? atoi(argv[2]) : 6388;
+    int count   = argc > 3 ? atoi(argv[3]) : 5000;
+    int threads = argc > 4 ? atoi(argv[4]) : std::thread::hardware_concurrency();
+    int repeats = argc > 5 ? atoi(argv[5]) : 3;
+
+    dsp_max_threads(threads > 0 ? threads : 1);
+    if (repeats < 1)
+        repeats = 1;
+
+    std::vector<Star> stars;
+    dsp_stream_p stream = createFrame(width, height, count, stars);
+    printf("Frame %dx%d (%.1f MP) with %d stars, %lu threads\n\n", width, height, width * height / 1e6, count,
+           dsp_max_threads(0));
+
+    report("whole frame", stream, nullptr, repeats, stars);
+    dsp_region roi[2] = { { width / 4, width / 2 }, { height / 4, height / 2 } };
+    report("centered quarter", stream, roi, repeats, stars);
+
+    for (int i = 0; i < stream->stars_count; i++)
+        free(stream->stars[i].center.location);
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+    return 0;
+}
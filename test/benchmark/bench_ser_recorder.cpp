@@ -0,0 +1,104 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    SER Recorder benchmark
+
+    Records synthetic frames and reports the sustained write rate.
+
+    Usage: bench_ser_recorder [directory] [width] [height] [depth] [frames]
+    Defaults to 3840x2160 16-bit frames written to /dev/shm (tmpfs).
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "stream/recorder/serrecorder.h"
+#include "stream/recorder/batchfilewriter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+static double recordFrames(const std::string &filename, uint32_t options, uint16_t width, uint16_t height,
+                           uint8_t depth, int frames, const std::vector<uint8_t> &frame)
+{
+    INDI::SER_Recorder recorder;
+    char errmsg[2048];
+
+    recorder.setPixelFormat(INDI_MONO, depth);
+    recorder.setSize(width, height);
+    recorder.setWriteOptions(options);
+
+    if (recorder.open(filename.c_str(), errmsg) == false)
+    {
+        fprintf(stderr, "%s", errmsg);
+        return -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < frames; ++i)
+        recorder.writeFrame(frame.data(), frame.size(), 0);
+
+    recorder.close();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    unlink(filename.c_str());
+
+    return (static_cast<double>(frame.size()) * frames) / seconds / 1024 / 1024;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string directory = argc > 1 ? argv[1] : "/dev/shm";
+    uint16_t width  = argc > 2 ? atoi(argv[2]) : 3840;
+    uint16_t height = argc > 3 ? atoi(argv[3]) : 2160;
+    uint8_t  depth  = argc > 4 ? atoi(argv[4]) : 16;
+    int      frames = argc > 5 ? atoi(argv[5]) : 200;
+
+    std::vector<uint8_t> frame(static_cast<size_t>(width) * height * (depth > 8 ? 2 : 1));
+    for (size_t i = 0; i < frame.size(); ++i)
+        frame[i] = static_cast<uint8_t>(i * 31);
+
+    std::string filename = directory + "/bench_ser_recorder.ser";
+
+    printf("Recording %d frames of %ux%u %u-bit (%.1f MB) to %s\n",
+           frames, width, height, depth, frame.size() / 1024.0 / 1024.0, directory.c_str());
+
+    struct
+    {
+        const char *name;
+        uint32_t options;
+    } modes[] =
+    {
+        {"buffered",                 0},
+        {"preallocate",              INDI::BatchFileWriter::PREALLOCATE},
+        {"direct I/O",               INDI::BatchFileWriter::DIRECT_IO},
+        {"direct I/O + preallocate", INDI::BatchFileWriter::DIRECT_IO | INDI::BatchFileWriter::PREALLOCATE},
+    };
+
+    for (const auto &mode : modes)
+    {
+        double rate = recordFrames(filename, mode.options, width, height, depth, frames, frame);
+        if (rate < 0)
+            return 1;
+        printf("%-26s %10.1f MB/s\n", mode.name, rate);
+    }
+
+    return 0;
+}
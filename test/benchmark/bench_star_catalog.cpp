@@ -0,0 +1,170 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    CCD simulator star catalog benchmark
+
+    Draws the light frames of a guided 10 ms exposure loop of a 320x240 sensor with the CCD simulator.
+    First the catalog is read on every exposure, running the catalog tool through popen and parsing its
+    output as the former simulator did, then the StarCatalog tiles are loaded once through the same tool.
+    A shell printing a recorded gsc output stands for the gsc tool, so the figures leave out the catalog
+    search itself.
+
+    Usage: bench_star_catalog [stars] [frames]
+    Defaults to 3000 stars around the field and 500 frames.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "drivers/ccd/ccd_simulator.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+static const double FieldRA = 83.8;
+static const double FieldDE = -5.4;
+
+static std::string recording;
+static int lookups = 0;
+
+// the former lookup, a popen of the catalog tool parsed line by line
+static bool formerLookup(double, double, double, double, std::vector<StarCatalog::Star> &stars)
+{
+    std::string command = "cat " + recording;
+    FILE *pp = popen(command.c_str(), "r");
+    if (pp == nullptr)
+        return false;
+    lookups++;
+
+    char line[256];
+    while (fgets(line, 256, pp) != nullptr)
+    {
+        char id[20];
+        char plate[6];
+        char ob[6];
+        float mag;
+        float mage;
+        float ra;
+        float dec;
+        float pose;
+        int band;
+        float dist;
+        int dir;
+        int c;
+
+        int rc = sscanf(line, "%10s %f %f %f %f %f %d %d %4s %2s %f %d", id, &ra, &dec, &pose, &mag, &mage,
+                        &band, &c, plate, ob, &dist, &dir);
+        if (rc == 12)
+            stars.push_back({ ra, dec, mag });
+    }
+    pclose(pp);
+    return true;
+}
+
+class BenchCCDSim : public CCDSim
+{
+    public:
+        BenchCCDSim()
+        {
+            initProperties();
+
+            // A small 320x240 sensor on a 400mm scope, exposing 10ms frames as a guide or focus loop would
+            SimulatorSettingsNP[SIM_XRES].setValue(320);
+            SimulatorSettingsNP[SIM_YRES].setValue(240);
+            SimulatorSettingsNP[SIM_XSIZE].setValue(5.2);
+            SimulatorSettingsNP[SIM_YSIZE].setValue(5.2);
+            SimulatorSettingsNP[SIM_LIMITINGMAG].setValue(14.0);
+            setupParameters();
+            ScopeInfoNP[FOCAL_LENGTH].setValue(400);
+            PrimaryCCD.setFrameType(INDI::CCDChip::LIGHT_FRAME);
+            ExposureRequest = 0.01;
+            m_Catalog.setLoader(formerLookup);
+        }
+
+        // Exposures per second, the catalog is either read on every exposure or kept in memory
+        double exposures(int frames, bool cached)
+        {
+            // Prime the tiles and the frame buffers
+            point(0);
+            DrawCcdFrame(&PrimaryCCD);
+
+            lookups = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; i++)
+            {
+                if (!cached)
+                    m_Catalog.clear();
+                point(i);
+                DrawCcdFrame(&PrimaryCCD);
+            }
+            return frames / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    private:
+        // Guiding moves the field by a few arcseconds between frames, RA is in hours
+        void point(int frame)
+        {
+            RA = (FieldRA + 0.001 * std::sin(frame * 0.1)) / 15.0;
+            Dec = FieldDE + 0.001 * std::cos(frame * 0.1);
+        }
+};
+
+int main(int argc, char *argv[])
+{
+    int count  = argc > 1 ? atoi(argv[1]) : 3000;
+    int frames = argc > 2 ? atoi(argv[2]) : 500;
+    if (frames < 1)
+        frames = 1;
+
+    char path[] = "/tmp/bench_star_catalog_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return 1;
+    recording = path;
+    FILE *fp = fdopen(fd, "w");
+    uint32_t seed = 1;
+    for (int i = 0; i < count; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        double ra = FieldRA + ((seed >> 8) / 16777216.0 - 0.5) * 2;
+        seed = seed * 1664525u + 1013904223u;
+        double dec = FieldDE + ((seed >> 8) / 16777216.0 - 0.5) * 2;
+        seed = seed * 1664525u + 1013904223u;
+        double mag = 4 + (seed >> 8) / 16777216.0 * 10;
+        fprintf(fp, "N9BI%06d %10.6f %+10.6f 0.2 %5.2f 0.40 0 1 0P9N 00 12.3 180\n", i, ra, dec, mag);
+    }
+    fclose(fp);
+
+    printf("Simulated 320x240 light frames of a guided 10 ms exposure loop, %d frames, %d stars around the field\n\n",
+           frames, count);
+
+    BenchCCDSim ccd;
+
+    double former = ccd.exposures(frames, false);
+    printf("catalog per exposure  %8.1f exposures/s  %6.3f ms each  %d catalog reads\n", former, 1000 / former, lookups);
+
+    double cached = ccd.exposures(frames, true);
+    printf("StarCatalog           %8.1f exposures/s  %6.3f ms each  %d catalog reads\n", cached, 1000 / cached, lookups);
+    printf("%.1fx\n", cached / former);
+
+    unlink(path);
+    return 0;
+}
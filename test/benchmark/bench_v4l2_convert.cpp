@@ -0,0 +1,158 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    V4L2 colour conversion benchmark
+
+    Converts random frames with the colour conversions and demosaics of V4L2 captures, and decodes them with the
+    builtin decoder for the formats it repacks, once on the calling thread only and once with the libdsp worker
+    pool. Reports the best of several runs as megapixels and frames per second.
+
+    Usage: bench_v4l2_convert [threads] [runs]
+    Defaults to the libdsp thread count and 20 runs, at 1920x1080 and 3840x2160.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; see the file COPYING.LIB.  If not, write to
+    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "dsp.h"
+#include "stream/ccvt.h"
+#include "webcam/v4l2_decode/v4l2_builtin_decoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+static int runs = 20;
+static unsigned long threads = 1;
+
+// Best time of the runs in seconds
+static double best(const std::function<void()> &convert)
+{
+    double result = 1e9;
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        convert();
+        result = std::min(result, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return result;
+}
+
+static void report(const char *name, int width, int height, const std::function<void()> &convert)
+{
+    dsp_max_threads(1);
+    double serial = best(convert);
+    dsp_max_threads(threads);
+    double parallel = best(convert);
+
+    const double pixels = static_cast<double>(width) * height / 1e6;
+    printf("%-10s 1 thread %8.1f MP/s %7.1f fps   %2lu threads %8.1f MP/s %7.1f fps\n", name, pixels / serial,
+           1 / serial, threads, pixels / parallel, 1 / parallel);
+}
+
+static void decoder(uint32_t format, unsigned int width, unsigned int height, unsigned int bytesPerPixel,
+                    unsigned char *frame, const char *name)
+{
+    V4L2_Builtin_Decoder decoder;
+    decoder.init();
+
+    v4l2_format f;
+    memset(&f, 0, sizeof(f));
+    f.type                 = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    f.fmt.pix.pixelformat  = format;
+    f.fmt.pix.width        = width;
+    f.fmt.pix.height       = height;
+    f.fmt.pix.bytesperline = width * bytesPerPixel;
+    decoder.setformat(f, false);
+
+    v4l2_buffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    report(name, width, height, [&]()
+    {
+        decoder.decode(frame, &buffer, false);
+    });
+}
+
+static void run(int width, int height)
+{
+    const size_t pixels = static_cast<size_t>(width) * height;
+
+    // Bayer frames get a row of margin on both sides, the GRBG demosaic reads a row before the frame
+    std::vector<uint8_t> src(pixels * 2 + 4 * width);
+    std::vector<uint16_t> src16(pixels + 2 * width);
+    uint32_t seed = 1;
+    for (auto &value : src)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        value = static_cast<uint8_t>(seed >> 16);
+    }
+    for (auto &value : src16)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        value = static_cast<uint16_t>(seed >> 16);
+    }
+    uint8_t *frame = src.data() + 2 * width;
+    std::vector<uint8_t> dst(pixels * 4);
+    std::vector<uint16_t> dst16(pixels * 3);
+
+    printf("\n%dx%d\n", width, height);
+    report("yuyv_bgr32", width, height, [&]()
+    {
+        ccvt_yuyv_bgr32(width, height, frame, dst.data());
+    });
+    report("yuyv_rgb24", width, height, [&]()
+    {
+        ccvt_yuyv_rgb24(width, height, frame, dst.data());
+    });
+    report("yuyv_420p", width, height, [&]()
+    {
+        ccvt_yuyv_420p(width, height, frame, dst.data(), dst.data() + pixels, dst.data() + pixels + pixels / 4);
+    });
+    report("bggr", width, height, [&]()
+    {
+        bayer2rgb24(dst.data(), frame, width, height);
+    });
+    report("rggb", width, height, [&]()
+    {
+        bayer_rggb_2rgb24(dst.data(), frame, width, height);
+    });
+    report("grbg", width, height, [&]()
+    {
+        bayer_grbg_to_rgb24(dst.data(), frame, width, height);
+    });
+    report("bggr16", width, height, [&]()
+    {
+        bayer16_2_rgb24(dst16.data(), src16.data() + width, width, height);
+    });
+
+    decoder(V4L2_PIX_FMT_UYVY, width, height, 2, frame, "uyvy");
+    decoder(V4L2_PIX_FMT_RGB565, width, height, 2, frame, "rgb565");
+    decoder(V4L2_PIX_FMT_NV12, width, height, 1, frame, "nv12");
+}
+
+int main(int argc, char *argv[])
+{
+    threads = argc > 1 ? std::max(1, atoi(argv[1])) : dsp_max_threads(0);
+    runs    = argc > 2 ? std::max(1, atoi(argv[2])) : 20;
+
+    run(1920, 1080);
+    run(3840, 2160);
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    Batch coordinate conversion tests
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "libastro.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+// Epochs from 1990 to 2050
+static const double Epochs[] = { 2447892.5, 2451545.0, 2459945.5, 2461331.75, 2469807.5 };
+
+// Angular distance in milliarcseconds
+static double separation(const INDI::IEquatorialCoordinates &a, const INDI::IEquatorialCoordinates &b)
+{
+    double ra1 = a.rightascension * M_PI / 12, dec1 = a.declination * M_PI / 180;
+    double ra2 = b.rightascension * M_PI / 12, dec2 = b.declination * M_PI / 180;
+    double x = cos(dec1) * sin(dec2) - sin(dec1) * cos(dec2) * cos(ra2 - ra1);
+    double y = cos(dec2) * sin(ra2 - ra1);
+    double z = sin(dec1) * sin(dec2) + cos(dec1) * cos(dec2) * cos(ra2 - ra1);
+    return atan2(sqrt(x * x + y * y), z) * 180 / M_PI * 3600e3;
+}
+
+// Positions all over the sky, up to a degree from the poles
+static std::vector<INDI::IEquatorialCoordinates> grid()
+{
+    std::vector<INDI::IEquatorialCoordinates> positions;
+    for (double dec = -89; dec <= 89; dec += 4.45)
+        for (double ra = 0.05; ra < 24; ra += 0.73)
+            positions.push_back({ ra, dec });
+    return positions;
+}
+
+// The per position conversions use first order nutation and aberration, which drift
+// from the rotation by a few milliarcseconds times the tangent of the declination
+static double tolerance(double dec)
+{
+    return 2 + 2 * fabs(tan(dec * M_PI / 180));
+}
+
+TEST(LibAstroTest, J2000toObservedMatchesPerPosition)
+{
+    INDI::SetEpochTolerance(0);
+    const std::vector<INDI::IEquatorialCoordinates> positions = grid();
+    std::vector<INDI::IEquatorialCoordinates> batch(positions.size());
+
+    for (double jd : Epochs)
+    {
+        INDI::J2000toObserved(positions.data(), positions.size(), jd, batch.data());
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+            INDI::IEquatorialCoordinates J2000pos = positions[i], observed;
+            INDI::J2000toObserved(&J2000pos, jd, &observed);
+            ASSERT_LT(separation(batch[i], observed), tolerance(positions[i].declination))
+                    << "JD " << jd << " RA " << positions[i].rightascension << " DE " << positions[i].declination;
+            ASSERT_GE(batch[i].rightascension, 0);
+            ASSERT_LT(batch[i].rightascension, 24);
+        }
+    }
+}
+
+TEST(LibAstroTest, ObservedToJ2000MatchesPerPosition)
+{
+    INDI::SetEpochTolerance(0);
+    const std::vector<INDI::IEquatorialCoordinates> positions = grid();
+    std::vector<INDI::IEquatorialCoordinates> batch(positions.size());
+
+    for (double jd : Epochs)
+    {
+        INDI::ObservedToJ2000(positions.data(), positions.size(), jd, batch.data());
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+            INDI::IEquatorialCoordinates observed = positions[i], J2000pos;
+            INDI::ObservedToJ2000(&observed, jd, &J2000pos);
+            ASSERT_LT(separation(batch[i], J2000pos), tolerance(positions[i].declination))
+                    << "JD " << jd << " RA " << positions[i].rightascension << " DE " << positions[i].declination;
+        }
+
+        // Converted back in place to where they were observed
+        INDI::J2000toObserved(batch.data(), batch.size(), jd, batch.data());
+        for (size_t i = 0; i < positions.size(); i++)
+            ASSERT_LT(separation(batch[i], positions[i]), tolerance(positions[i].declination)) << "JD " << jd;
+    }
+}
+
+TEST(LibAstroTest, ReusesEpochTermsWithinTolerance)
+{
+    const INDI::IEquatorialCoordinates vega = { 18.6156, 38.7837 };
+    const double jd = Epochs[3];
+    INDI::IEquatorialCoordinates first, later, exact;
+
+    INDI::SetEpochTolerance(0.5);
+    EXPECT_DOUBLE_EQ(INDI::GetEpochTolerance(), 0.5);
+    INDI::J2000toObserved(&vega, 1, jd, &first);
+    INDI::J2000toObserved(&vega, 1, jd + 0.25, &later);
+    EXPECT_EQ(first.rightascension, later.rightascension);
+    EXPECT_EQ(first.declination, later.declination);
+
+    // Past the tolerance, the terms of the new epoch are computed
+    INDI::SetEpochTolerance(1.0 / 1440);
+    INDI::J2000toObserved(&vega, 1, jd + 0.25, &exact);
+    EXPECT_GT(separation(exact, first), 10);
+    // A day and a minute apart, the positions are within a milliarcsecond
+    INDI::J2000toObserved(&vega, 1, jd + 0.25 + 0.5 / 1440, &later);
+    EXPECT_LT(separation(exact, later), 1);
+    INDI::SetEpochTolerance(1.0 / 1440);
+}
+
+TEST(LibAstroTest, ConvertsCatalogsFaster)
+{
+    INDI::SetEpochTolerance(1.0 / 1440);
+    std::vector<INDI::IEquatorialCoordinates> positions;
+    for (int i = 0; i < 100000; i++)
+        positions.push_back({ fmod(i * 0.0137, 24), fmod(i * 0.0291, 178) - 89 });
+    std::vector<INDI::IEquatorialCoordinates> observed(positions.size());
+    const double jd = Epochs[3];
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < positions.size(); i++)
+        INDI::J2000toObserved(&positions[i], jd, &observed[i]);
+    double single = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    INDI::J2000toObserved(positions.data(), positions.size(), jd, observed.data());
+    double batch = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%zu positions converted in %.1f ms one at a time, %.1f ms in a batch\n", positions.size(), single, batch);
+    RecordProperty("SingleMilliseconds", static_cast<int>(single));
+    RecordProperty("BatchMilliseconds", static_cast<int>(batch));
+    EXPECT_LT(batch, single);
+}
@@ -0,0 +1,243 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    Alpaca CCD image ingestion tests
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "alpaca_image.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ImageArray response of a 4x3 subframe, indented as some Alpaca servers send it
+static const char *RecordedPayload = R"({
+  "Type": 2,
+  "Rank": 2,
+  "Value": [
+    [ 1021, 1187, 65535 ],
+    [ 998, 1203, 40211 ],
+    [ 1002, 1195, 39877 ],
+    [ 0, 1210, 1044 ]
+  ],
+  "ClientTransactionID": 42,
+  "ServerTransactionID": 1187,
+  "ErrorNumber": 0,
+  "ErrorMessage": ""
+})";
+
+static const std::vector<int32_t> RecordedSamples =
+{
+    1021, 1187, 65535, 998, 1203, 40211, 1002, 1195, 39877, 0, 1210, 1044
+};
+
+static bool decode(AlpacaImage::JSONDecoder &decoder, const std::string &body, size_t chunk)
+{
+    for (size_t i = 0; i < body.size(); i += chunk)
+        if (!decoder.feed(body.data() + i, std::min(chunk, body.size() - i)))
+            return false;
+    return decoder.finish();
+}
+
+TEST(AlpacaImageTest, DecodesRecordedPayload)
+{
+    AlpacaImage::JSONDecoder decoder;
+    ASSERT_TRUE(decode(decoder, RecordedPayload, 4096)) << decoder.error();
+    EXPECT_EQ(decoder.width(), 4u);
+    EXPECT_EQ(decoder.height(), 3u);
+    EXPECT_EQ(decoder.rank(), 2);
+    EXPECT_EQ(decoder.planes(), 0u);
+    EXPECT_EQ(decoder.errorNumber(), 0);
+    EXPECT_EQ(decoder.samples(), RecordedSamples);
+
+    // Transposed to rows and flipped to the bottom-left origin
+    std::vector<uint16_t> frame(4 * 3);
+    ASSERT_TRUE(AlpacaImage::toFrame(reinterpret_cast<const uint8_t *>(decoder.samples().data()), AlpacaImage::Int32, 4, 3, 1,
+                                     true, frame.data()));
+    const std::vector<uint16_t> expected =
+    {
+        65535, 40211, 39877, 1044,
+        1187, 1203, 1195, 1210,
+        1021, 998, 1002, 0
+    };
+    EXPECT_EQ(frame, expected);
+}
+
+TEST(AlpacaImageTest, DecodesAcrossChunkBoundaries)
+{
+    const std::string body = RecordedPayload;
+    for (size_t chunk = 1; chunk <= 17; chunk++)
+    {
+        AlpacaImage::JSONDecoder decoder;
+        ASSERT_TRUE(decode(decoder, body, chunk)) << "chunk " << chunk << ": " << decoder.error();
+        EXPECT_EQ(decoder.samples(), RecordedSamples) << "chunk " << chunk;
+    }
+
+    for (size_t split = 1; split < body.size(); split++)
+    {
+        AlpacaImage::JSONDecoder decoder;
+        ASSERT_TRUE(decoder.feed(body.data(), split));
+        ASSERT_TRUE(decoder.feed(body.data() + split, body.size() - split));
+        ASSERT_TRUE(decoder.finish()) << "split " << split << ": " << decoder.error();
+        EXPECT_EQ(decoder.samples(), RecordedSamples) << "split " << split;
+    }
+}
+
+TEST(AlpacaImageTest, DecodesColorAndFloatingPointSamples)
+{
+    AlpacaImage::JSONDecoder color;
+    ASSERT_TRUE(decode(color, R"({"Value":[[[1,2,3],[4,5,6]],[[7,8,9],[10,11,12]]],"ErrorNumber":0})", 5)) << color.error();
+    EXPECT_EQ(color.width(), 2u);
+    EXPECT_EQ(color.height(), 2u);
+    EXPECT_EQ(color.rank(), 3);
+    EXPECT_EQ(color.planes(), 3u);
+    EXPECT_EQ(color.samples(), std::vector<int32_t>({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}));
+
+    AlpacaImage::JSONDecoder doubles;
+    ASSERT_TRUE(decode(doubles, R"({"Type":3,"Value":[[1.5e3,-3.7],[0.25,5000000000],[-12,1E2]]})", 3)) << doubles.error();
+    EXPECT_EQ(doubles.samples(), std::vector<int32_t>({1500, -3, 0, 2147483647, -12, 100}));
+}
+
+TEST(AlpacaImageTest, ReportsErrorResponses)
+{
+    AlpacaImage::JSONDecoder decoder;
+    ASSERT_TRUE(decode(decoder, R"({"Value":[],"ErrorNumber":1031,"ErrorMessage":"Camera \"Main\" is not connected"})", 4096));
+    EXPECT_EQ(decoder.errorNumber(), 1031);
+    EXPECT_EQ(decoder.errorMessage(), "Camera \"Main\" is not connected");
+}
+
+TEST(AlpacaImageTest, RejectsMalformedPayloads)
+{
+    const char *payloads[] =
+    {
+        R"({"Value":[[1,2],[3]]})",
+        R"({"Value":[[1,2],[[3],[4]]]})",
+        R"({"Value":[[[1,2]],[[3]]]})",
+        R"({"Value":[1,2,3]})",
+        R"({"Value":[[1,"2"]]})",
+        R"({"Value":[[1,null]]})",
+        R"({"Value":[[1,2]],)",
+        R"({"Value":[[1,2]]]})",
+        R"({"Value":[[1 2]]})",
+        R"({"Value":[[1,2]]} x)",
+        R"({"Value":[[1,-]]})",
+        R"({"Value":[[]]})",
+        R"({"ErrorNumber":0})",
+        R"({"Value":[[1],[2]],"Value":[[3],[4]]})",
+    };
+    for (const char *payload : payloads)
+    {
+        AlpacaImage::JSONDecoder decoder;
+        EXPECT_FALSE(decode(decoder, payload, 4096)) << payload;
+        EXPECT_FALSE(decoder.error().empty()) << payload;
+    }
+}
+
+// A 4144x2822 frame, as an 11.7 MP camera sends it, streamed to the decoder in 64 KB chunks
+static const uint32_t LargeWidth = 4144;
+static const uint32_t LargeHeight = 2822;
+
+static int32_t largeSample(uint32_t x, uint32_t y)
+{
+    return static_cast<int32_t>(1000 + (x * 7 + y * 13) % 3000);
+}
+
+static bool decodeLargeFrame(AlpacaImage::JSONDecoder &decoder, size_t &bodySize)
+{
+    std::string chunk = R"({"Type":2,"Rank":2,"Value":[)";
+    bodySize = 0;
+    for (uint32_t x = 0; x < LargeWidth; x++)
+    {
+        chunk += x ? ",[" : "[";
+        for (uint32_t y = 0; y < LargeHeight; y++)
+        {
+            if (y)
+                chunk += ',';
+            chunk += std::to_string(largeSample(x, y));
+            if (chunk.size() >= 65536)
+            {
+                bodySize += chunk.size();
+                if (!decoder.feed(chunk.data(), chunk.size()))
+                    return false;
+                chunk.clear();
+            }
+        }
+        chunk += ']';
+    }
+    chunk += R"(],"ClientTransactionID":0,"ServerTransactionID":0,"ErrorNumber":0,"ErrorMessage":""})";
+    bodySize += chunk.size();
+    return decoder.feed(chunk.data(), chunk.size()) && decoder.finish();
+}
+
+TEST(AlpacaImageTest, StreamsMultiMegapixelFrames)
+{
+    const size_t samples = static_cast<size_t>(LargeWidth) * LargeHeight;
+
+    AlpacaImage::JSONDecoder decoder(samples);
+    size_t bodySize = 0;
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(decodeLargeFrame(decoder, bodySize)) << decoder.error();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    ASSERT_EQ(decoder.width(), LargeWidth);
+    ASSERT_EQ(decoder.height(), LargeHeight);
+    ASSERT_EQ(decoder.samples().size(), samples);
+    for (uint32_t x = 0; x < LargeWidth; x += 97)
+        for (uint32_t y = 0; y < LargeHeight; y += 89)
+            ASSERT_EQ(decoder.samples()[static_cast<size_t>(x) * LargeHeight + y], largeSample(x, y));
+    decoder.samples() = std::vector<int32_t>();
+
+    // Peak memory of a child decoding the frame, above the one of a child doing nothing
+    auto peak = [](bool run)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            if (run)
+            {
+                AlpacaImage::JSONDecoder child(static_cast<size_t>(LargeWidth) * LargeHeight);
+                size_t size = 0;
+                _exit(decodeLargeFrame(child, size) ? 0 : 1);
+            }
+            _exit(0);
+        }
+        int status = 0;
+        struct rusage usage;
+        wait4(pid, &status, 0, &usage);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        return usage.ru_maxrss / 1024.0;
+    };
+    double peakMB = peak(true) - peak(false);
+    double samplesMB = samples * sizeof(int32_t) / 1048576.0;
+
+    printf("%ux%u frame, %.1f MB body generated and decoded in %.1f ms, peak %.1f MB for %.1f MB of samples\n", LargeWidth, LargeHeight,
+           bodySize / 1048576.0, ms, peakMB, samplesMB);
+    RecordProperty("DecodeMilliseconds", static_cast<int>(ms));
+    RecordProperty("PeakMegabytes", static_cast<int>(peakMB));
+
+    // Neither the body nor a document of it is held, only the samples and a chunk
+    EXPECT_LT(peakMB, samplesMB + 16);
+}
@@ -0,0 +1,82 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    Alpaca server request routing tests
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "device_manager.h"
+#include "bridges/camera_image_bytes.h"
+
+#include "basedevice.h"
+#include "indipropertytext.h"
+
+#include <cstdint>
+#include <string>
+
+#include <gtest/gtest.h>
+
+static int32_t metadataField(const std::string &body, int index)
+{
+    const uint8_t *field = reinterpret_cast<const uint8_t *>(body.data()) + 4 * index;
+    return static_cast<int32_t>(field[0] | field[1] << 8 | field[2] << 16 | static_cast<uint32_t>(field[3]) << 24);
+}
+
+// Camera device as defined by a driver, without image
+static INDI::BaseDevice cameraDevice()
+{
+    INDI::BaseDevice device;
+    device.setDeviceName("Alpaca Test CCD");
+
+    INDI::PropertyText driverInfo {1};
+    driverInfo[0].fill("DRIVER_INTERFACE", "Interface", std::to_string(INDI::BaseDevice::CCD_INTERFACE).c_str());
+    driverInfo.fill(device.getDeviceName(), "DRIVER_INFO", "Driver Info", "General Info", IP_RO, 60, IPS_IDLE);
+    device.registerProperty(driverInfo);
+    return device;
+}
+
+TEST(AlpacaServerTest, ImageBytesBodySurvivesRouting)
+{
+    DeviceManager *manager = DeviceManager::getInstance();
+    manager->addDevice(cameraDevice());
+
+    httplib::Request req;
+    req.method = "GET";
+    req.path   = "/api/v1/camera/0/imagearray";
+    req.set_header("Accept", "application/imagebytes, application/json");
+    req.params.emplace("ClientTransactionID", "42");
+
+    httplib::Response res;
+    manager->handleAlpacaRequest(req, res);
+
+    // The bridge answers with a binary InvalidOperation error, no image was captured
+    ASSERT_EQ(res.get_header_value("Content-Type"), AlpacaImageBytes::MimeType);
+    ASSERT_GT(res.body.size(), AlpacaImageBytes::MetadataSize);
+    EXPECT_EQ(metadataField(res.body, 0), 1);
+    EXPECT_EQ(metadataField(res.body, 1), 0x40B);
+    EXPECT_EQ(metadataField(res.body, 2), 42);
+    EXPECT_GT(metadataField(res.body, 3), 0);
+    EXPECT_EQ(res.body.substr(AlpacaImageBytes::MetadataSize), "No image available");
+
+    // Without ImageBytes in the Accept header, the response stays JSON with the transaction IDs
+    httplib::Request jsonReq = req;
+    jsonReq.headers.clear();
+    httplib::Response jsonRes;
+    manager->handleAlpacaRequest(jsonReq, jsonRes);
+
+    EXPECT_NE(jsonRes.body.find("\"ClientTransactionID\":42"), std::string::npos);
+}
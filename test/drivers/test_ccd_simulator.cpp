@@ -8,6 +8,59 @@ using ::testing::_;
 using ::testing::StrEq;
 
 #include "ccd_simulator.h"
+#include "star_catalog.h"
+
+#include <random>
+
+// A synthetic sky, standing for the gsc catalog
+static std::vector<StarCatalog::Star> syntheticSky(size_t count)
+{
+    std::vector<StarCatalog::Star> sky;
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    for (size_t i = 0; i < count; i++)
+    {
+        double ra = 360 * uniform(generator);
+        double dec = asin(2 * uniform(generator) - 1) * 180 / M_PI;
+        sky.push_back({ ra, dec, static_cast<float>(16 * uniform(generator)) });
+    }
+    // A few stars right on the poles and the origin of right ascension
+    sky.push_back({ 0, 90, 5 });
+    sky.push_back({ 180, -90, 5 });
+    sky.push_back({ 0, 0, 5 });
+    sky.push_back({ 359.999, 0.001, 5 });
+    return sky;
+}
+
+// Angular distance in arcminutes
+static double arcminutes(double ra1, double dec1, double ra2, double dec2)
+{
+    double c = sin(dec1 * M_PI / 180) * sin(dec2 * M_PI / 180) +
+               cos(dec1 * M_PI / 180) * cos(dec2 * M_PI / 180) * cos((ra1 - ra2) * M_PI / 180);
+    return acos(std::min(1.0, std::max(-1.0, c))) * 180 / M_PI * 60;
+}
+
+static std::vector<StarCatalog::Star> cone(const std::vector<StarCatalog::Star> &sky, double ra, double dec, double radius,
+        double magnitude)
+{
+    std::vector<StarCatalog::Star> stars;
+    for (const auto &star : sky)
+        if (star.mag <= magnitude && arcminutes(ra, dec, star.ra, star.dec) <= radius)
+            stars.push_back(star);
+    return stars;
+}
+
+static StarCatalog::Loader skyLoader(const std::vector<StarCatalog::Star> &sky, int *calls = nullptr)
+{
+    return [&sky, calls](double ra, double dec, double radius, double magnitude, std::vector<StarCatalog::Star> &stars)
+    {
+        if (calls)
+            (*calls)++;
+        auto found = cone(sky, ra, dec, radius, magnitude);
+        stars.insert(stars.end(), found.begin(), found.end());
+        return true;
+    };
+}
 
 char _me[] = "MockCCDSimDriver";
 char *me = _me;
@@ -194,6 +247,86 @@ class MockCCDSimDriver: public CCDSim
             std::cout << "[          ] DrawStarImage - randomized no-noise no-skyglow benchmark: " << duration << "ns per call" <<
                       std::endl;
         }
+
+        void testDrawFrameRate(const std::vector<StarCatalog::Star> &sky)
+        {
+            int loads = 0;
+            m_Catalog.setLoader(skyLoader(sky, &loads));
+
+            // A small 320x240 sensor on a 400mm scope, exposing 10ms frames as a guide or focus loop would
+            auto p = getNumber("SIMULATOR_SETTINGS");
+            ASSERT_NE(p, nullptr);
+            p.findWidgetByName("SIM_XRES")->setValue(320);
+            p.findWidgetByName("SIM_YRES")->setValue(240);
+            p.findWidgetByName("SIM_XSIZE")->setValue(5.2);
+            p.findWidgetByName("SIM_YSIZE")->setValue(5.2);
+            p.findWidgetByName("SIM_LIMITINGMAG")->setValue(14.0);
+            ASSERT_TRUE(setupParameters());
+            ScopeInfoNP[FOCAL_LENGTH].setValue(400);
+            PrimaryCCD.setFrameType(INDI::CCDChip::LIGHT_FRAME);
+            ExposureRequest = 0.01;
+            RA = 5.5;
+            Dec = 20;
+
+            ASSERT_EQ(DrawCcdFrame(&PrimaryCCD), 0);
+            const int first = loads;
+            EXPECT_GT(first, 0);
+
+            auto const before = std::chrono::steady_clock::now();
+            int const frames = 200;
+            for (int i = 0; i < frames; i++)
+                DrawCcdFrame(&PrimaryCCD);
+            auto const after = std::chrono::steady_clock::now();
+            double const seconds = std::chrono::duration<double>(after - before).count();
+
+            // The tracked field is drawn from memory, the catalog is not read again
+            EXPECT_EQ(loads, first);
+            std::cout << "[          ] DrawCcdFrame - 320x240 light frames: " << frames / seconds << " exposures per second" <<
+                      std::endl;
+        }
+
+        void testFrameSynthesis()
+        {
+            // The 6000x4000 sensor preset, taking dark frames with 20 ADUs of read noise
+            auto p = getNumber("SIMULATOR_SETTINGS");
+            ASSERT_NE(p, nullptr);
+            p.findWidgetByName("SIM_XRES")->setValue(6000);
+            p.findWidgetByName("SIM_YRES")->setValue(4000);
+            p.findWidgetByName("SIM_NOISE")->setValue(20);
+            ASSERT_TRUE(setupParameters());
+            ScopeInfoNP[FOCAL_LENGTH].setValue(400);
+            PrimaryCCD.setFrameType(INDI::CCDChip::DARK_FRAME);
+            ExposureRequest = 0.01;
+
+            ASSERT_EQ(DrawCcdFrame(&PrimaryCCD), 0);
+            uint16_t const * const fb = reinterpret_cast<uint16_t*>(PrimaryCCD.getFrameBuffer());
+            size_t const pixels = 6000 * 4000;
+            std::vector<uint16_t> first(fb, fb + pixels);
+
+            // The gaussian read noise has the mean and deviation of the former uniform noise, the pixel values being truncated
+            double sum = 0, squares = 0;
+            for (size_t i = 0; i < pixels; i++)
+            {
+                sum += fb[i];
+                squares += static_cast<double>(fb[i]) * fb[i];
+            }
+            double const mean = sum / pixels;
+            double const deviation = sqrt(squares / pixels - mean * mean);
+            EXPECT_NEAR(mean, m_Bias + 20 / 2.0 - 0.5, 0.05);
+            EXPECT_NEAR(deviation, 20 / sqrt(12.0), 0.1);
+
+            // Every frame has its own noise
+            auto const before = std::chrono::steady_clock::now();
+            int const frames = 5;
+            for (int i = 0; i < frames; i++)
+                DrawCcdFrame(&PrimaryCCD);
+            auto const after = std::chrono::steady_clock::now();
+            EXPECT_FALSE(std::equal(first.begin(), first.end(), fb));
+
+            double const seconds = std::chrono::duration<double>(after - before).count();
+            std::cout << "[          ] DrawCcdFrame - 6000x4000 dark frames: " << frames / seconds << " exposures per second" <<
+                      std::endl;
+        }
 };
 
 TEST(CCDSimulatorDriverTest, test_properties)
@@ -211,6 +344,108 @@ TEST(CCDSimulatorDriverTest, test_draw_star)
     MockCCDSimDriver().testDrawStar();
 }
 
+TEST(CCDSimulatorDriverTest, test_draw_frame_rate)
+{
+    static const auto sky = syntheticSky(200000);
+    MockCCDSimDriver().testDrawFrameRate(sky);
+}
+
+TEST(CCDSimulatorDriverTest, test_frame_synthesis)
+{
+    MockCCDSimDriver().testFrameSynthesis();
+}
+
+TEST(StarCatalogTest, test_cone_queries)
+{
+    static const auto sky = syntheticSky(200000);
+    StarCatalog catalog(skyLoader(sky));
+
+    // Fields of view around the sky, across the origin of right ascension and over the poles
+    const double pointings[][3] =
+    {
+        { 83.8, -5.4, 30 }, { 0.05, 0.0, 45 }, { 359.9, 1.0, 20 }, { 180.0, 89.8, 40 }, { 12.0, -89.95, 25 },
+        { 270.0, 60.0, 120 }, { 45.0, 75.0, 90 }, { 300.0, -30.0, 5 },
+    };
+    for (const auto &pointing : pointings)
+    {
+        const double ra = pointing[0], dec = pointing[1], radius = pointing[2];
+        std::vector<StarCatalog::Star> stars;
+        ASSERT_TRUE(catalog.query(ra, dec, radius, 12.0, stars));
+
+        // Every star of the cone, and none much beyond it
+        auto expected = cone(sky, ra, dec, radius, 12.0);
+        for (const auto &star : expected)
+        {
+            bool found = std::any_of(stars.begin(), stars.end(), [&star](const StarCatalog::Star & s)
+            {
+                return s.ra == star.ra && s.dec == star.dec;
+            });
+            EXPECT_TRUE(found) << "star " << star.ra << " " << star.dec << " missing at " << ra << " " << dec;
+        }
+        for (const auto &star : stars)
+        {
+            EXPECT_LE(star.mag, 12.0);
+            EXPECT_LE(arcminutes(ra, dec, star.ra, star.dec), radius * 1.1 + 1.0001);
+        }
+    }
+}
+
+TEST(StarCatalogTest, test_tile_reuse)
+{
+    static const auto sky = syntheticSky(200000);
+    int loads = 0;
+    StarCatalog catalog(skyLoader(sky, &loads));
+    std::vector<StarCatalog::Star> stars;
+
+    ASSERT_TRUE(catalog.query(120.0, 30.0, 40, 12.0, stars));
+    const int first = loads;
+    EXPECT_GT(first, 0);
+    EXPECT_EQ(catalog.loads(), static_cast<uint32_t>(first));
+
+    // Tracking and guiding around the same field reuses the previous result
+    for (int i = 0; i < 100; i++)
+        ASSERT_TRUE(catalog.query(120.0 + i * 0.0001, 30.0 - i * 0.0001, 40, 12.0, stars));
+    EXPECT_EQ(loads, first);
+
+    // Dithering a degree away and back loads the new tiles once
+    ASSERT_TRUE(catalog.query(121.0, 30.0, 40, 12.0, stars));
+    const int dithered = loads;
+    ASSERT_TRUE(catalog.query(120.0, 30.0, 40, 12.0, stars));
+    ASSERT_TRUE(catalog.query(121.0, 30.0, 40, 12.0, stars));
+    EXPECT_EQ(loads, dithered);
+
+    // Fainter stars reload the tiles, brighter ones are filtered from memory
+    ASSERT_TRUE(catalog.query(120.0, 30.0, 40, 14.0, stars));
+    const int fainter = loads;
+    EXPECT_GT(fainter, dithered);
+    ASSERT_TRUE(catalog.query(120.0, 30.0, 40, 10.0, stars));
+    EXPECT_EQ(loads, fainter);
+    for (const auto &star : stars)
+        EXPECT_LE(star.mag, 10.0);
+
+    // A catalog that cannot be read fails the query
+    catalog.setLoader([](double, double, double, double, std::vector<StarCatalog::Star> &)
+    {
+        return false;
+    });
+    EXPECT_FALSE(catalog.query(120.0, 30.0, 40, 12.0, stars));
+}
+
+TEST(StarCatalogTest, test_brightest_stars)
+{
+    // A dense field returns its 3000 brightest stars, as the former gsc lookup was limited to
+    std::vector<StarCatalog::Star> sky;
+    for (int i = 0; i < 5000; i++)
+        sky.push_back({ 120.0 + (i % 100) * 0.002, 30.0 + (i / 100) * 0.002, static_cast<float>(5 + (i * 7919 % 5000) * 0.001) });
+    StarCatalog catalog(skyLoader(sky));
+
+    std::vector<StarCatalog::Star> stars;
+    ASSERT_TRUE(catalog.query(120.1, 30.05, 20, 12.0, stars));
+    ASSERT_EQ(stars.size(), 3000u);
+    for (const auto &star : stars)
+        EXPECT_LT(star.mag, 5 + 3000 * 0.001);
+}
+
 int main(int argc, char **argv)
 {
     INDI::Logger::getInstance().configure("", INDI::Logger::file_off,
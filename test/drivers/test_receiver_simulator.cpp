@@ -0,0 +1,170 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    Receiver simulator and sample ring tests
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+// gtest first, the dsp.h macros pulled by the receiver clash with its own names
+#include <gtest/gtest.h>
+
+#include "receiver_simulator.h"
+#include "sample_ring.h"
+
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+TEST(SampleRingTest, CountsOverruns)
+{
+    SampleRing ring(1000);
+    EXPECT_EQ(ring.capacity(), 1024u);
+
+    std::vector<uint8_t> data(1000, 1), out(1000);
+    EXPECT_TRUE(ring.write(data.data(), 1000));
+    // Too large for the room left, the whole read is dropped
+    EXPECT_FALSE(ring.write(data.data(), 100));
+    EXPECT_EQ(ring.overruns(), 1u);
+    EXPECT_EQ(ring.droppedBytes(), 100u);
+    EXPECT_EQ(ring.available(), 1000u);
+
+    EXPECT_EQ(ring.read(out.data(), 500, std::chrono::milliseconds(0)), 500u);
+    EXPECT_TRUE(ring.write(data.data(), 100));
+    EXPECT_EQ(ring.available(), 600u);
+
+    // Only what is stored is returned once the timeout expires
+    EXPECT_EQ(ring.read(out.data(), 1000, std::chrono::milliseconds(10)), 600u);
+
+    EXPECT_TRUE(ring.write(data.data(), 300));
+    ring.clear();
+    EXPECT_EQ(ring.available(), 0u);
+    ring.resetCounters();
+    EXPECT_EQ(ring.overruns(), 0u);
+    EXPECT_EQ(ring.droppedBytes(), 0u);
+}
+
+TEST(SampleRingTest, KeepsSamplesInOrderAcrossThreads)
+{
+    const size_t total = 4 << 20;
+    SampleRing ring(4096);
+    uint64_t failed = 0;
+
+    // Reads of every size, wrapping around the end of the ring at every offset
+    std::thread producer([&]()
+    {
+        std::vector<uint8_t> chunk(1021);
+        size_t written = 0;
+        size_t size = 1;
+        while (written < total)
+        {
+            size = std::min(total - written, size % chunk.size() + 1);
+            for (size_t i = 0; i < size; i++)
+                chunk[i] = static_cast<uint8_t>((written + i) % 251);
+            if (ring.write(chunk.data(), size))
+                written += size;
+            else
+            {
+                failed++;
+                std::this_thread::yield();
+            }
+            size += 7;
+        }
+    });
+
+    std::vector<uint8_t> out(1500);
+    size_t done = 0;
+    size_t size = 1;
+    bool ordered = true;
+    while (done < total && ordered)
+    {
+        size = std::min(total - done, size % out.size() + 1);
+        size_t count = ring.read(out.data(), size, std::chrono::seconds(5));
+        ASSERT_GT(count, 0u);
+        for (size_t i = 0; i < count && ordered; i++)
+            ordered = out[i] == static_cast<uint8_t>((done + i) % 251);
+        done += count;
+        size += 13;
+    }
+    producer.join();
+
+    EXPECT_TRUE(ordered) << "at byte " << done;
+    EXPECT_EQ(done, total);
+    EXPECT_EQ(ring.overruns(), failed);
+    EXPECT_EQ(ring.available(), 0u);
+}
+
+class MockRadioSim : public RadioSim
+{
+    public:
+        MockRadioSim()
+        {
+            initProperties();
+            IUResetSwitch(&UploadSP);
+        }
+
+        bool connect()
+        {
+            return Connect();
+        }
+
+        void disconnect()
+        {
+            Disconnect();
+        }
+
+        bool integrate(double duration)
+        {
+            setSampleRate(1000000);
+            setBPS(16);
+            return StartIntegration(duration);
+        }
+
+        bool integrating()
+        {
+            return InIntegration;
+        }
+
+        SampleRing &ring()
+        {
+            return m_Ring;
+        }
+};
+
+TEST(RadioSimTest, IntegratesFromTheRing)
+{
+    MockRadioSim receiver;
+    ASSERT_TRUE(receiver.connect());
+
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(receiver.integrate(0.5));
+    while (receiver.integrating() && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    receiver.waitIntegrationsComplete();
+
+    EXPECT_FALSE(receiver.integrating());
+    // The samples come at the sample rate, 16 bits each
+    EXPECT_GE(seconds, 0.45);
+    ASSERT_EQ(receiver.getBufferSize(), 1000000);
+    EXPECT_EQ(receiver.ring().overruns(), 0u);
+
+    std::set<uint8_t> values(receiver.getBuffer(), receiver.getBuffer() + receiver.getBufferSize());
+    EXPECT_GT(values.size(), 250u);
+
+    receiver.disconnect();
+}
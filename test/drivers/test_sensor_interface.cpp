@@ -0,0 +1,192 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    Sensor interface integration completion tests
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+// gtest first, the dsp.h macros pulled by the sensor interface clash with its own names
+#include <gtest/gtest.h>
+
+#include "indisensorinterface.h"
+#include "indilogger.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+class MockSensor : public INDI::SensorInterface
+{
+    public:
+        MockSensor(int size)
+        {
+            initProperties();
+            setBPS(16);
+            setBufferSize(size);
+            setUpload(false, false);
+        }
+
+        const char *getDefaultName() override
+        {
+            return "MockSensor";
+        }
+
+        // Upload the integrations to the client, to a local directory, both or none
+        void setUpload(bool client, bool local, const char *dir = nullptr)
+        {
+            IUResetSwitch(&UploadSP);
+            UploadS[0].s = (client && !local) ? ISS_ON : ISS_OFF;
+            UploadS[1].s = (local && !client) ? ISS_ON : ISS_OFF;
+            UploadS[2].s = (client && local) ? ISS_ON : ISS_OFF;
+            if (dir)
+                IUSaveText(&UploadSettingsT[UPLOAD_DIR], dir);
+        }
+
+        // Integrate a buffer filled with the integration number
+        void integrate(uint32_t number)
+        {
+            for (int i = 0; i + 4 <= getBufferSize(); i += 4)
+                memcpy(getBuffer() + i, &number, 4);
+            IntegrationComplete();
+        }
+};
+
+// Number of threads of this process
+static int threads()
+{
+    int count = 0;
+    DIR *dir = opendir("/proc/self/task");
+    if (dir == nullptr)
+        return 0;
+    while (struct dirent *entry = readdir(dir))
+        if (entry->d_name[0] != '.')
+            count++;
+    closedir(dir);
+    return count;
+}
+
+TEST(SensorInterfaceTest, UploadsIntegrationsInOrder)
+{
+    char dir[] = "/tmp/test_sensor_interface_XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+
+    const int count = 20;
+    {
+        MockSensor sensor(4096);
+        sensor.setUpload(false, true, dir);
+        sensor.setIntegrationQueueDepth(2);
+        EXPECT_EQ(sensor.getIntegrationQueueDepth(), 2u);
+
+        // The driver buffer is overwritten right away, each upload still has its own integration
+        for (int i = 1; i <= count; i++)
+            sensor.integrate(i);
+        sensor.waitIntegrationsComplete();
+    }
+
+    for (int i = 1; i <= count; i++)
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/INTEGRATION_%03d.raw", dir, i);
+        FILE *fp = fopen(path, "r");
+        ASSERT_NE(fp, nullptr) << path;
+        std::vector<uint32_t> data(1024);
+        EXPECT_EQ(fread(data.data(), 4, data.size(), fp), data.size()) << path;
+        fclose(fp);
+        unlink(path);
+        EXPECT_EQ(data.front(), static_cast<uint32_t>(i)) << path;
+        EXPECT_EQ(data.back(), static_cast<uint32_t>(i)) << path;
+    }
+    rmdir(dir);
+}
+
+// Integrations of 4 MB, faster than they are processed, with up to Depth pending
+static const int LargeSize = 4 << 20;
+static const int Depth = 4;
+
+static double integrate(int count, int &maxThreads)
+{
+    MockSensor sensor(LargeSize);
+    sensor.setIntegrationQueueDepth(Depth);
+    int baseline = threads();
+    maxThreads = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        sensor.integrate(i);
+        maxThreads = std::max(maxThreads, threads() - baseline);
+    }
+    sensor.waitIntegrationsComplete();
+    return count / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+TEST(SensorInterfaceTest, BoundsPendingIntegrations)
+{
+    const int count = 500;
+    int maxThreads = 0;
+    double rate = integrate(count, maxThreads);
+
+    // A single worker, rather than a thread per integration
+    EXPECT_LE(maxThreads, 1);
+
+    // Peak memory of a child integrating, above the one of a child doing nothing
+    auto peak = [count](bool run)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            if (run)
+            {
+                int childThreads = 0;
+                integrate(count, childThreads);
+            }
+            _exit(0);
+        }
+        int status = 0;
+        struct rusage usage;
+        wait4(pid, &status, 0, &usage);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        return usage.ru_maxrss / 1024.0;
+    };
+    double peakMB = peak(true) - peak(false);
+    double bufferMB = LargeSize / 1048576.0;
+
+    printf("%d integrations of %.0f MB: %.0f integrations per second, peak %.1f MB, %d worker thread\n", count, bufferMB, rate,
+           peakMB, maxThreads);
+    RecordProperty("IntegrationsPerSecond", static_cast<int>(rate));
+    RecordProperty("PeakMegabytes", static_cast<int>(peakMB));
+
+    // The driver buffer, one recycled buffer per pending integration and the one being copied
+    EXPECT_LT(peakMB, bufferMB * (Depth + 2) + 16);
+}
+
+int main(int argc, char **argv)
+{
+    INDI::Logger::getInstance().configure("", INDI::Logger::file_off,
+                                          INDI::Logger::DBG_ERROR, INDI::Logger::DBG_ERROR);
+
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,172 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    libdsp star field alignment tests on synthetic star lists
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "dsp.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+static const int Width  = 1600;
+static const int Height = 1200;
+
+struct Field
+{
+    std::vector<double> x, y;
+};
+
+static dsp_stream_p createStream(const Field &field)
+{
+    dsp_stream_p stream = dsp_stream_new();
+    dsp_stream_add_dim(stream, Width);
+    dsp_stream_add_dim(stream, Height);
+    for (size_t i = 0; i < field.x.size(); i++)
+    {
+        double location[2] = { field.x[i], field.y[i] };
+        dsp_star star {};
+        star.center.dims = 2;
+        star.center.location = location;
+        star.diameter = 3;
+        star.peak = 1000;
+        star.flux = 10000;
+        dsp_stream_add_star(stream, star);
+    }
+    return stream;
+}
+
+static void destroyStream(dsp_stream_p stream)
+{
+    for (int i = 0; i < stream->stars_count; i++)
+        free(stream->stars[i].center.location);
+    dsp_stream_free(stream);
+}
+
+// current = scale * R(angle) * (reference - center) + center + shift, with noise, lost and spurious stars
+static void createFields(int count, double angle, double scale, double shiftX, double shiftY, double outliers,
+                         Field &reference, Field &current)
+{
+    std::mt19937 random(count);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::normal_distribution<double> noise(0, 0.1);
+    double cx = Width / 2.0, cy = Height / 2.0;
+    for (int i = 0; i < count; i++)
+    {
+        double x = uniform(random) * Width, y = uniform(random) * Height;
+        reference.x.push_back(x);
+        reference.y.push_back(y);
+        if (uniform(random) < outliers)
+            continue;
+        current.x.push_back(scale * (cos(angle) * (x - cx) - sin(angle) * (y - cy)) + cx + shiftX + noise(random));
+        current.y.push_back(scale * (sin(angle) * (x - cx) + cos(angle) * (y - cy)) + cy + shiftY + noise(random));
+    }
+    for (int i = 0; i < count * outliers; i++)
+    {
+        current.x.push_back(uniform(random) * Width);
+        current.y.push_back(uniform(random) * Height);
+    }
+}
+
+// position sampled by dsp_stream_align for a reference position
+static void alignedPosition(dsp_align_info &info, double x, double y, double &ax, double &ay)
+{
+    double px = x - info.center[0] + info.offset[0];
+    double py = y - info.center[1] + info.offset[1];
+    double r = -info.radians[0];
+    ax = (cos(r) * px - sin(r) * py) / info.factor[0] + info.center[0];
+    ay = (sin(r) * px + cos(r) * py) / info.factor[1] + info.center[1];
+}
+
+static void testAlignment(int count, double angle, double scale, double shiftX, double shiftY, double outliers)
+{
+    Field reference, current;
+    createFields(count, angle, scale, shiftX, shiftY, outliers, reference, current);
+    dsp_stream_p ref = createStream(reference);
+    dsp_stream_p cur = createStream(current);
+
+    int err = dsp_align_get_offset(ref, cur, 2, 50, 3);
+    EXPECT_EQ(err & DSP_ALIGN_NO_MATCH, 0);
+    EXPECT_EQ((err & DSP_ALIGN_ROTATED) != 0, angle != 0);
+    EXPECT_EQ((err & DSP_ALIGN_SCALED) != 0, scale != 1);
+    EXPECT_LT(cur->align_info.score, outliers + 0.1);
+
+    // reference stars kept in the current field land on their counterparts
+    double cx = Width / 2.0, cy = Height / 2.0;
+    for (int i = 0; i < count; i += 7)
+    {
+        double x = reference.x[i], y = reference.y[i], ax, ay;
+        alignedPosition(cur->align_info, x, y, ax, ay);
+        double ex = scale * (cos(angle) * (x - cx) - sin(angle) * (y - cy)) + cx + shiftX;
+        double ey = scale * (sin(angle) * (x - cx) + cos(angle) * (y - cy)) + cy + shiftY;
+        ASSERT_NEAR(ax, ex, 0.2) << "star " << i;
+        ASSERT_NEAR(ay, ey, 0.2) << "star " << i;
+    }
+
+    destroyStream(ref);
+    destroyStream(cur);
+}
+
+TEST(DSPAlignTest, Identity)
+{
+    Field reference, current;
+    createFields(50, 0, 1, 0, 0, 0, reference, current);
+    dsp_stream_p ref = createStream(reference);
+    dsp_stream_p cur = createStream(reference);
+    EXPECT_EQ(dsp_align_get_offset(ref, cur, 2, 50, 3), 0);
+    EXPECT_NEAR(cur->align_info.score, 0, 1e-9);
+    destroyStream(ref);
+    destroyStream(cur);
+}
+
+TEST(DSPAlignTest, Translation)
+{
+    testAlignment(80, 0, 1, 35.5, -12.25, 0);
+}
+
+TEST(DSPAlignTest, RotationAndScale)
+{
+    testAlignment(150, 0.3, 1.05, 10, 20, 0);
+    testAlignment(150, -2.5, 0.9, -40, 5, 0);
+}
+
+TEST(DSPAlignTest, Outliers)
+{
+    testAlignment(300, 1.2, 1.0, 25, -30, 0.3);
+}
+
+TEST(DSPAlignTest, NoMatch)
+{
+    Field reference, current, unrelated, ignored;
+    createFields(60, 0, 1, 0, 0, 0, reference, current);
+    createFields(61, 0, 1, 0, 0, 0, unrelated, ignored);
+    dsp_stream_p ref = createStream(reference);
+    dsp_stream_p cur = createStream(unrelated);
+    EXPECT_NE(dsp_align_get_offset(ref, cur, 2, 50, 3) & DSP_ALIGN_NO_MATCH, 0);
+    destroyStream(ref);
+    destroyStream(cur);
+
+    ref = createStream(Field());
+    cur = createStream(reference);
+    EXPECT_NE(dsp_align_get_offset(ref, cur, 2, 50, 3) & DSP_ALIGN_NO_MATCH, 0);
+    destroyStream(ref);
+    destroyStream(cur);
+}
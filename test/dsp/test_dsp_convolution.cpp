@@ -0,0 +1,194 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    libdsp convolution tests, every method compared with a naive spatial convolution
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "dsp.h"
+
+#include <cmath>
+#include <vector>
+
+static dsp_stream_p createStream(const std::vector<int> &sizes, unsigned int seed)
+{
+    dsp_stream_p stream = dsp_stream_new();
+    for (int size : sizes)
+        dsp_stream_add_dim(stream, size);
+    dsp_stream_alloc_buffer(stream, stream->len);
+    for (int i = 0; i < stream->len; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        stream->buf[i] = (seed >> 8) % 4096;
+    }
+    return stream;
+}
+
+static void destroyStream(dsp_stream_p stream)
+{
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+}
+
+// outer product of a row and a column, optionally disturbed to make it not separable
+static dsp_stream_p createKernel(int width, int height, bool separable)
+{
+    dsp_stream_p matrix = dsp_stream_new();
+    dsp_stream_add_dim(matrix, width);
+    dsp_stream_add_dim(matrix, height);
+    dsp_stream_alloc_buffer(matrix, matrix->len);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            matrix->buf[x + y * width] = exp(-0.1 * (x - width / 2) * (x - width / 2)) * (1.0 + y % 3);
+    if (!separable)
+        matrix->buf[0] += 0.5;
+    return matrix;
+}
+
+// out[x] = sum of K[k] * in[x + center - k], zero outside the stream
+static std::vector<double> reference(dsp_stream_p stream, dsp_stream_p matrix)
+{
+    int dims = stream->dims;
+    std::vector<double> out(stream->len, 0);
+    std::vector<int> pos(dims), k(dims), p(dims);
+    for (int x = 0; x < stream->len; x++)
+    {
+        for (int d = 0, rest = x; d < dims; d++, rest /= stream->sizes[d - 1])
+            pos[d] = rest % stream->sizes[d];
+        for (int y = 0; y < matrix->len; y++)
+        {
+            bool inside = true;
+            int offset = 0, stride = 1;
+            for (int d = 0, rest = y; d < dims; d++)
+            {
+                k[d] = rest % matrix->sizes[d];
+                rest /= matrix->sizes[d];
+                p[d] = pos[d] + matrix->sizes[d] / 2 - k[d];
+                inside = inside && p[d] >= 0 && p[d] < stream->sizes[d];
+                offset += p[d] * stride;
+                stride *= stream->sizes[d];
+            }
+            if (inside)
+                out[x] += matrix->buf[y] * stream->buf[offset];
+        }
+    }
+    return out;
+}
+
+static void testMethod(dsp_stream_p input, dsp_stream_p matrix, int method, int expected)
+{
+    std::vector<double> ref = reference(input, matrix);
+    double peak = 0;
+    for (double value : ref)
+        peak = std::max(peak, std::fabs(value));
+    double tolerance = peak * (sizeof(dsp_t) == sizeof(float) ? 1e-5 : 1e-9);
+
+    dsp_stream_p stream = dsp_stream_copy(input);
+    EXPECT_EQ(dsp_convolution_filter(stream, matrix, method), expected);
+    for (int x = 0; x < stream->len; x++)
+        ASSERT_NEAR(stream->buf[x], ref[x], tolerance) << "method " << expected << " at element " << x;
+    destroyStream(stream);
+}
+
+TEST(DSPConvolutionTest, Separable)
+{
+    dsp_stream_p matrix = createKernel(5, 3, true);
+    std::vector<dsp_t> row(5), column(3);
+    EXPECT_EQ(dsp_convolution_separable(matrix, row.data(), column.data()), 1);
+    for (int y = 0; y < 3; y++)
+        for (int x = 0; x < 5; x++)
+            EXPECT_NEAR(row[x] * column[y], matrix->buf[x + y * 5], 1e-5);
+    destroyStream(matrix);
+
+    matrix = createKernel(5, 3, false);
+    EXPECT_EQ(dsp_convolution_separable(matrix, row.data(), column.data()), 0);
+    destroyStream(matrix);
+}
+
+TEST(DSPConvolutionTest, Methods)
+{
+    dsp_stream_p stream = createStream({41, 29}, 1);
+    dsp_stream_p matrix = createKernel(7, 5, true);
+    testMethod(stream, matrix, DSP_CONVOLUTION_DIRECT, DSP_CONVOLUTION_DIRECT);
+    testMethod(stream, matrix, DSP_CONVOLUTION_SEPARABLE, DSP_CONVOLUTION_SEPARABLE);
+    testMethod(stream, matrix, DSP_CONVOLUTION_FOURIER, DSP_CONVOLUTION_FOURIER);
+    testMethod(stream, matrix, DSP_CONVOLUTION_AUTO, DSP_CONVOLUTION_SEPARABLE);
+    destroyStream(matrix);
+
+    // not separable, falls back to the direct sum
+    matrix = createKernel(4, 6, false);
+    testMethod(stream, matrix, DSP_CONVOLUTION_SEPARABLE, DSP_CONVOLUTION_DIRECT);
+    testMethod(stream, matrix, DSP_CONVOLUTION_FOURIER, DSP_CONVOLUTION_FOURIER);
+    destroyStream(matrix);
+    destroyStream(stream);
+}
+
+TEST(DSPConvolutionTest, FourierBlocks)
+{
+    // longer than a block, the transforms overlap and are processed in parallel
+    dsp_max_threads(3);
+    dsp_stream_p stream = createStream({1500}, 2);
+    dsp_stream_p matrix = createStream({31}, 3);
+    testMethod(stream, matrix, DSP_CONVOLUTION_FOURIER, DSP_CONVOLUTION_FOURIER);
+    testMethod(stream, matrix, DSP_CONVOLUTION_DIRECT, DSP_CONVOLUTION_DIRECT);
+    destroyStream(matrix);
+    destroyStream(stream);
+
+    stream = createStream({700, 6}, 4);
+    matrix = createKernel(9, 3, false);
+    testMethod(stream, matrix, DSP_CONVOLUTION_FOURIER, DSP_CONVOLUTION_FOURIER);
+    destroyStream(matrix);
+    destroyStream(stream);
+    dsp_max_threads(1);
+}
+
+TEST(DSPConvolutionTest, AutomaticMethod)
+{
+    // a large non separable kernel is multiplied in the frequency domain
+    dsp_stream_p stream = createStream({64, 64}, 5);
+    dsp_stream_p matrix = createKernel(25, 25, false);
+    EXPECT_EQ(dsp_convolution_filter(stream, matrix, DSP_CONVOLUTION_AUTO), DSP_CONVOLUTION_FOURIER);
+    destroyStream(matrix);
+
+    // a small one is summed directly
+    matrix = createKernel(3, 3, false);
+    EXPECT_EQ(dsp_convolution_filter(stream, matrix, DSP_CONVOLUTION_AUTO), DSP_CONVOLUTION_DIRECT);
+    destroyStream(matrix);
+
+    matrix = createStream({3}, 6);
+    EXPECT_EQ(dsp_convolution_filter(stream, matrix, DSP_CONVOLUTION_AUTO), -1);
+    destroyStream(matrix);
+    destroyStream(stream);
+}
+
+TEST(DSPBufferTest, Reverse)
+{
+    // the element past the end must stay untouched, odd lengths used to swap it with the first one
+    for (int len = 0; len <= 6; len++)
+    {
+        std::vector<int> buf(len + 1);
+        for (int i = 0; i <= len; i++)
+            buf[i] = i;
+        int *data = buf.data();
+        dsp_buffer_reverse(data, len);
+        for (int i = 0; i < len; i++)
+            EXPECT_EQ(buf[i], len - 1 - i) << "length " << len << " at element " << i;
+        EXPECT_EQ(buf[len], len) << "length " << len;
+    }
+}
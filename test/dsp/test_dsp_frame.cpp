@@ -0,0 +1,112 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    DSP frame processing context tests
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "dsp/frame.h"
+
+#include <thread>
+#include <vector>
+
+TEST(DSPFrameTest, ConvertsInput)
+{
+    std::vector<uint16_t> pixels(24 * 16);
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = i * 97 % 65536;
+    int sizes[2] = { 24, 16 };
+
+    DSP::Frame frame(reinterpret_cast<uint8_t*>(pixels.data()), 2, sizes, 16);
+    ASSERT_TRUE(frame.isValid());
+    dsp_stream_p stream = frame.getStream();
+    ASSERT_EQ(stream->len, 24 * 16);
+    for (int i = 0; i < stream->len; i++)
+        ASSERT_EQ(stream->buf[i], pixels[i]);
+
+    DSP::Frame unsupported(reinterpret_cast<uint8_t*>(pixels.data()), 2, sizes, 12);
+    EXPECT_FALSE(unsupported.isValid());
+    EXPECT_EQ(unsupported.getFourier(), nullptr);
+}
+
+TEST(DSPFrameTest, SharesTransform)
+{
+    std::vector<double> samples(32 * 8);
+    for (size_t i = 0; i < samples.size(); i++)
+        samples[i] = (i * 31) % 17;
+    int sizes[2] = { 32, 8 };
+    DSP::Frame frame(reinterpret_cast<uint8_t*>(samples.data()), 2, sizes, -64);
+
+    // concurrent plugins get the same transform, computed once
+    std::vector<dsp_stream_p> results(4, nullptr);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        threads.emplace_back([&, i]()
+        {
+            results[i] = frame.getFourier();
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    for (dsp_stream_p result : results)
+        EXPECT_EQ(result, results[0]);
+
+    dsp_stream_p reference = dsp_stream_copy(frame.getStream());
+    dsp_fourier_dft(reference, 1);
+    ASSERT_NE(results[0]->magnitude, nullptr);
+    ASSERT_NE(results[0]->phase, nullptr);
+    for (int i = 0; i < reference->len; i++)
+    {
+        EXPECT_EQ(results[0]->magnitude->buf[i], reference->magnitude->buf[i]);
+        EXPECT_EQ(results[0]->phase->buf[i], reference->phase->buf[i]);
+    }
+    dsp_stream_free_buffer(reference);
+    dsp_stream_free(reference);
+
+    // the input is left untouched
+    for (size_t i = 0; i < samples.size(); i++)
+        ASSERT_EQ(frame.getStream()->buf[i], samples[i]);
+}
+
+TEST(DSPFrameTest, ReadsInPlace)
+{
+    std::vector<uint16_t> pixels(16 * 16, 1234);
+    int sizes[2] = { 16, 16 };
+    DSP::Frame frame(reinterpret_cast<uint8_t*>(pixels.data()), 2, sizes, 16);
+    EXPECT_EQ(frame.getView<uint16_t>(), pixels.data());
+    EXPECT_EQ(frame.getView<float>(), nullptr);
+    EXPECT_EQ(frame.getView<int32_t>(), nullptr);
+
+    // samples already of the stream type are not copied, and are left to the caller
+    std::vector<dsp_t> samples(16 * 16);
+    for (size_t i = 0; i < samples.size(); i++)
+        samples[i] = i * 0.5;
+    {
+        DSP::Frame wrapped(reinterpret_cast<uint8_t*>(samples.data()), 2, sizes, DSP::Frame::sampleBits<dsp_t>());
+        EXPECT_EQ(wrapped.getView<dsp_t>(), samples.data());
+        ASSERT_NE(wrapped.getStream(), nullptr);
+        EXPECT_EQ(wrapped.getStream()->buf, samples.data());
+        EXPECT_EQ(wrapped.getStream()->len, 16 * 16);
+        ASSERT_NE(wrapped.getFourier(), nullptr);
+        EXPECT_NE(wrapped.getFourier()->buf, samples.data());
+    }
+    for (size_t i = 0; i < samples.size(); i++)
+        ASSERT_EQ(samples[i], i * 0.5);
+}
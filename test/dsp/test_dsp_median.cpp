@@ -0,0 +1,170 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    libdsp rank filter tests, compared with the sort based implementation they replace
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "dsp.h"
+
+#include <algorithm>
+#include <vector>
+
+static dsp_stream_p createStream(const std::vector<int> &sizes, bool integral, int range)
+{
+    dsp_stream_p stream = dsp_stream_new();
+    for (int size : sizes)
+        dsp_stream_add_dim(stream, size);
+    dsp_stream_alloc_buffer(stream, stream->len);
+
+    unsigned int seed = 1;
+    for (int i = 0; i < stream->len; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        stream->buf[i] = (seed >> 8) % range;
+        if (!integral)
+            stream->buf[i] += ((seed >> 4) % 1000) / 1000.0;
+        // hot and cold pixels
+        if (i % 37 == 0)
+            stream->buf[i] = range - 1;
+        if (i % 53 == 0)
+            stream->buf[i] = 0;
+    }
+    return stream;
+}
+
+static void destroyStream(dsp_stream_p stream)
+{
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+}
+
+static std::vector<int> boxOffsets(dsp_stream_p stream, int size)
+{
+    int len = 1;
+    for (int d = 0; d < stream->dims; d++)
+        len *= size;
+
+    std::vector<int> offsets(len);
+    for (int y = 0; y < len; y++)
+    {
+        int rest = y, m = 1;
+        offsets[y] = 0;
+        for (int d = 0; d < stream->dims; d++)
+        {
+            offsets[y] += m * (rest % size - size / 2);
+            rest /= size;
+            m *= stream->sizes[d];
+        }
+    }
+    return offsets;
+}
+
+// The implementation before the sliding windows: sort the box of each element and pick the given rank
+static std::vector<dsp_t> sortedRank(dsp_stream_p stream, int size, int rank)
+{
+    std::vector<int> offsets = boxOffsets(stream, size);
+    std::vector<dsp_t> out(stream->len, 0);
+    std::vector<dsp_t> box;
+    for (int x = 0; x < stream->len; x++)
+    {
+        box.clear();
+        for (int offset : offsets)
+            if (x + offset >= 0 && x + offset < stream->len)
+                box.push_back(stream->buf[x + offset]);
+        std::sort(box.begin(), box.end());
+        out[x] = box.size() == offsets.size() ? box[rank] : box[rank * box.size() / offsets.size()];
+    }
+    return out;
+}
+
+// the previous implementation read stale values at the ends of the stream, compare whole boxes only
+static void expectInteriorEqual(dsp_stream_p stream, int size, const std::vector<dsp_t> &reference,
+                                const std::vector<dsp_t> &result)
+{
+    std::vector<int> offsets = boxOffsets(stream, size);
+    int compared = 0;
+    for (int x = -offsets.front(); x < stream->len - offsets.back(); x++, compared++)
+        ASSERT_EQ(result[x], reference[x]) << "at element " << x;
+    EXPECT_GT(compared, 0);
+}
+
+static void testMedian(const std::vector<int> &sizes, bool integral, int range, int size, int median, int threads)
+{
+    dsp_max_threads(threads);
+    dsp_stream_p stream = createStream(sizes, integral, range);
+
+    int boxLength = 1;
+    for (size_t d = 0; d < sizes.size(); d++)
+        boxLength *= size;
+    std::vector<dsp_t> reference = sortedRank(stream, size, median * boxLength / size);
+
+    dsp_buffer_median(stream, size, median);
+    std::vector<dsp_t> result(stream->buf, stream->buf + stream->len);
+    expectInteriorEqual(stream, size, reference, result);
+
+    // partial boxes at the ends take the same relative rank
+    EXPECT_EQ(result.front(), reference.front());
+    EXPECT_EQ(result.back(), reference.back());
+
+    destroyStream(stream);
+    dsp_max_threads(1);
+}
+
+TEST(DSPMedianTest, Histogram8Bit)
+{
+    testMedian({97, 61}, true, 256, 3, 1, 1);
+    testMedian({97, 61}, true, 256, 5, 2, 3);
+}
+
+TEST(DSPMedianTest, Histogram16Bit)
+{
+    testMedian({128, 96}, true, 65536, 3, 1, 1);
+    testMedian({128, 96}, true, 65536, 7, 3, 4);
+}
+
+TEST(DSPMedianTest, SortedWindow)
+{
+    testMedian({83, 71}, false, 4096, 3, 1, 1);
+    testMedian({83, 71}, false, 4096, 5, 2, 2);
+}
+
+TEST(DSPMedianTest, ThreeDimensions)
+{
+    testMedian({23, 19, 11}, true, 1024, 3, 1, 3);
+    testMedian({23, 19, 11}, false, 1024, 3, 1, 2);
+}
+
+TEST(DSPMedianTest, Percentiles)
+{
+    for (bool integral : {true, false})
+    {
+        for (double percentile : {0.0, 25.0, 50.0, 100.0})
+        {
+            dsp_stream_p stream = createStream({64, 48}, integral, 1000);
+            std::vector<dsp_t> reference = sortedRank(stream, 5, static_cast<int>(percentile * 24 / 100 + 0.5));
+
+            dsp_buffer_percentile(stream, 5, percentile);
+            std::vector<dsp_t> result(stream->buf, stream->buf + stream->len);
+            expectInteriorEqual(stream, 5, reference, result);
+
+            destroyStream(stream);
+        }
+    }
+}
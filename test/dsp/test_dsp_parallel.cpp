@@ -0,0 +1,88 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    libdsp worker pool tests
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "dsp.h"
+
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+struct LoopThreads
+{
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::vector<int> visits;
+};
+
+// Every range is slow enough for the workers to take their share before the calling thread is done
+static void visit(void *arg, int start, int end)
+{
+    LoopThreads *loop = static_cast<LoopThreads *>(arg);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    std::lock_guard<std::mutex> lock(loop->mutex);
+    loop->threads.insert(std::this_thread::get_id());
+    for (int i = start; i < end; i++)
+        loop->visits[i]++;
+}
+
+// Must run first, before any test sets the number of threads
+TEST(DSPParallelTest, DefaultsToOnlineProcessors)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    EXPECT_EQ(dsp_max_threads(0), static_cast<unsigned long>(std::max(1L, cpus)));
+}
+
+TEST(DSPParallelTest, LargeLoopRunsOnSeveralThreads)
+{
+    if (dsp_max_threads(0) < 2)
+        GTEST_SKIP() << "single processor";
+
+    LoopThreads loop;
+    loop.visits.assign(1 << 20, 0);
+    dsp_parallel_for(static_cast<int>(loop.visits.size()), visit, &loop);
+
+    EXPECT_GT(loop.threads.size(), 1u);
+    EXPECT_EQ(dsp_parallel_threads(), static_cast<int>(dsp_max_threads(0)));
+    for (size_t i = 0; i < loop.visits.size(); i++)
+        ASSERT_EQ(loop.visits[i], 1) << "at element " << i;
+}
+
+TEST(DSPParallelTest, SingleThreadRunsInline)
+{
+    unsigned long threads = dsp_max_threads(0);
+    dsp_max_threads(1);
+
+    LoopThreads loop;
+    loop.visits.assign(1000, 0);
+    dsp_parallel_for(static_cast<int>(loop.visits.size()), visit, &loop);
+
+    ASSERT_EQ(loop.threads.size(), 1u);
+    EXPECT_EQ(*loop.threads.begin(), std::this_thread::get_id());
+
+    dsp_max_threads(threads);
+}
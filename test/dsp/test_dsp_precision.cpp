@@ -0,0 +1,96 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    libdsp precision tests, run against the configured dsp_t (double, or float with DSP_SINGLE_PRECISION)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "dsp.h"
+
+#include <cmath>
+#include <vector>
+
+// relative tolerance of the configured sample type
+static const double Epsilon = sizeof(dsp_t) == sizeof(float) ? 1e-5 : 1e-12;
+
+static dsp_stream_p createStream(int width, int height, std::vector<double> &reference)
+{
+    dsp_stream_p stream = dsp_stream_new();
+    dsp_stream_add_dim(stream, width);
+    dsp_stream_add_dim(stream, height);
+    dsp_stream_alloc_buffer(stream, stream->len);
+
+    reference.resize(stream->len);
+    unsigned int seed = 1;
+    for (int i = 0; i < stream->len; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        // 16 bit camera samples on a smooth background
+        reference[i] = 1000 + 200 * sin(i * 0.01) + (seed >> 16) % 4096;
+        stream->buf[i] = reference[i];
+    }
+    return stream;
+}
+
+static void destroyStream(dsp_stream_p stream)
+{
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+}
+
+TEST(DSPPrecisionTest, Statistics)
+{
+    std::vector<double> reference;
+    dsp_stream_p stream = createStream(512, 512, reference);
+
+    double mean = 0;
+    for (double v : reference)
+        mean += v;
+    mean /= reference.size();
+
+    double deviation = 0;
+    for (double v : reference)
+        deviation += fabs(v - mean);
+    deviation /= reference.size();
+
+    EXPECT_NEAR(dsp_stats_mean(stream->buf, stream->len), mean, mean * Epsilon);
+    EXPECT_NEAR(dsp_stats_stddev(stream->buf, stream->len), deviation, deviation * Epsilon);
+
+    destroyStream(stream);
+}
+
+TEST(DSPPrecisionTest, FourierMagnitude)
+{
+    std::vector<double> reference;
+    dsp_stream_p stream = createStream(256, 128, reference);
+
+    double sum = 0;
+    for (double v : reference)
+        sum += v;
+
+    dsp_fourier_dft(stream, 1);
+    ASSERT_NE(stream->magnitude, nullptr);
+
+    // the zero frequency term is the sum of all samples, shifted to the center of the magnitude
+    int center = stream->sizes[0] / 2 + stream->sizes[1] / 2 * stream->sizes[0];
+    EXPECT_NEAR(stream->magnitude->buf[center], sum, sum * Epsilon);
+
+    dsp_fourier_clear_plans();
+    destroyStream(stream);
+}
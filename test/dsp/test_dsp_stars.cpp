@@ -0,0 +1,184 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    libdsp star detection tests on synthetic frames
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "dsp.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+static const int Width  = 800;
+static const int Height = 600;
+static const double Sigma = 1.5;
+
+struct Star
+{
+    double x, y, amplitude;
+};
+
+// stars on a jittered grid, far enough from each other and from the borders
+static std::vector<Star> createStars(double shiftX, double shiftY)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> jitter(-10, 10);
+    std::vector<Star> stars;
+    for (int y = 40; y < Height - 40; y += 60)
+        for (int x = 40; x < Width - 40; x += 60)
+            stars.push_back({ x + jitter(random) + shiftX, y + jitter(random) + shiftY, 500.0 + stars.size() * 40 });
+    return stars;
+}
+
+// gradient background with gaussian noise and gaussian stars
+static dsp_stream_p createFrame(const std::vector<Star> &stars)
+{
+    dsp_stream_p stream = dsp_stream_new();
+    dsp_stream_add_dim(stream, Width);
+    dsp_stream_add_dim(stream, Height);
+    dsp_stream_alloc_buffer(stream, stream->len);
+    std::mt19937 random(11);
+    std::normal_distribution<double> noise(0, 10);
+    for (int y = 0; y < Height; y++)
+        for (int x = 0; x < Width; x++)
+            stream->buf[x + y * Width] = 1000 + x * 0.2 + y * 0.1 + noise(random);
+    for (const Star &star : stars)
+    {
+        for (int y = (int)star.y - 8; y <= (int)star.y + 8; y++)
+            for (int x = (int)star.x - 8; x <= (int)star.x + 8; x++)
+                stream->buf[x + y * Width] += star.amplitude *
+                                              exp(-(pow(x - star.x, 2) + pow(y - star.y, 2)) / (2 * Sigma * Sigma));
+    }
+    return stream;
+}
+
+static void destroyFrame(dsp_stream_p stream)
+{
+    for (int i = 0; i < stream->stars_count; i++)
+        free(stream->stars[i].center.location);
+    dsp_stream_free_buffer(stream);
+    dsp_stream_free(stream);
+}
+
+static const dsp_star *findNearest(dsp_stream_p stream, const Star &star)
+{
+    const dsp_star *nearest = nullptr;
+    double best = 1e9;
+    for (int i = 0; i < stream->stars_count; i++)
+    {
+        double d = hypot(stream->stars[i].center.location[0] - star.x, stream->stars[i].center.location[1] - star.y);
+        if (d < best)
+        {
+            best = d;
+            nearest = &stream->stars[i];
+        }
+    }
+    return nearest;
+}
+
+TEST(DSPStarsTest, CentroidsAndWidths)
+{
+    std::vector<Star> stars = createStars(0, 0);
+    dsp_stream_p stream = createFrame(stars);
+
+    ASSERT_EQ(dsp_stars_find(stream, nullptr, 5, 4, 0), (int)stars.size());
+    ASSERT_EQ(stream->stars_count, (int)stars.size());
+    for (const Star &star : stars)
+    {
+        const dsp_star *found = findNearest(stream, star);
+        ASSERT_NE(found, nullptr);
+        EXPECT_NEAR(found->center.location[0], star.x, 0.05);
+        EXPECT_NEAR(found->center.location[1], star.y, 0.05);
+        EXPECT_NEAR(found->diameter, 2.35482 * Sigma, 0.5);
+        EXPECT_NEAR(found->hfr, Sigma * sqrt(M_PI / 2), 0.25);
+        EXPECT_NEAR(found->peak, star.amplitude, star.amplitude * 0.1);
+        EXPECT_NEAR(found->flux, 2 * M_PI * Sigma * Sigma * star.amplitude, star.amplitude * 2);
+    }
+
+    // sorted by decreasing flux
+    for (int i = 1; i < stream->stars_count; i++)
+        EXPECT_GE(stream->stars[i - 1].flux, stream->stars[i].flux);
+
+    destroyFrame(stream);
+}
+
+TEST(DSPStarsTest, RegionOfInterestAndLimit)
+{
+    std::vector<Star> stars = createStars(0, 0);
+    dsp_stream_p stream = createFrame(stars);
+
+    dsp_region roi[2] = { { 200, 300 }, { 100, 250 } };
+    int expected = 0;
+    for (const Star &star : stars)
+        if (star.x > 210 && star.x < 490 && star.y > 110 && star.y < 340)
+            expected++;
+    int found = dsp_stars_find(stream, roi, 5, 4, 0);
+    EXPECT_GE(found, expected);
+    for (int i = 0; i < stream->stars_count; i++)
+    {
+        EXPECT_GE(stream->stars[i].center.location[0], 200);
+        EXPECT_LT(stream->stars[i].center.location[0], 500);
+        EXPECT_GE(stream->stars[i].center.location[1], 100);
+        EXPECT_LT(stream->stars[i].center.location[1], 350);
+    }
+
+    // the brightest stars are the last ones created
+    ASSERT_EQ(dsp_stars_find(stream, nullptr, 5, 4, 3), 3);
+    for (int i = 0; i < 3; i++)
+    {
+        const Star &star = stars[stars.size() - 1 - i];
+        EXPECT_NEAR(stream->stars[i].center.location[0], star.x, 0.05);
+        EXPECT_NEAR(stream->stars[i].center.location[1], star.y, 0.05);
+    }
+
+    destroyFrame(stream);
+}
+
+TEST(DSPStarsTest, NoiseOnly)
+{
+    dsp_stream_p stream = createFrame(std::vector<Star>());
+    EXPECT_EQ(dsp_stars_find(stream, nullptr, 5, 4, 0), 0);
+    destroyFrame(stream);
+
+    dsp_stream_p line = dsp_stream_new();
+    dsp_stream_add_dim(line, 100);
+    dsp_stream_alloc_buffer(line, line->len);
+    EXPECT_EQ(dsp_stars_find(line, nullptr, 5, 4, 0), -1);
+    dsp_stream_free_buffer(line);
+    dsp_stream_free(line);
+}
+
+TEST(DSPStarsTest, FeedsAlignment)
+{
+    dsp_stream_p ref = createFrame(createStars(0, 0));
+    dsp_stream_p cur = createFrame(createStars(12.5, -7.25));
+    ASSERT_GT(dsp_stars_find(ref, nullptr, 5, 4, 0), 3);
+    ASSERT_GT(dsp_stars_find(cur, nullptr, 5, 4, 0), 3);
+
+    int err = dsp_align_get_offset(ref, cur, 2, 50, 3);
+    EXPECT_EQ(err & DSP_ALIGN_NO_MATCH, 0);
+    EXPECT_EQ(err & (DSP_ALIGN_SCALED | DSP_ALIGN_ROTATED), 0);
+    EXPECT_NEAR(cur->align_info.offset[0], 12.5, 0.05);
+    EXPECT_NEAR(cur->align_info.offset[1], -7.25, 0.05);
+
+    destroyFrame(ref);
+    destroyFrame(cur);
+}
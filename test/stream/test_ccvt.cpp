@@ -0,0 +1,179 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    Colour conversion and demosaic tests
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "dsp.h"
+#include "stream/ccvt.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Frame sizes, odd ones included, the last ones large enough to be converted in parallel strips
+static const int Sizes[][2] = { { 2, 2 }, { 3, 3 }, { 5, 4 }, { 17, 9 }, { 64, 48 }, { 641, 479 }, { 1920, 1080 } };
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+template <typename T>
+static std::vector<T> randomFrame(size_t size, uint32_t seed)
+{
+    std::vector<T> frame(size);
+    for (auto &value : frame)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        value = static_cast<T>(seed >> 16);
+    }
+    return frame;
+}
+
+/*
+ * Hash of the outputs of a conversion over all the sizes. The outputs are filled beforehand so that the bytes the
+ * conversion leaves alone count too. The edges of some demosaics read a row before or after the frame, the source
+ * frames are padded with random values there.
+ */
+template <typename T>
+static uint64_t hashConversion(size_t inputSize(int, int), size_t outputSize(int, int),
+                               const std::function<void(int, int, T *, T *)> &convert)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto &size : Sizes)
+    {
+        const int width = size[0], height = size[1];
+        const size_t padding = width + 2;
+        std::vector<T> src = randomFrame<T>(inputSize(width, height) + 2 * padding, width * 7919 + height);
+        std::vector<T> dst(outputSize(width, height), static_cast<T>(0xA5A5));
+        convert(width, height, src.data() + padding, dst.data());
+        hash = fnv1a(hash, dst.data(), dst.size() * sizeof(T));
+    }
+    return hash;
+}
+
+static size_t yuyvSize(int width, int height)
+{
+    return static_cast<size_t>(width) * height * 2;
+}
+
+static size_t bayerSize(int width, int height)
+{
+    return static_cast<size_t>(width) * height;
+}
+
+static size_t rgb24Size(int width, int height)
+{
+    return static_cast<size_t>(width) * height * 3;
+}
+
+static size_t rgb32Size(int width, int height)
+{
+    return static_cast<size_t>(width) * height * 4;
+}
+
+static size_t yuv420pSize(int width, int height)
+{
+    return static_cast<size_t>(width) * height + 2 * ((width / 2) * (height / 2));
+}
+
+class CcvtTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            // Several strips even on a single core machine
+            threads = dsp_max_threads(0);
+            dsp_max_threads(4);
+        }
+
+        void TearDown() override
+        {
+            dsp_max_threads(threads);
+        }
+
+        unsigned long threads { 1 };
+};
+
+// The hashes are the ones of the former byte at a time conversions
+TEST_F(CcvtTest, YUYVConversionsMatchFormerOutput)
+{
+    EXPECT_EQ(hashConversion<uint8_t>(yuyvSize, rgb32Size, [](int width, int height, uint8_t *src, uint8_t *dst)
+    {
+        ccvt_yuyv_bgr32(width, height, src, dst);
+    }), 0xc49d873bdcfc99c0ull);
+    EXPECT_EQ(hashConversion<uint8_t>(yuyvSize, rgb24Size, [](int width, int height, uint8_t *src, uint8_t *dst)
+    {
+        ccvt_yuyv_bgr24(width, height, src, dst);
+    }), 0x7d4ec3cba987d7edull);
+    EXPECT_EQ(hashConversion<uint8_t>(yuyvSize, rgb24Size, [](int width, int height, uint8_t *src, uint8_t *dst)
+    {
+        ccvt_yuyv_rgb24(width, height, src, dst);
+    }), 0xea81514f3f134f99ull);
+    EXPECT_EQ(hashConversion<uint8_t>(yuyvSize, yuv420pSize, [](int width, int height, uint8_t *src, uint8_t *dst)
+    {
+        const size_t pixels = static_cast<size_t>(width) * height;
+        ccvt_yuyv_420p(width, height, src, dst, dst + pixels, dst + pixels + (width / 2) * (height / 2));
+    }), 0x44e15b7fc5ab243eull);
+}
+
+TEST_F(CcvtTest, DemosaicsMatchFormerOutput)
+{
+    EXPECT_EQ(hashConversion<uint8_t>(bayerSize, rgb24Size, [](int width, int height, uint8_t *src, uint8_t *dst)
+    {
+        bayer2rgb24(dst, src, width, height);
+    }), 0xf20a6da18da3d208ull);
+    EXPECT_EQ(hashConversion<uint8_t>(bayerSize, rgb24Size, [](int width, int height, uint8_t *src, uint8_t *dst)
+    {
+        bayer_rggb_2rgb24(dst, src, width, height);
+    }), 0xc70083723c08a2d4ull);
+    EXPECT_EQ(hashConversion<uint8_t>(bayerSize, rgb24Size, [](int width, int height, uint8_t *src, uint8_t *dst)
+    {
+        bayer_grbg_to_rgb24(dst, src, width, height);
+    }), 0x7480c321990ba450ull);
+    EXPECT_EQ(hashConversion<uint16_t>(bayerSize, rgb24Size, [](int width, int height, uint16_t *src, uint16_t *dst)
+    {
+        bayer16_2_rgb24(dst, src, width, height);
+    }), 0xe4042d0c386159adull);
+}
+
+TEST_F(CcvtTest, ConversionsDoNotDependOnThreads)
+{
+    const int width = 1280, height = 960;
+    std::vector<uint8_t> bayer = randomFrame<uint8_t>(width * (height + 2), 5);
+    std::vector<uint8_t> serial(width * height * 3), parallel(width * height * 3);
+
+    dsp_max_threads(1);
+    bayer_grbg_to_rgb24(serial.data(), bayer.data() + width, width, height);
+    dsp_max_threads(4);
+    bayer_grbg_to_rgb24(parallel.data(), bayer.data() + width, width, height);
+    EXPECT_EQ(serial, parallel);
+
+    std::vector<uint8_t> yuyv = randomFrame<uint8_t>(width * height * 2, 6);
+    dsp_max_threads(1);
+    ccvt_yuyv_rgb24(width, height, yuyv.data(), serial.data());
+    dsp_max_threads(4);
+    ccvt_yuyv_rgb24(width, height, yuyv.data(), parallel.data());
+    EXPECT_EQ(serial, parallel);
+}
@@ -0,0 +1,130 @@
+/*
+    Copyright (C) 2026 by Jasem Mutlaq <mutlaqja@ikarustech.com>
+
+    V4L2 builtin decoder tests
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "dsp.h"
+#include "webcam/v4l2_decode/v4l2_builtin_decoder.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+/*
+ * Hash of the RGB and Y/U/V buffers of a frame of random bytes decoded in a format, the rows of the frame padded as
+ * drivers do. The crop, if any, is done by the decoder.
+ */
+static uint64_t hashDecoded(uint32_t format, unsigned int width, unsigned int height, unsigned int bytesPerPixel,
+                            const v4l2_rect *crop = nullptr)
+{
+    V4L2_Builtin_Decoder decoder;
+    decoder.init();
+    decoder.setQuantization(false);
+    decoder.setLinearization(false);
+
+    v4l2_format f;
+    memset(&f, 0, sizeof(f));
+    f.type                 = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    f.fmt.pix.pixelformat  = format;
+    f.fmt.pix.width        = width;
+    f.fmt.pix.height       = height;
+    f.fmt.pix.bytesperline = width * bytesPerPixel + 24;
+    decoder.setformat(f, false);
+    if (crop)
+    {
+        v4l2_crop c;
+        memset(&c, 0, sizeof(c));
+        c.c = *crop;
+        decoder.usesoftcrop(true);
+        decoder.setcrop(c);
+        width  = crop->width;
+        height = crop->height;
+    }
+
+    // The GRBG demosaic reads a row before the frame
+    std::vector<uint8_t> frame(f.fmt.pix.bytesperline * (f.fmt.pix.height * 2 + 1));
+    uint32_t seed = format ^ width;
+    for (auto &value : frame)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        value = static_cast<uint8_t>(seed >> 16);
+    }
+
+    v4l2_buffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    buffer.bytesused = frame.size() - f.fmt.pix.bytesperline;
+    decoder.decode(frame.data() + f.fmt.pix.bytesperline, &buffer, false);
+
+    uint64_t hash = fnv1a(14695981039346656037ull, decoder.getRGBBuffer(), width * height * 3);
+    hash = fnv1a(hash, decoder.getY(), width * height);
+    hash = fnv1a(hash, decoder.getU(), (width / 2) * (height / 2));
+    return fnv1a(hash, decoder.getV(), (width / 2) * (height / 2));
+}
+
+class V4L2DecoderTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            threads = dsp_max_threads(0);
+            dsp_max_threads(4);
+        }
+
+        void TearDown() override
+        {
+            dsp_max_threads(threads);
+        }
+
+        unsigned long threads { 1 };
+};
+
+// The hashes are the ones of the former byte at a time decoder, the frames are large enough to be decoded in strips
+TEST_F(V4L2DecoderTest, DecodingMatchesFormerOutput)
+{
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_YUYV, 1280, 960, 2), 0xfb570e3916b66705ull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_UYVY, 1280, 960, 2), 0xc54e91eb06bb6e73ull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_VYUY, 1280, 960, 2), 0x9389ccd2e1cf5510ull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_YVYU, 1280, 960, 2), 0x97bd898bdb40adb7ull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_RGB555, 1280, 960, 2), 0x1b8ebb7bb974d8b3ull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_RGB565, 1280, 960, 2), 0x77d81f67518afe61ull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_NV12, 1280, 960, 1), 0xcee0a4e1af9d2cbeull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_NV21, 1280, 960, 1), 0x79aa932eef212be7ull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_SBGGR8, 1280, 960, 1), 0xe3eb897e9150ff5full);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_SRGGB8, 1280, 960, 1), 0xc80d32925b23893dull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_SGRBG8, 1280, 960, 1), 0x5361e9cdd8c1232eull);
+}
+
+TEST_F(V4L2DecoderTest, SoftCropMatchesFormerOutput)
+{
+    const v4l2_rect crop = { 6, 4, 322, 240 };
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_UYVY, 642, 480, 2, &crop), 0xee53614193f37ee6ull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_YVYU, 642, 480, 2, &crop), 0x5ed94d1fa1321c00ull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_RGB565, 642, 480, 2, &crop), 0x840fe840e0871b28ull);
+    EXPECT_EQ(hashDecoded(V4L2_PIX_FMT_NV12, 642, 480, 1, &crop), 0xdd91ed2755464b7full);
+}